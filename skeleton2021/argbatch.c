@@ -0,0 +1,209 @@
+#include <assert.h>
+#include <errno.h>
+#include <limits.h> // PATH_MAX
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "argbatch.h"
+#include "command.h"
+#include "pathindex.h"
+#include "vars.h"
+
+#define ARGBATCH_NAME "batch"
+
+/* Margen que se deja libre en ARG_MAX (xargs usa 2048): el kernel también
+ * guarda ahí la ruta del ejecutable y algunos punteros
+ */
+#define ARG_MARGIN 4096u
+
+/* Lo que ocupa un argumento en el execve */
+static size_t arg_size(const char* arg) {
+    return strlen(arg) + 1u + sizeof(char*);
+}
+
+bool argbatch_is_prefix(const scommand cmd) {
+    assert(cmd != NULL);
+
+    return !scommand_is_empty(cmd) &&
+           strcmp(scommand_front(cmd), ARGBATCH_NAME) == 0;
+}
+
+size_t argbatch_limit(void) {
+    long arg_max = sysconf(_SC_ARG_MAX);
+    size_t limit = arg_max > 0 ? (size_t)arg_max : 131072u;
+    size_t used = ARG_MARGIN + sizeof(char*); // el NULL del entorno
+    for (char* const* var = vars_envp(); *var != NULL; var++) {
+        used += arg_size(*var);
+    }
+    return used < limit ? limit - used : 0u;
+}
+
+size_t argbatch_fit(char* const* args, size_t count, size_t limit) {
+    assert(args != NULL || count == 0u);
+
+    size_t used = 0u;
+    size_t fit = 0u;
+    while (fit < count && used + arg_size(args[fit]) <= limit) {
+        used += arg_size(args[fit]);
+        fit++;
+    }
+    return fit;
+}
+
+/* Lee un número de opción.
+ * Returns: false si no es un número
+ */
+static bool parse_number(const char* text, size_t* number) {
+    char* end = NULL;
+    errno = 0;
+    unsigned long value = text != NULL ? strtoul(text, &end, 10) : 0ul;
+    if (text == NULL || end == text || *end != '\0' || errno != 0 ||
+        text[0] == '-') {
+        return false;
+    }
+    *number = (size_t)value;
+    return true;
+}
+
+/* Estado de salida de una invocación, a partir del de wait */
+static int exit_code(int wstatus) {
+    return WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : 128 + WTERMSIG(wstatus);
+}
+
+/* Suma el estado de una invocación al estado combinado */
+static int combine(int combined, int code) {
+    if (code == 0) {
+        return combined;
+    }
+    if (code < 126) {
+        code = ARGBATCH_FAILED;
+    }
+    return code > combined ? code : combined;
+}
+
+/* Lanza una invocación con argv (terminado en NULL).
+ * Returns: el pid, o -1 si no se pudo hacer fork
+ */
+static pid_t launch(char** argv) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+    } else if (pid == 0) {
+        char path[PATH_MAX];
+        if (pathindex_resolve(argv[0], path, sizeof(path))) {
+            execvp(path, argv);
+        }
+        execvp(argv[0], argv);
+        // Escribir el mensaje puede cambiar errno
+        int error = errno;
+        fprintf(stderr, "%s: %s\n", argv[0], strerror(error));
+        _exit(ARGBATCH_EXEC_STATUS(error));
+    }
+    return pid;
+}
+
+int argbatch_exec(const scommand cmd) {
+    assert(cmd != NULL && argbatch_is_prefix(cmd));
+
+    char** argv = scommand_get_argv(cmd);
+    if (argv == NULL) {
+        perror("Error fatal: calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // Opciones
+    size_t jobs = 1u, fixed = 0u, size_limit = 0u;
+    unsigned int i = 1u;
+    bool ok = true;
+    while (ok && argv[i] != NULL && argv[i][0] == '-' &&
+           argv[i][1] != '\0') {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        }
+        size_t* option = strcmp(argv[i], "-j") == 0   ? &jobs
+                         : strcmp(argv[i], "-f") == 0 ? &fixed
+                         : strcmp(argv[i], "-s") == 0 ? &size_limit
+                                                      : NULL;
+        ok = option != NULL && parse_number(argv[i + 1u], option);
+        i += 2u;
+    }
+    size_t count = 0u;
+    while (ok && argv[i + count] != NULL) {
+        count++;
+    }
+    if (!ok || count == 0u || fixed >= count) {
+        fprintf(stderr, "mybash: batch: uso: batch [-j N] [-s BYTES] [-f K] "
+                        "cmd arg...\n");
+        free(argv);
+        return ARGBATCH_USAGE;
+    }
+    if (jobs == 0u) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = cpus > 0 ? (size_t)cpus : 1u;
+    }
+
+    // Lo que se repite en cada invocación: cmd, los K fijos y el NULL
+    char** head = argv + i;
+    size_t head_count = fixed + 1u;
+    size_t limit = argbatch_limit();
+    if (size_limit > 0u && size_limit < limit) {
+        limit = size_limit;
+    }
+    size_t head_size = sizeof(char*);
+    for (size_t k = 0u; k < head_count; k++) {
+        head_size += arg_size(head[k]);
+    }
+    limit = head_size < limit ? limit - head_size : 0u;
+
+    char** args = head + head_count;
+    size_t args_count = count - head_count;
+    char** batch = malloc((count + 1u) * sizeof(char*));
+    if (batch == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(batch, head, head_count * sizeof(char*));
+
+    int combined = 0;
+    size_t running = 0u;
+    size_t next = 0u;
+    do {
+        size_t fit = argbatch_fit(args + next, args_count - next, limit);
+        if (fit == 0u && next < args_count) {
+            // No entra ni solo: que execve lo diga (E2BIG)
+            fit = 1u;
+        }
+        memcpy(batch + head_count, args + next, fit * sizeof(char*));
+        batch[head_count + fit] = NULL;
+        next += fit;
+
+        if (running == jobs) {
+            int wstatus = 0;
+            if (wait(&wstatus) > 0) {
+                combined = combine(combined, exit_code(wstatus));
+                running--;
+            }
+        }
+        if (launch(batch) > 0) {
+            running++;
+        } else {
+            combined = combine(combined, EXIT_FAILURE);
+        }
+    } while (next < args_count);
+
+    while (running > 0u) {
+        int wstatus = 0;
+        if (wait(&wstatus) <= 0) {
+            break;
+        }
+        combined = combine(combined, exit_code(wstatus));
+        running--;
+    }
+    free(batch);
+    free(argv);
+    return combined;
+}
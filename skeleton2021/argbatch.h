@@ -0,0 +1,71 @@
+/* Ejecución de un comando en tandas de argumentos: el prefijo "batch".
+ *
+ *   batch [-j N] [-s BYTES] [-f K] cmd arg...
+ *
+ * ejecuta cmd varias veces repartiendo los arg, con tantos en cada
+ * invocación como entren en el límite del kernel para execve (ARG_MAX, que
+ * cuenta argv y el entorno juntos). Así un glob que da más archivos de los
+ * que acepta execve (E2BIG) funciona igual, sin xargs ni el pipe extra:
+ *   - -f K: los primeros K arg se repiten en todas las invocaciones (en
+ *     "batch -f 1 grep patron *.c" el patrón va en cada una).
+ *   - -j N: hasta N invocaciones a la vez (1, lo inicial, es una después de
+ *     la otra; 0 es una por CPU). El orden de las tandas se respeta al
+ *     lanzarlas, pero con N > 1 las salidas se pueden mezclar.
+ *   - -s BYTES: límite propio, menor que el del kernel.
+ * Sin arg, cmd se ejecuta una vez.
+ *
+ * El estado final combina los de todas las invocaciones: 0 si todas
+ * terminan bien, 123 si alguna falla (como xargs), y si alguna no se pudo
+ * ejecutar (126 o 127) o terminó por una señal (128 + n), el mayor de esos.
+ */
+
+#ifndef _ARGBATCH_H_
+#define _ARGBATCH_H_
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "command.h"
+
+/* Estado si algún comando falla, y si el uso de batch es incorrecto */
+#define ARGBATCH_FAILED 123
+#define ARGBATCH_USAGE 2
+
+/* Estado de un comando cuyo exec falla con `error' (un errno), como en sh:
+ * 127 si no se encontró, 126 si no se pudo ejecutar
+ */
+#define ARGBATCH_EXEC_STATUS(error) ((error) == ENOENT ? 127 : 126)
+
+/* Sugerencia cuando un exec falla con E2BIG (printf, con el comando) */
+#define ARGBATCH_HINT                                                          \
+    "mybash: se pueden repartir los argumentos con batch %s ...\n"
+
+/*
+ * Indica si el comando empieza con el prefijo batch.
+ * Requires: cmd != NULL
+ */
+bool argbatch_is_prefix(const scommand cmd);
+
+/*
+ * Bytes disponibles para argv en un execve con el entorno actual: ARG_MAX
+ * menos lo que ocupa el entorno (cadenas y punteros) y un margen.
+ */
+size_t argbatch_limit(void);
+
+/*
+ * Cuántos de los `count' argumentos de `args' entran, empezando por el
+ * primero, en `limit' bytes (cada uno ocupa su largo, el '\0' y su puntero).
+ * Requires: args != NULL || count == 0
+ */
+size_t argbatch_fit(char* const* args, size_t count, size_t limit);
+
+/*
+ * Ejecuta el comando batch `cmd' (sin hacer sus redirecciones, que son de
+ * todas las invocaciones) y espera a que terminen todas.
+ * Returns: el estado combinado, o ARGBATCH_USAGE si el uso es incorrecto
+ * Requires: cmd != NULL && argbatch_is_prefix(cmd)
+ */
+int argbatch_exec(const scommand cmd);
+
+#endif
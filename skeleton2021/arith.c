@@ -0,0 +1,857 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arith.h"
+#include "vars.h"
+
+/* Instrucciones de la máquina de pila */
+typedef enum {
+    OP_NUMBER, // apila value
+    OP_LOAD,   // apila la variable que empieza en names + value
+    OP_STORE,  // guarda el tope en esa variable (y lo deja)
+    OP_PID,    // apila $$
+    OP_STATUS, // apila $?
+    OP_DUP,    // apila otra vez el tope
+    OP_POP,    // desapila
+    OP_BOOL,   // tope != 0
+    OP_NEG,    // los unarios cambian el tope
+    OP_NOT,
+    OP_BITNOT,
+    OP_MUL, // los binarios desapilan dos y apilan el resultado
+    OP_DIV,
+    OP_MOD,
+    OP_ADD,
+    OP_SUB,
+    OP_SHL,
+    OP_SHR,
+    OP_POW,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_AND,
+    OP_XOR,
+    OP_OR,
+    OP_JUMP,         // sigue en la instrucción value
+    OP_JUMP_ZERO,    // desapila, y si es 0 sigue en la instrucción value
+    OP_JUMP_NONZERO, // desapila, y si no es 0 sigue en la instrucción value
+} opcode;
+
+struct op {
+    opcode code;
+    int64_t value;
+};
+
+/* Una expresión compilada, guardada en el cache */
+struct program {
+    char* text; // el texto de la expresión (la clave del cache)
+    size_t length;
+    uint64_t hash;
+    struct op* ops;
+    size_t count;
+    char* names; // nombres de las variables, cada uno terminado en '\0'
+};
+
+/* Pila de la evaluación que no necesita malloc */
+#define SMALL_STACK 32u
+
+static struct program* cache[ARITH_CACHE];
+static unsigned long hits = 0u;
+static unsigned long misses = 0u;
+
+/********** COMPILADOR **********/
+
+typedef enum {
+    TOK_END,
+    TOK_NUMBER,
+    TOK_NAME,    // NOMBRE, $NOMBRE o ${NOMBRE}
+    TOK_SPECIAL, // $$ o $?
+    TOK_OPERATOR,
+    TOK_INVALID,
+} token_kind;
+
+typedef struct {
+    token_kind kind;
+    const char* start;
+    size_t length;
+    const char* op; // TOK_OPERATOR: el de la tabla operators
+    int64_t number; // TOK_NUMBER: el valor; TOK_SPECIAL: el caracter
+} token;
+
+typedef struct {
+    const char* pos;
+    const char* end;
+    token current;
+    struct op* ops;
+    size_t count;
+    size_t capacity;
+    char* names;
+    size_t names_length;
+    const char* error; // el primer error, o NULL
+} compiler;
+
+/* Los de más de un caracter primero, para que gane el más largo */
+static const char* const operators[] = {
+    "<<=", ">>=", "**", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+    "++",  "--",  "+=", "-=", "*=", "/=", "%=", "&=", "^=", "|=", "+",
+    "-",   "*",   "/",  "%",  "<",  ">",  "&",  "^",  "|",  "!",  "~",
+    "?",   ":",   "=",  ",",  "(",  ")"};
+
+/* Operadores binarios, por precedencia (de menor a mayor). && y || no
+ * tienen instrucción: se compilan con saltos.
+ */
+static const struct binary {
+    const char* op;
+    unsigned int precedence;
+    opcode code;
+} binaries[] = {
+    {"||", 1u, OP_JUMP_NONZERO}, {"&&", 2u, OP_JUMP_ZERO}, {"|", 3u, OP_OR},
+    {"^", 4u, OP_XOR},           {"&", 5u, OP_AND},        {"==", 6u, OP_EQ},
+    {"!=", 6u, OP_NE},           {"<", 7u, OP_LT},         {"<=", 7u, OP_LE},
+    {">", 7u, OP_GT},            {">=", 7u, OP_GE},        {"<<", 8u, OP_SHL},
+    {">>", 8u, OP_SHR},          {"+", 9u, OP_ADD},        {"-", 9u, OP_SUB},
+    {"*", 10u, OP_MUL},          {"/", 10u, OP_DIV},       {"%", 10u, OP_MOD},
+    {"**", 11u, OP_POW}};
+
+/* Asignaciones compuestas: la instrucción del operador sin el '=' */
+static const struct binary assignments[] = {
+    {"*=", 0u, OP_MUL},  {"/=", 0u, OP_DIV},  {"%=", 0u, OP_MOD},
+    {"+=", 0u, OP_ADD},  {"-=", 0u, OP_SUB},  {"<<=", 0u, OP_SHL},
+    {">>=", 0u, OP_SHR}, {"&=", 0u, OP_AND},  {"^=", 0u, OP_XOR},
+    {"|=", 0u, OP_OR}};
+
+static bool is_name_start(char c) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool is_name_char(char c) {
+    return is_name_start(c) || (c >= '0' && c <= '9');
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n';
+}
+
+/* Valor del dígito c, o 99 si no es un dígito */
+static unsigned int digit_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return (unsigned int)(c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+        return (unsigned int)(c - 'a') + 10u;
+    } else if (c >= 'A' && c <= 'F') {
+        return (unsigned int)(c - 'A') + 10u;
+    }
+    return 99u;
+}
+
+/* Lee un número sin signo que empieza en pos (un dígito).
+ * Returns: dónde termina, o NULL si no es un número válido
+ */
+static const char* read_number(const char* pos, const char* end,
+                               int64_t* result) {
+    unsigned int base = 10u;
+    if (pos + 1 < end && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X')) {
+        base = 16u;
+        pos += 2;
+        if (pos == end || digit_value(*pos) >= base) {
+            return NULL;
+        }
+    } else if (*pos == '0') {
+        base = 8u;
+    }
+    uint64_t value = 0u; // los desbordes dan la vuelta
+    while (pos < end && is_name_char(*pos)) {
+        unsigned int digit = digit_value(*pos);
+        if (digit >= base) {
+            return NULL;
+        }
+        value = value * base + digit;
+        pos++;
+    }
+    *result = (int64_t)value;
+    return pos;
+}
+
+static void set_error(compiler* c, const char* message) {
+    if (c->error == NULL) {
+        c->error = message;
+    }
+}
+
+/* Lee el siguiente token en c->current */
+static void next_token(compiler* c) {
+    while (c->pos < c->end && is_space(*c->pos)) {
+        c->pos++;
+    }
+    token tok = {TOK_END, c->pos, 0u, NULL, 0};
+    const char* pos = c->pos;
+    const char* end = c->end;
+    if (pos == end) {
+        c->current = tok;
+        return;
+    }
+
+    if (*pos == '$' && pos + 1 < end && pos[1] == '(') {
+        // $(( adentro de la expresión es un paréntesis más
+        pos++;
+        tok.start = pos;
+    }
+    if (*pos >= '0' && *pos <= '9') {
+        const char* next = read_number(pos, end, &tok.number);
+        tok.kind = next != NULL ? TOK_NUMBER : TOK_INVALID;
+        pos = next != NULL ? next : pos + 1;
+    } else if (is_name_start(*pos)) {
+        tok.kind = TOK_NAME;
+        pos++;
+        while (pos < end && is_name_char(*pos)) {
+            pos++;
+        }
+    } else if (*pos == '$') {
+        pos++;
+        tok.kind = TOK_INVALID;
+        if (pos < end && (*pos == '$' || *pos == '?')) {
+            tok.kind = TOK_SPECIAL;
+            tok.number = *pos;
+            pos++;
+        } else if (pos < end && is_name_start(*pos)) {
+            tok.kind = TOK_NAME;
+            tok.start = pos;
+            while (pos < end && is_name_char(*pos)) {
+                pos++;
+            }
+        } else if (pos + 1 < end && *pos == '{' && is_name_start(pos[1])) {
+            const char* name = pos + 1;
+            pos = name;
+            while (pos < end && is_name_char(*pos)) {
+                pos++;
+            }
+            if (pos < end && *pos == '}') {
+                tok.kind = TOK_NAME;
+                tok.start = name;
+                tok.length = (size_t)(pos - name);
+                pos++;
+            }
+        }
+    } else {
+        tok.kind = TOK_INVALID;
+        for (size_t i = 0u; i < sizeof(operators) / sizeof(*operators); i++) {
+            size_t length = strlen(operators[i]);
+            if ((size_t)(end - pos) >= length &&
+                memcmp(pos, operators[i], length) == 0) {
+                tok.kind = TOK_OPERATOR;
+                tok.op = operators[i];
+                pos += length;
+                break;
+            }
+        }
+        if (tok.kind == TOK_INVALID) {
+            pos++;
+        }
+    }
+    if (tok.length == 0u) { // ${NOMBRE} ya tiene el largo del nombre
+        tok.length = (size_t)(pos - tok.start);
+    }
+    if (tok.kind == TOK_INVALID) {
+        set_error(c, "caracter o número inválido");
+    }
+    c->pos = pos;
+    c->current = tok;
+}
+
+static bool is_operator(const compiler* c, const char* op) {
+    return c->current.kind == TOK_OPERATOR && strcmp(c->current.op, op) == 0;
+}
+
+/* Agrega una instrucción.
+ * Returns: su posición (para completar los saltos)
+ */
+static size_t emit(compiler* c, opcode code, int64_t value) {
+    if (c->count == c->capacity) {
+        c->capacity = c->capacity > 0u ? 2u * c->capacity : 16u;
+        c->ops = realloc(c->ops, c->capacity * sizeof(struct op));
+        if (c->ops == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    c->ops[c->count] = (struct op){code, value};
+    c->count++;
+    return c->count - 1u;
+}
+
+/* Hace que el salto de la instrucción `jump' vaya a la siguiente que se
+ * agregue
+ */
+static void patch(compiler* c, size_t jump) {
+    c->ops[jump].value = (int64_t)c->count;
+}
+
+/* Guarda el nombre del token actual.
+ * Returns: su posición en c->names
+ */
+static int64_t add_name(compiler* c) {
+    size_t length = c->current.length;
+    size_t offset = c->names_length;
+    char* names = realloc(c->names, offset + length + 1u);
+    if (names == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(names + offset, c->current.start, length);
+    names[offset + length] = '\0';
+    c->names = names;
+    c->names_length = offset + length + 1u;
+    return (int64_t)offset;
+}
+
+/* Indica si lo último que se compiló desde `start' es solo una variable, y
+ * entonces se le puede asignar
+ */
+static bool is_lvalue(const compiler* c, size_t start) {
+    return c->count == start + 1u && c->ops[start].code == OP_LOAD;
+}
+
+static void compile_assignment(compiler* c);
+
+/* Compila la expresión con comas */
+static void compile_expression(compiler* c) {
+    compile_assignment(c);
+    while (c->error == NULL && is_operator(c, ",")) {
+        next_token(c);
+        emit(c, OP_POP, 0);
+        compile_assignment(c);
+    }
+}
+
+/* Operandos y paréntesis, seguidos de ++ o -- */
+static void compile_postfix(compiler* c) {
+    size_t start = c->count;
+    token tok = c->current;
+    if (tok.kind == TOK_NUMBER) {
+        emit(c, OP_NUMBER, tok.number);
+        next_token(c);
+    } else if (tok.kind == TOK_NAME) {
+        emit(c, OP_LOAD, add_name(c));
+        next_token(c);
+    } else if (tok.kind == TOK_SPECIAL) {
+        emit(c, tok.number == '$' ? OP_PID : OP_STATUS, 0);
+        next_token(c);
+    } else if (is_operator(c, "(")) {
+        next_token(c);
+        compile_expression(c);
+        if (!is_operator(c, ")")) {
+            set_error(c, "falta ')'");
+        }
+        next_token(c);
+        return;
+    } else {
+        set_error(c, "falta un operando");
+        return;
+    }
+
+    if (is_lvalue(c, start) && (is_operator(c, "++") || is_operator(c, "--"))) {
+        // Queda el valor anterior
+        int64_t name = c->ops[start].value;
+        emit(c, OP_DUP, 0);
+        emit(c, OP_NUMBER, 1);
+        emit(c, is_operator(c, "++") ? OP_ADD : OP_SUB, 0);
+        emit(c, OP_STORE, name);
+        emit(c, OP_POP, 0);
+        next_token(c);
+    }
+}
+
+static void compile_unary(compiler* c) {
+    if (is_operator(c, "++") || is_operator(c, "--")) {
+        opcode code = is_operator(c, "++") ? OP_ADD : OP_SUB;
+        next_token(c);
+        if (c->current.kind != TOK_NAME) {
+            set_error(c, "falta una variable");
+            return;
+        }
+        int64_t name = add_name(c);
+        emit(c, OP_LOAD, name);
+        emit(c, OP_NUMBER, 1);
+        emit(c, code, 0);
+        emit(c, OP_STORE, name);
+        next_token(c);
+    } else if (is_operator(c, "-") || is_operator(c, "!") ||
+               is_operator(c, "~")) {
+        opcode code = is_operator(c, "-")   ? OP_NEG
+                      : is_operator(c, "!") ? OP_NOT
+                                            : OP_BITNOT;
+        next_token(c);
+        compile_unary(c);
+        emit(c, code, 0);
+    } else if (is_operator(c, "+")) {
+        next_token(c);
+        compile_unary(c);
+    } else {
+        compile_postfix(c);
+    }
+}
+
+/* El operador binario del token actual, o NULL si no hay */
+static const struct binary* current_binary(const compiler* c) {
+    for (size_t i = 0u; i < sizeof(binaries) / sizeof(*binaries); i++) {
+        if (is_operator(c, binaries[i].op)) {
+            return &binaries[i];
+        }
+    }
+    return NULL;
+}
+
+/* Precedence climbing: compila los operadores binarios de precedencia
+ * mayor o igual a `min'
+ */
+static void compile_binary(compiler* c, unsigned int min) {
+    compile_unary(c);
+    const struct binary* op = current_binary(c);
+    while (c->error == NULL && op != NULL && op->precedence >= min) {
+        next_token(c);
+        if (op->code == OP_JUMP_ZERO || op->code == OP_JUMP_NONZERO) {
+            // a && b: si a es 0 el resultado es 0 sin evaluar b
+            size_t jump = emit(c, op->code, 0);
+            compile_binary(c, op->precedence + 1u);
+            emit(c, OP_BOOL, 0);
+            size_t done = emit(c, OP_JUMP, 0);
+            patch(c, jump);
+            emit(c, OP_NUMBER, op->code == OP_JUMP_NONZERO ? 1 : 0);
+            patch(c, done);
+        } else {
+            // ** es asociativo a derecha
+            compile_binary(c, op->code == OP_POW ? op->precedence
+                                                 : op->precedence + 1u);
+            emit(c, op->code, 0);
+        }
+        op = current_binary(c);
+    }
+}
+
+static void compile_conditional(compiler* c) {
+    compile_binary(c, 1u);
+    if (c->error == NULL && is_operator(c, "?")) {
+        next_token(c);
+        size_t otherwise = emit(c, OP_JUMP_ZERO, 0);
+        compile_expression(c);
+        size_t done = emit(c, OP_JUMP, 0);
+        if (!is_operator(c, ":")) {
+            set_error(c, "falta ':'");
+        }
+        next_token(c);
+        patch(c, otherwise);
+        compile_assignment(c);
+        patch(c, done);
+    }
+}
+
+/* Asignaciones (asociativas a derecha) */
+static void compile_assignment(compiler* c) {
+    size_t start = c->count;
+    compile_conditional(c);
+    if (c->error != NULL || c->current.kind != TOK_OPERATOR) {
+        return;
+    }
+    const struct binary* compound = NULL;
+    for (size_t i = 0u; i < sizeof(assignments) / sizeof(*assignments); i++) {
+        if (is_operator(c, assignments[i].op)) {
+            compound = &assignments[i];
+        }
+    }
+    if (compound == NULL && !is_operator(c, "=")) {
+        return;
+    }
+    if (!is_lvalue(c, start)) {
+        set_error(c, "se asigna algo que no es una variable");
+        return;
+    }
+    int64_t name = c->ops[start].value;
+    if (compound == NULL) {
+        c->count = start; // no hace falta el valor anterior
+    }
+    next_token(c);
+    compile_assignment(c);
+    if (compound != NULL) {
+        emit(c, compound->code, 0);
+    }
+    emit(c, OP_STORE, name);
+}
+
+/* FNV-1a de 64 bits */
+static uint64_t text_hash(const char* text, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0u; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static void print_error(const char* text, size_t length, const char* message) {
+    fprintf(stderr, "mybash: %.*s: %s\n", (int)length, text, message);
+}
+
+static struct program* program_destroy(struct program* program) {
+    free(program->text);
+    free(program->ops);
+    free(program->names);
+    free(program);
+    return NULL;
+}
+
+/* Compila la expresión.
+ * Returns: el programa, o NULL si tiene un error (que ya se imprimió)
+ */
+static struct program* compile(const char* text, size_t length,
+                               uint64_t hash) {
+    compiler c = {text, text + length, {TOK_END, text, 0u, NULL, 0},
+                  NULL, 0u, 0u, NULL, 0u, NULL};
+    next_token(&c);
+    if (c.current.kind == TOK_END) {
+        emit(&c, OP_NUMBER, 0); // $(( )) es 0
+    } else {
+        compile_expression(&c);
+        if (c.error == NULL && c.current.kind != TOK_END) {
+            set_error(&c, "sobra algo al final de la expresión");
+        }
+    }
+    if (c.error != NULL) {
+        print_error(text, length, c.error);
+        free(c.ops);
+        free(c.names);
+        return NULL;
+    }
+
+    struct program* program = malloc(sizeof(struct program));
+    char* copy = malloc(length + 1u);
+    if (program == NULL || copy == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    if (length > 0u) {
+        memcpy(copy, text, length);
+    }
+    copy[length] = '\0';
+    *program =
+        (struct program){copy, length, hash, c.ops, c.count, c.names};
+    return program;
+}
+
+/* El programa de la expresión, del cache o compilándolo */
+static struct program* lookup(const char* text, size_t length) {
+    uint64_t hash = text_hash(text, length);
+    struct program** slot = &cache[hash % ARITH_CACHE];
+    struct program* program = *slot;
+    if (program != NULL && program->hash == hash &&
+        program->length == length &&
+        (length == 0u || memcmp(program->text, text, length) == 0)) {
+        hits++;
+        return program;
+    }
+    misses++;
+    program = compile(text, length, hash);
+    if (program != NULL) {
+        if (*slot != NULL) {
+            program_destroy(*slot);
+        }
+        *slot = program;
+    }
+    return program;
+}
+
+/********** EVALUACIÓN **********/
+
+static bool evaluate(const char* text, size_t length, unsigned int depth,
+                     int64_t* result);
+
+/* Valor de la variable `name': 0 si no tiene, el número si es uno, y si no
+ * el resultado de evaluarla como expresión
+ */
+static bool load(const char* name, unsigned int depth, int64_t* result) {
+    const char* value = vars_get(name);
+    if (value == NULL) {
+        *result = 0;
+        return true;
+    }
+    const char* pos = value;
+    const char* end = value + strlen(value);
+    while (pos < end && is_space(*pos)) {
+        pos++;
+    }
+    bool negative = pos < end && *pos == '-';
+    const char* digits = negative ? pos + 1 : pos;
+    const char* next = NULL;
+    int64_t number = 0;
+    if (digits < end && *digits >= '0' && *digits <= '9') {
+        next = read_number(digits, end, &number);
+        while (next != NULL && next < end && is_space(*next)) {
+            next++;
+        }
+    }
+    if (next == end) {
+        *result = negative ? (int64_t)(0u - (uint64_t)number) : number;
+        return true;
+    }
+    if (depth >= ARITH_MAX_DEPTH) {
+        print_error(value, strlen(value), "demasiados niveles de variables");
+        return false;
+    }
+    // vars_get deja de valer si la expresión asigna algo
+    size_t size = strlen(value);
+    char* copy = malloc(size + 1u);
+    if (copy == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, value, size + 1u);
+    bool ok = evaluate(copy, size, depth + 1u, result);
+    free(copy);
+    return ok;
+}
+
+static void store(const char* name, int64_t value) {
+    char number[32];
+    snprintf(number, sizeof(number), "%" PRId64, value);
+    vars_set(name, number);
+}
+
+/* a ** b, con b >= 0 */
+static int64_t power(int64_t base, int64_t exponent) {
+    uint64_t result = 1u;
+    uint64_t factor = (uint64_t)base;
+    uint64_t e = (uint64_t)exponent;
+    while (e > 0u) {
+        if (e & 1u) {
+            result *= factor;
+        }
+        factor *= factor;
+        e >>= 1;
+    }
+    return (int64_t)result;
+}
+
+/* Aplica el operador binario `code' a a y b.
+ * Returns: el mensaje de error, o NULL
+ */
+static const char* binary_op(opcode code, int64_t a, int64_t b,
+                             int64_t* result) {
+    uint64_t ua = (uint64_t)a;
+    uint64_t ub = (uint64_t)b;
+    switch (code) {
+    case OP_MUL:
+        *result = (int64_t)(ua * ub);
+        break;
+    case OP_DIV:
+    case OP_MOD:
+        if (b == 0) {
+            return "división por cero";
+        }
+        if (a == INT64_MIN && b == -1) {
+            *result = code == OP_DIV ? INT64_MIN : 0;
+        } else {
+            *result = code == OP_DIV ? a / b : a % b;
+        }
+        break;
+    case OP_ADD:
+        *result = (int64_t)(ua + ub);
+        break;
+    case OP_SUB:
+        *result = (int64_t)(ua - ub);
+        break;
+    case OP_SHL:
+        *result = (int64_t)(ua << (ub & 63u));
+        break;
+    case OP_SHR:
+        *result = a >> (ub & 63u);
+        break;
+    case OP_POW:
+        if (b < 0) {
+            return "exponente negativo";
+        }
+        *result = power(a, b);
+        break;
+    case OP_LT:
+        *result = a < b;
+        break;
+    case OP_LE:
+        *result = a <= b;
+        break;
+    case OP_GT:
+        *result = a > b;
+        break;
+    case OP_GE:
+        *result = a >= b;
+        break;
+    case OP_EQ:
+        *result = a == b;
+        break;
+    case OP_NE:
+        *result = a != b;
+        break;
+    case OP_AND:
+        *result = a & b;
+        break;
+    case OP_XOR:
+        *result = a ^ b;
+        break;
+    case OP_OR:
+        *result = a | b;
+        break;
+    default:
+        assert(false);
+    }
+    return NULL;
+}
+
+/* Ejecuta el programa. Cada instrucción apila a lo sumo un valor, así que
+ * la pila nunca pasa de program->count.
+ */
+static bool run(const struct program* program, unsigned int depth,
+                int64_t* result) {
+    int64_t small[SMALL_STACK];
+    int64_t* stack = small;
+    if (program->count > SMALL_STACK) {
+        stack = malloc(program->count * sizeof(int64_t));
+        if (stack == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    size_t top = 0u; // cantidad de valores apilados
+    const char* error = NULL;
+    bool ok = true;
+    size_t pc = 0u;
+    while (ok && pc < program->count) {
+        struct op op = program->ops[pc];
+        pc++;
+        switch (op.code) {
+        case OP_NUMBER:
+            stack[top++] = op.value;
+            break;
+        case OP_LOAD:
+            ok = load(program->names + op.value, depth, &stack[top]);
+            top++;
+            break;
+        case OP_STORE:
+            store(program->names + op.value, stack[top - 1u]);
+            break;
+        case OP_PID:
+            stack[top++] = (int64_t)getpid();
+            break;
+        case OP_STATUS:
+            stack[top++] = vars_status();
+            break;
+        case OP_DUP:
+            stack[top] = stack[top - 1u];
+            top++;
+            break;
+        case OP_POP:
+            top--;
+            break;
+        case OP_BOOL:
+            stack[top - 1u] = stack[top - 1u] != 0;
+            break;
+        case OP_NEG:
+            stack[top - 1u] = (int64_t)(0u - (uint64_t)stack[top - 1u]);
+            break;
+        case OP_NOT:
+            stack[top - 1u] = !stack[top - 1u];
+            break;
+        case OP_BITNOT:
+            stack[top - 1u] = ~stack[top - 1u];
+            break;
+        case OP_JUMP:
+            pc = (size_t)op.value;
+            break;
+        case OP_JUMP_ZERO:
+        case OP_JUMP_NONZERO:
+            top--;
+            if ((stack[top] != 0) == (op.code == OP_JUMP_NONZERO)) {
+                pc = (size_t)op.value;
+            }
+            break;
+        default:
+            top--;
+            error = binary_op(op.code, stack[top - 1u], stack[top],
+                              &stack[top - 1u]);
+            ok = error == NULL;
+        }
+    }
+    if (error != NULL) {
+        print_error(program->text, program->length, error);
+    }
+    if (ok) {
+        assert(top == 1u);
+        *result = stack[0];
+    }
+    if (stack != small) {
+        free(stack);
+    }
+    return ok;
+}
+
+static bool evaluate(const char* text, size_t length, unsigned int depth,
+                     int64_t* result) {
+    struct program* program = lookup(text, length);
+    if (program == NULL) {
+        return false;
+    }
+    /* Una variable puede tener una expresión que reemplace a esta en el
+       cache, así que mientras se ejecuta el programa es de este llamado */
+    struct program** slot = &cache[program->hash % ARITH_CACHE];
+    *slot = NULL;
+    bool ok = run(program, depth, result);
+    if (*slot == NULL) {
+        *slot = program;
+    } else {
+        program_destroy(program);
+    }
+    return ok;
+}
+
+/********** INTERFAZ **********/
+
+bool arith_eval(const char* text, size_t length, int64_t* result) {
+    assert((text != NULL || length == 0u) && result != NULL);
+
+    return evaluate(text != NULL ? text : "", length, 0u, result);
+}
+
+const char* arith_find_end(const char* start, const char* end) {
+    assert(start != NULL && end != NULL && start <= end);
+
+    unsigned int depth = 0u;
+    for (const char* pos = start; pos < end; pos++) {
+        if (*pos == '(') {
+            depth++;
+        } else if (*pos == ')' && depth > 0u) {
+            depth--;
+        } else if (*pos == ')') {
+            return pos + 1 < end && pos[1] == ')' ? pos : NULL;
+        }
+    }
+    return NULL;
+}
+
+void arith_clear(void) {
+    for (size_t i = 0u; i < ARITH_CACHE; i++) {
+        if (cache[i] != NULL) {
+            cache[i] = program_destroy(cache[i]);
+        }
+    }
+}
+
+void arith_stats(unsigned long* hits_out, unsigned long* misses_out) {
+    if (hits_out != NULL) {
+        *hits_out = hits;
+    }
+    if (misses_out != NULL) {
+        *misses_out = misses;
+    }
+}
@@ -0,0 +1,63 @@
+/* Expansión aritmética: $(( expresión )).
+ *
+ * Las expresiones son de enteros de 64 bits con signo, con los operadores
+ * de C y sus precedencias (de menor a mayor):
+ *   ,   = *= /= %= += -= <<= >>= &= ^= |=   ?:   ||   &&   |   ^   &
+ *   == !=   < <= > >=   << >>   + -   * / %   **   + - ! ~ ++ --
+ * (** es la potencia, como en bash). Los números son decimales, octales
+ * (con 0 adelante) o hexadecimales (con 0x). Una variable (NOMBRE, $NOMBRE
+ * o ${NOMBRE}) vale 0 si no tiene valor, y si su valor no es un número se
+ * evalúa como otra expresión; $? y $$ son los de siempre. Las asignaciones
+ * y los ++ y -- cambian la variable. Los desbordes dan la vuelta, como en
+ * bash. && || y ?: no evalúan el operando que no hace falta.
+ *
+ * Cada expresión se compila una sola vez a un programa para una máquina de
+ * pila (con saltos para && || y ?:), y los programas se guardan en un cache
+ * por el texto de la expresión: en un ciclo, evaluar $((i + 1)) de nuevo
+ * no vuelve a leer el texto. El cache tiene ARITH_CACHE lugares, y una
+ * expresión nueva reemplaza a la que estaba en el suyo.
+ */
+
+#ifndef _ARITH_H_
+#define _ARITH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Cantidad de expresiones compiladas que se guardan */
+#define ARITH_CACHE 128u
+
+/* Profundidad máxima de variables cuyo valor es otra expresión */
+#define ARITH_MAX_DEPTH 32u
+
+/*
+ * Evalúa la expresión de los `length' bytes de `text'. Si tiene un error
+ * (de sintaxis, una división por cero...) se imprime en stderr.
+ * Returns: false si hubo un error, y entonces *result no cambia
+ * Requires: (text != NULL || length == 0) && result != NULL
+ */
+bool arith_eval(const char* text, size_t length, int64_t* result);
+
+/*
+ * Busca el final de una expresión aritmética que empieza en `start' (justo
+ * después de "$(("): los "))" que la cierran, salteando los paréntesis que
+ * se abren adentro.
+ * Returns: puntero al primero de los dos ')', o NULL si no se cierra antes
+ *     de `end'
+ * Requires: start != NULL && end != NULL && start <= end
+ */
+const char* arith_find_end(const char* start, const char* end);
+
+/*
+ * Vacía el cache de expresiones compiladas. Los contadores no se tocan.
+ */
+void arith_clear(void);
+
+/*
+ * Contadores de aciertos y fallos del cache. Cualquiera de los punteros
+ * puede ser NULL.
+ */
+void arith_stats(unsigned long* hits, unsigned long* misses);
+
+#endif
@@ -0,0 +1,87 @@
+/* Benchmark del índice de directorios de cd.
+ *
+ * Llena un índice con muchos directorios (que no existen, salvo uno) y mide
+ * cuánto tarda anotar una visita, y buscar con palabras y con letras
+ * salteadas. La búsqueda recorre todo el índice mapeado, así que lo que
+ * importa es que siga por debajo del milisegundo con índices grandes.
+ *
+ * Uso: ./bench-dirindex [cantidad de directorios]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dirindex.h"
+
+#define DEFAULT_DIRS 10000u
+#define QUERIES 1000u
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void measure(const char* name, char* const* words, size_t count) {
+    char result[4096];
+    bool found = false;
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < QUERIES; i++) {
+        found = dirindex_query(words, count, result, sizeof(result));
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%-24s %10.3f us/búsqueda  (%s)\n", name,
+            elapsed / QUERIES * 1e6, found ? result : "no está");
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int dirs = DEFAULT_DIRS;
+    if (argc > 1) {
+        dirs = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    char root[] = "/tmp/bench-dirindex-XXXXXX";
+    if (mkdtemp(root) == NULL) {
+        perror(root);
+        return EXIT_FAILURE;
+    }
+    char path[128];
+    snprintf(path, sizeof(path), "%s/index", root);
+    if (!dirindex_open(path)) {
+        return EXIT_FAILURE;
+    }
+
+    char dir[128];
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < dirs; i++) {
+        snprintf(dir, sizeof(dir), "%s/proyecto%u/src/modulo%u", root,
+                 i % 97u, i);
+        dirindex_visit(dir);
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%u directorios: %.3f us/visita\n", dirs,
+            elapsed / (double)dirs * 1e6);
+
+    // El único que existe
+    snprintf(dir, sizeof(dir), "%s/documentos", root);
+    mkdir(dir, 0755);
+    dirindex_visit(dir);
+
+    char* exact[] = {"documentos"};
+    char* keywords[] = {"bench", "docu"};
+    char* fuzzy[] = {"dcmnts"};
+    char* missing[] = {"nada"};
+    measure("palabra", exact, 1u);
+    measure("dos palabras", keywords, 2u);
+    measure("letras salteadas", fuzzy, 1u);
+    measure("sin coincidencias", missing, 1u);
+
+    dirindex_close();
+    rmdir(dir);
+    unlink(path);
+    rmdir(root);
+    return EXIT_SUCCESS;
+}
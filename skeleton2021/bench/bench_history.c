@@ -0,0 +1,157 @@
+/* Benchmark de la búsqueda en el historial (Ctrl-R).
+ *
+ * Llena un historial con líneas parecidas a las de una sesión real y mide
+ * cuánto tarda una búsqueda con el índice de trigramas de history.c, contra
+ * recorrer todas las líneas con strstr. Se busca tanto una cadena que está
+ * solo en las líneas más viejas (el peor caso del recorrido) como una que no
+ * está en ninguna. También se mide el costo de agregar cada línea, y el de
+ * cargar el historial al arrancar: desde la foto mapeada de histlog.c, contra
+ * leer un archivo de texto línea a línea.
+ *
+ * Uso: ./bench-history [cantidad de líneas]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "histlog.h"
+#include "history.h"
+
+#define DEFAULT_LINES 1000000u
+#define SEARCHES 100u
+
+static const char* const commands[] = {
+    "ls -l %u", "cd /tmp/dir%u", "make test%u", "git commit -m 'cambio %u'",
+    "grep -rn foo%u src", "cat archivo%u.txt | sort | uniq -c",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Lo que hacía Ctrl-R sin el índice */
+static bool linear_search(history hist, const char* query, unsigned int before,
+                          unsigned int* found) {
+    for (unsigned int n = before; n > 0u; n--) {
+        if (strstr(history_get(hist, n - 1u), query) != NULL) {
+            *found = n - 1u;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void measure(const char* name, history hist, const char* query,
+                    bool (*search)(history, const char*, unsigned int,
+                                   unsigned int*)) {
+    unsigned int found = 0u;
+    bool result = false;
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < SEARCHES; i++) {
+        result = search(hist, query, history_length(hist), &found);
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%-10s %-12s %10.3f us/búsqueda  (%s)\n", name, query,
+            elapsed / SEARCHES * 1e6, result ? "encontrada" : "no está");
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int lines = DEFAULT_LINES;
+    if (argc > 1) {
+        lines = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    history hist = history_new();
+    char line[128];
+    // La única línea con "zygote" es la primera
+    history_add(hist, "echo zygote");
+    double start = now_seconds();
+    for (unsigned int i = 1u; i < lines; i++) {
+        size_t n = sizeof(commands) / sizeof(commands[0]);
+        snprintf(line, sizeof(line), commands[i % n], i);
+        history_add(hist, line);
+    }
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%u líneas: %.3f us/línea agregada\n", lines,
+            elapsed / (double)lines * 1e6);
+
+    // La primera búsqueda arma el índice de todas las líneas
+    unsigned int found = 0u;
+    start = now_seconds();
+    history_search(hist, "zygote", history_length(hist), &found);
+    elapsed = now_seconds() - start;
+    fprintf(stderr, "primera búsqueda (arma el índice): %.3f ms\n",
+            elapsed * 1e3);
+
+    measure("índice", hist, "zygote", history_search);
+    measure("recorrido", hist, "zygote", linear_search);
+    measure("índice", hist, "xyzzy", history_search);
+    measure("recorrido", hist, "xyzzy", linear_search);
+    measure("índice", hist, "make test9", history_search);
+    measure("recorrido", hist, "make test9", linear_search);
+
+    // Carga al arrancar, con las mismas líneas (sin las que no entran en la
+    // foto)
+    char dir[] = "/tmp/bench-history-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+    char path[64], log_path[64], text_path[64];
+    snprintf(path, sizeof(path), "%s/history", dir);
+    snprintf(log_path, sizeof(log_path), "%s/history.log", dir);
+    snprintf(text_path, sizeof(text_path), "%s/history.txt", dir);
+    unsigned int first = history_length(hist) > HISTLOG_MAX_ENTRIES
+                             ? history_length(hist) - HISTLOG_MAX_ENTRIES
+                             : 0u;
+    history loaded = history_new();
+    histlog saved = histlog_open(path, loaded);
+    FILE* text = fopen(text_path, "w");
+    for (unsigned int n = first; n < history_length(hist); n++) {
+        histlog_append(saved, history_get(hist, n));
+        fprintf(text, "%s\n", history_get(hist, n));
+    }
+    fclose(text);
+    histlog_close(saved);
+    histlog_compact(path);
+    loaded = history_destroy(loaded);
+
+    loaded = history_new();
+    start = now_seconds();
+    saved = histlog_open(path, loaded);
+    elapsed = now_seconds() - start;
+    fprintf(stderr, "carga foto   %u líneas %10.3f ms\n",
+            history_length(loaded), elapsed * 1e3);
+    histlog_close(saved);
+    loaded = history_destroy(loaded);
+
+    loaded = history_new();
+    start = now_seconds();
+    text = fopen(text_path, "r");
+    char* text_line = NULL;
+    size_t text_size = 0u;
+    ssize_t read = 0;
+    while ((read = getline(&text_line, &text_size, text)) != -1) {
+        text_line[read - 1] = '\0';
+        history_add(loaded, text_line);
+    }
+    fclose(text);
+    free(text_line);
+    elapsed = now_seconds() - start;
+    fprintf(stderr, "carga texto  %u líneas %10.3f ms\n",
+            history_length(loaded), elapsed * 1e3);
+    loaded = history_destroy(loaded);
+
+    unlink(path);
+    unlink(log_path);
+    unlink(text_path);
+    rmdir(dir);
+
+    hist = history_destroy(hist);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,214 @@
+/* Benchmark de throughput del parser.
+ *
+ * Genera un script sintético en memoria, y mide cuánto tarda en parsearlo
+ * completo. Se compila dos veces: contra parser.c (bench-parser) y contra los
+ * objetos precompilados de objects-<arch> (bench-parser-prebuilt, con
+ * -DPREBUILT_PARSER), así se pueden comparar las dos implementaciones con
+ * exactamente la misma entrada. Contra parser.c además se mide la lectura
+ * desde un descriptor: un archivo regular (mmap) y un pipe (lectura en
+ * bloques), con la implementación de scan.h que se eligió, y el parseo
+ * con un linecache (el script sintético repite pocas líneas distintas).
+ *
+ * Uso: ./bench-parser [cantidad de líneas]
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "parser.h"
+#ifndef PREBUILT_PARSER
+#include "linecache.h"
+#include "scan.h"
+#endif
+
+#define DEFAULT_LINES 200000u
+#define RUNS 5u
+
+#ifdef PREBUILT_PARSER
+#define IMPLEMENTATION "prebuilt"
+#else
+#define IMPLEMENTATION "parser.c"
+#endif
+
+static const char* sample_lines[] = {
+    "ls -l /usr/lib | grep -v foo > salida.txt &\n",
+    "cat < entrada.txt | sort | uniq -c | head -n 10\n",
+    "gcc -std=gnu11 -Wall -Wextra -O2 -o programa main.c util.c parser.c\n",
+    "echo hola\n",
+    "find . -name *.c | xargs wc -l | sort -n | tail -n 5 > top.txt\n",
+    "\n",
+};
+
+/* Arma el contenido del script en memoria nueva */
+static char* make_script(unsigned int lines, size_t* size) {
+    size_t n_samples = sizeof(sample_lines) / sizeof(sample_lines[0]);
+    size_t total = 0u;
+    for (unsigned int i = 0u; i < lines; i++) {
+        total += strlen(sample_lines[i % n_samples]);
+    }
+    char* script = malloc(total + 1u);
+    if (script == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    char* pos = script;
+    for (unsigned int i = 0u; i < lines; i++) {
+        size_t len = strlen(sample_lines[i % n_samples]);
+        memcpy(pos, sample_lines[i % n_samples], len);
+        pos += len;
+    }
+    *pos = '\0';
+    *size = total;
+    return script;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Parsea todo lo que haya en parser y devuelve la cantidad de pipelines */
+static unsigned int parse_all(Parser parser) {
+    unsigned int count = 0u;
+    while (!parser_at_eof(parser)) {
+        pipeline apipe = parse_pipeline(parser);
+        if (apipe != NULL) {
+            count++;
+            pipeline_destroy(apipe);
+        }
+    }
+    return count;
+}
+
+static void report(const char* mode, double best, unsigned int lines,
+                   size_t size, unsigned int parsed) {
+    printf("%-9s %-7s %8.3f ms  %10.0f líneas/s  %8.1f MB/s  (%u pipelines)\n",
+           IMPLEMENTATION, mode, best * 1e3, (double)lines / best,
+           (double)size / best / 1e6, parsed);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int lines = DEFAULT_LINES;
+    if (argc > 1) {
+        lines = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    size_t size = 0u;
+    char* script = make_script(lines, &size);
+
+    double best = 0.0;
+    unsigned int parsed = 0u;
+    for (unsigned int run = 0u; run < RUNS; run++) {
+        FILE* input = fmemopen(script, size, "r");
+        if (input == NULL) {
+            perror("fmemopen");
+            return EXIT_FAILURE;
+        }
+        double start = now_seconds();
+        Parser parser = parser_new(input);
+        parsed = parse_all(parser);
+        parser_destroy(parser);
+        double elapsed = now_seconds() - start;
+        fclose(input);
+        if (run == 0u || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("FILE*", best, lines, size, parsed);
+
+#ifndef PREBUILT_PARSER
+    for (unsigned int run = 0u; run < RUNS; run++) {
+        double start = now_seconds();
+        Parser parser = parser_new_from_buffer(script, size);
+        parsed = parse_all(parser);
+        parser_destroy(parser);
+        double elapsed = now_seconds() - start;
+        if (run == 0u || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("buffer", best, lines, size, parsed);
+
+    unsigned long hits = 0ul, misses = 0ul;
+    for (unsigned int run = 0u; run < RUNS; run++) {
+        double start = now_seconds();
+        linecache cache = linecache_new(64u);
+        Parser parser = parser_new_from_buffer(script, size);
+        parser_set_cache(parser, cache);
+        parsed = parse_all(parser);
+        parser_destroy(parser);
+        linecache_stats(cache, &hits, &misses);
+        linecache_destroy(cache);
+        double elapsed = now_seconds() - start;
+        if (run == 0u || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("cache", best, lines, size, parsed);
+    printf("linecache: %lu aciertos, %lu fallos\n", hits, misses);
+
+    // Archivo regular: parser_new_from_fd lo mapea
+    FILE* file = tmpfile();
+    if (file == NULL || fwrite(script, 1u, size, file) != size ||
+        fflush(file) != 0) {
+        perror("tmpfile");
+        return EXIT_FAILURE;
+    }
+    for (unsigned int run = 0u; run < RUNS; run++) {
+        double start = now_seconds();
+        Parser parser = parser_new_from_fd(fileno(file));
+        parsed = parse_all(parser);
+        parser_destroy(parser);
+        double elapsed = now_seconds() - start;
+        if (run == 0u || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    fclose(file);
+    report("mmap", best, lines, size, parsed);
+
+    // Pipe: lo llena un proceso hijo, parser_new_from_fd lee en bloques
+    for (unsigned int run = 0u; run < RUNS; run++) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            perror("pipe");
+            return EXIT_FAILURE;
+        }
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(fds[0]);
+            size_t written = 0u;
+            while (written < size) {
+                ssize_t n = write(fds[1], script + written, size - written);
+                if (n < 0) {
+                    _exit(EXIT_FAILURE);
+                }
+                written += (size_t)n;
+            }
+            _exit(EXIT_SUCCESS);
+        }
+        close(fds[1]);
+        double start = now_seconds();
+        Parser parser = parser_new_from_fd(fds[0]);
+        parsed = parse_all(parser);
+        parser_destroy(parser);
+        double elapsed = now_seconds() - start;
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+        if (run == 0u || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    report("pipe", best, lines, size, parsed);
+    printf("scan: %s\n", scan_impl_name());
+#endif
+
+    free(script);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/* Benchmark de la expansión de nombres de archivo.
+ *
+ * Arma un directorio temporal con muchos archivos y compara pathexp_expand
+ * contra lo que haría glob(3) a mano: readdir de todo el directorio, fnmatch
+ * con cada nombre y qsort con strcmp. También mide varios patrones sobre el
+ * mismo directorio con el mismo pathexp (el listado se lee una vez) y el
+ * ordenamiento solo.
+ *
+ * Después arma un árbol de directorios y compara "**" + "*.c" contra un
+ * recorrido recursivo con readdir, lstat de cada entrada y fnmatch (lo que
+ * hace find), con uno y con varios hilos.
+ *
+ * Uso: ./bench-pathexp [cantidad de archivos]
+ */
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pathexp.h"
+
+#define DEFAULT_FILES 5000u
+#define ROUNDS 200u
+#define TREE_DIRS 20u  // por nivel, dos niveles
+#define TREE_FILES 20u // por directorio
+#define TREE_ROUNDS 10u
+
+static const char* suffixes[] = {".c", ".h", ".o", ".txt"};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, double start, unsigned int count) {
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%-28s %10.3f us/op\n", name, elapsed / count * 1e6);
+}
+
+static int compare(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* readdir + fnmatch + qsort, en el directorio actual */
+static size_t naive_glob(const char* pattern, char*** matches) {
+    DIR* dir = opendir(".");
+    size_t count = 0u, capacity = 64u;
+    char** list = malloc(capacity * sizeof(char*));
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.' &&
+            fnmatch(pattern, entry->d_name, FNM_PERIOD) == 0) {
+            if (count == capacity) {
+                capacity *= 2u;
+                list = realloc(list, capacity * sizeof(char*));
+            }
+            list[count] = strdup(entry->d_name);
+            count++;
+        }
+    }
+    closedir(dir);
+    qsort(list, count, sizeof(char*), compare);
+    *matches = list;
+    return count;
+}
+
+/* Recorrido recursivo con lstat de cada entrada, como find */
+static size_t naive_walk(const char* dir, const char* pattern) {
+    DIR* d = opendir(dir);
+    size_t count = 0u;
+    struct dirent* entry = NULL;
+    char path[4096];
+    while (d != NULL && (entry = readdir(d)) != NULL) {
+        struct stat st;
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (lstat(path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            count += naive_walk(path, pattern);
+        } else if (fnmatch(pattern, entry->d_name, FNM_PERIOD) == 0) {
+            count++;
+        }
+    }
+    if (d != NULL) {
+        closedir(d);
+    }
+    return count;
+}
+
+/* Mide "**" + "*.c" en el directorio actual con threads hilos */
+static size_t bench_globstar(const char* name, unsigned int threads) {
+    size_t found = 0u;
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < TREE_ROUNDS; i++) {
+        char** matches = NULL;
+        pathexp self = pathexp_new();
+        pathexp_set_threads(self, threads);
+        size_t count = pathexp_expand(self, "arbol/**/*.c", &matches);
+        found = count;
+        pathexp_free(matches, count);
+        pathexp_destroy(self);
+    }
+    report(name, start, TREE_ROUNDS);
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int files = DEFAULT_FILES;
+    if (argc > 1) {
+        files = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    char root[] = "/tmp/mybash-bench-pathexp-XXXXXX";
+    char cwd[1024];
+    if (mkdtemp(root) == NULL || getcwd(cwd, sizeof(cwd)) == NULL ||
+        chdir(root) != 0) {
+        perror("bench-pathexp");
+        return EXIT_FAILURE;
+    }
+    char name[160];
+    for (unsigned int i = 0u; i < files; i++) {
+        snprintf(name, sizeof(name), "archivo_%05u%s", (i * 7919u) % files,
+                 suffixes[i % 4u]);
+        close(open(name, O_CREAT | O_WRONLY, 0644));
+    }
+
+    char** matches = NULL;
+    size_t found = 0u;
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        size_t count = naive_glob("archivo_*1?.c", &matches);
+        found += count;
+        for (size_t j = 0u; j < count; j++) {
+            free(matches[j]);
+        }
+        free(matches);
+    }
+    report("readdir+fnmatch+qsort", start, ROUNDS);
+
+    size_t found_pathexp = 0u;
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        pathexp self = pathexp_new();
+        size_t count = pathexp_expand(self, "archivo_*1?.c", &matches);
+        found_pathexp += count;
+        pathexp_free(matches, count);
+        pathexp_destroy(self);
+    }
+    report("pathexp", start, ROUNDS);
+
+    /* Una línea como "wc *.c *.h" lee el directorio una vez */
+    const char* patterns[] = {"*.c", "*.h", "*[0-4].o", "archivo_000??.*"};
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        for (unsigned int j = 0u; j < 4u; j++) {
+            size_t count = naive_glob(patterns[j], &matches);
+            for (size_t k = 0u; k < count; k++) {
+                free(matches[k]);
+            }
+            free(matches);
+        }
+    }
+    report("readdir+fnmatch, 4 patrones", start, ROUNDS);
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        pathexp self = pathexp_new();
+        for (unsigned int j = 0u; j < 4u; j++) {
+            size_t count = pathexp_expand(self, patterns[j], &matches);
+            pathexp_free(matches, count);
+        }
+        pathexp_destroy(self);
+    }
+    report("pathexp, 4 patrones", start, ROUNDS);
+
+    /* Ordenar todos los nombres: qsort con strcmp contra pathexp_sort */
+    pathexp self = pathexp_new();
+    size_t count = pathexp_expand(self, "*", &matches);
+    char** copy = malloc(count * sizeof(char*));
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        memcpy(copy, matches, count * sizeof(char*));
+        qsort(copy, count, sizeof(char*), compare);
+    }
+    report("ordenar con qsort", start, ROUNDS);
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        memcpy(copy, matches, count * sizeof(char*));
+        pathexp_sort(copy, count);
+    }
+    report("ordenar con pathexp_sort", start, ROUNDS);
+    free(copy);
+
+    for (size_t i = 0u; i < count; i++) {
+        unlink(matches[i]);
+    }
+    pathexp_free(matches, count);
+    pathexp_destroy(self);
+
+    /* El árbol, con los archivos en los dos niveles */
+    char dir[64];
+    mkdir("arbol", 0755);
+    for (unsigned int i = 0u; i < TREE_DIRS; i++) {
+        for (unsigned int j = 0u; j <= TREE_DIRS; j++) {
+            if (j == 0u) {
+                snprintf(dir, sizeof(dir), "arbol/d%02u", i);
+            } else {
+                snprintf(dir, sizeof(dir), "arbol/d%02u/s%02u", i, j - 1u);
+            }
+            mkdir(dir, 0755);
+            for (unsigned int k = 0u; k < TREE_FILES; k++) {
+                snprintf(name, sizeof(name), "%s/f%02u%s", dir, k,
+                         suffixes[k % 4u]);
+                close(open(name, O_CREAT | O_WRONLY, 0644));
+            }
+        }
+    }
+    size_t walked = 0u;
+    start = now_seconds();
+    for (unsigned int i = 0u; i < TREE_ROUNDS; i++) {
+        walked = naive_walk("arbol", "*.c");
+    }
+    report("readdir+lstat recursivo", start, TREE_ROUNDS);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int threads = cpus > 4 ? (unsigned int)cpus : 4u;
+    bool same = bench_globstar("pathexp **, 1 hilo", 1u) == walked;
+    snprintf(name, sizeof(name), "pathexp **, %u hilos", threads);
+    same = bench_globstar(name, threads) == walked && same;
+
+    self = pathexp_new();
+    count = pathexp_expand(self, "arbol/**", &matches);
+    for (size_t i = count; i > 0u; i--) {
+        remove(matches[i - 1u]);
+    }
+    pathexp_free(matches, count);
+    pathexp_destroy(self);
+    rmdir("arbol");
+    if (chdir(cwd) != 0 || rmdir(root) != 0) {
+        perror("bench-pathexp");
+    }
+
+    return found == found_pathexp && same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
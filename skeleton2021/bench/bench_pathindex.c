@@ -0,0 +1,115 @@
+/* Benchmark del índice del PATH.
+ *
+ * Compara completar un comando y buscar su ruta con el índice de
+ * pathindex.c, contra lo que habría que hacer sin él: leer todos los
+ * directorios del PATH en cada Tab, y probar directorio por directorio (como
+ * execvp) en cada comando. Con directorios en un disco de red cada lectura y
+ * cada prueba es un viaje por la red; acá se mide con el disco local, así
+ * que la diferencia real es mayor.
+ *
+ * Uso: ./bench-pathindex [cantidad de repeticiones]
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pathindex.h"
+
+#define DEFAULT_ROUNDS 200u
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Cuenta los archivos del PATH que empiezan con prefix, leyendo todo */
+static size_t scan_complete(const char* prefix) {
+    char* path = strdup(getenv("PATH") != NULL ? getenv("PATH") : "");
+    size_t found = 0u;
+    size_t length = strlen(prefix);
+    for (char* dir = strtok(path, ":"); dir != NULL; dir = strtok(NULL, ":")) {
+        DIR* d = opendir(dir);
+        if (d == NULL) {
+            continue;
+        }
+        struct dirent* entry = NULL;
+        while ((entry = readdir(d)) != NULL) {
+            if (strncmp(entry->d_name, prefix, length) == 0) {
+                found++;
+            }
+        }
+        closedir(d);
+    }
+    free(path);
+    return found;
+}
+
+/* Busca name como execvp: probando cada directorio */
+static bool scan_resolve(const char* name, char* result, size_t size) {
+    char* path = strdup(getenv("PATH") != NULL ? getenv("PATH") : "");
+    bool found = false;
+    for (char* dir = strtok(path, ":"); dir != NULL && !found;
+         dir = strtok(NULL, ":")) {
+        snprintf(result, size, "%s/%s", dir, name);
+        found = access(result, X_OK) == 0;
+    }
+    free(path);
+    return found;
+}
+
+static size_t index_complete(const char* prefix) {
+    return pathindex_complete(prefix, NULL, 0u);
+}
+
+static void report(const char* name, double elapsed, unsigned int rounds) {
+    fprintf(stderr, "%-22s %10.3f us/consulta\n", name,
+            elapsed / (double)rounds * 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int rounds = DEFAULT_ROUNDS;
+    if (argc > 1) {
+        rounds = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    double start = now_seconds();
+    pathindex_start();
+    while (!pathindex_ready()) {
+        usleep(1000u);
+    }
+    fprintf(stderr, "índice armado en %.3f ms\n",
+            (now_seconds() - start) * 1e3);
+
+    size_t (*completers[])(const char*) = {scan_complete, index_complete};
+    bool (*resolvers[])(const char*, char*, size_t) = {scan_resolve,
+                                                        pathindex_resolve};
+    const char* names[] = {"leyendo el PATH", "con el índice"};
+    for (unsigned int k = 0u; k < 2u; k++) {
+        size_t found = 0u;
+        start = now_seconds();
+        for (unsigned int i = 0u; i < rounds; i++) {
+            found = completers[k]("g");
+        }
+        char label[64];
+        snprintf(label, sizeof(label), "Tab %s", names[k]);
+        report(label, now_seconds() - start, rounds);
+
+        char path[PATH_MAX];
+        start = now_seconds();
+        for (unsigned int i = 0u; i < rounds; i++) {
+            resolvers[k]("uname", path, sizeof(path));
+        }
+        snprintf(label, sizeof(label), "ruta %s", names[k]);
+        report(label, now_seconds() - start, rounds);
+        (void)found;
+    }
+
+    pathindex_stop();
+    return EXIT_SUCCESS;
+}
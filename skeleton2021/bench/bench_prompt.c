@@ -0,0 +1,99 @@
+/* Benchmark de latencia del prompt.
+ *
+ * Compara el prompt compilado de prompt.c contra la forma en que se armaba
+ * antes (gethostname, getpwuid y getcwd en cada prompt, y printf). La salida
+ * va a /dev/null, así que lo que se mide es el costo de armar el prompt y de
+ * las llamadas al sistema, no el de la terminal. Se mide también el caso
+ * después de un cd, en el que hay que volver a calcular el directorio, y un
+ * formato con segmentos en segundo plano (segments.h), en el que cada prompt
+ * espera a lo sumo un momento a los valores nuevos.
+ *
+ * Uso: ./bench-prompt [cantidad de prompts]
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "prompt.h"
+
+#define DEFAULT_PROMPTS 100000u
+
+#define ANSI_NOCOLOR "\033[0m"
+#define ANSI_GREEN "\033[38;2;0;255;0m"
+#define ANSI_BLUE "\033[38;2;14;112;255m"
+
+/* El show_prompt de antes de compilar el formato */
+static void legacy_show_prompt(void) {
+    char hostname[256];
+    hostname[255] = '\0';
+    gethostname(hostname, 256);
+
+    struct passwd* password = getpwuid(geteuid());
+
+    char workdir[2556];
+    workdir[2555] = '\0';
+    getcwd(workdir, 2556);
+
+    printf(ANSI_GREEN "%s@%s" ANSI_NOCOLOR "/mybash>" ANSI_BLUE
+                      "%s" ANSI_NOCOLOR "$ ",
+           password != NULL ? password->pw_name : "?", hostname, workdir);
+    fflush(stdout);
+}
+
+static void show_prompt_after_cd(void) {
+    prompt_cwd_changed();
+    show_prompt();
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double measure(void (*show)(void), unsigned int prompts) {
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < prompts; i++) {
+        show();
+    }
+    return now_seconds() - start;
+}
+
+static void report(const char* name, double elapsed, unsigned int prompts) {
+    fprintf(stderr, "%-16s %8.3f ms  %8.2f us/prompt\n", name, elapsed * 1e3,
+            elapsed / (double)prompts * 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int prompts = DEFAULT_PROMPTS;
+    if (argc > 1) {
+        prompts = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    // Los resultados se muestran por stderr, el prompt va a /dev/null
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd == -1 || dup2(null_fd, STDOUT_FILENO) == -1) {
+        perror("/dev/null");
+        return EXIT_FAILURE;
+    }
+    close(null_fd);
+
+    prompt_init(NULL);
+    report("antes", measure(legacy_show_prompt, prompts), prompts);
+    report("compilado", measure(show_prompt, prompts), prompts);
+    report("compilado + cd", measure(show_prompt_after_cd, prompts), prompts);
+
+    // Cada vuelta de los segmentos mira el repositorio entero, así que se
+    // hacen menos prompts
+    unsigned int async_prompts = prompts / 100u > 0u ? prompts / 100u : 1u;
+    prompt_init("\\u@\\h \\w (\\g) [\\j] \\L\\$ ");
+    report("con \\g \\j \\L", measure(show_prompt, async_prompts),
+           async_prompts);
+    prompt_destroy();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/* Benchmark del arranque de un script con scriptcache.h.
+ *
+ * Genera un script con líneas parecidas a las de un script de entorno
+ * (export, if, case, for) y mide cuánto tarda en tener todos sus pipelines
+ * listos para ejecutar: parseando el texto, compilándolo (parsear y
+ * escribir el caché) y desde el caché ya escrito. No se ejecuta nada.
+ *
+ * Uso: ./bench-scriptcache [cantidad de líneas]
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "parser.h"
+#include "scriptcache.h"
+
+#define DEFAULT_LINES 5000u
+#define RUNS 20u
+
+static const char* const sample_lines[] = {
+    "export VAR%u=\"/opt/pkg%u/bin:$HOME/lib\"\n",
+    "if test -d /opt/pkg%u; then export PATH=\"$PATH:/opt/pkg%u\"; fi\n",
+    "case $TERM%u in xterm*|screen*) export COLOR%u=1 ;; *) ;; esac\n",
+    "for d in lib%u share%u; do test -e $d && export DIRS=\"$DIRS:$d\"; "
+    "done\n",
+    "grep -q foo%u /etc/config%u > /dev/null || echo falta\n",
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Parsea el script sin caché, como cuando MYBASH_SCRIPTCACHE="" */
+static unsigned int parse_text(int fd) {
+    Parser parser = parser_new_from_fd(fd);
+    unsigned int count = 0u;
+    while (!parser_at_eof(parser)) {
+        pipeline apipe = parse_pipeline(parser);
+        if (apipe != NULL) {
+            count++;
+            pipeline_destroy(apipe);
+        }
+    }
+    parser_destroy(parser);
+    return count;
+}
+
+static unsigned int open_script(const char* path, int fd, bool* cached) {
+    scriptcache script = scriptcache_open(path, fd, NULL);
+    *cached = scriptcache_is_cached(script);
+    unsigned int count = 0u;
+    pipeline apipe = scriptcache_next(script);
+    while (apipe != NULL) {
+        count++;
+        pipeline_destroy(apipe);
+        apipe = scriptcache_next(script);
+    }
+    scriptcache_close(script);
+    return count;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int lines = DEFAULT_LINES;
+    if (argc > 1) {
+        lines = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    char dir[] = "/tmp/bench-scriptcache-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/env.sh", dir);
+    char* cache_path = scriptcache_path(path);
+    FILE* out = fopen(path, "w");
+    for (unsigned int i = 0u; i < lines; i++) {
+        size_t n = sizeof(sample_lines) / sizeof(sample_lines[0]);
+        fprintf(out, sample_lines[i % n], i, i);
+    }
+    fclose(out);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    double start = now_seconds();
+    unsigned int count = 0u;
+    for (unsigned int r = 0u; r < RUNS; r++) {
+        count = parse_text(fd);
+    }
+    double elapsed = (now_seconds() - start) / RUNS;
+    fprintf(stderr, "%u líneas, %u pipelines\n", lines, count);
+    fprintf(stderr, "parseando el texto  %10.3f ms\n", elapsed * 1e3);
+
+    bool cached = false;
+    start = now_seconds();
+    for (unsigned int r = 0u; r < RUNS; r++) {
+        unlink(cache_path);
+        count = open_script(path, fd, &cached);
+    }
+    elapsed = (now_seconds() - start) / RUNS;
+    fprintf(stderr, "compilando          %10.3f ms  (%s)\n", elapsed * 1e3,
+            cached ? "desde el caché" : "parseado");
+
+    start = now_seconds();
+    for (unsigned int r = 0u; r < RUNS; r++) {
+        count = open_script(path, fd, &cached);
+    }
+    elapsed = (now_seconds() - start) / RUNS;
+    fprintf(stderr, "desde el caché      %10.3f ms  (%s, %u pipelines)\n",
+            elapsed * 1e3, cached ? "desde el caché" : "parseado", count);
+
+    close(fd);
+    unlink(cache_path);
+    unlink(path);
+    rmdir(dir);
+    free(cache_path);
+    return EXIT_SUCCESS;
+}
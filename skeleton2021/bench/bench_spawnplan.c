@@ -0,0 +1,133 @@
+/* Benchmark del lanzamiento de pipelines largos.
+ *
+ * Mide cuánto tarda en llegar el primer byte al final de un pipeline de
+ * echo y muchos cat: lanzando las etapas una atrás de la otra con fork y
+ * execvp (como multiple_commands), contra spawnplan con uno y con varios
+ * hilos. El tiempo corre hasta que se lee el primer byte, y después se
+ * espera a que terminen todas las etapas.
+ *
+ * Uso: ./bench-spawnplan [etapas] [repeticiones]
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "spawnplan.h"
+
+#define DEFAULT_STAGES 64u
+#define DEFAULT_ROUNDS 20u
+
+static char* first[] = {"echo", "x", NULL};
+static char* middle[] = {"cat", NULL};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Un fork por etapa, como multiple_commands.
+ * Returns: cuántos procesos se lanzaron
+ */
+static unsigned int launch_fork(unsigned int stages, int out) {
+    int* pipes = malloc(2u * stages * sizeof(int));
+    for (unsigned int i = 0u; i + 1u < stages; i++) {
+        if (pipe(pipes + 2u * i) == -1) {
+            perror("pipe");
+            exit(EXIT_FAILURE);
+        }
+    }
+    unsigned int launched = 0u;
+    for (unsigned int i = 0u; i < stages; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (i > 0u) {
+                dup2(pipes[2u * (i - 1u)], STDIN_FILENO);
+            }
+            dup2(i + 1u < stages ? pipes[2u * i + 1u] : out, STDOUT_FILENO);
+            for (unsigned int k = 0u; k + 1u < stages; k++) {
+                close(pipes[2u * k]);
+                close(pipes[2u * k + 1u]);
+            }
+            char** argv = i == 0u ? first : middle;
+            execvp(argv[0], argv);
+            _exit(EXIT_FAILURE);
+        }
+        launched += pid > 0 ? 1u : 0u;
+    }
+    for (unsigned int k = 0u; k + 1u < stages; k++) {
+        close(pipes[2u * k]);
+        close(pipes[2u * k + 1u]);
+    }
+    free(pipes);
+    return launched;
+}
+
+static unsigned int launch_plan(unsigned int stages, int out,
+                                unsigned int threads) {
+    spawnplan plan = spawnplan_new(stages);
+    spawnplan_set_threads(plan, threads);
+    for (unsigned int i = 0u; i < stages; i++) {
+        char** argv = malloc(3u * sizeof(char*));
+        char** model = i == 0u ? first : middle;
+        for (unsigned int k = 0u; k < 3u; k++) {
+            argv[k] = model[k];
+            if (model[k] == NULL) {
+                break;
+            }
+        }
+        int fd = i + 1u == stages ? fcntl(out, F_DUPFD_CLOEXEC, 0) : -1;
+        spawnplan_set_stage(plan, i, NULL, argv, -1, fd);
+    }
+    unsigned int launched = spawnplan_run(plan, NULL);
+    plan = spawnplan_destroy(plan);
+    return launched;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int stages = DEFAULT_STAGES;
+    unsigned int rounds = DEFAULT_ROUNDS;
+    if (argc > 1) {
+        stages = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        rounds = (unsigned int)strtoul(argv[2], NULL, 10);
+    }
+    if (stages < 2u) {
+        stages = 2u;
+    }
+
+    const char* names[] = {"un fork por etapa", "spawnplan, 1 hilo",
+                           "spawnplan, 4 hilos"};
+    for (unsigned int k = 0u; k < 3u; k++) {
+        double first_byte = 0.0, total = 0.0;
+        for (unsigned int r = 0u; r < rounds; r++) {
+            int result[2];
+            if (pipe(result) == -1) {
+                perror("pipe");
+                return EXIT_FAILURE;
+            }
+            double start = now_seconds();
+            unsigned int launched =
+                k == 0u ? launch_fork(stages, result[1])
+                        : launch_plan(stages, result[1], k == 1u ? 1u : 4u);
+            close(result[1]);
+            char byte;
+            if (read(result[0], &byte, 1u) != 1) {
+                fprintf(stderr, "%s: no llegó nada\n", names[k]);
+            }
+            first_byte += now_seconds() - start;
+            for (unsigned int i = 0u; i < launched; i++) {
+                wait(NULL);
+            }
+            total += now_seconds() - start;
+            close(result[0]);
+        }
+        fprintf(stderr, "%-20s %9.3f ms primer byte %9.3f ms total\n",
+                names[k], first_byte / rounds * 1e3, total / rounds * 1e3);
+    }
+    return EXIT_SUCCESS;
+}
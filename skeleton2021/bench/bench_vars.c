@@ -0,0 +1,148 @@
+/* Benchmark de las variables del shell.
+ *
+ * Define muchas variables (la mitad exportadas) y mide cuánto cuesta
+ * cambiarlas y leerlas, expandir una palabra, y conseguir el entorno para un
+ * exec: con el envp que mantiene vars.h, contra armarlo de nuevo en cada
+ * exec copiando las variables exportadas (lo que haría un shell que no lo
+ * guarda). También mide expansiones con operadores (lo que de otra forma
+ * serían un basename y un sed), y una expansión aritmética con el programa
+ * compilado en el cache, contra compilarla cada vez.
+ *
+ * Uso: ./bench-vars [cantidad de variables]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arith.h"
+#include "command.h"
+#include "expand.h"
+#include "vars.h"
+
+#define DEFAULT_VARS 200u
+#define ROUNDS 100000u
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void report(const char* name, double start, unsigned int count) {
+    double elapsed = now_seconds() - start;
+    fprintf(stderr, "%-28s %10.3f ns/op\n", name, elapsed / count * 1e9);
+}
+
+/* Arma un entorno nuevo con copias de las variables exportadas */
+static char** rebuild_envp(void) {
+    char* const* envp = vars_envp();
+    size_t count = 0u;
+    while (envp[count] != NULL) {
+        count++;
+    }
+    char** result = malloc((count + 1u) * sizeof(char*));
+    for (size_t i = 0u; i < count; i++) {
+        result[i] = strdup(envp[i]);
+    }
+    result[count] = NULL;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int vars = DEFAULT_VARS;
+    if (argc > 1) {
+        vars = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+
+    char name[32], value[64];
+    double start = now_seconds();
+    for (unsigned int i = 0u; i < vars; i++) {
+        snprintf(name, sizeof(name), "BENCH_VAR_%u", i);
+        snprintf(value, sizeof(value), "/usr/local/valor/numero/%u", i);
+        vars_set(name, value);
+        if (i % 2u == 0u) {
+            vars_export(name);
+        }
+    }
+    report("definir", start, vars);
+
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        snprintf(name, sizeof(name), "BENCH_VAR_%u", i % vars);
+        vars_set(name, "otro valor");
+    }
+    report("cambiar", start, ROUNDS);
+
+    size_t found = 0u;
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        snprintf(name, sizeof(name), "BENCH_VAR_%u", i % vars);
+        found += vars_get(name) != NULL;
+    }
+    report("leer", start, ROUNDS);
+
+    scommand cmd = scommand_new();
+    char word[] = "\001$BENCH_VAR_1/\"$BENCH_VAR_2\"/x";
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        unsigned int count = expand_word(word, cmd);
+        for (unsigned int j = 0u; j < count; j++) {
+            scommand_pop_front(cmd);
+        }
+    }
+    report("expandir palabra", start, ROUNDS);
+
+    char affix[] = "\001${BENCH_VAR_3##*/}.${BENCH_VAR_3//[aeiou]/_}";
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        unsigned int count = expand_word(affix, cmd);
+        for (unsigned int j = 0u; j < count; j++) {
+            scommand_pop_front(cmd);
+        }
+    }
+    report("expandir ${##} y ${//}", start, ROUNDS);
+    scommand_destroy(cmd);
+
+    const char expression[] = "(BENCH_VAR_I * 3 + 1) % 7 << 2";
+    size_t length = strlen(expression);
+    int64_t total = 0;
+    vars_set("BENCH_VAR_I", "0");
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        int64_t result = 0;
+        arith_eval(expression, length, &result);
+        total += result;
+    }
+    report("aritmética en el cache", start, ROUNDS);
+
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        int64_t result = 0;
+        arith_clear();
+        arith_eval(expression, length, &result);
+        total += result;
+    }
+    report("aritmética compilando", start, ROUNDS);
+
+    char* const* cached = NULL;
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        cached = vars_envp();
+    }
+    report("envp guardado", start, ROUNDS);
+
+    start = now_seconds();
+    for (unsigned int i = 0u; i < ROUNDS; i++) {
+        char** envp = rebuild_envp();
+        for (char** var = envp; *var != NULL; var++) {
+            free(*var);
+        }
+        free(envp);
+    }
+    report("envp armado en cada exec", start, ROUNDS);
+
+    return found > 0u && cached != NULL && total > 0 ? EXIT_SUCCESS
+                                                     : EXIT_FAILURE;
+}
@@ -0,0 +1,91 @@
+/* Benchmark del zygote.
+ *
+ * Compara lanzar un comando (/bin/true) y esperarlo haciendo fork y exec
+ * desde el shell, contra pedírselo al zygote de zygote.c, a medida que el
+ * shell usa más memoria. fork tiene que copiar las tablas de páginas de
+ * toda la memoria del proceso, así que tarda más cuanto más grande es el
+ * shell; el zygote es chico y no cambia.
+ *
+ * Uso: ./bench-zygote [cantidad de repeticiones]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "zygote.h"
+
+#define DEFAULT_ROUNDS 200u
+#define MEGABYTE (1024u * 1024u)
+
+static char* command[] = {"true", NULL};
+static char* environment[] = {"PATH=/bin:/usr/bin", NULL};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static pid_t spawn_fork(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execve("/bin/true", command, environment);
+        _exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+static pid_t spawn_zygote(void) {
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    return zygote_spawn("/bin/true", command, environment, fds);
+}
+
+static void report(const char* name, size_t megabytes, double elapsed,
+                   unsigned int rounds) {
+    char label[64];
+    snprintf(label, sizeof(label), "%s (%zu MB)", name, megabytes);
+    fprintf(stderr, "%-22s %10.3f us/comando\n", label,
+            elapsed / (double)rounds * 1e6);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int rounds = DEFAULT_ROUNDS;
+    if (argc > 1) {
+        rounds = (unsigned int)strtoul(argv[1], NULL, 10);
+    }
+    // Como en mybash: antes de usar memoria
+    if (!zygote_start()) {
+        perror("zygote_start");
+        return EXIT_FAILURE;
+    }
+
+    size_t sizes[] = {0u, 64u, 256u};
+    pid_t (*spawners[])(void) = {spawn_fork, spawn_zygote};
+    const char* names[] = {"fork y exec", "zygote"};
+    char* memory = NULL;
+    for (unsigned int s = 0u; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        // La memoria se escribe para que tenga páginas de verdad
+        free(memory);
+        memory = sizes[s] > 0u ? malloc(sizes[s] * MEGABYTE) : NULL;
+        if (memory != NULL) {
+            memset(memory, 1, sizes[s] * MEGABYTE);
+        }
+        for (unsigned int k = 0u; k < 2u; k++) {
+            double start = now_seconds();
+            for (unsigned int i = 0u; i < rounds; i++) {
+                pid_t pid = spawners[k]();
+                if (pid > 0) {
+                    waitpid(pid, NULL, 0);
+                }
+            }
+            report(names[k], sizes[s], now_seconds() - start, rounds);
+        }
+    }
+    free(memory);
+
+    zygote_stop();
+    return EXIT_SUCCESS;
+}
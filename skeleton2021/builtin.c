@@ -1,4 +1,7 @@
 #include <assert.h>
+#include <errno.h>
+#include <glib.h>
+#include <limits.h> // PATH_MAX
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,7 +9,18 @@
 
 #include "builtin.h"
 #include "command.h"
+#include "dirindex.h"
+#include "prompt.h"
 #include "strextra.h"
+#include "vars.h"
+
+const char* const builtin_names[] = {
+    ":", "break", "cd", "continue", "dirs", "exit", "export", "false", "popd",
+    "pushd", "true", "unset", NULL};
+
+unsigned int builtin_loop_depth = 0u;
+unsigned int builtin_loop_jumps = 0u;
+bool builtin_loop_continue = false;
 
 // exit
 
@@ -16,15 +30,44 @@ bool builtin_scommand_is_exit(const scommand cmd) {
     return strcmp(scommand_front(cmd), "exit") == 0;
 }
 
+/* Estado de exit con un argumento que no es un número, como en bash */
+#define EXIT_NOT_NUMERIC 2
+
 /*
- * Ejecuta el comando interno exit
+ * Ejecuta el comando interno exit [n]: el shell termina con el estado n
+ * (módulo 256), o sin n con el del último pipeline. Si n no es un número
+ * termina con EXIT_NOT_NUMERIC; con más de un argumento no termina. El
+ * estado queda también en $?, para que sea el del shell aunque el exit esté
+ * adentro de un compuesto.
  *
  * REQUIRES: cmd != NULL && builtin_scommand_is_exit
+ * RETURNS: el estado con el que termina el shell
  */
-static void builtin_run_exit(const scommand cmd) {
+static int builtin_run_exit(const scommand cmd) {
     assert(cmd != NULL && builtin_scommand_is_exit(cmd));
 
+    int status = vars_status();
+    if (scommand_length(cmd) > 2u) {
+        fprintf(stderr, "mybash: exit: demasiados argumentos\n");
+        return EXIT_FAILURE;
+    }
+    if (scommand_length(cmd) == 2u) {
+        const char* arg = scommand_get_nth(cmd, 1u);
+        char* end = NULL;
+        errno = 0;
+        long long value = strtoll(arg, &end, 10);
+        if (arg[0] == '\0' || *end != '\0' || errno == ERANGE) {
+            fprintf(stderr,
+                    "mybash: exit: %s: se requiere un argumento numérico\n",
+                    arg);
+            status = EXIT_NOT_NUMERIC;
+        } else {
+            status = (int)((unsigned long long)value & 0xFFu);
+        }
+    }
+    vars_set_status(status);
     exit_from_mybash = true;
+    return status;
 }
 
 // cd
@@ -35,111 +78,461 @@ bool builtin_scommand_is_cd(const scommand cmd) {
     // Si son iguales strcmp devuelve 0
 }
 
+/*
+ * Cambia al directorio input_path, resolviendo ~ y '~'. Con NULL, "" o "~"
+ * va al directorio principal.
+ *
+ * RETURNS: el resultado de chdir
+ */
+static int change_to_path(char* input_path) {
+    unsigned int path_length = input_path != NULL ? strlen(input_path) : 0u;
+    int ret_code = 0;
+    const char* home_path = vars_get("HOME");
+
+    /* Si el argumento de chdir comienza con / el path se toma desde equipo
+       (ósea como path absoluto) y si empieza con ./ o sin nada se toma desde
+       el directorio actual. También, chdir acepta .. para ir un directorio
+       para arriba.
+    */
+
+    if (path_length > 1u) {
+        char* relative_path = NULL;
+        char* full_path = NULL;
+        if (input_path[0] == '~' && input_path[1] == '/' &&
+            home_path != NULL) {
+            /* Caso en el que el ~ es seguido por un /, por ejemplo ~/Documentos, esto
+            se considera como un directorio relativo al directorio principal.
+            */
+            relative_path = &input_path[1];
+            full_path = strmerge(home_path, relative_path);
+
+            ret_code = chdir(full_path);
+        } else if (input_path[0] == '\'' && input_path[1] == '~' &&
+                   input_path[2] == '\'') {
+            relative_path = &input_path[3];
+            full_path = strmerge("~", relative_path);
+            ret_code = chdir(full_path);
+            if (ret_code != 0) {
+                ret_code = chdir(input_path);
+            }
+        } else {
+            /* Maneja cualquier caso en el que no se encuentre un ~ o '~' antes de /
+            */
+            ret_code = chdir(input_path);
+        }
+        free(full_path);
+        full_path = NULL;
+    } else {
+        if (input_path == NULL || input_path[0] == '~' ||
+            strcmp(input_path, "") == 0) {
+            if (home_path == NULL) {
+                ret_code = chdir("~");
+            } else {
+                ret_code = chdir(home_path);
+            }
+        } else {
+            ret_code = chdir(input_path);
+        }
+    }
+    return ret_code;
+}
+
+/*
+ * Después de cambiar de directorio: actualiza PWD y OLDPWD (old_cwd es el
+ * directorio anterior, o NULL si no se sabe), el prompt y el índice de
+ * directorios visitados.
+ */
+static void directory_changed(const char* old_cwd) {
+    if (old_cwd != NULL) {
+        vars_set("OLDPWD", old_cwd);
+        vars_export("OLDPWD");
+    }
+    char* cwd = getcwd(NULL, 0);
+    if (cwd != NULL) {
+        vars_set("PWD", cwd);
+        vars_export("PWD");
+        dirindex_visit(cwd);
+        free(cwd);
+    }
+    // El prompt guarda el directorio actual
+    prompt_cwd_changed();
+}
+
+/*
+ * Cambia de directorio según los argumentos de cd (o de pushd): ninguno es
+ * el directorio principal, "-" es el anterior (OLDPWD), y uno es una ruta.
+ * Si la ruta no existe, o si hay más de un argumento, se busca en el índice
+ * de directorios visitados (dirindex.h). Los errores se informan como
+ * `name'.
+ *
+ * REQUIRES: args != NULL || count == 0
+ * RETURNS: true si se cambió de directorio
+ */
+static bool change_directory(const char* name, char* const* args,
+                             unsigned int count) {
+    char* old_cwd = getcwd(NULL, 0);
+    char found[PATH_MAX];
+    bool show = false; // se muestra a dónde se fue, si no era obvio
+    int ret_code = 0;
+
+    if (count == 1u && strcmp(args[0], "-") == 0) {
+        const char* oldpwd = vars_get("OLDPWD");
+        if (oldpwd == NULL) {
+            fprintf(stderr, "mybash: %s: OLDPWD no está definido\n", name);
+            free(old_cwd);
+            return false;
+        }
+        snprintf(found, sizeof(found), "%s", oldpwd);
+        ret_code = chdir(found);
+        show = true;
+    } else if (count <= 1u) {
+        ret_code = change_to_path(count == 1u ? args[0] : NULL);
+        int error = errno;
+        if (ret_code != 0 && count == 1u &&
+            (error == ENOENT || error == ENOTDIR) &&
+            dirindex_query(args, count, found, sizeof(found))) {
+            ret_code = chdir(found);
+            show = true;
+        } else {
+            // Se informa el error de la ruta, no el de la búsqueda
+            errno = error;
+        }
+    } else if (dirindex_query(args, count, found, sizeof(found))) {
+        ret_code = chdir(found);
+        show = true;
+    } else {
+        printf("mybash: %s: demasiados argumentos\n", name);
+        free(old_cwd);
+        return false;
+    }
+
+    if (ret_code != 0) {
+        /* La función chdir deja un mensaje en algún lado, con perror se puede
+           imprimir el último mensaje, por lo cuál, en caso de error se la usa.
+           perror toma un string, e imprime primero ese string, y después el
+           mensaje de error. man perror para mas información
+        */
+        char message[64];
+        snprintf(message, sizeof(message), "mybash: %s", name);
+        perror(message);
+    } else {
+        if (show) {
+            printf("%s\n", found);
+        }
+        directory_changed(old_cwd);
+    }
+    free(old_cwd);
+    return ret_code == 0;
+}
+
 /*
  * Ejecuta el comando interno cd
  *
  * REQUIRES: cmd != NULL && builtin_scommand_is_cd(cmd)
  */
-static void builtin_run_cd(const scommand cmd) {
+static int builtin_run_cd(const scommand cmd) {
     assert(cmd != NULL && builtin_scommand_is_cd(cmd));
 
-    unsigned int length = scommand_length(cmd);
-    if (length <= 2u) {
+    // Los argumentos siguen siendo de cmd
+    char** argv = scommand_get_argv(cmd);
+    if (argv == NULL) {
+        perror("mybash: cd");
+        return EXIT_FAILURE;
+    }
+    bool changed = change_directory("cd", argv + 1, scommand_length(cmd) - 1u);
+    free(argv);
+    return changed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-        char* input_path = NULL;
-        unsigned int path_length = 0u;
-        if (length > 1u) {
-            input_path = scommand_get_nth(cmd, 1u);
-            path_length = strlen(input_path);
-        }
-        int ret_code = 0;
-        char* home_path = getenv("HOME");
+// pushd, popd, dirs
 
-        /* Si el argumento de chdir comienza con / el path se toma desde equipo
-           (ósea como path absoluto) y si empieza con ./ o sin nada se toma desde
-           el directorio actual. También, chdir acepta .. para ir un directorio
-           para arriba.
-        */
+/* Pila de directorios de pushd: el tope es el primero. El directorio actual
+ * no está en la pila, pero se muestra antes que ella.
+ */
+static GSList* directory_stack = NULL;
 
-        if (path_length > 1u) {
-            char* relative_path = NULL;
-            char* full_path = NULL;
-            if (input_path[0] == '~' && input_path[1] == '/' &&
-                home_path != NULL) {
-                /* Caso en el que el ~ es seguido por un /, por ejemplo ~/Documentos, esto
-                se considera como un directorio relativo al directorio principal.
-                */
-                relative_path = &input_path[1];
-                full_path = strmerge(home_path, relative_path);
-
-                ret_code = chdir(full_path);
-            } else if (input_path[0] == '\'' && input_path[1] == '~' &&
-                       input_path[2] == '\'') {
-                relative_path = &input_path[3];
-                full_path = strmerge("~", relative_path);
-                ret_code = chdir(full_path);
-                if (ret_code != 0) {
-                    ret_code = chdir(input_path);
-                }
-            } else {
-                /* Maneja cualquier caso en el que no se encuentre un ~ o '~' antes de /
-                */
-                ret_code = chdir(input_path);
-            }
-            free(full_path);
-            full_path = NULL;
+static bool is_named(const scommand cmd, const char* name) {
+    return strcmp(scommand_front(cmd), name) == 0;
+}
+
+/*
+ * Muestra el directorio actual y la pila, como dirs
+ */
+static void print_directory_stack(void) {
+    char* cwd = getcwd(NULL, 0);
+    printf("%s", cwd != NULL ? cwd : ".");
+    free(cwd);
+    for (GSList* node = directory_stack; node != NULL; node = node->next) {
+        printf(" %s", (char*)node->data);
+    }
+    printf("\n");
+}
+
+/*
+ * pushd dir: guarda el directorio actual en la pila y va a dir (como cd).
+ * pushd sin argumentos: intercambia el directorio actual con el tope.
+ */
+static int builtin_run_pushd(const scommand cmd) {
+    unsigned int count = scommand_length(cmd) - 1u;
+    char* cwd = getcwd(NULL, 0);
+    if (cwd == NULL) {
+        perror("mybash: pushd");
+        return EXIT_FAILURE;
+    }
+    bool changed = false;
+    if (count == 0u) {
+        if (directory_stack == NULL) {
+            fprintf(stderr, "mybash: pushd: no hay otro directorio\n");
         } else {
-            if (input_path == NULL || input_path[0] == '~' ||
-                strcmp(input_path, "") == 0) {
-                if (home_path == NULL) {
-                    ret_code = chdir("~");
-                } else {
-                    ret_code = chdir(home_path);
-                }
+            char* top = directory_stack->data;
+            changed = chdir(top) == 0;
+            if (!changed) {
+                perror("mybash: pushd");
             } else {
-                ret_code = chdir(input_path);
+                directory_stack = g_slist_delete_link(directory_stack,
+                                                      directory_stack);
+                free(top);
+                directory_changed(cwd);
             }
         }
-        if (ret_code != 0) {
-            /* La función chdir deja un mensaje en algún lado, con perror se puede
-               imprimir el último mensaje, por lo cuál, en caso de error se la usa.
-               perror toma un string, e imprime primero ese string, y después el
-               mensaje de error. man perror para mas información
-            */
-            perror("mybash: cd");
+    } else {
+        char** argv = scommand_get_argv(cmd);
+        if (argv == NULL) {
+            perror("mybash: pushd");
+        } else {
+            changed = change_directory("pushd", argv + 1, count);
+            free(argv);
         }
+    }
+    if (changed) {
+        directory_stack = g_slist_prepend(directory_stack, cwd);
+        print_directory_stack();
+    } else {
+        free(cwd);
+    }
+    return changed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * popd: saca el tope de la pila y va a ese directorio.
+ */
+static int builtin_run_popd(const scommand cmd) {
+    if (directory_stack == NULL) {
+        fprintf(stderr, "mybash: popd: la pila de directorios está vacía\n");
+        return EXIT_FAILURE;
+    }
+    char* cwd = getcwd(NULL, 0);
+    char* top = directory_stack->data;
+    bool changed = chdir(top) == 0;
+    if (!changed) {
+        perror("mybash: popd");
     } else {
-        printf("mybash: cd: demasiados argumentos\n");
+        directory_stack = g_slist_delete_link(directory_stack, directory_stack);
+        free(top);
+        directory_changed(cwd);
+        print_directory_stack();
+    }
+    free(cwd);
+    return changed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Ciclos
+
+/*
+ * break [n] y continue [n]: dejan pendiente el salto, que hacen los ciclos
+ * (ver builtin_loop_jumps). n es cuántos ciclos de los que rodean al comando
+ * se cortan (1 si no está, y como mucho todos); con continue el último de
+ * ellos sigue con la próxima vuelta. Si n no es un número mayor que 0 se
+ * imprime el error y se salta igual que sin n, así el ciclo no queda dando
+ * vueltas. Fuera de un ciclo no hacen nada.
+ *
+ * RETURNS: EXIT_FAILURE si n no es válido, si no EXIT_SUCCESS
+ */
+static int builtin_run_loop_jump(const scommand cmd, bool is_continue) {
+    const char* name = scommand_front(cmd);
+    if (builtin_loop_depth == 0u) {
+        fprintf(stderr,
+                "mybash: %s: solo tiene sentido en un for, while o until\n",
+                name);
+        return EXIT_SUCCESS;
+    }
+    int status = EXIT_SUCCESS;
+    unsigned long count = 1u;
+    if (scommand_length(cmd) > 1u) {
+        const char* arg = scommand_get_nth(cmd, 1u);
+        char* end = NULL;
+        errno = 0;
+        count = strtoul(arg, &end, 10);
+        if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || errno == ERANGE ||
+            count == 0u) {
+            fprintf(stderr, "mybash: %s: %s: cantidad de ciclos inválida\n",
+                    name, arg);
+            status = EXIT_FAILURE;
+            count = 1u;
+        }
+    }
+    builtin_loop_jumps = count < builtin_loop_depth ? (unsigned int)count
+                                                    : builtin_loop_depth;
+    builtin_loop_continue = is_continue;
+    return status;
+}
+
+// Variables
+
+/*
+ * Indica si el comando son solo asignaciones (NOMBRE=valor ...)
+ */
+static bool is_only_assignments(const scommand cmd) {
+    char** argv = scommand_get_argv(cmd);
+    bool result = argv != NULL;
+    for (unsigned int i = 0u; result && argv[i] != NULL; i++) {
+        result = vars_is_assignment(argv[i]);
+    }
+    free(argv);
+    return result;
+}
+
+/*
+ * Hace las asignaciones del comando
+ *
+ * REQUIRES: cmd != NULL && is_only_assignments(cmd)
+ */
+static void builtin_run_assignments(const scommand cmd) {
+    for (unsigned int i = 0u; i < scommand_length(cmd); i++) {
+        vars_assign(scommand_get_nth(cmd, i), false);
+    }
+}
+
+static int compare_strings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/*
+ * Muestra las variables exportadas, ordenadas, como export sin argumentos
+ */
+static void print_exported(void) {
+    char* const* envp = vars_envp();
+    size_t count = 0u;
+    while (envp[count] != NULL) {
+        count++;
+    }
+    char** sorted = calloc(count + 1u, sizeof(char*));
+    if (sorted == NULL) {
+        perror("mybash: export");
+        return;
+    }
+    memcpy(sorted, envp, count * sizeof(char*));
+    qsort(sorted, count, sizeof(char*), compare_strings);
+    for (size_t i = 0u; i < count; i++) {
+        size_t length = strcspn(sorted[i], "=");
+        printf("export %.*s=\"%s\"\n", (int)length, sorted[i],
+               sorted[i] + length + 1u);
+    }
+    free(sorted);
+}
+
+/*
+ * export NOMBRE[=valor] ...: exporta las variables, dándoles el valor si
+ * lo tienen. Sin argumentos muestra las exportadas.
+ */
+static int builtin_run_export(const scommand cmd) {
+    unsigned int length = scommand_length(cmd);
+    int status = EXIT_SUCCESS;
+    if (length == 1u) {
+        print_exported();
+    }
+    for (unsigned int i = 1u; i < length; i++) {
+        const char* arg = scommand_get_nth(cmd, i);
+        if (vars_assign(arg, true)) {
+            continue;
+        }
+        if (arg[0] != '\0' && vars_name_length(arg) == strlen(arg)) {
+            vars_export(arg);
+        } else {
+            fprintf(stderr,
+                    "mybash: export: `%s': no es un identificador válido\n",
+                    arg);
+            status = EXIT_FAILURE;
+        }
+    }
+    return status;
+}
+
+/*
+ * unset NOMBRE ...: borra las variables
+ */
+static int builtin_run_unset(const scommand cmd) {
+    int status = EXIT_SUCCESS;
+    for (unsigned int i = 1u; i < scommand_length(cmd); i++) {
+        const char* arg = scommand_get_nth(cmd, i);
+        if (arg[0] != '\0' && vars_name_length(arg) == strlen(arg)) {
+            vars_unset(arg);
+        } else {
+            fprintf(stderr,
+                    "mybash: unset: `%s': no es un identificador válido\n",
+                    arg);
+            status = EXIT_FAILURE;
+        }
     }
+    return status;
 }
 
 // Chequeo
 
 bool builtin_scommand_is_internal(const scommand cmd) {
     assert(cmd != NULL);
-    return builtin_scommand_is_exit(cmd) || builtin_scommand_is_cd(cmd);
+    // Las cadenas de un compuesto (for, case) no son un comando
+    return scommand_get_kind(cmd) == SCOMMAND_SIMPLE &&
+           !scommand_is_empty(cmd) &&
+           (builtin_scommand_is_exit(cmd) || builtin_scommand_is_cd(cmd) ||
+            is_named(cmd, "pushd") || is_named(cmd, "popd") ||
+            is_named(cmd, "dirs") || is_named(cmd, "export") ||
+            is_named(cmd, "unset") || is_named(cmd, "true") ||
+            is_named(cmd, "false") || is_named(cmd, ":") ||
+            is_named(cmd, "break") || is_named(cmd, "continue") ||
+            is_only_assignments(cmd));
 }
 
 bool builtin_scommand_is_single_internal(const pipeline pipe) {
     assert(pipe != NULL);
     return pipeline_length(pipe) == 1 &&
-           builtin_scommand_is_internal(pipeline_front(pipe));
+           builtin_scommand_is_internal(pipeline_get_nth(pipe, 0u));
 }
 
 // Ejecución
 
-void builtin_scommand_exec(const scommand cmd) {
+int builtin_scommand_exec(const scommand cmd) {
     assert(cmd != NULL && builtin_scommand_is_internal(cmd));
+    int status = EXIT_SUCCESS;
     if (builtin_scommand_is_cd(cmd)) {
-        builtin_run_cd(cmd);
+        status = builtin_run_cd(cmd);
+    } else if (is_named(cmd, "pushd")) {
+        status = builtin_run_pushd(cmd);
+    } else if (is_named(cmd, "popd")) {
+        status = builtin_run_popd(cmd);
+    } else if (is_named(cmd, "dirs")) {
+        print_directory_stack();
+    } else if (is_named(cmd, "export")) {
+        status = builtin_run_export(cmd);
+    } else if (is_named(cmd, "unset")) {
+        status = builtin_run_unset(cmd);
+    } else if (is_named(cmd, "false")) {
+        status = EXIT_FAILURE;
+    } else if (is_named(cmd, "true") || is_named(cmd, ":")) {
+        // No hacen nada: son las condiciones de los ciclos sin fork
+    } else if (is_named(cmd, "break") || is_named(cmd, "continue")) {
+        status = builtin_run_loop_jump(cmd, is_named(cmd, "continue"));
+    } else if (is_only_assignments(cmd)) {
+        builtin_run_assignments(cmd);
     } else { // builtin_scommand_is_exit(cmd)
-        builtin_run_exit(cmd);
+        status = builtin_run_exit(cmd);
     }
+    return status;
 }
 
-void builtin_single_pipeline_exec(const pipeline pipe) {
+int builtin_single_pipeline_exec(const pipeline pipe) {
     assert(pipe != NULL && builtin_scommand_is_single_internal(pipe));
 
-    scommand cmd = pipeline_front(pipe);
-    builtin_scommand_exec(cmd);
+    scommand cmd = pipeline_get_nth(pipe, 0u);
+    return builtin_scommand_exec(cmd);
 }
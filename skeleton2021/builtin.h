@@ -9,6 +9,21 @@
  */
 bool exit_from_mybash;
 
+/* Nombres de los comandos internos, terminado en NULL
+ */
+extern const char* const builtin_names[];
+
+/* break y continue: builtin_loop_depth es cuántos ciclos se están
+ * ejecutando (los lleva el que los ejecuta). break n y continue n dejan en
+ * builtin_loop_jumps cuántos de esos ciclos hay que cortar; mientras no es
+ * 0 las listas no ejecutan nada más, y cada ciclo que termina una vuelta
+ * descuenta uno y termina, salvo el último de un continue
+ * (builtin_loop_continue), que sigue con la próxima vuelta.
+ */
+extern unsigned int builtin_loop_depth;
+extern unsigned int builtin_loop_jumps;
+extern bool builtin_loop_continue;
+
 /*
  * Indica si un "exit"
  *
@@ -25,7 +40,9 @@ bool builtin_scommand_is_cd(const scommand cmd);
 
 
 /*
- * Indica si un comando es interno
+ * Indica si un comando es interno: cd, pushd, popd, dirs, exit, export,
+ * unset, true, false, :, break, continue o solo asignaciones. Un compuesto
+ * nunca lo es.
  *
  * REQUIRES: cmd != NULL
  */
@@ -43,14 +60,18 @@ bool builtin_scommand_is_single_internal(const pipeline pipe);
  * Ejecuta un comando interno
  *
  * REQUIRES: cmd != NULL && builtin_scommand_is_internal(cmd)
+ * RETURNS: su estado: EXIT_FAILURE si falló (cd a un directorio que no
+ *     existe, false...), el del shell al salir si es un exit (exit n, o
+ *     sin n el del último pipeline), si no EXIT_SUCCESS
  */
-void builtin_scommand_exec(const scommand cmd);
+int builtin_scommand_exec(const scommand cmd);
 
 /*
  * Ejecuta una pipeline con un único comando
  *
  * REQUIRES: pipe != NULL && builtin_scommand_is_single_internal(pipe)
+ * RETURNS: el estado del comando, como builtin_scommand_exec
  */
-void builtin_single_pipeline_exec(const pipeline pipe);
+int builtin_single_pipeline_exec(const pipeline pipe);
 
 #endif
@@ -1,5 +1,7 @@
 #include <assert.h>
 #include <glib.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +11,16 @@
 
 /********** Funciones auxiliares **********/
 
+/* g_slist_free_full necesita una función que devuelva void */
+static void void_pipeline_destroy(void* self) {
+    pipeline_destroy(self);
+}
+
+/* g_slist_copy_deep necesita una función con esta firma */
+static gpointer clone_pipeline(gconstpointer src, gpointer user_data) {
+    return pipeline_clone((const pipeline)src);
+}
+
 /* Elimina el primer elemento de una lista no vacía, destrullendolo con
  * free_func Requires: xs != NULL && free_func != NULL
  */
@@ -29,11 +41,19 @@ static GSList* g_slist_tail_free_full(GSList* xs, GDestroyNotify free_func) {
 
 /* Estructura correspondiente a un comando simple.
  * Es una 3-upla del tipo ([char*], char* , char*).
+ *
+ * borrowed indica que las cadenas no son del TAD sino que apuntan dentro de
+ * un buffer de pipeline_deserialize: no se liberan y el comando no se puede
+ * modificar.
  */
 struct scommand_s {
     GSList* args;
     char* redir_in;
     char* redir_out;
+    bool borrowed;
+    scommand_kind kind;
+    GSList* lists;  // pipelines, solo en los compuestos
+    GSList* redirs; // scommand_redir*, las redirecciones generales en orden
 };
 
 scommand scommand_new(void) {
@@ -51,6 +71,10 @@ scommand scommand_new(void) {
     result->args = NULL;
     result->redir_in = NULL;
     result->redir_out = NULL;
+    result->borrowed = false;
+    result->kind = SCOMMAND_SIMPLE;
+    result->lists = NULL;
+    result->redirs = NULL;
 
     assert(result != NULL && scommand_is_empty(result) &&
            scommand_get_redir_in(result) == NULL &&
@@ -62,12 +86,27 @@ scommand scommand_new(void) {
 scommand scommand_destroy(scommand self) {
     assert(self != NULL);
 
-    g_slist_free_full(self->args, free);
+    if (self->borrowed) {
+        // Las cadenas son del buffer, solo se liberan los nodos
+        g_slist_free(self->args);
+    } else {
+        g_slist_free_full(self->args, free);
+        free(self->redir_in);
+        free(self->redir_out);
+    }
+    for (GSList* xs = self->redirs; xs != NULL; xs = g_slist_next(xs)) {
+        scommand_redir* redir = xs->data;
+        if (!self->borrowed) {
+            free(redir->target);
+        }
+        free(redir);
+    }
+    g_slist_free(self->redirs);
+    self->redirs = NULL;
+    g_slist_free_full(self->lists, void_pipeline_destroy);
+    self->lists = NULL;
     self->args = NULL;
-
-    free(self->redir_in);
     self->redir_in = NULL;
-    free(self->redir_out);
     self->redir_out = NULL;
 
     free(self);
@@ -79,7 +118,7 @@ scommand scommand_destroy(scommand self) {
 }
 
 void scommand_push_back(scommand self, char* argument) {
-    assert(self != NULL && argument != NULL);
+    assert(self != NULL && argument != NULL && !self->borrowed);
 
     self->args = g_slist_append(self->args, argument);
 
@@ -87,23 +126,103 @@ void scommand_push_back(scommand self, char* argument) {
 }
 
 void scommand_pop_front(scommand self) {
-    assert(self != NULL && !scommand_is_empty(self));
+    assert(self != NULL && !scommand_is_empty(self) && !self->borrowed);
 
     self->args = g_slist_tail_free_full(self->args, free);
 }
 
 void scommand_set_redir_in(scommand self, char* filename) {
-    assert(self != NULL);
+    assert(self != NULL && !self->borrowed);
 
     self->redir_in = filename;
 }
 
 void scommand_set_redir_out(scommand self, char* filename) {
-    assert(self != NULL);
+    assert(self != NULL && !self->borrowed);
 
     self->redir_out = filename;
 }
 
+/* Nueva redirección general, sin agregarla a ningún comando */
+static scommand_redir* redir_new(scommand_redir_kind kind, int fd, int source,
+                                 char* target) {
+    scommand_redir* redir = malloc(sizeof(scommand_redir));
+    if (redir == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    redir->kind = kind;
+    redir->fd = fd;
+    redir->source = source;
+    redir->target = target;
+    return redir;
+}
+
+void scommand_add_redir(scommand self, scommand_redir_kind kind, int fd,
+                        int source, char* target) {
+    assert(self != NULL && !self->borrowed && 0 <= fd &&
+           fd <= SCOMMAND_MAX_FD &&
+           (kind == SCOMMAND_REDIR_DUP) ==
+               (0 <= source && source <= SCOMMAND_MAX_FD) &&
+           (kind == SCOMMAND_REDIR_DUP || kind == SCOMMAND_REDIR_CLOSE) ==
+               (target == NULL));
+
+    self->redirs =
+        g_slist_append(self->redirs, redir_new(kind, fd, source, target));
+}
+
+void scommand_set_kind(scommand self, scommand_kind kind) {
+    assert(self != NULL && kind != SCOMMAND_SIMPLE && !self->borrowed &&
+           self->kind == SCOMMAND_SIMPLE && scommand_is_empty(self));
+
+    self->kind = kind;
+
+    assert(scommand_get_kind(self) == kind && scommand_list_count(self) == 0);
+}
+
+void scommand_add_list(scommand self, pipeline list) {
+    assert(self != NULL && list != NULL && self->kind != SCOMMAND_SIMPLE &&
+           !self->borrowed);
+
+    self->lists = g_slist_append(self->lists, list);
+}
+
+void scommand_set_body(scommand self, scommand_kind kind, pipeline body) {
+    assert(self != NULL && body != NULL && kind != SCOMMAND_SIMPLE &&
+           !self->borrowed && self->kind == SCOMMAND_SIMPLE &&
+           scommand_is_empty(self));
+
+    scommand_set_kind(self, kind);
+    scommand_add_list(self, body);
+}
+
+scommand_kind scommand_get_kind(const scommand self) {
+    assert(self != NULL);
+
+    return self->kind;
+}
+
+pipeline scommand_get_body(const scommand self) {
+    assert(self != NULL);
+
+    return self->lists != NULL ? self->lists->data : NULL;
+}
+
+unsigned int scommand_list_count(const scommand self) {
+    assert(self != NULL);
+
+    return g_slist_length(self->lists);
+}
+
+pipeline scommand_get_list(const scommand self, unsigned int n) {
+    assert(self != NULL && n < scommand_list_count(self));
+
+    pipeline result = g_slist_nth_data(self->lists, n);
+
+    assert(result != NULL);
+    return result;
+}
+
 bool scommand_is_empty(const scommand self) {
     assert(self != NULL);
 
@@ -130,7 +249,7 @@ char* scommand_front(const scommand self) {
 }
 
 char* scommand_front_and_pop(scommand self) {
-    assert(self != NULL && !scommand_is_empty(self));
+    assert(self != NULL && !scommand_is_empty(self) && !self->borrowed);
 
     char* result = g_slist_nth_data(self->args, 0u);
 
@@ -162,9 +281,42 @@ char* scommand_get_redir_out(const scommand self) {
     return (self->redir_out);
 }
 
-char** scommand_to_argv(scommand self) {
+unsigned int scommand_redir_count(const scommand self) {
     assert(self != NULL);
 
+    return g_slist_length(self->redirs);
+}
+
+const scommand_redir* scommand_get_redir(const scommand self, unsigned int n) {
+    assert(self != NULL && n < scommand_redir_count(self));
+
+    const scommand_redir* result = g_slist_nth_data(self->redirs, n);
+
+    assert(result != NULL);
+    return result;
+}
+
+static bool has_mark(const char* word) {
+    return word != NULL && word[0] == SCOMMAND_EXPAND_MARK;
+}
+
+bool scommand_has_expansions(const scommand self) {
+    assert(self != NULL);
+
+    bool result = has_mark(self->redir_in) || has_mark(self->redir_out);
+    for (GSList* xs = self->args; xs != NULL && !result; xs = g_slist_next(xs)) {
+        result = has_mark(xs->data);
+    }
+    for (GSList* xs = self->redirs; xs != NULL && !result;
+         xs = g_slist_next(xs)) {
+        result = has_mark(((scommand_redir*)xs->data)->target);
+    }
+    return result;
+}
+
+char** scommand_to_argv(scommand self) {
+    assert(self != NULL && !self->borrowed);
+
     unsigned int n = scommand_length(self);
     char** argv = calloc(sizeof(char*), n + 1);
 
@@ -185,30 +337,260 @@ char** scommand_to_argv(scommand self) {
     return (argv);
 }
 
+char** scommand_get_argv(const scommand self) {
+    assert(self != NULL);
+
+    unsigned int n = scommand_length(self);
+    char** argv = calloc(sizeof(char*), n + 1);
+
+    if (argv != NULL) {
+        unsigned int j = 0u;
+        for (GSList* xs = self->args; xs != NULL; xs = g_slist_next(xs)) {
+            argv[j] = xs->data;
+            j++;
+        }
+        argv[n] = NULL;
+    }
+
+    return (argv);
+}
+
+scommand scommand_copy(const scommand self) {
+    assert(self != NULL);
+
+    scommand result = scommand_new();
+    GSList* args = NULL;
+    bool ok = true;
+    for (GSList* xs = self->args; xs != NULL && ok; xs = g_slist_next(xs)) {
+        char* arg = strdup(xs->data);
+        ok = arg != NULL;
+        if (ok) {
+            args = g_slist_prepend(args, arg);
+        }
+    }
+    result->args = g_slist_reverse(args);
+    if (ok && self->redir_in != NULL) {
+        result->redir_in = strdup(self->redir_in);
+        ok = result->redir_in != NULL;
+    }
+    if (ok && self->redir_out != NULL) {
+        result->redir_out = strdup(self->redir_out);
+        ok = result->redir_out != NULL;
+    }
+    for (GSList* xs = self->redirs; xs != NULL && ok; xs = g_slist_next(xs)) {
+        const scommand_redir* redir = xs->data;
+        char* target = NULL;
+        if (redir->target != NULL) {
+            target = strdup(redir->target);
+            ok = target != NULL;
+        }
+        if (ok) {
+            result->redirs = g_slist_prepend(
+                result->redirs,
+                redir_new(redir->kind, redir->fd, redir->source, target));
+        }
+    }
+    result->redirs = g_slist_reverse(result->redirs);
+    if (!ok) {
+        perror("Error fatal: strdup");
+        exit(EXIT_FAILURE);
+    }
+    // Las listas son inmutables mientras sean compartidas
+    result->kind = self->kind;
+    result->lists = g_slist_copy_deep(self->lists, clone_pipeline, NULL);
+
+    assert(result != NULL && !result->borrowed &&
+           scommand_length(result) == scommand_length(self));
+    return result;
+}
+
+/* Texto de una palabra para mostrarla: sin la marca de expansiones */
+static const char* word_text(const char* word) {
+    return has_mark(word) ? word + 1 : word;
+}
+
+static pipeline last_of_list(pipeline list) {
+    while (pipeline_get_next(list) != NULL) {
+        list = pipeline_get_next(list);
+    }
+    return list;
+}
+
+/* Agrega en chars la lista list como va antes de una palabra reservada,
+ * terminada en "; " (o en " " si termina con &)
+ */
+static char* append_list(char* chars, const pipeline list) {
+    char* text = pipeline_to_string(list);
+    if (text == NULL) {
+        free(chars);
+        return NULL;
+    }
+    chars = str_concat(chars, text);
+    free(text);
+    return str_concat(chars, pipeline_get_wait(last_of_list(list)) ? "; "
+                                                                   : " ");
+}
+
+/* Agrega en chars las cadenas de self desde la n-ésima, separadas con sep */
+static char* append_words(char* chars, const scommand self, unsigned int n,
+                          const char* sep) {
+    GSList* xs = g_slist_nth(self->args, n);
+    for (GSList* ys = xs; ys != NULL; ys = g_slist_next(ys)) {
+        if (ys != xs) {
+            chars = str_concat(chars, sep);
+        }
+        chars = str_concat(chars, word_text(ys->data));
+    }
+    return chars;
+}
+
+/* Agrega en chars las cláusulas de un case: "p1 | p2) lista ;; " */
+static char* append_case_clauses(char* chars, const scommand self) {
+    for (GSList* xs = self->lists; xs != NULL && chars != NULL;
+         xs = g_slist_next(g_slist_next(xs))) {
+        chars = append_words(chars, pipeline_get_nth(xs->data, 0u), 0u,
+                             " | ");
+        chars = str_concat(chars, ") ");
+        pipeline body = g_slist_next(xs)->data;
+        if (!pipeline_is_empty(body) && chars != NULL) {
+            char* text = pipeline_to_string(body);
+            chars = text != NULL ? str_concat(chars, text) : NULL;
+            chars = str_concat(chars, " ");
+            free(text);
+        }
+        chars = str_concat(chars, ";; ");
+    }
+    return chars;
+}
+
+/* Agrega en chars el compuesto self, como se escribe: "{ lista; }",
+ * "( lista )", "if c; then l; fi"...
+ */
+static char* append_compound_to_string(char* chars, const scommand self) {
+    GSList* xs = self->lists;
+    switch (self->kind) {
+    case SCOMMAND_SUBSHELL: {
+        char* body = pipeline_to_string(xs->data);
+        if (body == NULL) {
+            free(chars);
+            return NULL;
+        }
+        chars = str_concat(chars, "( ");
+        chars = str_concat(chars, body);
+        chars = str_concat(chars, " )");
+        free(body);
+        break;
+    }
+    case SCOMMAND_IF:
+        for (unsigned int i = 0u; xs != NULL; i++) {
+            if (g_slist_next(xs) == NULL) {
+                chars = str_concat(chars, "else ");
+            } else {
+                chars = str_concat(chars, i == 0u ? "if " : "elif ");
+                chars = append_list(chars, xs->data);
+                chars = str_concat(chars, "then ");
+                xs = g_slist_next(xs);
+            }
+            chars = append_list(chars, xs->data);
+            xs = g_slist_next(xs);
+        }
+        chars = str_concat(chars, "fi");
+        break;
+    case SCOMMAND_WHILE:
+    case SCOMMAND_UNTIL:
+        chars = str_concat(chars, self->kind == SCOMMAND_WHILE ? "while "
+                                                               : "until ");
+        chars = append_list(chars, xs->data);
+        chars = str_concat(chars, "do ");
+        chars = append_list(chars, g_slist_next(xs)->data);
+        chars = str_concat(chars, "done");
+        break;
+    case SCOMMAND_FOR:
+        chars = str_concat(chars, "for ");
+        chars = str_concat(chars, word_text(self->args->data));
+        chars = str_concat(chars, " in");
+        if (g_slist_next(self->args) != NULL) {
+            chars = str_concat(chars, " ");
+            chars = append_words(chars, self, 1u, " ");
+        }
+        chars = str_concat(chars, "; do ");
+        chars = append_list(chars, xs->data);
+        chars = str_concat(chars, "done");
+        break;
+    case SCOMMAND_CASE:
+        chars = str_concat(chars, "case ");
+        chars = str_concat(chars, word_text(self->args->data));
+        chars = str_concat(chars, " in ");
+        chars = append_case_clauses(chars, self);
+        chars = str_concat(chars, "esac");
+        break;
+    default: // SCOMMAND_BRACE_GROUP
+        chars = str_concat(chars, "{ ");
+        chars = append_list(chars, xs->data);
+        chars = str_concat(chars, "}");
+    }
+    return chars;
+}
+
+/* Agrega en chars la redirección general redir como se escribe: " 2> a",
+ * " >> a", " 2>&1", " 3>&-" (sin el número si es la entrada en un '<' o la
+ * salida en un '>')
+ */
+static char* append_redir(char* chars, const scommand_redir* redir) {
+    static const char* const operators[] = {"<", ">", ">>", ">&", ">&"};
+    int usual = redir->kind == SCOMMAND_REDIR_INPUT ? 0 : 1;
+    char number[16] = "";
+    if (redir->fd != usual) {
+        snprintf(number, sizeof(number), "%d", redir->fd);
+    }
+    chars = str_concat(chars, " ");
+    chars = str_concat(chars, number);
+    chars = str_concat(chars, operators[redir->kind]);
+    if (redir->kind == SCOMMAND_REDIR_DUP) {
+        snprintf(number, sizeof(number), "%d", redir->source);
+        chars = str_concat(chars, number);
+    } else if (redir->kind == SCOMMAND_REDIR_CLOSE) {
+        chars = str_concat(chars, "-");
+    } else {
+        chars = str_concat(chars, " ");
+        chars = str_concat(chars, word_text(redir->target));
+    }
+    return chars;
+}
+
 char* scommand_to_string(const scommand self) {
     assert(self != NULL);
 
     GSList* xs = self->args;
     char* result = strdup("");
+    if (self->kind != SCOMMAND_SIMPLE) {
+        // Las cadenas de un compuesto van en su lugar
+        result = append_compound_to_string(result, self);
+        xs = NULL;
+    }
 
     if (xs != NULL) {
-        result = str_concat(result, xs->data);
+        result = str_concat(result, word_text(xs->data));
         xs = g_slist_next(xs);
         while (xs != NULL) {
             result = str_concat(result, " ");
-            result = str_concat(result, g_slist_nth_data(xs, 0u));
+            result = str_concat(result, word_text(g_slist_nth_data(xs, 0u)));
             xs = g_slist_next(xs);
         }
     }
 
     if (self->redir_out != NULL) {
         result = str_concat(result, " > ");
-        result = str_concat(result, self->redir_out);
+        result = str_concat(result, word_text(self->redir_out));
     }
 
     if (self->redir_in != NULL) {
         result = str_concat(result, " < ");
-        result = str_concat(result, self->redir_in);
+        result = str_concat(result, word_text(self->redir_in));
+    }
+
+    for (GSList* ys = self->redirs; ys != NULL; ys = g_slist_next(ys)) {
+        result = append_redir(result, ys->data);
     }
 
     // Notar que todo el manejo de errores pasa por str_concat
@@ -237,14 +619,50 @@ static char* append_scommand_to_string(char* chars, const scommand self) {
 
 /********** COMANDO PIPELINE **********/
 
-/* Estructura correspondiente a un comando pipeline.
- * Es un 2-upla del tipo ([scommand], bool)
+/* Contenido de un pipeline. Es un 2-upla del tipo ([scommand], bool)
+ *
+ * Puede estar compartido entre varios pipeline (ver pipeline_clone), refs
+ * cuenta cuántos lo usan. Mientras esté compartido es inmutable: antes de
+ * modificarlo hay que hacer una copia propia (pipeline_unshare).
+ *
+ * read_only indica que salió de pipeline_deserialize y no se puede modificar
+ * nunca.
  */
-struct pipeline_s {
+struct pipeline_data {
     GSList* scmds;
+    pipeline next; // el siguiente de la lista, propio
+    pipeline_connector connector;
     bool wait;
+    bool read_only;
+    atomic_uint refs;
 };
 
+/* Estructura correspondiente a un comando pipeline.
+ * Es solo una referencia al contenido, que puede ser compartido.
+ */
+struct pipeline_s {
+    struct pipeline_data* data;
+};
+
+/* Pide memoria para un contenido de pipeline vacío con una sola referencia.
+ * Si malloc falla termina el programa (ver pipeline_new).
+ */
+static struct pipeline_data* pipeline_data_new(void) {
+    struct pipeline_data* data = malloc(sizeof(struct pipeline_data));
+    if (data == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    data->scmds = NULL;
+    data->next = NULL;
+    data->connector = PIPELINE_SEQUENCE;
+    data->wait = true;
+    data->read_only = false;
+    atomic_init(&data->refs, 1u);
+
+    return data;
+}
+
 pipeline pipeline_new(void) {
     pipeline result = malloc(sizeof(struct pipeline_s));
     if (result == NULL) {
@@ -258,8 +676,7 @@ pipeline pipeline_new(void) {
         exit(EXIT_FAILURE);
     }
 
-    result->scmds = NULL;
-    result->wait = true;
+    result->data = pipeline_data_new();
 
     assert(result != NULL && pipeline_is_empty(result) &&
            pipeline_get_wait(result));
@@ -275,11 +692,56 @@ static void void_scommand_destroy(void* self) {
     scommand_destroy(self2);
 }
 
+/* Suelta una referencia al contenido, liberándolo si era la última
+ * Requires: data != NULL
+ */
+static void pipeline_data_release(struct pipeline_data* data) {
+    assert(data != NULL);
+
+    if (atomic_fetch_sub(&data->refs, 1u) == 1u) {
+        g_slist_free_full(data->scmds, void_scommand_destroy);
+        data->scmds = NULL;
+        if (data->next != NULL) {
+            data->next = pipeline_destroy(data->next);
+        }
+        free(data);
+    }
+}
+
+/* g_slist_copy_deep necesita una función con esta firma */
+static gpointer copy_scommand(gconstpointer src, gpointer user_data) {
+    return scommand_copy((const scommand)src);
+}
+
+/* Copy-on-write: si el contenido de self está compartido lo reemplaza por
+ * una copia propia, así se puede modificar sin afectar a los demás.
+ * Requires: self != NULL && !self->data->read_only
+ * Ensures: self->data->refs == 1
+ */
+static void pipeline_unshare(pipeline self) {
+    assert(self != NULL && !self->data->read_only);
+
+    struct pipeline_data* shared = self->data;
+    if (atomic_load(&shared->refs) > 1u) {
+        struct pipeline_data* own = pipeline_data_new();
+        own->scmds = g_slist_copy_deep(shared->scmds, copy_scommand, NULL);
+        own->wait = shared->wait;
+        own->connector = shared->connector;
+        if (shared->next != NULL) {
+            own->next = pipeline_clone(shared->next);
+        }
+        self->data = own;
+        pipeline_data_release(shared);
+    }
+
+    assert(atomic_load(&self->data->refs) == 1u);
+}
+
 pipeline pipeline_destroy(pipeline self) {
     assert(self != NULL);
 
-    g_slist_free_full(self->scmds, void_scommand_destroy);
-    self->scmds = NULL;
+    pipeline_data_release(self->data);
+    self->data = NULL;
     free(self);
     self = NULL;
 
@@ -287,59 +749,125 @@ pipeline pipeline_destroy(pipeline self) {
     return self;
 }
 
+pipeline pipeline_clone(const pipeline self) {
+    assert(self != NULL);
+
+    pipeline result = malloc(sizeof(struct pipeline_s));
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    atomic_fetch_add(&self->data->refs, 1u);
+    result->data = self->data;
+
+    assert(result != NULL && result != self);
+    return result;
+}
+
 void pipeline_push_back(pipeline self, scommand sc) {
     // El TAD se apropia del comando
-    assert(self != NULL && sc != NULL);
+    assert(self != NULL && sc != NULL && !self->data->read_only);
 
-    self->scmds = g_slist_append(self->scmds, sc);
+    pipeline_unshare(self);
+    self->data->scmds = g_slist_append(self->data->scmds, sc);
 
     assert(!pipeline_is_empty(self));
 }
 
 void pipeline_pop_front(pipeline self) {
-    assert(self != NULL && !pipeline_is_empty(self));
+    assert(self != NULL && !pipeline_is_empty(self) &&
+           !self->data->read_only);
 
-    self->scmds = g_slist_tail_free_full(self->scmds, void_scommand_destroy);
+    pipeline_unshare(self);
+    self->data->scmds =
+        g_slist_tail_free_full(self->data->scmds, void_scommand_destroy);
 }
 
 void pipeline_set_wait(pipeline self, const bool w) {
+    assert(self != NULL && !self->data->read_only);
+
+    if (self->data->wait != w) {
+        pipeline_unshare(self);
+        self->data->wait = w;
+    }
+}
+
+void pipeline_set_next(pipeline self, pipeline next) {
+    assert(self != NULL && next != NULL && next != self &&
+           !self->data->read_only && self->data->next == NULL);
+
+    pipeline_unshare(self);
+    self->data->next = next;
+
+    assert(pipeline_get_next(self) != NULL);
+}
+
+void pipeline_set_connector(pipeline self, pipeline_connector connector) {
+    assert(self != NULL && !self->data->read_only);
+
+    if (self->data->connector != connector) {
+        pipeline_unshare(self);
+        self->data->connector = connector;
+    }
+}
+
+pipeline_connector pipeline_get_connector(const pipeline self) {
+    assert(self != NULL);
+
+    return self->data->connector;
+}
+
+pipeline pipeline_get_next(const pipeline self) {
     assert(self != NULL);
 
-    self->wait = w;
+    return self->data->next;
 }
 
 bool pipeline_is_empty(const pipeline self) {
     assert(self != NULL);
 
-    return (self->scmds == NULL);
+    return (self->data->scmds == NULL);
 }
 
 unsigned int pipeline_length(const pipeline self) {
     assert(self != NULL);
 
-    return g_slist_length(self->scmds);
+    return g_slist_length(self->data->scmds);
 }
 
 scommand pipeline_front(const pipeline self) {
     assert(self != NULL && !pipeline_is_empty(self));
 
-    scommand result = g_slist_nth_data(self->scmds, 0u);
+    // El llamador puede modificar el comando, así que no puede ser compartido
+    if (!self->data->read_only) {
+        pipeline_unshare(self);
+    }
+    scommand result = g_slist_nth_data(self->data->scmds, 0u);
 
     assert(result != NULL);
 
     return result;
 }
 
+scommand pipeline_get_nth(const pipeline self, unsigned int n) {
+    assert(self != NULL && n < pipeline_length(self));
+
+    scommand result = g_slist_nth_data(self->data->scmds, n);
+
+    assert(result != NULL);
+    return result;
+}
+
 bool pipeline_get_wait(const pipeline self) {
     assert(self != NULL);
 
-    return self->wait;
+    return self->data->wait;
 }
 
 char* pipeline_to_string(const pipeline self) {
     assert(self != NULL);
 
-    GSList* commands = self->scmds;
+    GSList* commands = self->data->scmds;
     char* result = strdup("");
 
     if (commands != NULL) {
@@ -358,6 +886,24 @@ char* pipeline_to_string(const pipeline self) {
             result = str_concat(result, " &");
         }
     }
+    if (self->data->next != NULL) {
+        // El & ya separa del siguiente
+        if (self->data->connector == PIPELINE_AND) {
+            result = str_concat(result, " && ");
+        } else if (self->data->connector == PIPELINE_OR) {
+            result = str_concat(result, " || ");
+        } else {
+            result = str_concat(result, pipeline_get_wait(self) ? "; " : " ");
+        }
+        char* rest = pipeline_to_string(self->data->next);
+        if (rest == NULL) {
+            free(result);
+            result = NULL;
+        } else {
+            result = str_concat(result, rest);
+            free(rest);
+        }
+    }
 
     // Notar que todo el manejo de errores pasa por str_concat
 
@@ -366,3 +912,402 @@ char* pipeline_to_string(const pipeline self) {
 
     return result;
 }
+
+/********** SERIALIZACIÓN **********/
+
+#define SERIAL_MAGIC 0x4c50424du /* "MBPL" leído como uint32_t little endian */
+#define SERIAL_VERSION 3u
+#define SERIAL_WAIT 0x1u
+#define SERIAL_HAS_NEXT 0x2u
+#define SERIAL_CONNECTOR_SHIFT 2u
+#define SERIAL_CONNECTOR_MASK 0x3u
+#define SERIAL_HAS_IN 0x1u
+#define SERIAL_HAS_OUT 0x2u
+#define SERIAL_HAS_LISTS 0x4u
+#define SERIAL_HAS_REDIRS 0x8u
+#define SERIAL_REDIR_WORDS 3u /* clase, fd, source */
+#define SERIAL_HEADER_WORDS 4u /* magic+versión/flags, tamaño, n */
+
+/* Redondea n al siguiente múltiplo de 4 */
+static size_t align4(size_t n) {
+    return (n + 3u) & ~(size_t)3u;
+}
+
+/* Escribe un uint32_t en buf + offset. Se usa memcpy para no depender de la
+ * alineación del buffer.
+ */
+static void put_u32(char* buf, size_t offset, uint32_t value) {
+    memcpy(buf + offset, &value, sizeof(uint32_t));
+}
+
+static uint32_t get_u32(const char* buf, size_t offset) {
+    uint32_t value = 0u;
+    memcpy(&value, buf + offset, sizeof(uint32_t));
+    return value;
+}
+
+/* Copia la cadena str (con su '\0') en buf + offset y devuelve el offset
+ * siguiente
+ */
+static size_t put_string(char* buf, size_t offset, const char* str) {
+    size_t len = strlen(str) + 1u;
+    memcpy(buf + offset, str, len);
+    return offset + len;
+}
+
+static size_t pipeline_serial_size(const pipeline self);
+
+/* Tamaño del registro serializado de un comando simple, con padding y las
+ * listas si es un compuesto
+ * Requires: cmd != NULL
+ */
+static size_t scommand_serial_size(const scommand cmd) {
+    assert(cmd != NULL);
+
+    size_t size = 2u * sizeof(uint32_t);
+    for (GSList* xs = cmd->args; xs != NULL; xs = g_slist_next(xs)) {
+        size += strlen(xs->data) + 1u;
+    }
+    if (cmd->redir_in != NULL) {
+        size += strlen(cmd->redir_in) + 1u;
+    }
+    if (cmd->redir_out != NULL) {
+        size += strlen(cmd->redir_out) + 1u;
+    }
+    if (cmd->redirs != NULL) {
+        size += (1u + SERIAL_REDIR_WORDS * g_slist_length(cmd->redirs)) *
+                sizeof(uint32_t);
+    }
+    for (GSList* xs = cmd->redirs; xs != NULL; xs = g_slist_next(xs)) {
+        const scommand_redir* redir = xs->data;
+        if (redir->target != NULL) {
+            size += strlen(redir->target) + 1u;
+        }
+    }
+    size = align4(size);
+    if (cmd->kind != SCOMMAND_SIMPLE) {
+        size += sizeof(uint32_t);
+        for (GSList* xs = cmd->lists; xs != NULL; xs = g_slist_next(xs)) {
+            size += sizeof(uint32_t) + pipeline_serial_size(xs->data);
+        }
+    }
+    return size;
+}
+
+/* Tamaño de self sin los siguientes de la lista */
+static size_t pipeline_own_serial_size(const pipeline self) {
+    uint32_t n = g_slist_length(self->data->scmds);
+    size_t total = (SERIAL_HEADER_WORDS + n) * sizeof(uint32_t);
+    for (GSList* xs = self->data->scmds; xs != NULL; xs = g_slist_next(xs)) {
+        total += scommand_serial_size(xs->data);
+    }
+    return total;
+}
+
+/* Tamaño de self con toda la lista */
+static size_t pipeline_serial_size(const pipeline self) {
+    size_t total = 0u;
+    for (pipeline p = self; p != NULL; p = p->data->next) {
+        total += pipeline_own_serial_size(p);
+    }
+    return total;
+}
+
+/* Escribe self (y su lista) en buf, que tiene lugar para
+ * pipeline_serial_size(self) bytes
+ */
+static void pipeline_serialize_into(const pipeline self, char* buf) {
+    uint32_t n = g_slist_length(self->data->scmds);
+    size_t total = pipeline_own_serial_size(self);
+
+    uint32_t flags = self->data->wait ? SERIAL_WAIT : 0u;
+    flags |= self->data->next != NULL ? SERIAL_HAS_NEXT : 0u;
+    flags |= (uint32_t)self->data->connector << SERIAL_CONNECTOR_SHIFT;
+    put_u32(buf, 0u, SERIAL_MAGIC);
+    put_u32(buf, 4u, SERIAL_VERSION | (flags << 16));
+    put_u32(buf, 8u, (uint32_t)total);
+    put_u32(buf, 12u, n);
+
+    size_t offset = (SERIAL_HEADER_WORDS + n) * sizeof(uint32_t);
+    unsigned int i = 0u;
+    for (GSList* xs = self->data->scmds; xs != NULL; xs = g_slist_next(xs)) {
+        scommand cmd = xs->data;
+        put_u32(buf, (SERIAL_HEADER_WORDS + i) * sizeof(uint32_t),
+                (uint32_t)offset);
+
+        uint32_t cmd_flags = 0u;
+        cmd_flags |= cmd->redir_in != NULL ? SERIAL_HAS_IN : 0u;
+        cmd_flags |= cmd->redir_out != NULL ? SERIAL_HAS_OUT : 0u;
+        cmd_flags |= cmd->redirs != NULL ? SERIAL_HAS_REDIRS : 0u;
+        if (cmd->kind != SCOMMAND_SIMPLE) {
+            cmd_flags |= SERIAL_HAS_LISTS | ((uint32_t)cmd->kind << 8);
+        }
+        put_u32(buf, offset, g_slist_length(cmd->args));
+        put_u32(buf, offset + 4u, cmd_flags);
+
+        size_t next = offset + 2u * sizeof(uint32_t);
+        if (cmd->redirs != NULL) {
+            put_u32(buf, next, g_slist_length(cmd->redirs));
+            next += sizeof(uint32_t);
+            for (GSList* ys = cmd->redirs; ys != NULL; ys = g_slist_next(ys)) {
+                const scommand_redir* redir = ys->data;
+                put_u32(buf, next, (uint32_t)redir->kind);
+                put_u32(buf, next + 4u, (uint32_t)redir->fd);
+                put_u32(buf, next + 8u, (uint32_t)redir->source);
+                next += SERIAL_REDIR_WORDS * sizeof(uint32_t);
+            }
+        }
+        if (cmd->redir_in != NULL) {
+            next = put_string(buf, next, cmd->redir_in);
+        }
+        if (cmd->redir_out != NULL) {
+            next = put_string(buf, next, cmd->redir_out);
+        }
+        for (GSList* ys = cmd->redirs; ys != NULL; ys = g_slist_next(ys)) {
+            const scommand_redir* redir = ys->data;
+            if (redir->target != NULL) {
+                next = put_string(buf, next, redir->target);
+            }
+        }
+        for (GSList* ys = cmd->args; ys != NULL; ys = g_slist_next(ys)) {
+            next = put_string(buf, next, ys->data);
+        }
+
+        offset = align4(next);
+        if (cmd->kind != SCOMMAND_SIMPLE) {
+            put_u32(buf, offset, g_slist_length(cmd->lists));
+            offset += sizeof(uint32_t);
+            for (GSList* ys = cmd->lists; ys != NULL; ys = g_slist_next(ys)) {
+                size_t size = pipeline_serial_size(ys->data);
+                put_u32(buf, offset, (uint32_t)size);
+                pipeline_serialize_into(ys->data, buf + offset + 4u);
+                offset += sizeof(uint32_t) + size;
+            }
+        }
+        i++;
+    }
+    assert(offset == total);
+
+    if (self->data->next != NULL) {
+        pipeline_serialize_into(self->data->next, buf + total);
+    }
+}
+
+void* pipeline_serialize(const pipeline self, size_t* size) {
+    assert(self != NULL && size != NULL);
+
+    size_t total = pipeline_serial_size(self);
+    if (total > UINT32_MAX) {
+        return NULL;
+    }
+
+    // calloc para que el padding quede en cero
+    char* buf = calloc(total, sizeof(char));
+    if (buf == NULL) {
+        return NULL;
+    }
+    pipeline_serialize_into(self, buf);
+
+    *size = total;
+    return buf;
+}
+
+/* Devuelve la cadena que empieza en buf + *offset y avanza *offset hasta
+ * después de su '\0', o NULL si la cadena no termina antes de end.
+ */
+static char* take_string(const char* buf, size_t* offset, size_t end) {
+    if (*offset >= end) {
+        return NULL;
+    }
+    const char* str = buf + *offset;
+    const char* nul = memchr(str, '\0', end - *offset);
+    if (nul == NULL) {
+        return NULL;
+    }
+    *offset += (size_t)(nul - str) + 1u;
+    /* El TAD guarda char*, pero un scommand borrowed nunca escribe sus
+       cadenas */
+    return (char*)str;
+}
+
+/* Indica si cmd tiene las listas y las cadenas de su clase de compuesto
+ * (ver scommand_kind)
+ */
+static bool compound_is_well_formed(const scommand cmd) {
+    unsigned int lists = g_slist_length(cmd->lists);
+    unsigned int argc = g_slist_length(cmd->args);
+    bool ok = true;
+    switch (cmd->kind) {
+    case SCOMMAND_IF:
+        ok = lists >= 2u && argc == 0u;
+        break;
+    case SCOMMAND_WHILE:
+    case SCOMMAND_UNTIL:
+        ok = lists == 2u && argc == 0u;
+        break;
+    case SCOMMAND_FOR:
+        ok = lists == 1u && argc >= 1u;
+        break;
+    case SCOMMAND_CASE:
+        ok = lists % 2u == 0u && argc == 1u;
+        for (GSList* xs = cmd->lists; xs != NULL && ok;
+             xs = g_slist_next(g_slist_next(xs))) {
+            ok = pipeline_length(xs->data) == 1u &&
+                 !scommand_is_empty(pipeline_get_nth(xs->data, 0u));
+        }
+        break;
+    default:
+        ok = lists == 1u && argc == 0u;
+    }
+    return ok;
+}
+
+/* Arma un scommand borrowed a partir del registro en buf + offset.
+ * Devuelve NULL si el registro está mal formado.
+ */
+static scommand scommand_deserialize(const char* buf, size_t offset,
+                                     size_t end) {
+    if (offset % 4u != 0u || offset + 2u * sizeof(uint32_t) > end) {
+        return NULL;
+    }
+    uint32_t argc = get_u32(buf, offset);
+    uint32_t flags = get_u32(buf, offset + 4u);
+    offset += 2u * sizeof(uint32_t);
+
+    scommand cmd = scommand_new();
+    cmd->borrowed = true;
+    bool ok = true;
+
+    if (flags & SERIAL_HAS_REDIRS) {
+        ok = offset + sizeof(uint32_t) <= end;
+        uint32_t count = ok ? get_u32(buf, offset) : 0u;
+        offset += sizeof(uint32_t);
+        ok = ok && count > 0u &&
+             count <= (end - offset) /
+                          (SERIAL_REDIR_WORDS * sizeof(uint32_t));
+        for (uint32_t j = 0u; ok && j < count; j++) {
+            uint32_t kind = get_u32(buf, offset);
+            int32_t fd = (int32_t)get_u32(buf, offset + 4u);
+            int32_t source = (int32_t)get_u32(buf, offset + 8u);
+            offset += SERIAL_REDIR_WORDS * sizeof(uint32_t);
+            ok = kind <= SCOMMAND_REDIR_CLOSE && 0 <= fd &&
+                 fd <= SCOMMAND_MAX_FD &&
+                 (kind == SCOMMAND_REDIR_DUP) ==
+                     (0 <= source && source <= SCOMMAND_MAX_FD);
+            if (ok) {
+                // Los archivos se toman después, con las demás cadenas
+                cmd->redirs = g_slist_prepend(
+                    cmd->redirs,
+                    redir_new((scommand_redir_kind)kind, fd, source, NULL));
+            }
+        }
+        cmd->redirs = g_slist_reverse(cmd->redirs);
+    }
+    if (ok && (flags & SERIAL_HAS_IN)) {
+        cmd->redir_in = take_string(buf, &offset, end);
+        ok = cmd->redir_in != NULL;
+    }
+    if (ok && (flags & SERIAL_HAS_OUT)) {
+        cmd->redir_out = take_string(buf, &offset, end);
+        ok = cmd->redir_out != NULL;
+    }
+    for (GSList* xs = cmd->redirs; ok && xs != NULL; xs = g_slist_next(xs)) {
+        scommand_redir* redir = xs->data;
+        if (redir->kind != SCOMMAND_REDIR_DUP &&
+            redir->kind != SCOMMAND_REDIR_CLOSE) {
+            redir->target = take_string(buf, &offset, end);
+            ok = redir->target != NULL;
+        }
+    }
+    // Se arma la lista al revés y se la da vuelta para no recorrerla en
+    // cada append
+    for (uint32_t j = 0u; ok && j < argc; j++) {
+        char* arg = take_string(buf, &offset, end);
+        ok = arg != NULL;
+        if (ok) {
+            cmd->args = g_slist_prepend(cmd->args, arg);
+        }
+    }
+    cmd->args = g_slist_reverse(cmd->args);
+
+    uint32_t kind = (flags >> 8) & 0xffu;
+    if (ok && (flags & SERIAL_HAS_LISTS)) {
+        // Cada lista es otra serialización, después de las cadenas
+        offset = align4(offset);
+        ok = offset + sizeof(uint32_t) <= end && kind != SCOMMAND_SIMPLE &&
+             kind <= SCOMMAND_CASE;
+        uint32_t count = ok ? get_u32(buf, offset) : 0u;
+        offset += sizeof(uint32_t);
+        cmd->kind = ok ? (scommand_kind)kind : SCOMMAND_SIMPLE;
+        for (uint32_t j = 0u; ok && j < count; j++) {
+            ok = offset + sizeof(uint32_t) <= end;
+            size_t size = ok ? get_u32(buf, offset) : 0u;
+            offset += sizeof(uint32_t);
+            ok = ok && size <= end - offset;
+            pipeline list =
+                ok ? pipeline_deserialize(buf + offset, size) : NULL;
+            ok = list != NULL;
+            if (ok) {
+                cmd->lists = g_slist_prepend(cmd->lists, list);
+                offset += size;
+            }
+        }
+        cmd->lists = g_slist_reverse(cmd->lists);
+        ok = ok && compound_is_well_formed(cmd);
+    }
+
+    if (!ok) {
+        cmd = scommand_destroy(cmd);
+    }
+    return cmd;
+}
+
+pipeline pipeline_deserialize(const void* buffer, size_t size) {
+    assert(buffer != NULL);
+
+    const char* buf = buffer;
+    size_t header = SERIAL_HEADER_WORDS * sizeof(uint32_t);
+    if (size < header || get_u32(buf, 0u) != SERIAL_MAGIC ||
+        (get_u32(buf, 4u) & 0xffffu) != SERIAL_VERSION) {
+        return NULL;
+    }
+    uint32_t flags = get_u32(buf, 4u) >> 16;
+    size_t total = get_u32(buf, 8u);
+    uint32_t n = get_u32(buf, 12u);
+    if (total > size || total < header ||
+        n > (total - header) / sizeof(uint32_t)) {
+        return NULL;
+    }
+
+    uint32_t connector = (flags >> SERIAL_CONNECTOR_SHIFT) &
+                         SERIAL_CONNECTOR_MASK;
+    if (connector > PIPELINE_OR) {
+        return NULL;
+    }
+
+    pipeline result = pipeline_new();
+    result->data->wait = (flags & SERIAL_WAIT) != 0u;
+    result->data->connector = (pipeline_connector)connector;
+    for (uint32_t i = 0u; i < n && result != NULL; i++) {
+        size_t offset = get_u32(buf, header + i * sizeof(uint32_t));
+        scommand cmd = scommand_deserialize(buf, offset, total);
+        if (cmd == NULL) {
+            result = pipeline_destroy(result);
+        } else {
+            result->data->scmds = g_slist_prepend(result->data->scmds, cmd);
+        }
+    }
+    if (result != NULL && (flags & SERIAL_HAS_NEXT)) {
+        // El resto de la lista empieza donde termina este
+        result->data->next = pipeline_deserialize(buf + total, size - total);
+        if (result->data->next == NULL) {
+            result = pipeline_destroy(result);
+        }
+    }
+    if (result != NULL) {
+        result->data->scmds = g_slist_reverse(result->data->scmds);
+        result->data->read_only = true;
+    }
+
+    return result;
+}
@@ -8,6 +8,7 @@
 #define COMMAND_H
 
 #include <stdbool.h> /* para tener bool */
+#include <stddef.h>  /* para tener size_t */
 
 /* scommand: comando simple.
  * Ejemplo: ls -l ej1.c > out < in
@@ -15,6 +16,8 @@
  * comando y desde la segunda se denominan argumentos.
  * Almacena dos cadenas que representan los redirectores de entrada y salida.
  * Cualquiera de ellos puede estar NULL indicando que no hay redirección.
+ * Las demás (de otros descriptores, de duplicado...) van en una lista
+ * aparte, en orden (ver scommand_redir_kind).
  *
  * En general, todas las operaciones hacen que el TAD adquiera propiedad de
  * los argumentos que le pasan. Es decir, el llamador queda desligado de la
@@ -30,6 +33,79 @@
  */
 typedef struct scommand_s* scommand;
 
+/* Ver más abajo; las listas de los compuestos son pipelines */
+typedef struct pipeline_s* pipeline;
+
+/* Las palabras (argumentos o redirecciones) que empiezan con este caracter
+ * tienen expansiones pendientes ($NOMBRE, ver expand.h): después de la marca
+ * viene el texto tal cual se escribió, con las comillas, porque qué se
+ * expande depende de ellas. Se expanden al ejecutar, no al parsear, así el
+ * mismo comando se puede ejecutar muchas veces con distintos valores.
+ */
+#define SCOMMAND_EXPAND_MARK '\001'
+
+/* Clase de comando. Un comando simple tiene sus cadenas; los compuestos
+ * tienen listas de pipelines (ver pipeline_get_next) que se ejecutan con
+ * las redirecciones del comando:
+ *   { l; }   SCOMMAND_BRACE_GROUP: l en el mismo shell
+ *   ( l )    SCOMMAND_SUBSHELL: como en otro shell, los cambios de estado
+ *            (cd, variables, exit) no se ven afuera
+ *   if c1; then l1; elif c2; then l2; else l3; fi
+ *            SCOMMAND_IF: las listas c1, l1, c2, l2, l3 (puede haber
+ *            cualquier cantidad de elif, y con else la cantidad es impar)
+ *   while c; do l; done
+ *            SCOMMAND_WHILE: c y l (SCOMMAND_UNTIL con until: l mientras
+ *            c falle)
+ *   for x in a b; do l; done
+ *            SCOMMAND_FOR: l; las cadenas son x, a y b
+ *   case w in p1 | p2) l1;; p3) l2;; esac
+ *            SCOMMAND_CASE: la cadena es w, y cada cláusula son dos
+ *            listas: un pipeline de un comando cuyas cadenas son los
+ *            patrones, y lo que se ejecuta (que puede estar vacío)
+ * Los grupos no tienen cadenas. Las listas no cambian al ejecutarlas: un
+ * ciclo vuelve a ejecutar las mismas en cada vuelta.
+ */
+typedef enum {
+    SCOMMAND_SIMPLE,
+    SCOMMAND_BRACE_GROUP,
+    SCOMMAND_SUBSHELL,
+    SCOMMAND_IF,
+    SCOMMAND_WHILE,
+    SCOMMAND_UNTIL,
+    SCOMMAND_FOR,
+    SCOMMAND_CASE
+} scommand_kind;
+
+/* Redirecciones generales, además de la de entrada y la de salida: con el
+ * número del descriptor que cambian (n), de duplicado y de cierre.
+ *   n< arch   SCOMMAND_REDIR_INPUT: n lee de arch
+ *   n> arch   SCOMMAND_REDIR_OUTPUT: n escribe en arch (se crea si no está)
+ *   n>> arch  SCOMMAND_REDIR_APPEND: como la anterior, pero siempre al final
+ *             del archivo (O_APPEND)
+ *   n>&m      SCOMMAND_REDIR_DUP: n pasa a ser una copia de m (también n<&m)
+ *   n>&-      SCOMMAND_REDIR_CLOSE: n se cierra (también n<&-)
+ * Se aplican en el orden en que se agregaron, después de la redirección de
+ * entrada y la de salida: en "cmd > out 2>&1" el error va a out, y en
+ * "cmd 2>&1 > out" va a donde iba la salida antes.
+ */
+typedef enum {
+    SCOMMAND_REDIR_INPUT,
+    SCOMMAND_REDIR_OUTPUT,
+    SCOMMAND_REDIR_APPEND,
+    SCOMMAND_REDIR_DUP,
+    SCOMMAND_REDIR_CLOSE
+} scommand_redir_kind;
+
+/* Descriptor más grande que puede cambiar una redirección */
+#define SCOMMAND_MAX_FD 255
+
+typedef struct {
+    scommand_redir_kind kind;
+    int fd;       // el descriptor que cambia
+    int source;   // de qué descriptor es copia (SCOMMAND_REDIR_DUP), o -1
+    char* target; // el archivo (las que abren uno), o NULL
+} scommand_redir;
+
 /*
  * Nuevo `scommand', sin comandos o argumentos y los redirectores vacíos
  *   Returns: nuevo comando simple sin ninguna cadena y redirectores vacíos.
@@ -83,8 +159,84 @@ void scommand_set_redir_in(scommand self, char* filename);
  */
 void scommand_set_redir_out(scommand self, char* filename);
 
+/*
+ * Agrega una redirección general al final de las de self (ver
+ * scommand_redir_kind).
+ *   fd: el descriptor que cambia.
+ *   source: de qué descriptor es copia, solo en SCOMMAND_REDIR_DUP (si no,
+ *     -1).
+ *   target: el archivo, solo en las que abren uno (si no, NULL). El TAD se
+ *     apropia de la referencia.
+ * Requires: self != NULL && 0 <= fd <= SCOMMAND_MAX_FD &&
+ *     (kind == SCOMMAND_REDIR_DUP) == (0 <= source <= SCOMMAND_MAX_FD) &&
+ *     (kind == SCOMMAND_REDIR_DUP || kind == SCOMMAND_REDIR_CLOSE) ==
+ *     (target == NULL)
+ * Ensures: scommand_redir_count(self) aumenta en 1
+ */
+void scommand_add_redir(scommand self, scommand_redir_kind kind, int fd,
+                        int source, char* target);
+
+/*
+ * Convierte self en un comando compuesto de la clase kind, todavía sin
+ * listas. Las redirecciones de self quedan como las del compuesto, y las
+ * cadenas que se agreguen después son las suyas (ver scommand_kind).
+ * Requires: self != NULL && kind != SCOMMAND_SIMPLE &&
+ *     scommand_get_kind(self) == SCOMMAND_SIMPLE && scommand_is_empty(self)
+ * Ensures: scommand_get_kind(self) == kind && scommand_list_count(self) == 0
+ */
+void scommand_set_kind(scommand self, scommand_kind kind);
+
+/*
+ * Agrega por detrás una lista al comando compuesto self.
+ *   list: el primer pipeline de la lista. El TAD se apropia del pipeline.
+ * Requires: self != NULL && list != NULL &&
+ *     scommand_get_kind(self) != SCOMMAND_SIMPLE
+ */
+void scommand_add_list(scommand self, pipeline list);
+
+/*
+ * Convierte self en un compuesto con `body' como primera lista: es
+ * scommand_set_kind seguido de scommand_add_list.
+ *   kind: SCOMMAND_BRACE_GROUP o SCOMMAND_SUBSHELL, o cualquier otra clase
+ *       de compuesto
+ *   body: el TAD se apropia del pipeline.
+ * Requires: self != NULL && body != NULL && kind != SCOMMAND_SIMPLE &&
+ *     scommand_get_kind(self) == SCOMMAND_SIMPLE && scommand_is_empty(self)
+ * Ensures: scommand_get_kind(self) == kind && scommand_is_empty(self)
+ */
+void scommand_set_body(scommand self, scommand_kind kind, pipeline body);
+
 /* Proyectores */
 
+/*
+ * Clase del comando: SCOMMAND_SIMPLE salvo que sea un compuesto.
+ * Requires: self != NULL
+ */
+scommand_kind scommand_get_kind(const scommand self);
+
+/*
+ * Cuerpo de un grupo: la primera lista, o NULL si self no tiene listas
+ * (un comando simple). Sigue siendo propiedad del TAD y no se debe
+ * modificar ni destruir.
+ * Requires: self != NULL
+ * Ensures: scommand_get_kind(self) != SCOMMAND_SIMPLE || result == NULL
+ */
+pipeline scommand_get_body(const scommand self);
+
+/*
+ * Cantidad de listas del comando (0 en un comando simple).
+ * Requires: self != NULL
+ */
+unsigned int scommand_list_count(const scommand self);
+
+/*
+ * La n-ésima lista del comando compuesto. Sigue siendo propiedad del TAD y
+ * no se debe modificar ni destruir.
+ * Requires: self != NULL && n < scommand_list_count(self)
+ * Ensures: result != NULL
+ */
+pipeline scommand_get_list(const scommand self, unsigned int n);
+
 /*
  * Indica si la secuencia de cadenas tiene longitud 0.
  *   self: comando simple a decidir si está vacío.
@@ -142,6 +294,13 @@ char* scommand_get_nth(scommand self, unsigned int n);
  */
 char* scommand_get_redir_in(const scommand self);
 
+/*
+ * Indica si alguna palabra de self (argumento o redirección) tiene
+ * expansiones pendientes, es decir si empieza con SCOMMAND_EXPAND_MARK.
+ * Requires: self != NULL
+ */
+bool scommand_has_expansions(const scommand self);
+
 /*
  * Obtiene los nombres de archivos a donde redirigir la salida.
  *   self: comando simple a decidir si está vacío.
@@ -152,6 +311,20 @@ char* scommand_get_redir_in(const scommand self);
  */
 char* scommand_get_redir_out(const scommand self);
 
+/*
+ * Cantidad de redirecciones generales de self.
+ * Requires: self != NULL
+ */
+unsigned int scommand_redir_count(const scommand self);
+
+/*
+ * La redirección general número n de self, en orden. Sigue siendo
+ * propiedad del TAD.
+ * Requires: self != NULL && n < scommand_redir_count(self)
+ * Ensures: result != NULL
+ */
+const scommand_redir* scommand_get_redir(const scommand self, unsigned int n);
+
 /*
  * Convierte todos los argumentos de self en un arreglo de arreglos, que termina
  * en NULL. Los argumentos son eliminados de self, de forma que self queda vacía
@@ -174,6 +347,28 @@ char* scommand_get_redir_out(const scommand self);
  */
 char** scommand_to_argv(scommand self);
 
+/*
+ * Como scommand_to_argv, pero sin modificar self: devuelve un arreglo nuevo
+ * terminado en NULL cuyas cadenas siguen siendo propiedad del TAD. El
+ * llamador libera solo el arreglo (con free), y no debe modificar ni liberar
+ * las cadenas. El arreglo deja de ser válido si se modifica o destruye self.
+ *
+ * En caso de error de allocado de memoria devuelve NULL.
+ *
+ * Requires: self != NULL
+ * Ensures: argv == NULL || argv[scommand_length(self)] == NULL
+ */
+char** scommand_get_argv(const scommand self);
+
+/*
+ * Copia profunda de self: el resultado es un comando simple nuevo, dueño de
+ * sus propias cadenas, aun cuando self sea de solo lectura.
+ *   Returns: la copia. Si falla la memoria termina el programa.
+ * Requires: self != NULL
+ * Ensures: result != NULL && scommand_length(result) == scommand_length(self)
+ */
+scommand scommand_copy(const scommand self);
+
 /* Pretty printer para hacer debugging/logging.
  * Genera una representación del comando simple en un string (aka "serializar")
  *   self: comando simple a convertir.
@@ -204,9 +399,25 @@ char* scommand_to_string(const scommand self);
  *           ______________________________
  *  front -> | scmd1 | scmd2 | ... | scmdn | <-back
  *           ------------------------------
+ *
+ * Un pipeline puede compartir su contenido con otros (pipeline_clone), con
+ * conteo de referencias. El contenido compartido no se modifica: el primer
+ * modificador que se aplique sobre uno de ellos le hace una copia propia
+ * (copy-on-write), de forma que los demás no ven el cambio.
  */
 
-typedef struct pipeline_s* pipeline;
+/* Cómo sigue la lista después de un pipeline:
+ *   a; b    PIPELINE_SEQUENCE: b se ejecuta siempre (también a & b)
+ *   a && b  PIPELINE_AND: b solo si a terminó bien (estado 0)
+ *   a || b  PIPELINE_OR: b solo si a falló
+ * Si b se saltea, lo que sigue se decide con el estado de a y el conector
+ * de b (en "a && b || c", c se ejecuta si a falla).
+ */
+typedef enum {
+    PIPELINE_SEQUENCE,
+    PIPELINE_AND,
+    PIPELINE_OR
+} pipeline_connector;
 
 /*
  * Nuevo `pipeline', sin comandos simples y establecido para que espere.
@@ -225,6 +436,17 @@ pipeline pipeline_new(void);
  */
 pipeline pipeline_destroy(pipeline self);
 
+/*
+ * Clona `self' en tiempo constante, compartiendo el contenido.
+ * El clon es un pipeline independiente para el llamador (se destruye con
+ * pipeline_destroy y se puede modificar sin afectar a self, ver copy-on-write
+ * arriba). Se pueden clonar y destruir clones desde distintos hilos.
+ *   Returns: nuevo pipeline con el mismo contenido que self.
+ * Requires: self != NULL
+ * Ensures: result != NULL && result != self
+ */
+pipeline pipeline_clone(const pipeline self);
+
 /* Modificadores */
 
 /*
@@ -251,8 +473,38 @@ void pipeline_pop_front(pipeline self);
  */
 void pipeline_set_wait(pipeline self, const bool w);
 
+/*
+ * Encadena `next' después de self: una lista de pipelines que se ejecutan
+ * uno después del otro (a; b; c). next puede tener a su vez otro siguiente.
+ *   next: el TAD se apropia del pipeline.
+ * Requires: self != NULL && next != NULL && next != self &&
+ *     pipeline_get_next(self) == NULL
+ * Ensures: pipeline_get_next(self) != NULL
+ */
+void pipeline_set_next(pipeline self, pipeline next);
+
+/*
+ * Define cómo se pasa de self al siguiente de la lista. Al comienzo es
+ * PIPELINE_SEQUENCE.
+ * Requires: self != NULL
+ */
+void pipeline_set_connector(pipeline self, pipeline_connector connector);
+
 /* Proyectores */
 
+/*
+ * El pipeline que sigue a self en la lista, o NULL si es el último. Sigue
+ * siendo propiedad del TAD y no se debe modificar ni destruir.
+ * Requires: self != NULL
+ */
+pipeline pipeline_get_next(const pipeline self);
+
+/*
+ * Cómo se pasa de self al siguiente de la lista.
+ * Requires: self != NULL
+ */
+pipeline_connector pipeline_get_connector(const pipeline self);
+
 /*
  * Indica si la secuencia de comandos simples tiene longitud 0.
  *   self: pipeline a decidir si está vacío.
@@ -278,11 +530,22 @@ unsigned int pipeline_length(const pipeline self);
  *      propiedad del TAD.
  *      El resultado no es un "const scommand" ya que el llamador puede
  *      hacer modificaciones en el comando, siempre y cuando no lo destruya.
+ *      Por eso, si el contenido estaba compartido, se hace una copia propia.
  * Requires: self != NULL && !pipeline_is_empty(self)
  * Ensures: result != NULL
  */
 scommand pipeline_front(const pipeline self);
 
+/*
+ * Devuelve el n-esimo comando simple de la secuencia, solo para lectura:
+ * a diferencia de pipeline_front, nunca copia el contenido, y el llamador no
+ * debe modificar ni destruir el comando devuelto.
+ *
+ * Requires: self != NULL && n < pipeline_length(self)
+ * Ensures: result != NULL
+ */
+scommand pipeline_get_nth(const pipeline self, unsigned int n);
+
 /*
  * Consulta si el pipeline tiene que esperar o no.
  *   self: pipeline a decidir si hay que esperar.
@@ -303,4 +566,59 @@ bool pipeline_get_wait(const pipeline self);
  */
 char* pipeline_to_string(const pipeline self);
 
+/* Serialización binaria compacta.
+ * Aplana el pipeline en un único buffer contiguo, pensado para guardarlo en
+ * el historial o en caches, o mandarlo a otro proceso por un pipe o memoria
+ * compartida, sin tener que volver a parsear.
+ *
+ * Formato (todos los enteros son uint32_t en el orden de bytes de la
+ * máquina, y cada registro de comando empieza alineado a 4 bytes):
+ *
+ *   header:  magic "MBPL" | versión (16 bits) | flags (16 bits, bit 0: wait,
+ *            bit 1: hay siguiente, bits 2 y 3: conector) | tamaño total
+ *            | n (cantidad de comandos)
+ *   offsets: n offsets, desde el comienzo del buffer, a cada registro
+ *   registro de comando simple:
+ *            argc | flags (bit 0: hay redir_in, bit 1: hay redir_out,
+ *            bit 2: es un compuesto, bit 3: hay redirecciones generales,
+ *            bits 8 a 15: su scommand_kind)
+ *            | [r (cantidad) | por cada una: clase | fd | source]
+ *            | [redir_in\0] [redir_out\0] [archivo de cada redirección
+ *            general que abre uno\0] arg0\0 arg1\0 ... arg(argc-1)\0
+ *            | [listas del compuesto, alineadas a 4 bytes]
+ *   listas:  m (cantidad) | por cada una: tamaño | su serialización
+ *
+ * El tamaño total del header no incluye la lista: si hay siguiente, su
+ * serialización (con el mismo formato) empieza en ese offset. Cada lista de
+ * un compuesto es una serialización completa, con sus siguientes.
+ */
+
+/*
+ * Serializa `self' en un buffer nuevo.
+ *   self: pipeline a serializar.
+ *   size: donde se guarda el tamaño en bytes del buffer devuelto.
+ *   Returns: el buffer (propiedad del llamador, se libera con free) o NULL
+ *     en caso de error de alocado de memoria.
+ * Requires: self != NULL && size != NULL
+ * Ensures: result == NULL || *size > 0
+ */
+void* pipeline_serialize(const pipeline self, size_t* size);
+
+/*
+ * Construye un pipeline de solo lectura a partir de un buffer generado por
+ * pipeline_serialize. Los argumentos y redirecciones del resultado apuntan
+ * dentro de `buffer' (no se copian), por lo que el buffer tiene que seguir
+ * vivo y sin modificarse mientras exista el pipeline.
+ *
+ * El pipeline devuelto se puede consultar y convertir a string, y se libera
+ * con pipeline_destroy (que no toca el buffer), pero no se puede modificar:
+ * los modificadores de pipeline y de sus comandos simples fallan por assert.
+ *
+ *   buffer: datos serializados.
+ *   size: tamaño en bytes de buffer.
+ *   Returns: el pipeline, o NULL si el buffer está mal formado.
+ * Requires: buffer != NULL
+ */
+pipeline pipeline_deserialize(const void* buffer, size_t size);
+
 #endif /* COMMAND_H */
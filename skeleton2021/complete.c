@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "builtin.h"
+#include "complete.h"
+#include "pathindex.h"
+
+/* Máxima cantidad de comandos que se ofrecen */
+#define MAX_COMMANDS 4096u
+
+/* Lo que leyó el hilo de un directorio. Los directorios terminan en '/'. */
+struct listing {
+    char* dir; // ruta absoluta
+    char** names;
+    size_t count;
+    struct timespec read_at;
+};
+
+/* Estado compartido con el hilo que lee los directorios; todo con lock */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup; // hay un directorio pedido, o hay que parar
+    pthread_cond_t done;   // terminó una lectura
+    pthread_t thread;
+    bool running;
+    bool stop;
+    char* requested;         // directorio a leer, NULL si no hay
+    struct listing last;     // la última lectura terminada
+} reader = {.lock = PTHREAD_MUTEX_INITIALIZER,
+            .wakeup = PTHREAD_COND_INITIALIZER,
+            .done = PTHREAD_COND_INITIALIZER,
+            .running = false,
+            .stop = false,
+            .requested = NULL,
+            .last = {NULL, NULL, 0u, {0, 0}}};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static char* checked_strndup(const char* s, size_t n) {
+    char* result = strndup(s, n);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static long elapsed_ms(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000l +
+           (now.tv_nsec - since->tv_nsec) / 1000000l;
+}
+
+/* Agrega una copia de los n bytes de s a la lista */
+static void list_add(char*** list, size_t* count, size_t* capacity,
+                     const char* s, size_t n) {
+    if (*count == *capacity) {
+        *capacity = *capacity > 0u ? 2u * *capacity : 32u;
+        *list = checked_realloc(*list, *capacity * sizeof(char*));
+    }
+    (*list)[*count] = checked_strndup(s, n);
+    (*count)++;
+}
+
+static void listing_free(struct listing* listing) {
+    complete_free(listing->names, listing->count);
+    free(listing->dir);
+    *listing = (struct listing){NULL, NULL, 0u, {0, 0}};
+}
+
+/********** Hilo que lee los directorios **********/
+
+static void listing_read(struct listing* listing, const char* dir) {
+    listing->dir = checked_strndup(dir, strlen(dir));
+    listing->names = NULL;
+    listing->count = 0u;
+    size_t capacity = 0u;
+
+    DIR* d = opendir(dir);
+    if (d != NULL) {
+        struct dirent* entry = NULL;
+        while ((entry = readdir(d)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 ||
+                strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            bool is_dir = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+                struct stat st;
+                is_dir = fstatat(dirfd(d), entry->d_name, &st, 0) == 0 &&
+                         S_ISDIR(st.st_mode);
+            }
+            size_t length = strlen(entry->d_name);
+            list_add(&listing->names, &listing->count, &capacity,
+                     entry->d_name, length + (is_dir ? 1u : 0u));
+            if (is_dir) {
+                listing->names[listing->count - 1u][length] = '/';
+            }
+        }
+        closedir(d);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &listing->read_at);
+}
+
+static void* complete_reader(void* arg) {
+    pthread_mutex_lock(&reader.lock);
+    while (!reader.stop) {
+        if (reader.requested == NULL) {
+            pthread_cond_wait(&reader.wakeup, &reader.lock);
+            continue;
+        }
+        char* dir = reader.requested;
+        reader.requested = NULL;
+        pthread_mutex_unlock(&reader.lock);
+
+        // La lectura (que puede tardar) se hace sin el lock
+        struct listing listing;
+        listing_read(&listing, dir);
+        free(dir);
+
+        pthread_mutex_lock(&reader.lock);
+        listing_free(&reader.last);
+        reader.last = listing;
+        pthread_cond_broadcast(&reader.done);
+    }
+    pthread_mutex_unlock(&reader.lock);
+    return NULL;
+}
+
+static bool reader_start(void) {
+    if (reader.running) {
+        return true;
+    }
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_destroy(&reader.done);
+    pthread_cond_init(&reader.done, &attr);
+    pthread_condattr_destroy(&attr);
+
+    reader.stop = false;
+    int error = pthread_create(&reader.thread, NULL, complete_reader, NULL);
+    if (error != 0) {
+        errno = error;
+        perror("mybash: completar");
+        return false;
+    }
+    reader.running = true;
+    return true;
+}
+
+void complete_stop(void) {
+    if (!reader.running) {
+        return;
+    }
+    pthread_mutex_lock(&reader.lock);
+    reader.stop = true;
+    pthread_cond_broadcast(&reader.wakeup);
+    pthread_mutex_unlock(&reader.lock);
+    pthread_join(reader.thread, NULL);
+    reader.running = false;
+    free(reader.requested);
+    reader.requested = NULL;
+    listing_free(&reader.last);
+}
+
+/********** Candidatos **********/
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Ordena la lista y saca los repetidos */
+static size_t sort_unique(char** list, size_t count) {
+    qsort(list, count, sizeof(char*), compare_names);
+    size_t unique = 0u;
+    for (size_t i = 0u; i < count; i++) {
+        if (unique > 0u && strcmp(list[i], list[unique - 1u]) == 0) {
+            free(list[i]);
+        } else {
+            list[unique] = list[i];
+            unique++;
+        }
+    }
+    return unique;
+}
+
+static size_t complete_command(const char* word, size_t length,
+                               char*** matches) {
+    size_t count = 0u;
+    size_t capacity = 0u;
+    char* prefix = checked_strndup(word, length);
+
+    for (unsigned int i = 0u; builtin_names[i] != NULL; i++) {
+        if (strncmp(builtin_names[i], prefix, length) == 0) {
+            list_add(matches, &count, &capacity, builtin_names[i],
+                     strlen(builtin_names[i]));
+        }
+    }
+    const char* names[MAX_COMMANDS];
+    size_t found = pathindex_complete(prefix, names, MAX_COMMANDS);
+    for (size_t i = 0u; i < found && i < MAX_COMMANDS; i++) {
+        list_add(matches, &count, &capacity, names[i], strlen(names[i]));
+    }
+    free(prefix);
+    return count;
+}
+
+/* Pide la lectura de dir, y espera a lo sumo COMPLETE_WAIT_MS una lectura
+ * reciente de ese directorio. Copia a matches los nombres que empiezan con
+ * prefix, precedidos por lead.
+ */
+static size_t complete_listing(const char* dir, const char* lead,
+                               size_t lead_length, const char* prefix,
+                               size_t prefix_length, char*** matches) {
+    size_t count = 0u;
+    size_t capacity = 0u;
+    if (!reader_start()) {
+        return 0u;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += (long)COMPLETE_WAIT_MS * 1000000l;
+    if (deadline.tv_nsec >= 1000000000l) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000l;
+    }
+
+    pthread_mutex_lock(&reader.lock);
+    bool same = reader.last.dir != NULL && strcmp(reader.last.dir, dir) == 0;
+    if (!same || elapsed_ms(&reader.last.read_at) > COMPLETE_LISTING_TTL_MS) {
+        // Si el hilo todavía está leyendo otro, se lee este después
+        free(reader.requested);
+        reader.requested = checked_strndup(dir, strlen(dir));
+        pthread_cond_signal(&reader.wakeup);
+        int error = 0;
+        while (error != ETIMEDOUT &&
+               (reader.last.dir == NULL || strcmp(reader.last.dir, dir) != 0 ||
+                elapsed_ms(&reader.last.read_at) > COMPLETE_LISTING_TTL_MS)) {
+            error = pthread_cond_timedwait(&reader.done, &reader.lock,
+                                           &deadline);
+        }
+        // Si no llegó a tiempo, sirve la lectura vieja del mismo directorio
+        same = reader.last.dir != NULL && strcmp(reader.last.dir, dir) == 0;
+    }
+    if (same) {
+        for (size_t i = 0u; i < reader.last.count; i++) {
+            const char* name = reader.last.names[i];
+            // Los ocultos solo si se empezó a escribir el punto
+            if ((name[0] == '.' && (prefix_length == 0u || prefix[0] != '.')) ||
+                strncmp(name, prefix, prefix_length) != 0) {
+                continue;
+            }
+            size_t name_length = strlen(name);
+            list_add(matches, &count, &capacity, lead, lead_length);
+            char* match = checked_realloc((*matches)[count - 1u],
+                                          lead_length + name_length + 1u);
+            memcpy(match + lead_length, name, name_length + 1u);
+            (*matches)[count - 1u] = match;
+        }
+    }
+    pthread_mutex_unlock(&reader.lock);
+    return count;
+}
+
+static size_t complete_file(const char* word, size_t length, char*** matches) {
+    // word = lead + prefix, donde lead es el directorio (con su '/')
+    const char* slash = memrchr(word, '/', length);
+    size_t lead_length = slash != NULL ? (size_t)(slash - word) + 1u : 0u;
+
+    // El directorio se busca por su ruta absoluta: el directorio actual
+    // puede cambiar antes de que se lea
+    char* dir = NULL;
+    if (lead_length > 0u && word[0] == '/') {
+        dir = checked_strndup(word, lead_length);
+    } else if (lead_length >= 2u && word[0] == '~' && word[1] == '/' &&
+               getenv("HOME") != NULL) {
+        // ~/algo/ es $HOME/algo/
+        const char* home = getenv("HOME");
+        size_t home_length = strlen(home);
+        dir = checked_realloc(NULL, home_length + lead_length);
+        memcpy(dir, home, home_length);
+        memcpy(dir + home_length, word + 1, lead_length - 1u);
+        dir[home_length + lead_length - 1u] = '\0';
+    } else {
+        char* cwd = getcwd(NULL, 0);
+        if (cwd == NULL) {
+            return 0u;
+        }
+        size_t cwd_length = strlen(cwd);
+        dir = checked_realloc(cwd, cwd_length + 1u + lead_length + 1u);
+        dir[cwd_length] = '/';
+        memcpy(dir + cwd_length + 1u, word, lead_length);
+        dir[cwd_length + 1u + lead_length] = '\0';
+    }
+    size_t count = complete_listing(dir, word, lead_length, word + lead_length,
+                                    length - lead_length, matches);
+    free(dir);
+    return count;
+}
+
+/* Indica si la palabra que empieza en start es la primera de un comando */
+static bool command_position(const char* line, size_t start) {
+    while (start > 0u && line[start - 1u] == ' ') {
+        start--;
+    }
+    return start == 0u || line[start - 1u] == '|' || line[start - 1u] == '&';
+}
+
+size_t complete_word(const char* line, size_t cursor, size_t* start,
+                     char*** matches) {
+    assert(line != NULL && cursor <= strlen(line) && start != NULL &&
+           matches != NULL);
+
+    size_t word_start = cursor;
+    while (word_start > 0u && strchr(" |&<>", line[word_start - 1u]) == NULL) {
+        word_start--;
+    }
+    const char* word = line + word_start;
+    size_t length = cursor - word_start;
+    *start = word_start;
+    *matches = NULL;
+
+    size_t count = 0u;
+    if (command_position(line, word_start) && memchr(word, '/', length) == NULL) {
+        count = complete_command(word, length, matches);
+    } else {
+        count = complete_file(word, length, matches);
+    }
+    return sort_unique(*matches, count);
+}
+
+void complete_free(char** matches, size_t count) {
+    for (size_t i = 0u; i < count; i++) {
+        free(matches[i]);
+    }
+    free(matches);
+}
@@ -0,0 +1,50 @@
+/* Completado de palabras para el editor de línea (Tab).
+ *
+ * La primera palabra de cada comando (al comienzo de la línea, o después de
+ * '|' o '&') se completa con los comandos internos y los ejecutables del
+ * PATH, que salen del índice de pathindex.h. Las demás palabras, y las que
+ * tienen '/', se completan con los archivos del directorio que corresponda.
+ *
+ * Los directorios los lee un hilo aparte, y se espera a lo sumo
+ * COMPLETE_WAIT_MS a que termine: si el directorio está en un disco lento el
+ * Tab no completa nada, pero la terminal no se traba, y el siguiente Tab usa
+ * la lectura que ya terminó.
+ */
+
+#ifndef _COMPLETE_H_
+#define _COMPLETE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Cuánto se espera la lectura de un directorio en cada Tab */
+#define COMPLETE_WAIT_MS 100u
+
+/* Cuánto tiempo se usa la lectura de un directorio sin volver a leerlo */
+#define COMPLETE_LISTING_TTL_MS 2000u
+
+/*
+ * Busca las formas de completar la palabra de `line' que termina en la
+ * posición `cursor'.
+ *   start: dónde se guarda la posición en la que empieza la palabra
+ *   matches: dónde se guarda el arreglo de candidatos (memoria nueva, a
+ *       liberar con complete_free). Cada candidato es la palabra entera ya
+ *       completada; los directorios terminan en '/'
+ * Returns: la cantidad de candidatos, ordenados y sin repetir
+ * Requires: line != NULL && cursor <= strlen(line) && start != NULL
+ *     && matches != NULL
+ */
+size_t complete_word(const char* line, size_t cursor, size_t* start,
+                     char*** matches);
+
+/*
+ * Libera los candidatos de complete_word.
+ */
+void complete_free(char** matches, size_t count);
+
+/*
+ * Para el hilo que lee los directorios, si está corriendo.
+ */
+void complete_stop(void);
+
+#endif
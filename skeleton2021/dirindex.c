@@ -0,0 +1,405 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dirindex.h"
+
+/* El archivo es el encabezado, seguido de capacity entradas y de un espacio
+ * de heap_capacity bytes donde están las rutas (sin '\0'). El archivo solo
+ * crece: otra sesión puede tenerlo mapeado, y lo vuelve a mapear cuando ve
+ * que cambió de tamaño.
+ */
+struct file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t heap_used;
+    uint32_t heap_capacity;
+    float total_rank;
+    uint32_t reserved;
+};
+
+struct dir_entry {
+    uint32_t offset; // de la ruta, dentro del heap
+    uint32_t length;
+    float rank;
+    uint32_t last_access; // segundos desde la época
+};
+
+#define INDEX_MAGIC 0x4944594du // "MYDI"
+#define INDEX_VERSION 1u
+
+#define INITIAL_CAPACITY 256u
+#define INITIAL_HEAP (16u * 1024u)
+
+/* Al envejecer, la suma de los puntos queda en este tanto del máximo */
+#define AGING_FACTOR 0.9f
+
+static struct {
+    int fd;
+    char* data; // el archivo mapeado
+    size_t mapped;
+} index_file = {-1, NULL, 0u};
+
+static struct file_header* header(void) {
+    return (struct file_header*)index_file.data;
+}
+
+static struct dir_entry* entries(void) {
+    return (struct dir_entry*)(index_file.data + sizeof(struct file_header));
+}
+
+static char* heap(void) {
+    return index_file.data + sizeof(struct file_header) +
+           header()->capacity * sizeof(struct dir_entry);
+}
+
+static size_t file_size(uint32_t capacity, uint32_t heap_capacity) {
+    return sizeof(struct file_header) + capacity * sizeof(struct dir_entry) +
+           heap_capacity;
+}
+
+/********** Archivo **********/
+
+/* Mapea el archivo entero, si cambió de tamaño desde la última vez.
+ * Requires: flock tomado
+ */
+static bool remap(void) {
+    struct stat st;
+    if (fstat(index_file.fd, &st) == -1) {
+        return false;
+    }
+    if ((size_t)st.st_size == index_file.mapped) {
+        return index_file.data != NULL;
+    }
+    if (index_file.data != NULL) {
+        munmap(index_file.data, index_file.mapped);
+        index_file.data = NULL;
+        index_file.mapped = 0u;
+    }
+    if ((size_t)st.st_size < sizeof(struct file_header)) {
+        return false;
+    }
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, index_file.fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    index_file.data = map;
+    index_file.mapped = (size_t)st.st_size;
+    return true;
+}
+
+/* Toma el flock (LOCK_SH o LOCK_EX) y deja el archivo mapeado */
+static bool lock_index(int operation) {
+    if (index_file.fd == -1 || flock(index_file.fd, operation) == -1) {
+        return false;
+    }
+    if (!remap()) {
+        flock(index_file.fd, LOCK_UN);
+        return false;
+    }
+    return true;
+}
+
+static void unlock_index(void) {
+    flock(index_file.fd, LOCK_UN);
+}
+
+/* Vuelve a escribir el índice con otra capacidad, sacando las entradas con
+ * menos de min_rank puntos y juntando las rutas al comienzo del heap.
+ * Requires: LOCK_EX tomado
+ */
+static bool rebuild(uint32_t capacity, uint32_t heap_capacity, float min_rank) {
+    struct file_header old = *header();
+    struct dir_entry* kept = malloc((old.count + 1u) * sizeof(struct dir_entry));
+    char* strings = malloc(old.heap_used + 1u);
+    if (kept == NULL || strings == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t count = 0u;
+    uint32_t used = 0u;
+    float total = 0.0f;
+    for (uint32_t i = 0u; i < old.count; i++) {
+        struct dir_entry e = entries()[i];
+        if (e.rank >= min_rank) {
+            memcpy(strings + used, heap() + e.offset, e.length);
+            e.offset = used;
+            used += e.length;
+            total += e.rank;
+            kept[count] = e;
+            count++;
+        }
+    }
+
+    bool result = true;
+    if (capacity != old.capacity || heap_capacity != old.heap_capacity) {
+        result = ftruncate(index_file.fd, (off_t)file_size(capacity,
+                                                            heap_capacity)) == 0 &&
+                 remap();
+    }
+    if (result) {
+        header()->capacity = capacity;
+        header()->heap_capacity = heap_capacity;
+        header()->count = count;
+        header()->heap_used = used;
+        header()->total_rank = total;
+        memcpy(entries(), kept, count * sizeof(struct dir_entry));
+        memcpy(heap(), strings, used);
+    }
+    free(strings);
+    free(kept);
+    return result;
+}
+
+bool dirindex_open(const char* path) {
+    assert(path != NULL);
+
+    dirindex_close();
+    index_file.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (index_file.fd == -1) {
+        perror(path);
+        return false;
+    }
+    bool ok = flock(index_file.fd, LOCK_EX) == 0;
+    struct stat st;
+    if (ok && fstat(index_file.fd, &st) == 0 && st.st_size == 0) {
+        // Índice nuevo
+        ok = ftruncate(index_file.fd,
+                       (off_t)file_size(INITIAL_CAPACITY, INITIAL_HEAP)) == 0 &&
+             remap();
+        if (ok) {
+            *header() = (struct file_header){INDEX_MAGIC, INDEX_VERSION,   0u,
+                                             INITIAL_CAPACITY, 0u,
+                                             INITIAL_HEAP,     0.0f,       0u};
+        }
+    } else {
+        ok = ok && remap();
+    }
+    if (!ok) {
+        perror(path);
+    } else if (header()->magic != INDEX_MAGIC ||
+               header()->version != INDEX_VERSION ||
+               index_file.mapped < file_size(header()->capacity,
+                                             header()->heap_capacity)) {
+        // No se pisa un archivo que no es nuestro
+        fprintf(stderr, "mybash: %s: no es un índice de directorios\n", path);
+        ok = false;
+    }
+    flock(index_file.fd, LOCK_UN);
+    if (!ok) {
+        dirindex_close();
+    }
+    return ok;
+}
+
+void dirindex_close(void) {
+    if (index_file.data != NULL) {
+        munmap(index_file.data, index_file.mapped);
+    }
+    if (index_file.fd != -1) {
+        close(index_file.fd);
+    }
+    index_file.fd = -1;
+    index_file.data = NULL;
+    index_file.mapped = 0u;
+}
+
+size_t dirindex_length(void) {
+    size_t result = 0u;
+    if (lock_index(LOCK_SH)) {
+        result = header()->count;
+        unlock_index();
+    }
+    return result;
+}
+
+/********** Visitas **********/
+
+void dirindex_visit(const char* dir) {
+    assert(dir != NULL && dir[0] == '/');
+
+    size_t length = strlen(dir);
+    if (length > UINT32_MAX / 2u || !lock_index(LOCK_EX)) {
+        return;
+    }
+    /* Envejecimiento: se reducen todos y se olvidan los de menos de un
+       punto. Se hace antes de sumar la visita, para no olvidar justo el
+       directorio al que se entra */
+    if (header()->total_rank + 1.0f > DIRINDEX_MAX_RANK) {
+        float factor = AGING_FACTOR * DIRINDEX_MAX_RANK / header()->total_rank;
+        for (uint32_t i = 0u; i < header()->count; i++) {
+            entries()[i].rank *= factor;
+        }
+        rebuild(header()->capacity, header()->heap_capacity, 1.0f);
+    }
+
+    uint32_t now = (uint32_t)time(NULL);
+    struct dir_entry* found = NULL;
+    for (uint32_t i = 0u; i < header()->count && found == NULL; i++) {
+        struct dir_entry* e = &entries()[i];
+        if (e->length == length && memcmp(heap() + e->offset, dir, length) == 0) {
+            found = e;
+        }
+    }
+
+    bool ok = true;
+    if (found == NULL) {
+        // Si no hay lugar, se duplica lo que falte
+        uint32_t capacity = header()->capacity;
+        uint32_t heap_capacity = header()->heap_capacity;
+        if (header()->count == capacity) {
+            capacity *= 2u;
+        }
+        while (header()->heap_used + length > heap_capacity) {
+            heap_capacity *= 2u;
+        }
+        if (capacity != header()->capacity ||
+            heap_capacity != header()->heap_capacity) {
+            ok = rebuild(capacity, heap_capacity, 0.0f);
+        }
+        if (ok) {
+            found = &entries()[header()->count];
+            *found = (struct dir_entry){header()->heap_used, (uint32_t)length,
+                                        0.0f, now};
+            memcpy(heap() + header()->heap_used, dir, length);
+            header()->heap_used += (uint32_t)length;
+            header()->count++;
+        }
+    }
+    if (ok) {
+        found->rank += 1.0f;
+        found->last_access = now;
+        header()->total_rank += 1.0f;
+    }
+    unlock_index();
+}
+
+/********** Búsqueda **********/
+
+/* Primera aparición de needle en los n bytes de s, sin importar mayúsculas */
+static const char* find_ci(const char* s, size_t n, const char* needle) {
+    size_t length = strlen(needle);
+    for (size_t i = 0u; i + length <= n; i++) {
+        if (strncasecmp(s + i, needle, length) == 0) {
+            return s + i;
+        }
+    }
+    return NULL;
+}
+
+/* Indica si las letras de word aparecen en orden en los n bytes de s */
+static bool subsequence_ci(const char* s, size_t n, const char* word) {
+    for (size_t i = 0u; i < n && *word != '\0'; i++) {
+        if (tolower((unsigned char)s[i]) == tolower((unsigned char)*word)) {
+            word++;
+        }
+    }
+    return *word == '\0';
+}
+
+/* Indica si la ruta path (de length bytes) coincide con las palabras.
+ * Con fuzzy, la última palabra puede tener letras salteadas.
+ */
+static bool matches(const char* path, size_t length, char* const* words,
+                    size_t count, bool fuzzy) {
+    const char* end = path + length;
+    const char* pos = path;
+    for (size_t i = 0u; i + 1u < count; i++) {
+        const char* found = find_ci(pos, (size_t)(end - pos), words[i]);
+        if (found == NULL) {
+            return false;
+        }
+        pos = found + strlen(words[i]);
+    }
+    // La última, en el último componente
+    const char* last = memrchr(path, '/', length);
+    last = last != NULL ? last + 1 : path;
+    if (last < pos) {
+        last = pos;
+    }
+    const char* word = words[count - 1u];
+    if (fuzzy) {
+        return subsequence_ci(last, (size_t)(end - last), word);
+    }
+    return find_ci(last, (size_t)(end - last), word) != NULL;
+}
+
+static float frecency(const struct dir_entry* e, uint32_t now) {
+    uint32_t age = now > e->last_access ? now - e->last_access : 0u;
+    if (age < 3600u) {
+        return e->rank * 4.0f;
+    } else if (age < 86400u) {
+        return e->rank * 2.0f;
+    } else if (age < 604800u) {
+        return e->rank / 2.0f;
+    }
+    return e->rank / 4.0f;
+}
+
+bool dirindex_query(char* const* words, size_t count, char* result,
+                    size_t size) {
+    assert(words != NULL && count > 0u && result != NULL && size > 0u);
+
+    if (!lock_index(LOCK_SH)) {
+        return false;
+    }
+    char* cwd = getcwd(NULL, 0);
+    uint32_t now = (uint32_t)time(NULL);
+    bool found = false;
+    for (unsigned int pass = 0u; pass < 2u && !found; pass++) {
+        /* Se prueban de mejor a peor: se elige el mejor que no se probó
+           todavía (los que se descartan quedan marcados en tried) */
+        bool* tried = calloc(header()->count + 1u, sizeof(bool));
+        if (tried == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+        while (!found) {
+            int64_t best = -1;
+            float best_score = 0.0f;
+            for (uint32_t i = 0u; i < header()->count; i++) {
+                const struct dir_entry* e = &entries()[i];
+                if (tried[i] || !matches(heap() + e->offset, e->length, words,
+                                         count, pass == 1u)) {
+                    continue;
+                }
+                float score = frecency(e, now);
+                if (best == -1 || score > best_score) {
+                    best = i;
+                    best_score = score;
+                }
+            }
+            if (best == -1) {
+                break;
+            }
+            tried[best] = true;
+            const struct dir_entry* e = &entries()[best];
+            if (e->length >= size) {
+                continue;
+            }
+            memcpy(result, heap() + e->offset, e->length);
+            result[e->length] = '\0';
+            struct stat st;
+            found = (cwd == NULL || strcmp(cwd, result) != 0) &&
+                    stat(result, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        free(tried);
+    }
+    free(cwd);
+    unlock_index();
+    return found;
+}
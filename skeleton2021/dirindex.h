@@ -0,0 +1,64 @@
+/* Índice de los directorios visitados, ordenados por "frecencia".
+ *
+ * Cada vez que se entra a un directorio con cd se le suma un punto. Para
+ * elegir entre varios directorios se usa el puntaje pesado por cuánto hace
+ * que se visitó cada uno (x4 en la última hora, x2 en el último día, /2 en
+ * la última semana, /4 si es más viejo). Cuando la suma de los puntos pasa
+ * de DIRINDEX_MAX_RANK se reducen todos, y se olvidan los que quedan en
+ * menos de un punto, así el índice no crece sin límite.
+ *
+ * El índice se guarda en un archivo binario compacto que se mapea en memoria
+ * y que comparten todas las sesiones (con flock para los cambios), así que
+ * buscar no lee ni parsea nada.
+ *
+ * Búsqueda: un directorio coincide con las palabras w1 ... wn si todas
+ * aparecen en su ruta, en ese orden y sin importar mayúsculas, y wn aparece
+ * en el último componente de la ruta. Si ninguno coincide así, se prueban
+ * las letras de wn salteadas en el último componente ("dcm" encuentra
+ * "documentos").
+ */
+
+#ifndef _DIRINDEX_H_
+#define _DIRINDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DIRINDEX_MAX_RANK 10000.0f
+
+/*
+ * Abre (o crea) el índice guardado en `path'. Si ya había uno abierto, lo
+ * cierra antes.
+ * Returns: false si no se pudo abrir (ya se informó el error)
+ * Requires: path != NULL
+ */
+bool dirindex_open(const char* path);
+
+/*
+ * Cierra el índice, si está abierto.
+ */
+void dirindex_close(void);
+
+/*
+ * Anota una visita al directorio `dir'. Si el índice no está abierto no
+ * hace nada.
+ * Requires: dir != NULL && dir es una ruta absoluta
+ */
+void dirindex_visit(const char* dir);
+
+/*
+ * Busca el mejor directorio para las palabras `words' (ver arriba), sin
+ * contar el directorio actual ni los que ya no existen.
+ *   result: dónde se guarda la ruta encontrada
+ * Returns: false si no hay ninguno, o si el índice no está abierto
+ * Requires: words != NULL && count > 0 && result != NULL && size > 0
+ */
+bool dirindex_query(char* const* words, size_t count, char* result,
+                    size_t size);
+
+/*
+ * Cantidad de directorios del índice (0 si no está abierto).
+ */
+size_t dirindex_length(void);
+
+#endif
@@ -1,14 +1,27 @@
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h> // open
+#include <limits.h> // PATH_MAX
+#include <signal.h> // kill
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "argbatch.h"
 #include "builtin.h"
 #include "command.h"
 #include "execute.h"
+#include "expand.h"
+#include "pathexp.h"
+#include "pathindex.h"
+#include "prefetch.h"
+#include "spawnplan.h"
+#include "vars.h"
+#include "zygote.h"
 
 // typedef
 
@@ -21,6 +34,61 @@
  */
 typedef int fd_t;
 
+/* Desde cuántas etapas un pipeline de comandos externos se lanza con
+ * spawnplan (todas juntas) en vez de con un fork por etapa
+ */
+#define CONCURRENT_STAGES 4u
+
+/* Lo que deja lanzar un pipeline: cuántos hijos hay que esperar, cuál es el
+ * de la última etapa (su estado es el del pipeline) y el estado si la
+ * última etapa no fue un hijo (un comando interno o un grupo en el shell)
+ */
+typedef struct {
+    unsigned int children;
+    pid_t last;
+    int status;
+} launch_t;
+
+/* Pipelines en background
+ *
+ * Cada pipeline en background corre en su propio grupo de procesos, cuyo id
+ * es el pid del proceso que lo lanza. El pipeline sigue corriendo mientras
+ * quede algún proceso en el grupo. Se guardan los ids de los grupos (0 es un
+ * lugar libre); la tabla se lee también desde el hilo del prompt, por eso es
+ * atómica.
+ */
+#define MAX_BACKGROUND_JOBS 64u
+static atomic_int background_jobs[MAX_BACKGROUND_JOBS];
+
+/* Guarda el grupo de un pipeline en background. Si la tabla está llena el
+ * pipeline no se cuenta.
+ */
+static void background_job_add(pid_t pgid) {
+    bool added = false;
+    for (unsigned int i = 0u; i < MAX_BACKGROUND_JOBS && !added; i++) {
+        int expected = 0;
+        added = atomic_compare_exchange_strong(&background_jobs[i], &expected,
+                                               (int)pgid);
+    }
+}
+
+unsigned int execute_background_jobs(void) {
+    unsigned int running = 0u;
+    for (unsigned int i = 0u; i < MAX_BACKGROUND_JOBS; i++) {
+        int pgid = atomic_load(&background_jobs[i]);
+        if (pgid == 0) {
+            continue;
+        }
+        // Con la señal 0 solo se pregunta si el grupo tiene procesos
+        if (kill(-pgid, 0) == 0 || errno == EPERM) {
+            running++;
+        } else {
+            atomic_compare_exchange_strong(&background_jobs[i], &pgid, 0);
+        }
+    }
+    return running;
+}
+
 /* Pone, si existe, el archivo de redirección de entrada en el stdin,
  * si no existe no hace nada
  * Returns: EXIT_SUCCESS si la operación fue exitosa
@@ -80,8 +148,10 @@ static int change_file_descriptor_out(scommand cmd) {
     if (redir_out != NULL) {
 
         /*  open como segundo parametro toma flags, en este caso tiene los
-           flags O_WRONLY que hace que el archivo se abra en solo escritura, y
-           O_CREAT que hace que si el archivo no existe, se cree. En el caso de
+           flags O_WRONLY que hace que el archivo se abra en solo escritura,
+           O_CREAT que hace que si el archivo no existe, se cree, y O_TRUNC
+           que lo vacía si ya existía (si no, queda la cola de lo que tenía
+           antes, si era más largo). En el caso de
            estar seeteado O_CREAT, open toma un tercer parametro de flags de
            cración del archivo, en este caso están puestos los flags:
                S_IRUSR: user has read permission
@@ -89,7 +159,7 @@ static int change_file_descriptor_out(scommand cmd) {
              */
 
         fd_t file_redir_out =
-            open(redir_out, O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
+            open(redir_out, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
 
         // Si hay algún error devuelve -1, en caso de que no exista el archivo
         // lo crea, si no hay error retorna el descriptor del archivo
@@ -118,6 +188,62 @@ static int change_file_descriptor_out(scommand cmd) {
     return (EXIT_SUCCESS);
 }
 
+/* Flags de open para una redirección general que abre un archivo: los mismos
+ * que change_file_descriptor_in y change_file_descriptor_out, y O_APPEND
+ * en lugar de O_TRUNC para las que agregan al final
+ */
+static int redirection_flags(scommand_redir_kind kind) {
+    int flags = O_RDONLY;
+    if (kind == SCOMMAND_REDIR_OUTPUT) {
+        flags = O_WRONLY | O_CREAT | O_TRUNC;
+    } else if (kind == SCOMMAND_REDIR_APPEND) {
+        flags = O_WRONLY | O_CREAT | O_APPEND;
+    }
+    return flags;
+}
+
+/* Aplica en orden las redirecciones generales de cmd (ver
+ * scommand_redir_kind), que van después de la de entrada y la de salida
+ * Returns: EXIT_SUCCESS si se pudieron hacer todas
+ *          EXIT_FAILURE si alguna falló (con el error impreso)
+ *
+ * Requires: cmd != NULL
+ *
+ */
+static int apply_redirections(scommand cmd) {
+    assert(cmd != NULL);
+
+    int result = EXIT_SUCCESS;
+    for (unsigned int i = 0u;
+         i < scommand_redir_count(cmd) && result == EXIT_SUCCESS; i++) {
+        const scommand_redir* redir = scommand_get_redir(cmd, i);
+        if (redir->kind == SCOMMAND_REDIR_CLOSE) {
+            // Cerrar uno que ya estaba cerrado no es un error
+            close(redir->fd);
+        } else if (redir->kind == SCOMMAND_REDIR_DUP) {
+            if (dup2(redir->source, redir->fd) == -1) {
+                fprintf(stderr, "%d: %s\n", redir->source, strerror(errno));
+                result = EXIT_FAILURE;
+            }
+        } else {
+            fd_t file = open(redir->target, redirection_flags(redir->kind),
+                             S_IRUSR | S_IWUSR);
+            if (file == -1) {
+                perror(redir->target);
+                result = EXIT_FAILURE;
+            } else if (file != redir->fd) {
+                // Si open ya dio justo ese descriptor no hay que moverlo
+                if (dup2(file, redir->fd) == -1) {
+                    perror("dup2");
+                    result = EXIT_FAILURE;
+                }
+                close(file);
+            }
+        }
+    }
+    return result;
+}
+
 /* Ejecuta un comando como comando externo en el mismo proceso, es decir sin hacer
  * fork, redirigiendo el stdin y el stdout si están seeteados.
  * Si la ejecución es exitosa no retorna por que hace execvp. Si la ejecución
@@ -142,22 +268,42 @@ static void scommand_exec_external(scommand cmd) {
         exit(EXIT_FAILURE);
     }
 
-    char** argv = scommand_to_argv(cmd);
+    // Después, las demás redirecciones en el orden en que se escribieron
+    if (apply_redirections(cmd) != EXIT_SUCCESS) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Las cadenas de argv siguen siendo de cmd, que no se modifica
+    char** argv = scommand_get_argv(cmd);
     if (argv == NULL) {
-        // En caso de que scommand_to_argv falle
+        // En caso de que scommand_get_argv falle
         perror("calloc");
         exit(EXIT_FAILURE);
     }
 
+    /* Si el comando está en el índice del PATH se ejecuta directamente con
+       su ruta, sin que execvp pruebe directorio por directorio. Si no, o si
+       el índice quedó viejo, se busca como siempre */
+    char path[PATH_MAX];
+    if (pathindex_resolve(argv[0], path, sizeof(path))) {
+        execvp(path, argv);
+    }
     execvp(argv[0], argv);
 
     /* Si execvp falla (y por ende retorna) se imprime un mensaje
-      y se termina el programa */
+      y se termina el programa, con 127 si no se encontró y 126 si no se
+      pudo ejecutar */
+    int error = errno;
     perror(argv[0]);
+    if (error == E2BIG) {
+        fprintf(stderr, ARGBATCH_HINT, argv[0]);
+    }
 
-    exit(EXIT_FAILURE);
+    exit(ARGBATCH_EXEC_STATUS(error));
 }
 
+static int run_compound(scommand cmd, bool replace);
+
 /* Ejecuta un comando, tanto si es interno como si es externo y termina la
  * ejecución.
  *
@@ -168,11 +314,36 @@ static void scommand_exec_external(scommand cmd) {
 static void scommand_exec(scommand cmd) {
     assert(cmd != NULL);
 
+    if (scommand_get_kind(cmd) != SCOMMAND_SIMPLE) {
+        // Un compuesto con proceso propio termina con su estado
+        exit(run_compound(cmd, true));
+    }
+
+    if (!scommand_is_empty(cmd) && vars_is_assignment(scommand_front(cmd)) &&
+        !builtin_scommand_is_internal(cmd)) {
+        /* Las asignaciones antes de un comando (A=1 B=2 cmd) son variables
+           exportadas solo para ese comando: como esto ya es el hijo, se
+           exportan acá y se ejecuta el resto */
+        scommand rest = scommand_copy(cmd);
+        while (vars_is_assignment(scommand_front(rest))) {
+            vars_assign(scommand_front(rest), true);
+            scommand_pop_front(rest);
+        }
+        cmd = rest;
+    }
+
     if (builtin_scommand_is_internal(cmd)) {
-        // Si es interno se ejecuta
-        builtin_scommand_exec(cmd);
-        // Y se sale del programa
-        exit(EXIT_SUCCESS);
+        // Si es interno se ejecuta, y se sale del programa con su estado
+        exit(builtin_scommand_exec(cmd));
+    } else if (argbatch_is_prefix(cmd)) {
+        /* batch: las redirecciones se hacen una sola vez, así todas las
+           invocaciones escriben en el mismo archivo sin truncarlo */
+        if (change_file_descriptor_in(cmd) != EXIT_SUCCESS ||
+            change_file_descriptor_out(cmd) != EXIT_SUCCESS ||
+            apply_redirections(cmd) != EXIT_SUCCESS) {
+            exit(EXIT_FAILURE);
+        }
+        exit(argbatch_exec(cmd));
     } else if (!scommand_is_empty(cmd)) {
         // Si es externo y no vacio se lo ejecuta
         scommand_exec_external(cmd);
@@ -185,59 +356,459 @@ static void scommand_exec(scommand cmd) {
     assert(false);
 }
 
+/* Arma el entorno de un comando con asignaciones antes (A=1 B=2 cmd): el
+ * entorno del shell más esas variables, que reemplazan a las que tengan el
+ * mismo nombre.
+ * Returns: memoria nueva (solo el arreglo, las cadenas son de env y argv)
+ */
+static char** command_environment(char** argv, unsigned int assignments) {
+    char* const* env = vars_envp();
+    unsigned int count = 0u;
+    while (env[count] != NULL) {
+        count++;
+    }
+    char** result = malloc((count + assignments + 1u) * sizeof(char*));
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int length = 0u;
+    for (unsigned int i = 0u; i < count; i++) {
+        size_t name = vars_name_length(env[i]);
+        bool replaced = false;
+        for (unsigned int j = 0u; j < assignments && !replaced; j++) {
+            replaced = strncmp(env[i], argv[j], name + 1u) == 0;
+        }
+        if (!replaced) {
+            result[length] = env[i];
+            length++;
+        }
+    }
+    for (unsigned int j = 0u; j < assignments; j++) {
+        result[length] = argv[j];
+        length++;
+    }
+    result[length] = NULL;
+    return result;
+}
+
+/* Las redirecciones de un comando que se lanza sin fork (con el zygote o
+ * con spawnplan) se resuelven en el shell: el comando recibe ya puestos su
+ * entrada, su salida y su error. fds empieza con los que tendría sin
+ * redirecciones y termina con los que le tocan; en spawnplan, -1 en la
+ * entrada o en la salida es el pipe (o el del shell), y SPAWNPLAN_OUTPUT en
+ * el error es la salida sin redirección. opened son los que abrió el plan
+ * (con O_CLOEXEC), que se cierran después de lanzarlo; todos están en fds.
+ */
+typedef struct {
+    fd_t fds[3];
+    fd_t opened[3];
+    unsigned int count;
+} redir_plan;
+
+/* Indica si las redirecciones generales de cmd se pueden resolver en un
+ * redir_plan: si solo cambian la entrada, la salida y el error, sin
+ * cerrarlos y sin copias de la entrada ni en la entrada (las demás las hace
+ * el hijo de un fork, con apply_redirections)
+ *
+ * Requires: cmd != NULL
+ */
+static bool redirections_fit_plan(scommand cmd) {
+    assert(cmd != NULL);
+
+    bool fit = true;
+    for (unsigned int i = 0u; i < scommand_redir_count(cmd) && fit; i++) {
+        const scommand_redir* redir = scommand_get_redir(cmd, i);
+        fit = redir->fd <= STDERR_FILENO &&
+              redir->kind != SCOMMAND_REDIR_CLOSE &&
+              (redir->kind != SCOMMAND_REDIR_DUP ||
+               (redir->fd != STDIN_FILENO && redir->source != STDIN_FILENO &&
+                redir->source <= STDERR_FILENO));
+    }
+    return fit;
+}
+
+static bool plan_owns(const redir_plan* plan, fd_t fd) {
+    bool owned = false;
+    for (unsigned int k = 0u; k < plan->count && !owned; k++) {
+        owned = plan->opened[k] == fd;
+    }
+    return owned;
+}
+
+/* Pone fd en el lugar n de plan (owned: si es del plan). Lo que había antes
+ * se cierra si era del plan y no quedó en ningún otro lugar.
+ */
+static void plan_assign(redir_plan* plan, unsigned int n, fd_t fd,
+                        bool owned) {
+    fd_t old = plan->fds[n];
+    plan->fds[n] = fd;
+    bool used = false;
+    for (unsigned int k = 0u; k < 3u; k++) {
+        used = used || plan->fds[k] == old;
+    }
+    unsigned int k = 0u;
+    while (!used && k < plan->count && plan->opened[k] != old) {
+        k++;
+    }
+    if (!used && k < plan->count) {
+        close(old);
+        plan->count--;
+        plan->opened[k] = plan->opened[plan->count];
+    }
+    if (owned && !plan_owns(plan, fd)) {
+        plan->opened[plan->count] = fd;
+        plan->count++;
+    }
+}
+
+/* Cierra todo lo que abrió plan */
+static void plan_close(redir_plan* plan) {
+    for (unsigned int k = 0u; k < plan->count; k++) {
+        close(plan->opened[k]);
+    }
+    plan->count = 0u;
+}
+
+/* Abre path para el lugar n de plan.
+ * Returns: false si no se pudo (y si report, se imprime el error)
+ */
+static bool plan_open(redir_plan* plan, unsigned int n, const char* path,
+                      int flags, bool report) {
+    fd_t fd = open(path, flags | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1 && report) {
+        perror(path);
+    }
+    if (fd != -1) {
+        plan_assign(plan, n, fd, true);
+    }
+    return fd != -1;
+}
+
+/* El lugar n de plan pasa a ser una copia del lugar source: el mismo
+ * descriptor si es del plan, o una copia si es del shell (para que el plan
+ * la pueda cerrar sin tocar el del shell).
+ * Returns: false si no se pudo copiar (y si report, se imprime el error)
+ */
+static bool plan_dup(redir_plan* plan, unsigned int n, unsigned int source,
+                     bool report) {
+    if (n == source) {
+        return true;
+    }
+    fd_t fd = plan->fds[source];
+    bool owned = plan_owns(plan, fd);
+    if (fd == -1 || fd == SPAWNPLAN_OUTPUT) {
+        /* Solo en spawnplan (con redirections_fit_plan, n y source son la
+           salida y el error): la salida sin redirección va del uno al otro */
+        assert((fd == -1 && n == STDERR_FILENO) ||
+               (fd == SPAWNPLAN_OUTPUT && n == STDOUT_FILENO));
+        fd = fd == -1 ? SPAWNPLAN_OUTPUT : -1;
+    } else if (!owned) {
+        fd = fcntl(fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+        if (fd == -1) {
+            if (report) {
+                perror("fcntl");
+            }
+            return false;
+        }
+        owned = true;
+    }
+    plan_assign(plan, n, fd, owned);
+    return true;
+}
+
+/* Resuelve en plan las redirecciones de cmd, en el mismo orden en que las
+ * hace el hijo de un fork.
+ *   report: si se imprime el error cuando algo no se puede abrir
+ * Returns: false si algo no se pudo abrir (y no queda nada abierto)
+ *
+ * Requires: cmd != NULL && plan != NULL && plan->count == 0 &&
+ *     redirections_fit_plan(cmd)
+ */
+static bool plan_redirections(scommand cmd, bool report, redir_plan* plan) {
+    assert(cmd != NULL && plan != NULL && plan->count == 0u &&
+           redirections_fit_plan(cmd));
+
+    char* redir_in = scommand_get_redir_in(cmd);
+    char* redir_out = scommand_get_redir_out(cmd);
+    bool ok = true;
+    if (redir_in != NULL) {
+        ok = plan_open(plan, STDIN_FILENO, redir_in, O_RDONLY, report);
+    }
+    if (ok && redir_out != NULL) {
+        ok = plan_open(plan, STDOUT_FILENO, redir_out,
+                       O_WRONLY | O_CREAT | O_TRUNC, report);
+    }
+    for (unsigned int i = 0u; ok && i < scommand_redir_count(cmd); i++) {
+        const scommand_redir* redir = scommand_get_redir(cmd, i);
+        if (redir->kind == SCOMMAND_REDIR_DUP) {
+            ok = plan_dup(plan, (unsigned int)redir->fd,
+                          (unsigned int)redir->source, report);
+        } else {
+            ok = plan_open(plan, (unsigned int)redir->fd, redir->target,
+                           redirection_flags(redir->kind), report);
+        }
+    }
+    if (!ok) {
+        plan_close(plan);
+    }
+    return ok;
+}
+
+/* Lanza el comando externo cmd con el zygote, con in y out como entrada y
+ * salida (antes de sus redirecciones).
+ * Returns: el pid, o -1 si no se puede (y hay que hacer fork, que también
+ *     muestra los errores de las redirecciones)
+ *
+ * Requires: cmd != NULL
+ */
+static pid_t spawn_with_zygote(scommand cmd, fd_t in, fd_t out) {
+    assert(cmd != NULL);
+
+    if (!zygote_available() || scommand_get_kind(cmd) != SCOMMAND_SIMPLE ||
+        scommand_is_empty(cmd) || builtin_scommand_is_internal(cmd) ||
+        argbatch_is_prefix(cmd) || !redirections_fit_plan(cmd)) {
+        return -1;
+    }
+    char** argv = scommand_get_argv(cmd);
+    if (argv == NULL) {
+        return -1;
+    }
+    unsigned int assignments = 0u;
+    bool sets_path = false;
+    while (argv[assignments] != NULL && vars_is_assignment(argv[assignments])) {
+        sets_path = sets_path || strncmp(argv[assignments], "PATH=", 5u) == 0;
+        assignments++;
+    }
+    if (argv[assignments] == NULL) {
+        free(argv);
+        return -1;
+    }
+
+    // Las redirecciones se abren acá y el comando las recibe ya abiertas
+    redir_plan plan = {{in, out, STDERR_FILENO}, {-1, -1, -1}, 0u};
+    pid_t pid = -1;
+    if (plan_redirections(cmd, false, &plan)) {
+        char* const* envp = vars_envp();
+        char** merged = NULL;
+        if (assignments > 0u) {
+            merged = command_environment(argv, assignments);
+            envp = merged;
+        }
+        /* El índice es del PATH del shell: con un PATH=... antes, el
+           comando se busca en el de envp */
+        char path[PATH_MAX];
+        bool resolved =
+            !sets_path &&
+            pathindex_resolve(argv[assignments], path, sizeof(path));
+        pid = zygote_spawn(resolved ? path : NULL, argv + assignments, envp,
+                           plan.fds);
+        free(merged);
+        plan_close(&plan);
+    }
+    free(argv);
+    return pid;
+}
+
+/* Indica si ejecutar la lista de un subshell en el shell cambiaría su
+ * estado: si tiene comandos internos (cd, exit, asignaciones...) que no
+ * estén en un pipeline de varias etapas (esos ya corren en un hijo),
+ * palabras a expandir al comienzo de un comando (podrían dar uno interno),
+ * palabras cuya expansión asigna (expand_assigns; se expanden en el shell
+ * aunque el comando corra en un hijo), pipelines en background o un for
+ * (que asigna su variable). Los subshells de adentro no cuentan, porque se
+ * aíslan solos (salvo sus redirecciones); los demás compuestos sí, por sus
+ * listas.
+ *
+ * Requires: list != NULL
+ */
+static bool list_changes_state(pipeline list) {
+    assert(list != NULL);
+
+    for (pipeline p = list; p != NULL; p = pipeline_get_next(p)) {
+        if (!pipeline_get_wait(p)) {
+            return true;
+        }
+        for (unsigned int i = 0u; i < pipeline_length(p); i++) {
+            if (expand_assigns(pipeline_get_nth(p, i))) {
+                return true;
+            }
+        }
+        if (pipeline_length(p) != 1u) {
+            continue;
+        }
+        scommand cmd = pipeline_get_nth(p, 0u);
+        scommand_kind kind = scommand_get_kind(cmd);
+        // En un case las listas pares son los patrones
+        unsigned int step = kind == SCOMMAND_CASE ? 2u : 1u;
+        if (kind == SCOMMAND_FOR) {
+            return true;
+        } else if (kind != SCOMMAND_SIMPLE && kind != SCOMMAND_SUBSHELL) {
+            for (unsigned int i = step - 1u; i < scommand_list_count(cmd);
+                 i += step) {
+                if (list_changes_state(scommand_get_list(cmd, i))) {
+                    return true;
+                }
+            }
+        } else if (kind == SCOMMAND_SIMPLE &&
+                   !scommand_is_empty(cmd) &&
+                   (scommand_front(cmd)[0] == SCOMMAND_EXPAND_MARK ||
+                    builtin_scommand_is_internal(cmd))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Ejecuta un pipeline de un solo comando tanto si es interno como si es externo
  * en caso de ser externo hace fork pero en caso de ser interno no.
+ * Un compuesto se ejecuta en el shell si inline_groups y no tiene que
+ * aislarse (un subshell que cambia el estado); si no, en un hijo.
  * Retorna la cantidad de hijos creados (0 o 1)
  *
  * Requires: apipe != NULL && pipeline_length(apipe) == 1
  * 
  * Ensures: child_processes_running == 0 || child_processes_running == 1
  */
-static unsigned int single_command(pipeline apipe) {
+static launch_t single_command(pipeline apipe, bool inline_groups) {
     assert(apipe != NULL && pipeline_length(apipe) == 1);
 
-    unsigned int child_processes_running = 0u;
+    launch_t result = {0u, -1, EXIT_SUCCESS};
+    scommand cmd = pipeline_get_nth(apipe, 0u);
+    scommand_kind kind = scommand_get_kind(cmd);
+    pid_t pid = -1;
 
-    if (builtin_scommand_is_single_internal(apipe)) {
+    if (kind != SCOMMAND_SIMPLE && inline_groups &&
+        (kind != SCOMMAND_SUBSHELL ||
+         !list_changes_state(scommand_get_body(cmd)))) {
+        // El compuesto corre en el shell, sin ningún fork para él
+        result.status = run_compound(cmd, false);
+    } else if (builtin_scommand_is_single_internal(apipe)) {
         // Caso en el que comando es interno
-        builtin_single_pipeline_exec(apipe);
+        result.status = builtin_single_pipeline_exec(apipe);
+    } else if ((pid = spawn_with_zygote(cmd, STDIN_FILENO, STDOUT_FILENO)) >
+               0) {
+        // Lo lanzó el zygote, sin hacer fork del shell
+        result.children++;
+        result.last = pid;
     } else {
         //Caso en el que el comando es externo y se debe hacer fork()
-        pid_t pid = fork();
+        // El hijo de un grupo no tiene que repetir lo que el shell no escribió
+        fflush(stdout);
+        pid = fork();
         if (pid < 0) {
             // En caso de error
             perror("fork");
-            return child_processes_running;
+            result.status = EXIT_FAILURE;
+            return result;
         } else if (pid == 0) {
             // El hijo
-            scommand_exec(pipeline_front(apipe));
+            scommand_exec(cmd);
             // scommand_exec no retorna
         } else {
             // El padre
             // Se cuenta un hijo
-            child_processes_running++;
+            result.children++;
+            result.last = pid;
         }
     }
 
-    assert(child_processes_running == 0 || child_processes_running == 1);
+    assert(result.children == 0 || result.children == 1);
+
+    return result;
+}
 
-    return child_processes_running;
+/* Indica si cmd es un comando externo común, sin asignaciones antes ni el
+ * prefijo batch, y con redirecciones que se pueden resolver en el shell:
+ * uno que se puede lanzar directamente con su argv.
+ *
+ * Requires: cmd != NULL
+ */
+static bool is_plain_external(scommand cmd) {
+    assert(cmd != NULL);
+
+    return scommand_get_kind(cmd) == SCOMMAND_SIMPLE &&
+           !scommand_is_empty(cmd) && !builtin_scommand_is_internal(cmd) &&
+           !argbatch_is_prefix(cmd) &&
+           !vars_is_assignment(scommand_front(cmd)) &&
+           redirections_fit_plan(cmd);
+}
+
+/* Ejecuta un pipeline de comandos externos comunes con spawnplan: arma el
+ * plan de todas las etapas (argv, ruta y redirecciones) y después las
+ * lanza todas juntas, desde varios hilos. Una etapa cuya redirección no se
+ * puede abrir no se lanza (como el hijo que hace fork y termina).
+ * Returns: los hijos creados
+ *
+ * Requires: apipe != NULL && pipeline_length(apipe) >= 2
+ */
+static launch_t concurrent_commands(pipeline apipe) {
+    assert(apipe != NULL && pipeline_length(apipe) >= 2u);
+
+    unsigned int length = pipeline_length(apipe);
+    spawnplan plan = spawnplan_new(length);
+    for (unsigned int i = 0u; i < length; i++) {
+        scommand cmd = pipeline_get_nth(apipe, i);
+        char** argv = scommand_get_argv(cmd);
+        if (argv == NULL) {
+            perror("calloc");
+            continue;
+        }
+        // Lo que abre redirs pasa a ser del plan
+        redir_plan redirs = {{-1, -1, STDERR_FILENO}, {-1, -1, -1}, 0u};
+        if (!plan_redirections(cmd, true, &redirs)) {
+            free(argv);
+            continue;
+        }
+        char path[PATH_MAX];
+        bool resolved = pathindex_resolve(argv[0], path, sizeof(path));
+        spawnplan_set_stage(plan, i, resolved ? path : NULL, argv,
+                            redirs.fds[0], redirs.fds[1]);
+        if (redirs.fds[2] != STDERR_FILENO) {
+            spawnplan_set_error(plan, i, redirs.fds[2]);
+        }
+    }
+    launch_t result = {0u, -1, EXIT_FAILURE};
+    pid_t* pids = malloc(length * sizeof(pid_t));
+    if (pids == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    result.children = spawnplan_run(plan, pids);
+    result.last = pids[length - 1u];
+    if (result.last == -1) {
+        result.status = spawnplan_failure_status(plan, length - 1u);
+    }
+    free(pids);
+    plan = spawnplan_destroy(plan);
+    return result;
 }
 
 /* Ejecutá un pipeline de multiples comandos (2 o mas) haciendo fork para cada comando
- * (incluso para los internos) y retorna la cantidad de hijos creados
+ * (incluso para los internos y los grupos, que usan un solo proceso cada
+ * uno) y retorna los hijos creados
  * 
- * Puede modificar apipe pero no destruirlo, en caso de que no haya ningún error,
- * deja vacio a apipe
+ * No modifica apipe
  *
  * Requires: apipe != NULL && pipeline_length(apipe) >= 2
  * 
  * Ensures: apipe != NULL
  */
-static unsigned int multiple_commands(pipeline apipe) {
+static launch_t multiple_commands(pipeline apipe) {
     assert(apipe != NULL && pipeline_length(apipe) >= 2u);
 
-    unsigned int child_processes_running = 0u;
+    // Si la última etapa no se lanza el pipeline falla
+    launch_t result = {0u, -1, EXIT_FAILURE};
+
+    /* Un pipeline largo de comandos externos se lanza de una vez, en vez de
+       un fork atrás del otro */
+    bool plain = pipeline_length(apipe) >= CONCURRENT_STAGES;
+    for (unsigned int i = 0u; plain && i < pipeline_length(apipe); i++) {
+        plain = is_plain_external(pipeline_get_nth(apipe, i));
+    }
+    if (plain) {
+        return concurrent_commands(apipe);
+    }
 
     unsigned int numberOfPipes = pipeline_length(apipe) - 1u;
     // pipeline_length(apipe) >= 2u  ⇒  numberOfPipes >= 1u
@@ -250,7 +821,7 @@ static unsigned int multiple_commands(pipeline apipe) {
         // Se imprime mensaje de error
         perror("calloc");
         // Se retorna
-        return child_processes_running;
+        return result;
     }
 
     // Se abren todos los pipes que se van a necesitar para la ejecucion
@@ -266,14 +837,27 @@ static unsigned int multiple_commands(pipeline apipe) {
             // se libera la memoria
             free(pipesfd);
             pipesfd = NULL;
-            return child_processes_running;
+            return result;
         }
     }
 
-    unsigned int j = 0;
     // Caso en el que haya un pipeline multiple
-    while (!pipeline_is_empty(apipe) && !error_flag) {
-        pid_t pid = fork();
+    // j es el índice en pipesfd de la punta de lectura del pipe del comando i
+    unsigned int j = 0u;
+    for (unsigned int i = 0u; i <= numberOfPipes && !error_flag; i++) {
+        // Los externos los lanza el zygote, si se puede
+        fd_t in = i != 0u ? pipesfd[j - 2u] : STDIN_FILENO;
+        fd_t out = i < numberOfPipes ? pipesfd[j + 1] : STDOUT_FILENO;
+        pid_t pid = spawn_with_zygote(pipeline_get_nth(apipe, i), in, out);
+        if (pid > 0) {
+            j = j + 2u;
+            result.children++;
+            result.last = pid;
+            continue;
+        }
+
+        fflush(stdout);
+        pid = fork();
         if (pid < 0) {
             //Caso de que el fork falle
             perror("error");
@@ -285,7 +869,7 @@ static unsigned int multiple_commands(pipeline apipe) {
             // El hijo
 
             //Si no es el ultimo comando
-            if (pipeline_length(apipe) > 1) {
+            if (i < numberOfPipes) {
                 fd_t res_dup = dup2(pipesfd[j + 1], STDOUT_FILENO);
                 if (res_dup < 0) {
                     perror("dup");
@@ -294,7 +878,7 @@ static unsigned int multiple_commands(pipeline apipe) {
             }
 
             // Si no es el primer comando
-            if (j != 0u) {
+            if (i != 0u) {
                 /* j se va incrementando de a 2, y nunca se decrementa,
                    por ende j >= 2 */
                 fd_t res_dup = dup2(pipesfd[j - 2u], STDIN_FILENO);
@@ -305,19 +889,19 @@ static unsigned int multiple_commands(pipeline apipe) {
             }
 
             // Se cierran todos los file descriptors
-            for (unsigned int i = 0u; i < 2u * numberOfPipes; i++) {
-                close(pipesfd[i]);
+            for (unsigned int k = 0u; k < 2u * numberOfPipes; k++) {
+                close(pipesfd[k]);
             }
 
-            scommand_exec(pipeline_front(apipe));
+            scommand_exec(pipeline_get_nth(apipe, i));
             // scommand_exec no retorna
         } else if (pid > 0) {
             // El padre
-            // Elimina un comando del pipe y aumenta el contador de procesos hijos
+            // Pasa al siguiente comando y aumenta el contador de procesos hijos
             // ejecutandose
-            pipeline_pop_front(apipe);
             j = j + 2u;
-            child_processes_running++;
+            result.children++;
+            result.last = pid;
         }
     }
 
@@ -330,34 +914,58 @@ static unsigned int multiple_commands(pipeline apipe) {
     free(pipesfd);
     pipesfd = NULL;
 
-    return child_processes_running;
+    if (error_flag) {
+        // La última etapa no se llegó a lanzar
+        result.last = -1;
+    }
+    return result;
 }
 
 /* Ejecuta un pipeline, haciendo fork para cada comando
- * y retorna la cantidad de hijos creados
+ * y retorna los hijos creados
+ * Con inline_groups, un grupo solo (sin pipes) puede correr en el shell.
  * 
- * Puede modificar apipe pero no destruirlo
+ * No modifica apipe
  * 
  * Requires: apipe != NULL
  * 
  * Ensures: apipe != NULL
  */
-static unsigned int execute_pipeline_foreground(pipeline apipe) {
+static launch_t execute_pipeline_foreground(pipeline apipe,
+                                            bool inline_groups) {
     assert(apipe != NULL);
 
     unsigned int length = pipeline_length(apipe);
-    unsigned int child_processes_running = 0u;
+    launch_t result = {0u, -1, EXIT_SUCCESS};
 
     if (length == 1u) {
-        child_processes_running = single_command(apipe);
+        result = single_command(apipe, inline_groups);
     } else if (length >= 2u) {
-        child_processes_running = multiple_commands(apipe);
+        result = multiple_commands(apipe);
     }
     // En el caso de que apipe esté vacio no se hace nada
 
     assert(apipe != NULL);
 
-    return child_processes_running;
+    return result;
+}
+
+/* Espera a todos los hijos de launched.
+ * Returns: el estado del pipeline, el de su última etapa (128 + n si
+ *     terminó por la señal n)
+ */
+static int wait_children(launch_t launched) {
+    int status = launched.status;
+    while (launched.children > 0u) {
+        int wstatus = 0;
+        pid_t pid = wait(&wstatus);
+        if (pid > 0 && pid == launched.last) {
+            status = WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus)
+                                          : WEXITSTATUS(wstatus);
+        }
+        launched.children--;
+    }
+    return status;
 }
 
 /* Ejecuta los pipelines haciendo llamadas a las diferentes funciones
@@ -367,30 +975,38 @@ static unsigned int execute_pipeline_foreground(pipeline apipe) {
  * son hijos del hijo, de esta forma podemos hacer que el proceso hijo haga exit para que
  * no espere a los hijos y de esta forma se corran los procesos en background, y ademas
  * quedan sus hijos como huerfanos por lo que el proceso padre se encarga de recogerlos, 
- * de esta manera evitamos los procesos zombies.    
+ * de esta manera evitamos los procesos zombies.
+ * Returns: el estado del pipeline (0 si queda en background)
 */
-
-void execute_pipeline(pipeline p) {
+static int run_pipeline(pipeline p) {
     assert(p != NULL);
 
-    if (pipeline_get_wait(p)) {
-        // Se ejecutan todos los comandos
-        unsigned int child_processes_running = execute_pipeline_foreground(p);
+    /* Las variables se expanden acá, en el padre, así los comandos internos
+       y los hijos ven las mismas palabras. Si no hay nada que expandir se
+       ejecuta p tal cual */
+    pipeline expanded = expand_pipeline(p);
+    if (expanded != NULL) {
+        p = expanded;
+    }
+    int status = EXIT_SUCCESS;
 
-        // Se espera a que todos los hijos terminen
-        while (child_processes_running > 0u) {
-            wait(NULL);
-            child_processes_running--;
-        }
+    if (pipeline_get_wait(p)) {
+        // Se ejecutan todos los comandos y se espera a que todos terminen
+        status = wait_children(execute_pipeline_foreground(p, true));
     } else {
         // Hay que correrlo en modo background
+        fflush(stdout);
         pid_t pid = fork();
         if (pid < 0) {
             // Caso de que el fork falle
             perror("fork");
+            status = EXIT_FAILURE;
         } else if (pid == 0) {
             // El proceso hijo
 
+            // Los comandos del pipeline quedan en un grupo propio
+            setpgid(0, 0);
+
             // Se conecta el stdin del hijo a un archivo vacio
             /* Como archivo vacio se usa una punta de lectura de pipe
                con punta de escritura cerrada */
@@ -411,15 +1027,335 @@ void execute_pipeline(pipeline p) {
                 exit(EXIT_FAILURE);
             }
 
-            // Ejecuta todos los comandos del pipeline
-            execute_pipeline_foreground(p);
+            /* Ejecuta todos los comandos del pipeline (un grupo también en
+               otro proceso, para no esperarlo acá) */
+            execute_pipeline_foreground(p, false);
 
             // Y termina para que los hijos pasen a ser hijos del sistema
             exit(EXIT_SUCCESS);
         } else {
             // El proceso padre
+            // Se pone el grupo también acá, por si el hijo todavía no lo hizo
+            setpgid(pid, pid);
+            background_job_add(pid);
             // Espera a que el hijo termine de crear todos los procesos
             wait(NULL);
         }
     }
+
+    if (expanded != NULL) {
+        pipeline_destroy(expanded);
+    }
+    return status;
+}
+
+/* Ejecuta la lista que empieza en list, un pipeline atrás del otro, hasta
+ * el final, hasta un exit o hasta un break o continue. Los que siguen a un && o un || se saltean según
+ * el estado (ver pipeline_connector); cada estado queda en $?.
+ * Si replace, el proceso es un hijo que termina con la lista: el último
+ * pipeline, si es un solo comando, se ejecuta en su lugar (con exec) en vez
+ * de en otro hijo, así un grupo en un pipeline cuesta un único proceso.
+ * Returns: el estado del último pipeline ejecutado
+ *
+ * Requires: list != NULL
+ */
+static int run_list(pipeline list, bool replace) {
+    assert(list != NULL);
+
+    int status = vars_status();
+    pipeline p = list;
+    while (p != NULL && !exit_from_mybash && builtin_loop_jumps == 0u) {
+        if (replace && pipeline_get_next(p) == NULL && pipeline_get_wait(p) &&
+            pipeline_length(p) == 1u) {
+            pipeline expanded = expand_pipeline(p);
+            fflush(stdout);
+            scommand_exec(pipeline_get_nth(expanded != NULL ? expanded : p,
+                                           0u));
+            // scommand_exec no retorna
+        }
+        status = run_pipeline(p);
+        if (exit_from_mybash) {
+            // El estado del exit, aunque haya sido adentro de un compuesto
+            status = vars_status();
+        }
+        vars_set_status(status);
+
+        pipeline_connector connector = pipeline_get_connector(p);
+        p = pipeline_get_next(p);
+        while (p != NULL &&
+               ((connector == PIPELINE_AND && status != EXIT_SUCCESS) ||
+                (connector == PIPELINE_OR && status == EXIT_SUCCESS))) {
+            connector = pipeline_get_connector(p);
+            p = pipeline_get_next(p);
+        }
+    }
+    return status;
+}
+
+/* Indica si word coincide con alguno de los patrones de una cláusula de
+ * case (las cadenas del único comando de patterns, ver scommand_kind)
+ */
+static bool case_matches(pipeline patterns, const char* word) {
+    char** argv = scommand_get_argv(pipeline_get_nth(patterns, 0u));
+    if (argv == NULL) {
+        perror("calloc");
+        return false;
+    }
+    bool found = false;
+    for (unsigned int i = 0u; argv[i] != NULL && !found; i++) {
+        if (argv[i][0] != SCOMMAND_EXPAND_MARK &&
+            strpbrk(argv[i], "*?[]\\") == NULL) {
+            // Un patrón sin nada especial se compara sin armarlo
+            found = strcmp(argv[i], word) == 0;
+        } else {
+            char* pattern = expand_pattern(argv[i]);
+            found = pathexp_match(pattern, word);
+            free(pattern);
+        }
+    }
+    free(argv);
+    return found;
+}
+
+/* Después de la condición o del cuerpo de un ciclo, toma el break o
+ * continue pendiente si llega hasta este ciclo (ver builtin_loop_jumps).
+ *   stop: dónde se indica si el ciclo tiene que terminar
+ * Returns: si había un salto pendiente
+ */
+static bool loop_jumped(bool* stop) {
+    if (builtin_loop_jumps == 0u) {
+        return false;
+    }
+    builtin_loop_jumps--;
+    *stop = builtin_loop_jumps > 0u || !builtin_loop_continue;
+    return true;
+}
+
+/* Ejecuta las listas del compuesto cmd según su clase (ver scommand_kind).
+ * Las listas no se copian ni se vuelven a parsear: cada vuelta de un ciclo
+ * ejecuta los mismos pipelines (que solo se expanden si tienen algo que
+ * expandir), y los comandos internos corren sin fork.
+ * Si replace, la lista que se ejecuta al final puede reemplazar al proceso
+ * (ver run_list).
+ * Returns: el estado del compuesto: el de la última lista que no es una
+ *     condición, o EXIT_SUCCESS si no se ejecutó ninguna
+ */
+static int run_compound_lists(scommand cmd, bool replace) {
+    unsigned int count = scommand_list_count(cmd);
+    scommand_kind kind = scommand_get_kind(cmd);
+    int status = EXIT_SUCCESS;
+
+    if (kind == SCOMMAND_IF) {
+        // Las condiciones en orden, hasta la primera que se cumple
+        for (unsigned int i = 0u; i < count; i += 2u) {
+            if (i + 1u == count) {
+                return run_list(scommand_get_list(cmd, i), replace); // else
+            }
+            if (run_list(scommand_get_list(cmd, i), false) == EXIT_SUCCESS) {
+                return run_list(scommand_get_list(cmd, i + 1u), replace);
+            }
+        }
+    } else if (kind == SCOMMAND_WHILE || kind == SCOMMAND_UNTIL) {
+        pipeline condition = scommand_get_list(cmd, 0u);
+        pipeline body = scommand_get_list(cmd, 1u);
+        // Con exit o break (en la condición o en el cuerpo) se deja de dar
+        // vueltas; un continue en la condición la vuelve a evaluar
+        bool stop = false;
+        builtin_loop_depth++;
+        while (!stop && !exit_from_mybash) {
+            bool holds = (run_list(condition, false) == EXIT_SUCCESS) ==
+                         (kind == SCOMMAND_WHILE);
+            if (loop_jumped(&stop)) {
+                continue;
+            }
+            if (!holds) {
+                break;
+            }
+            status = run_list(body, false);
+            loop_jumped(&stop);
+        }
+        builtin_loop_depth--;
+    } else if (kind == SCOMMAND_FOR) {
+        // Las palabras ya están expandidas; la primera es la variable
+        char** argv = scommand_get_argv(cmd);
+        if (argv == NULL) {
+            perror("calloc");
+            return EXIT_FAILURE;
+        }
+        pipeline body = scommand_get_list(cmd, 0u);
+        bool stop = false;
+        builtin_loop_depth++;
+        for (unsigned int i = 1u;
+             argv[i] != NULL && !stop && !exit_from_mybash; i++) {
+            vars_set(argv[0], argv[i]);
+            status = run_list(body, false);
+            loop_jumped(&stop);
+        }
+        builtin_loop_depth--;
+        free(argv);
+    } else if (kind == SCOMMAND_CASE) {
+        const char* word = scommand_front(cmd);
+        for (unsigned int i = 0u; i + 1u < count; i += 2u) {
+            if (case_matches(scommand_get_list(cmd, i), word)) {
+                return run_list(scommand_get_list(cmd, i + 1u), replace);
+            }
+        }
+    } else {
+        status = run_list(scommand_get_body(cmd), replace);
+    }
+    return status;
+}
+
+/* Copia de un descriptor que cambia una redirección general de un compuesto
+ * que corre en el shell: saved es la copia, o -1 si estaba cerrado (y al
+ * final se vuelve a cerrar)
+ */
+typedef struct {
+    fd_t fd;
+    fd_t saved;
+} saved_fd_t;
+
+/* Guarda copias (como las de run_compound) de los descriptores que cambian
+ * las redirecciones generales de cmd, una por descriptor.
+ *   count: dónde se guarda la cantidad de copias
+ * Returns: memoria nueva, para restore_descriptors
+ *
+ * Requires: cmd != NULL && count != NULL
+ */
+static saved_fd_t* save_descriptors(scommand cmd, unsigned int* count) {
+    assert(cmd != NULL && count != NULL);
+
+    unsigned int redirs = scommand_redir_count(cmd);
+    saved_fd_t* saved = malloc((redirs + 1u) * sizeof(saved_fd_t));
+    if (saved == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    *count = 0u;
+    for (unsigned int i = 0u; i < redirs; i++) {
+        fd_t fd = scommand_get_redir(cmd, i)->fd;
+        bool seen = false;
+        for (unsigned int k = 0u; k < *count; k++) {
+            seen = seen || saved[k].fd == fd;
+        }
+        if (!seen) {
+            if (fd == STDOUT_FILENO) {
+                fflush(stdout);
+            }
+            saved[*count].fd = fd;
+            saved[*count].saved = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+            (*count)++;
+        }
+    }
+    return saved;
+}
+
+/* Restaura los descriptores que guardó save_descriptors y libera saved */
+static void restore_descriptors(saved_fd_t* saved, unsigned int count) {
+    // Lo que escribieron los internos va a la redirección
+    fflush(stdout);
+    for (unsigned int k = 0u; k < count; k++) {
+        if (saved[k].saved == -1) {
+            close(saved[k].fd);
+        } else {
+            dup2(saved[k].saved, saved[k].fd);
+            close(saved[k].saved);
+        }
+    }
+    free(saved);
+}
+
+/* Ejecuta el compuesto cmd en este proceso, con sus redirecciones.
+ * Si replace, el proceso es un hijo que termina con el compuesto, y las
+ * redirecciones quedan puestas. Si no, es el shell: los descriptores que
+ * cambian se guardan en copias (fuera del rango de los comandos y que no
+ * se heredan) y se restauran al final.
+ * Returns: el estado del compuesto, o EXIT_FAILURE si falla una
+ *     redirección
+ *
+ * Requires: cmd != NULL && scommand_get_kind(cmd) != SCOMMAND_SIMPLE
+ */
+static int run_compound(scommand cmd, bool replace) {
+    assert(cmd != NULL && scommand_get_kind(cmd) != SCOMMAND_SIMPLE);
+
+    fd_t saved_in = -1, saved_out = -1;
+    if (!replace && scommand_get_redir_in(cmd) != NULL) {
+        saved_in = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10);
+    }
+    if (!replace && scommand_get_redir_out(cmd) != NULL) {
+        fflush(stdout);
+        saved_out = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+    }
+    saved_fd_t* saved = NULL;
+    unsigned int saved_count = 0u;
+    if (!replace && scommand_redir_count(cmd) > 0u) {
+        saved = save_descriptors(cmd, &saved_count);
+    }
+
+    int status = EXIT_FAILURE;
+    if (change_file_descriptor_in(cmd) == EXIT_SUCCESS &&
+        change_file_descriptor_out(cmd) == EXIT_SUCCESS &&
+        apply_redirections(cmd) == EXIT_SUCCESS) {
+        status = run_compound_lists(cmd, replace);
+    }
+
+    if (saved != NULL) {
+        restore_descriptors(saved, saved_count);
+    }
+    if (saved_in != -1) {
+        dup2(saved_in, STDIN_FILENO);
+        close(saved_in);
+    }
+    if (saved_out != -1) {
+        // Lo que escribieron los internos va a la redirección
+        fflush(stdout);
+        dup2(saved_out, STDOUT_FILENO);
+        close(saved_out);
+    }
+    return status;
+}
+
+int execute_pipeline(pipeline p) {
+    assert(p != NULL);
+
+    return run_list(p, false);
+}
+
+/* Pide precargar el comando externo de cmd, o los de las listas si es un
+ * compuesto
+ */
+static void prefetch_scommand(scommand cmd) {
+    scommand_kind kind = scommand_get_kind(cmd);
+    if (kind != SCOMMAND_SIMPLE) {
+        // En un case las listas pares son los patrones
+        unsigned int step = kind == SCOMMAND_CASE ? 2u : 1u;
+        for (unsigned int i = step - 1u; i < scommand_list_count(cmd);
+             i += step) {
+            execute_prefetch(scommand_get_list(cmd, i));
+        }
+        return;
+    }
+    if (scommand_is_empty(cmd) || builtin_scommand_is_internal(cmd) ||
+        argbatch_is_prefix(cmd)) {
+        return;
+    }
+    unsigned int length = scommand_length(cmd);
+    unsigned int n = 0u;
+    while (n < length && vars_is_assignment(scommand_get_nth(cmd, n))) {
+        n++;
+    }
+    // Un nombre con expansiones se sabe recién al ejecutarlo
+    if (n < length && scommand_get_nth(cmd, n)[0] != SCOMMAND_EXPAND_MARK) {
+        prefetch_command(scommand_get_nth(cmd, n));
+    }
+}
+
+void execute_prefetch(const pipeline apipe) {
+    assert(apipe != NULL);
+
+    for (pipeline p = apipe; p != NULL; p = pipeline_get_next(p)) {
+        for (unsigned int i = 0u; i < pipeline_length(p); i++) {
+            prefetch_scommand(pipeline_get_nth(p, i));
+        }
+    }
 }
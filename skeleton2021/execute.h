@@ -9,11 +9,36 @@
 
 /*
  * Ejecuta un pipeline, identificando comandos internos, forkeando, y
- *   redirigiendo la entrada y salida. puede modificar `apipe' en el proceso
- *   de ejecución.
+ *   redirigiendo la entrada y salida. No modifica `apipe', así que el mismo
+ *   pipeline (o un clon, ver pipeline_clone) se puede volver a ejecutar.
+ *   Si apipe tiene siguientes (pipeline_get_next) se ejecuta toda la lista,
+ *   con sus && y ||. El estado de cada pipeline queda en $? (vars_status).
+ *   Los compuestos (grupos "{ ...; }", if, while, until, for y case)
+ *   corren en el shell, y los subshells "( ... )" también salvo que
+ *   cambien su estado (cd, variables, exit...); en un pipeline de varias
+ *   etapas o en background, cada compuesto es un proceso. Un ciclo vuelve
+ *   a ejecutar sus listas sin copiarlas, y los comandos internos de cada
+ *   vuelta no hacen fork.
  *   apipe: pipeline a ejecutar
+ * Returns: el estado del último pipeline ejecutado: el de la última etapa
+ *   (128 + n si terminó por la señal n), 0 si quedó en background
  * Requires: apipe != NULL
  */
-void execute_pipeline(pipeline apipe);
+int execute_pipeline(pipeline apipe);
+
+/*
+ * Pide precargar (ver prefetch.h) los ejecutables de los comandos externos
+ *   de `apipe', de sus siguientes y de las listas de sus compuestos, para
+ *   ejecutarlo después. Los comandos cuyo nombre tiene expansiones no se
+ *   precargan. No modifica `apipe'.
+ * Requires: apipe != NULL
+ */
+void execute_prefetch(const pipeline apipe);
+
+/*
+ * Cantidad de pipelines lanzados en background que siguen corriendo.
+ *   Se puede llamar desde cualquier hilo.
+ */
+unsigned int execute_background_jobs(void);
 
 #endif /* EXECUTE_H */
@@ -0,0 +1,773 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "arith.h"
+#include "command.h"
+#include "expand.h"
+#include "pathexp.h"
+#include "vars.h"
+
+/* Separadores si IFS no está definida */
+#define DEFAULT_IFS " \t\n"
+
+/* Cadena que crece, terminada en '\0' si ya tiene memoria */
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} buffer;
+
+/* Estado de la expansión de una palabra */
+typedef struct {
+    buffer field;      // palabra que se está armando
+    buffer pattern;    // la misma palabra con lo citado escapado con '\'
+    bool started;      // la palabra existe aunque esté vacía ("" o '')
+    bool glob;         // la palabra tiene *, ? o [ sin citar
+    const char* ifs;   // separadores, o NULL si no se separa
+    pathexp* paths;    // listados para el globbing (se crean al usarlos), o
+                       // NULL si no se hace globbing
+    scommand out;      // dónde van las palabras terminadas, si se separa
+    unsigned int count;
+} expander;
+
+static char* checked_strdup(const char* s) {
+    char* result = strdup(s);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static char* checked_strndup(const char* s, size_t n) {
+    char* result = strndup(s, n);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static bool is_name_start(char c) {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static void append(buffer* b, const char* s, size_t n) {
+    if (b->length + n + 1u > b->capacity) {
+        while (b->length + n + 1u > b->capacity) {
+            b->capacity = b->capacity > 0u ? 2u * b->capacity : 64u;
+        }
+        b->data = realloc(b->data, b->capacity);
+        if (b->data == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(b->data + b->length, s, n);
+    b->length += n;
+    b->data[b->length] = '\0';
+}
+
+static const char* text_of(const buffer* b) {
+    return b->data != NULL ? b->data : "";
+}
+
+/* Agrega un caracter a la palabra. Si hay globbing también se arma el
+ * patrón, donde los caracteres citados van escapados para que no sean
+ * especiales.
+ */
+static void add_char(expander* e, char c, bool quoted) {
+    append(&e->field, &c, 1u);
+    if (e->paths != NULL) {
+        if (quoted && strchr("*?[]\\", c) != NULL) {
+            append(&e->pattern, "\\", 1u);
+        }
+        append(&e->pattern, &c, 1u);
+        e->glob = e->glob || (!quoted && strchr("*?[", c) != NULL);
+    }
+    e->started = true;
+}
+
+/* Termina la palabra que se está armando, si hay una. Si tiene un patrón se
+ * reemplaza por las rutas que coinciden, salvo que no haya ninguna.
+ */
+static void end_field(expander* e) {
+    if (e->started) {
+        char** matches = NULL;
+        size_t count = 0u;
+        if (e->glob && pathexp_has_magic(text_of(&e->pattern))) {
+            if (*e->paths == NULL) {
+                *e->paths = pathexp_new();
+            }
+            count = pathexp_expand(*e->paths, text_of(&e->pattern), &matches);
+        }
+        if (count == 0u) {
+            scommand_push_back(e->out, checked_strndup(text_of(&e->field),
+                                                       e->field.length));
+            e->count++;
+        }
+        for (size_t i = 0u; i < count; i++) {
+            scommand_push_back(e->out, matches[i]); // pasan a ser del comando
+            e->count++;
+        }
+        free(matches);
+    }
+    e->field.length = 0u;
+    e->pattern.length = 0u;
+    e->started = false;
+    e->glob = false;
+}
+
+/* Agrega el valor de una expansión; sin comillas se separa con e->ifs */
+static void add_value(expander* e, const char* value, bool quoted) {
+    if (quoted || e->ifs == NULL) {
+        for (const char* c = value; *c != '\0'; c++) {
+            add_char(e, *c, quoted);
+        }
+        e->started = e->started || quoted;
+        return;
+    }
+    for (const char* c = value; *c != '\0'; c++) {
+        if (strchr(e->ifs, *c) != NULL) {
+            end_field(e);
+        } else {
+            add_char(e, *c, false);
+        }
+    }
+}
+
+static void expand_range(expander* e, const char* pos, const char* end);
+
+/* Busca el '}' que cierra el '{' de pos, salteando las comillas, los
+ * escapes y los ${...} de adentro.
+ * Returns: el '}', o NULL si no se cierra
+ */
+static const char* find_brace_end(const char* pos, const char* end) {
+    unsigned int depth = 0u;
+    char quote = '\0';
+    for (const char* c = pos; c < end; c++) {
+        if (quote != '\0') {
+            if (*c == quote) {
+                quote = '\0';
+            } else if (quote == '"' && *c == '\\' && c + 1 < end) {
+                c++;
+            }
+        } else if (*c == '\'' || *c == '"') {
+            quote = *c;
+        } else if (*c == '\\' && c + 1 < end) {
+            c++;
+        } else if (*c == '{' && (c == pos || c[-1] == '$')) {
+            depth++;
+        } else if (*c == '}' && depth > 0u) {
+            depth--;
+            if (depth == 0u) {
+                return c;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Busca `c' en [pos, end) fuera de comillas, escapes y paréntesis.
+ * Returns: dónde está, o NULL si no está
+ */
+static const char* find_unquoted(const char* pos, const char* end, char c) {
+    unsigned int depth = 0u;
+    char quote = '\0';
+    for (; pos < end; pos++) {
+        if (quote != '\0') {
+            quote = *pos == quote ? '\0' : quote;
+        } else if (*pos == '\'' || *pos == '"') {
+            quote = *pos;
+        } else if (*pos == '\\' && pos + 1 < end) {
+            pos++;
+        } else if (*pos == c && depth == 0u) {
+            return pos;
+        } else if (*pos == '(') {
+            depth++;
+        } else if (*pos == ')' && depth > 0u) {
+            depth--;
+        }
+    }
+    return NULL;
+}
+
+/* Expande el operando de un ${...} (entre start y end), sin separarlo.
+ * Con pattern se devuelve como patrón: lo citado va escapado con '\'.
+ * Returns: el resultado, en memoria nueva
+ */
+static char* expand_operand(const char* start, const char* end,
+                            bool pattern) {
+    pathexp none = NULL; // solo para que se arme el patrón
+    expander sub = {{NULL, 0u, 0u}, {NULL, 0u, 0u}, false, false, NULL,
+                    pattern ? &none : NULL, NULL, 0u};
+    expand_range(&sub, start, end);
+    const buffer* b = pattern ? &sub.pattern : &sub.field;
+    char* result = checked_strndup(text_of(b), b->length);
+    free(sub.field.data);
+    free(sub.pattern.data);
+    return result;
+}
+
+/* Largo del nombre de parámetro que empieza en pos: una variable, '$' o
+ * '?'; 0 si no hay
+ */
+static size_t parameter_name_length(const char* pos, const char* end) {
+    if (pos < end && (*pos == '$' || *pos == '?')) {
+        return 1u;
+    }
+    size_t length = 0u;
+    while (pos + length < end &&
+           (is_name_start(pos[length]) ||
+            (length > 0u && pos[length] >= '0' && pos[length] <= '9'))) {
+        length++;
+    }
+    return length;
+}
+
+/* Valor del parámetro `name' (de `length' bytes).
+ * Returns: el valor en memoria nueva, o NULL si no tiene
+ */
+static char* parameter_value(const char* name, size_t length) {
+    char number[32];
+    if (length == 1u && (*name == '$' || *name == '?')) {
+        snprintf(number, sizeof(number), "%ld",
+                 *name == '$' ? (long)getpid() : (long)vars_status());
+        return checked_strdup(number);
+    }
+    char* copy = checked_strndup(name, length);
+    const char* value = vars_get(copy);
+    free(copy);
+    return value != NULL ? checked_strdup(value) : NULL;
+}
+
+/* Largo de la coincidencia más larga de `pattern' que empieza en
+ * value + pos (y que termina al final, con at_end). Las vacías solo
+ * cuentan con allow_empty.
+ * Returns: false si no hay
+ */
+static bool longest_match(const pathexp_pattern pattern, const char* value,
+                          size_t pos, size_t length, bool at_end,
+                          bool allow_empty, size_t* n) {
+    size_t min = allow_empty ? 0u : 1u;
+    size_t k = length - pos;
+    while (k >= min) {
+        if (pathexp_pattern_match(pattern, value + pos, k)) {
+            *n = k;
+            return true;
+        }
+        if (at_end || k == 0u) {
+            return false;
+        }
+        k--;
+    }
+    return false;
+}
+
+/* ${v#p}, ${v##p}, ${v%p} y ${v%%p}: saca el prefijo (#) o sufijo (%) más
+ * corto (o más largo, con el operador doble) que coincide con p.
+ * Requires: op < end && (*op == '#' || *op == '%')
+ */
+static char* remove_affix(const char* value, const char* op,
+                          const char* end) {
+    bool suffix = *op == '%';
+    bool longest = op + 1 < end && op[1] == *op;
+    char* text = expand_operand(op + (longest ? 2 : 1), end, true);
+    pathexp_pattern pattern = pathexp_pattern_new(text);
+    free(text);
+    size_t length = strlen(value);
+    size_t cut = 0u;
+    bool found = false;
+    for (size_t k = 0u; k <= length && !found; k++) {
+        size_t n = longest ? length - k : k;
+        found = pathexp_pattern_match(pattern, suffix ? value + length - n
+                                                      : value,
+                                      n);
+        cut = found ? n : 0u;
+    }
+    pattern = pathexp_pattern_destroy(pattern);
+    return suffix ? checked_strndup(value, length - cut)
+                  : checked_strdup(value + cut);
+}
+
+/* ${v/p/r}: reemplaza la primera coincidencia (la más larga) de p por r;
+ * ${v//p/r} todas, ${v/#p/r} solo al principio y ${v/%p/r} solo al final.
+ * Requires: op < end && *op == '/'
+ */
+static char* replace_pattern(const char* value, const char* op,
+                             const char* end) {
+    op++;
+    char mode = '\0';
+    if (op < end && (*op == '/' || *op == '#' || *op == '%')) {
+        mode = *op;
+        op++;
+    }
+    const char* slash = find_unquoted(op, end, '/');
+    char* text = expand_operand(op, slash != NULL ? slash : end, true);
+    char* replacement = slash != NULL ? expand_operand(slash + 1, end, false)
+                                      : checked_strdup("");
+    pathexp_pattern pattern = pathexp_pattern_new(text);
+    free(text);
+
+    size_t length = strlen(value);
+    size_t replacement_length = strlen(replacement);
+    bool anchored = mode == '#' || mode == '%';
+    buffer out = {NULL, 0u, 0u};
+    size_t pos = 0u;
+    bool done = false;
+    while (!done && pos <= length) {
+        size_t n = 0u;
+        if (longest_match(pattern, value, pos, length, mode == '%', anchored,
+                          &n)) {
+            append(&out, replacement, replacement_length);
+            pos += n;
+            done = mode != '/' || n == 0u;
+        } else if (mode == '#' || pos == length) {
+            done = true;
+        } else {
+            append(&out, value + pos, 1u);
+            pos++;
+        }
+    }
+    append(&out, value + pos, length - pos);
+    pattern = pathexp_pattern_destroy(pattern);
+    free(replacement);
+    return out.data;
+}
+
+/* ${v:inicio} y ${v:inicio:largo}, donde inicio y largo son expresiones
+ * aritméticas; un inicio negativo cuenta desde el final, y un largo
+ * negativo es dónde termina, contando desde el final.
+ * Returns: la subcadena, o NULL si hay un error (que ya se imprimió)
+ */
+static char* substring(const char* value, const char* spec,
+                       const char* end) {
+    const char* colon = find_unquoted(spec, end, ':');
+    int64_t offset = 0;
+    int64_t count = 0;
+    if (!arith_eval(spec, (size_t)((colon != NULL ? colon : end) - spec),
+                    &offset) ||
+        (colon != NULL &&
+         !arith_eval(colon + 1, (size_t)(end - colon - 1), &count))) {
+        return NULL;
+    }
+    int64_t length = (int64_t)strlen(value);
+    offset = offset < 0 ? offset + length : offset;
+    if (offset < 0 || offset > length) {
+        return checked_strdup("");
+    }
+    int64_t stop = length;
+    if (colon != NULL) {
+        stop = count < 0 ? length + count
+                         : (count < length - offset ? offset + count : length);
+    }
+    if (stop < offset) {
+        fprintf(stderr, "mybash: %.*s: expresión de subcadena < 0\n",
+                (int)(end - spec), spec);
+        return NULL;
+    }
+    return checked_strndup(value + offset, (size_t)(stop - offset));
+}
+
+/* Expande ${...}; body es lo que está entre las llaves.
+ * Returns: el valor en memoria nueva, o NULL si no queda nada
+ */
+static char* expand_braces(const char* body, const char* end) {
+    bool length_of = end - body > 1 && *body == '#';
+    const char* name = length_of ? body + 1 : body;
+    size_t name_length = parameter_name_length(name, end);
+    const char* op = name + name_length;
+    char* value =
+        name_length > 0u ? parameter_value(name, name_length) : NULL;
+    const char* current = value != NULL ? value : "";
+    char* result = NULL;
+    bool colon = op < end && *op == ':' && op + 1 < end &&
+                 strchr("-=+?", op[1]) != NULL;
+    const char* word = colon ? op + 2 : op + 1;
+
+    if (name_length == 0u || (length_of && op != end) ||
+        (op < end && strchr(":-=+?#%/", *op) == NULL)) {
+        fprintf(stderr, "mybash: ${%.*s}: sustitución errónea\n",
+                (int)(end - body), body);
+    } else if (length_of) {
+        char number[32];
+        snprintf(number, sizeof(number), "%zu", strlen(current));
+        result = checked_strdup(number);
+    } else if (op == end) {
+        result = value;
+        value = NULL;
+    } else if (colon || strchr("-=+?", *op) != NULL) {
+        // Con ':' una variable vacía cuenta como sin valor
+        bool set = value != NULL && (value[0] != '\0' || !colon);
+        char kind = colon ? op[1] : *op;
+        if (kind == '+') {
+            result = set ? expand_operand(word, end, false) : NULL;
+        } else if (set) {
+            result = value;
+            value = NULL;
+        } else if (kind == '-') {
+            result = expand_operand(word, end, false);
+        } else if (kind == '=') {
+            // Es una variable: $$ y $? siempre tienen valor
+            result = expand_operand(word, end, false);
+            char* variable = checked_strndup(name, name_length);
+            vars_set(variable, result);
+            free(variable);
+        } else {
+            char* message = expand_operand(word, end, false);
+            fprintf(stderr, "mybash: %.*s: %s\n", (int)name_length, name,
+                    message[0] != '\0' ? message
+                                       : "parámetro nulo o sin valor");
+            free(message);
+        }
+    } else if (*op == ':') {
+        result = substring(current, op + 1, end);
+    } else if (*op == '#' || *op == '%') {
+        result = remove_affix(current, op, end);
+    } else {
+        result = replace_pattern(current, op, end);
+    }
+    free(value);
+    return result;
+}
+
+/* Expande el parámetro que empieza en pos (justo después del '$').
+ * Returns: dónde sigue la palabra
+ */
+static const char* expand_parameter(expander* e, const char* pos,
+                                    const char* end, bool quoted) {
+    const char* close =
+        pos < end && *pos == '{' ? find_brace_end(pos, end) : NULL;
+    const char* value = NULL;
+    char number[32]; // $$, $? y $(( ))
+    char* name = NULL;
+    char* computed = NULL; // ${...}
+    const char* next = pos;
+    const char* arith_end = pos + 1 < end && pos[0] == '(' && pos[1] == '('
+                                ? arith_find_end(pos + 2, end)
+                                : NULL;
+
+    if (arith_end != NULL) {
+        int64_t result = 0;
+        if (arith_eval(pos + 2, (size_t)(arith_end - pos - 2), &result)) {
+            snprintf(number, sizeof(number), "%" PRId64, result);
+            value = number;
+        }
+        next = arith_end + 2;
+    } else if (pos < end && *pos == '$') {
+        snprintf(number, sizeof(number), "%ld", (long)getpid());
+        value = number;
+        next = pos + 1;
+    } else if (pos < end && *pos == '?') {
+        snprintf(number, sizeof(number), "%d", vars_status());
+        value = number;
+        next = pos + 1;
+    } else if (pos < end && is_name_start(*pos)) {
+        while (next < end && (is_name_start(*next) ||
+                              (*next >= '0' && *next <= '9'))) {
+            next++;
+        }
+        name = checked_strndup(pos, (size_t)(next - pos));
+    } else if (close != NULL) {
+        computed = expand_braces(pos + 1, close);
+        value = computed;
+        next = close + 1;
+    } else {
+        // No es una expansión
+        add_char(e, '$', quoted);
+        return pos;
+    }
+
+    if (name != NULL) {
+        value = vars_get(name);
+        free(name);
+    }
+    if (value != NULL) {
+        add_value(e, value, quoted);
+    }
+    free(computed);
+    return next;
+}
+
+/* Expande el texto entre pos y end y saca las comillas, como unquote en
+ * parser.c
+ */
+static void expand_range(expander* e, const char* pos, const char* end) {
+    char quote = '\0';
+    while (pos < end) {
+        char c = *pos;
+        pos++;
+        if (quote == '\0' && (c == '\'' || c == '"')) {
+            quote = c;
+            e->started = true;
+        } else if (c == quote) {
+            quote = '\0';
+        } else if (c == '\\' && pos < end &&
+                   (quote == '\0' ||
+                    (quote == '"' && strchr("\"\\$`", *pos) != NULL))) {
+            add_char(e, *pos, true);
+            pos++;
+        } else if (c == '$' && quote != '\'') {
+            pos = expand_parameter(e, pos, end, quote == '"');
+        } else {
+            add_char(e, c, quote != '\0');
+        }
+    }
+}
+
+/* expand_word, con los listados de directorios de `paths' */
+static unsigned int expand_fields(const char* word, scommand out,
+                                  pathexp* paths) {
+    if (word[0] != SCOMMAND_EXPAND_MARK) {
+        scommand_push_back(out, checked_strdup(word));
+        return 1u;
+    }
+    const char* ifs = vars_get("IFS");
+    expander e = {{NULL, 0u, 0u}, {NULL, 0u, 0u}, false, false,
+                  ifs != NULL ? ifs : DEFAULT_IFS, paths, out, 0u};
+    if (e.ifs[0] == '\0') {
+        e.ifs = NULL;
+    }
+    expand_range(&e, word + 1, word + strlen(word));
+    end_field(&e);
+    free(e.field.data);
+    free(e.pattern.data);
+    return e.count;
+}
+
+unsigned int expand_word(const char* word, scommand out) {
+    assert(word != NULL && out != NULL);
+
+    pathexp paths = NULL;
+    unsigned int count = expand_fields(word, out, &paths);
+    if (paths != NULL) {
+        pathexp_destroy(paths);
+    }
+    return count;
+}
+
+char* expand_word_joined(const char* word) {
+    assert(word != NULL);
+
+    if (word[0] != SCOMMAND_EXPAND_MARK) {
+        return checked_strdup(word);
+    }
+    expander e = {{NULL, 0u, 0u}, {NULL, 0u, 0u}, false, false, NULL, NULL,
+                  NULL, 0u};
+    expand_range(&e, word + 1, word + strlen(word));
+    char* result = checked_strndup(text_of(&e.field), e.field.length);
+    free(e.field.data);
+    return result;
+}
+
+char* expand_pattern(const char* word) {
+    assert(word != NULL);
+
+    buffer pattern = {NULL, 0u, 0u};
+    if (word[0] != SCOMMAND_EXPAND_MARK) {
+        for (const char* c = word; *c != '\0'; c++) {
+            if (strchr("*?[]\\", *c) != NULL) {
+                append(&pattern, "\\", 1u);
+            }
+            append(&pattern, c, 1u);
+        }
+    } else {
+        // Con paths se arma el patrón, pero no se busca ningún archivo
+        pathexp unused = NULL;
+        expander e = {{NULL, 0u, 0u}, {NULL, 0u, 0u}, false, false, NULL,
+                      &unused, NULL, 0u};
+        expand_range(&e, word + 1, word + strlen(word));
+        free(e.field.data);
+        pattern = e.pattern;
+    }
+    char* result = checked_strndup(text_of(&pattern), pattern.length);
+    free(pattern.data);
+    return result;
+}
+
+/* Indica si el valor de una variable usada en una expresión es un número
+ * (si no, se evalúa como otra expresión, que puede asignar)
+ */
+static bool is_number_value(const char* value) {
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    if (*value == '+' || *value == '-') {
+        value++;
+    }
+    if (*value < '0' || *value > '9') {
+        return false;
+    }
+    while ((*value >= '0' && *value <= '9') || is_name_start(*value)) {
+        value++;
+    }
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+    return *value == '\0';
+}
+
+/* Indica si evaluar la expresión de [pos, end) podría asignar: si tiene
+ * '=' (también ==, <=...), ++ o --, o una variable cuyo valor no es un
+ * número. Se equivoca solo para el lado de decir que sí.
+ */
+static bool arith_assigns(const char* pos, const char* end) {
+    for (const char* c = pos; c < end; c++) {
+        if (*c == '=' ||
+            (c + 1 < end && (*c == '+' || *c == '-') && c[1] == *c)) {
+            return true;
+        }
+        if (is_name_start(*c) && (c == pos || !is_name_start(c[-1])) &&
+            (c == pos || c[-1] < '0' || c[-1] > '9')) {
+            size_t length = parameter_name_length(c, end);
+            char* name = checked_strndup(c, length);
+            const char* value = vars_get(name);
+            free(name);
+            if (value != NULL && value[0] != '\0' &&
+                !is_number_value(value)) {
+                return true;
+            }
+            c += length - 1u;
+        }
+    }
+    return false;
+}
+
+/* Indica si expandir `word' podría asignar alguna variable: con ${P=W} o
+ * ${P:=W}, o con una expresión que asigna (arith_assigns) en un $(( )) o
+ * en los índices de ${P:i:n}. No se miran las comillas (un '${a=b}' entre
+ * comillas simples también cuenta), ni se saltean las expansiones de
+ * adentro de otras: cada '$' se mira por separado.
+ */
+static bool word_assigns(const char* word) {
+    if (word == NULL || word[0] != SCOMMAND_EXPAND_MARK) {
+        return false;
+    }
+    const char* end = word + strlen(word);
+    for (const char* c = word + 1; c + 1 < end; c++) {
+        if (c[0] == '$' && c[1] == '{') {
+            const char* name = c + 2;
+            const char* op = name + parameter_name_length(name, end);
+            const char* close = find_brace_end(c + 1, end);
+            if (op < end && *op == ':' && op + 1 < end &&
+                strchr("-+?", op[1]) == NULL) {
+                op++;
+                if (*op != '=' && close != NULL && arith_assigns(op, close)) {
+                    return true;
+                }
+            }
+            if (op < end && *op == '=') {
+                return true;
+            }
+        } else if (c[0] == '$' && c[1] == '(' && c + 2 < end && c[2] == '(') {
+            const char* close = arith_find_end(c + 3, end);
+            if (arith_assigns(c + 3, close != NULL ? close : end)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool expand_assigns(const scommand cmd) {
+    assert(cmd != NULL);
+
+    bool result = word_assigns(scommand_get_redir_in(cmd)) ||
+                  word_assigns(scommand_get_redir_out(cmd));
+    char** argv = scommand_get_argv(cmd);
+    if (argv == NULL) {
+        perror("Error fatal: calloc");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned int i = 0u; argv[i] != NULL && !result; i++) {
+        result = word_assigns(argv[i]);
+    }
+    free(argv);
+    for (unsigned int i = 0u; i < scommand_redir_count(cmd) && !result;
+         i++) {
+        result = word_assigns(scommand_get_redir(cmd, i)->target);
+    }
+    return result;
+}
+
+/* Las asignaciones se reconocen por el texto escrito, antes de expandir */
+static bool is_assignment_word(const char* word) {
+    return vars_is_assignment(word[0] == SCOMMAND_EXPAND_MARK ? word + 1
+                                                              : word);
+}
+
+static scommand expand_scommand(const scommand cmd, pathexp* paths) {
+    scommand result = scommand_new();
+    char** argv = scommand_get_argv(cmd);
+    if (argv == NULL) {
+        perror("Error fatal: calloc");
+        exit(EXIT_FAILURE);
+    }
+    scommand_kind kind = scommand_get_kind(cmd);
+    if (kind != SCOMMAND_SIMPLE) {
+        scommand_set_kind(result, kind);
+        for (unsigned int i = 0u; i < scommand_list_count(cmd); i++) {
+            scommand_add_list(result,
+                              pipeline_clone(scommand_get_list(cmd, i)));
+        }
+    }
+    // La palabra de un case no se separa
+    bool leading = true; // todavía en las asignaciones del comienzo
+    for (unsigned int i = 0u; argv[i] != NULL; i++) {
+        leading = leading && is_assignment_word(argv[i]);
+        if (leading || kind == SCOMMAND_CASE) {
+            scommand_push_back(result, expand_word_joined(argv[i]));
+        } else {
+            expand_fields(argv[i], result, paths);
+        }
+    }
+    free(argv);
+    if (scommand_get_redir_in(cmd) != NULL) {
+        scommand_set_redir_in(result,
+                              expand_word_joined(scommand_get_redir_in(cmd)));
+    }
+    if (scommand_get_redir_out(cmd) != NULL) {
+        scommand_set_redir_out(result,
+                               expand_word_joined(scommand_get_redir_out(cmd)));
+    }
+    for (unsigned int i = 0u; i < scommand_redir_count(cmd); i++) {
+        const scommand_redir* redir = scommand_get_redir(cmd, i);
+        char* target = NULL;
+        if (redir->target != NULL) {
+            target = expand_word_joined(redir->target);
+        }
+        scommand_add_redir(result, redir->kind, redir->fd, redir->source,
+                           target);
+    }
+    return result;
+}
+
+pipeline expand_pipeline(const pipeline self) {
+    assert(self != NULL);
+
+    unsigned int length = pipeline_length(self);
+    bool needed = false;
+    for (unsigned int i = 0u; i < length && !needed; i++) {
+        needed = scommand_has_expansions(pipeline_get_nth(self, i));
+    }
+    if (!needed) {
+        return NULL;
+    }
+
+    // Los patrones de toda la línea comparten los listados
+    pathexp paths = NULL;
+    pipeline result = pipeline_new();
+    for (unsigned int i = 0u; i < length; i++) {
+        pipeline_push_back(result,
+                           expand_scommand(pipeline_get_nth(self, i), &paths));
+    }
+    pipeline_set_wait(result, pipeline_get_wait(self));
+    if (paths != NULL) {
+        pathexp_destroy(paths);
+    }
+    return result;
+}
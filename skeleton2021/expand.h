@@ -0,0 +1,98 @@
+/* Expansión de las palabras de los comandos.
+ *
+ * El parser deja las palabras con '$' o con '*', '?' o '[' sin citar tal cual
+ * se escribieron, marcadas con SCOMMAND_EXPAND_MARK (ver command.h), y acá se
+ * expanden justo antes de ejecutar:
+ *   - $NOMBRE y ${NOMBRE} son el valor de la variable (vars.h), o nada si
+ *     no tiene valor.
+ *   - $$ es el pid del shell, y $? el estado del último pipeline.
+ *   - ${#P} es el largo del valor de P (un nombre, $ o ?), y con un
+ *     operador (como en bash; la palabra W y el patrón p se expanden, y lo
+ *     citado en p es literal):
+ *       ${P:-W} W si P no tiene valor o está vacío (sin ':', solo si no
+ *               tiene valor); ${P:=W} además se lo asigna; ${P:+W} W si P
+ *               tiene valor; ${P:?W} imprime W como error si no tiene.
+ *       ${P#p} ${P##p} ${P%p} ${P%%p}  sin el prefijo o sufijo más corto
+ *               o más largo que coincide con p (pathexp.h).
+ *       ${P/p/W} ${P//p/W} ${P/#p/W} ${P/%p/W}  con la coincidencia más
+ *               larga de p (la primera, todas, al principio, al final)
+ *               reemplazada por W.
+ *       ${P:i} ${P:i:n}  desde el caracter i (contando desde el final si
+ *               es negativo) y n caracteres (o hasta n desde el final, si
+ *               es negativo); i y n son expresiones aritméticas.
+ *     Un operador desconocido es una sustitución errónea: se imprime el
+ *     error y no queda nada, igual que con ${P:?W}.
+ *   - $(( expresión )) es el resultado de la expresión (arith.h); si tiene
+ *     un error se imprime y no queda nada.
+ *   - Cualquier otro '$' queda literal.
+ * Después se sacan las comillas y los escapes, igual que el parser.
+ *
+ * Las expansiones sin comillas dobles se separan en varias palabras en los
+ * caracteres de $IFS (o en blancos, si IFS no está definida); las que quedan
+ * vacías desaparecen. Entre comillas dobles el valor queda en una sola
+ * palabra. No se separan las asignaciones (NOMBRE=valor) del comienzo del
+ * comando ni las redirecciones.
+ *
+ * Por último, cada palabra que tiene '*', '?' o '[' sin citar (escritos o
+ * salidos de una expansión sin comillas) se reemplaza por los archivos que
+ * coinciden, ordenados (pathexp.h); si no coincide ninguno queda como está.
+ * Todas las palabras de un pipeline comparten los listados de directorios.
+ * Las asignaciones y las redirecciones no se expanden así.
+ */
+
+#ifndef _EXPAND_H_
+#define _EXPAND_H_
+
+#include "command.h"
+
+/*
+ * Expande la palabra `word' y agrega las palabras que resultan al final de
+ * `out' (sin expansiones pendientes, se copia tal cual).
+ * Returns: la cantidad de palabras agregadas
+ * Requires: word != NULL && out != NULL
+ */
+unsigned int expand_word(const char* word, scommand out);
+
+/*
+ * Expande la palabra `word' sin separarla ni buscar archivos.
+ * Returns: memoria nueva, a liberar por el llamador
+ * Requires: word != NULL
+ * Ensures: result != NULL
+ */
+char* expand_word_joined(const char* word);
+
+/*
+ * Expande la palabra `word' sin separarla ni buscar archivos, como un
+ * patrón de pathexp_match (pathexp.h): lo que estaba citado (o escapado, o
+ * en una palabra sin expansiones) queda escapado con '\', así solo son
+ * especiales los '*', '?' y '[' escritos sin citar o salidos de una
+ * expansión sin comillas. Es lo que se hace con los patrones de un case.
+ * Returns: memoria nueva, a liberar por el llamador
+ * Requires: word != NULL
+ * Ensures: result != NULL
+ */
+char* expand_pattern(const char* word);
+
+/*
+ * Indica si expandir las palabras de `cmd' (argumentos, cadenas de un
+ * compuesto y redirecciones) podría asignar variables del shell: si tienen
+ * un ${P=W} o ${P:=W}, o una expresión aritmética que asigna o usa ++ o --
+ * (o una variable cuyo valor no es un número, que se evalúa como otra
+ * expresión). Puede decir que sí de más, nunca de menos.
+ * Requires: cmd != NULL
+ */
+bool expand_assigns(const scommand cmd);
+
+/*
+ * Expande todas las palabras de los comandos de `self'. De los compuestos
+ * se expanden las cadenas (las palabras de un for como las de un comando,
+ * la de un case sin separar) y las redirecciones. Las listas se copian
+ * tal cual: se expanden al ejecutar cada uno de sus pipelines. El resultado
+ * no tiene siguiente (el resto de la lista no se expande).
+ * Returns: un pipeline nuevo, a liberar por el llamador, o NULL si ninguna
+ *     palabra tenía expansiones (y se puede ejecutar self tal cual)
+ * Requires: self != NULL
+ */
+pipeline expand_pipeline(const pipeline self);
+
+#endif
@@ -0,0 +1,522 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "histlog.h"
+
+/* Cada línea se guarda como este encabezado seguido de sus bytes, sin '\0'.
+ * El hash sirve para reconocer un registro cortado (por ejemplo si se llenó
+ * el disco), y para buscar repetidas al compactar.
+ */
+struct record_header {
+    uint32_t length;
+    uint32_t hash;
+};
+
+/* Las líneas más largas no se guardan */
+#define RECORD_MAX_LINE (64u * 1024u)
+
+/* Encabezado de la foto, seguido de count registros */
+struct snapshot_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+#define SNAPSHOT_MAGIC 0x4842594du // "MYBH"
+#define SNAPSHOT_VERSION 1u
+
+#define LOG_SUFFIX ".log"
+#define TMP_SUFFIX ".tmp"
+
+struct histlog_s {
+    char* path;
+    char* log_path;
+    int log_fd;
+    pthread_t thread;
+    // Lo que sigue lo protege lock
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup; // hay registros pendientes, o hay que parar
+    char* pending;         // registros a escribir, ya armados
+    size_t pending_length;
+    size_t pending_capacity;
+    bool compact; // hay que compactar antes de esperar más registros
+    bool stop;
+};
+
+/* Un registro leído de un archivo mapeado */
+struct entry {
+    const char* line;
+    uint32_t length;
+    uint32_t hash;
+};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static char* concat(const char* s1, const char* s2) {
+    size_t length1 = strlen(s1);
+    size_t length2 = strlen(s2);
+    char* result = checked_realloc(NULL, length1 + length2 + 1u);
+    memcpy(result, s1, length1);
+    memcpy(result + length1, s2, length2 + 1u);
+    return result;
+}
+
+/* FNV-1a de 32 bits */
+static uint32_t line_hash(const char* line, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0u; i < length; i++) {
+        hash ^= (unsigned char)line[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0u) {
+        ssize_t written = write(fd, data, length);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/********** Lectura **********/
+
+/* Mapea todo el archivo fd. Un archivo vacío queda en NULL con *size 0.
+ * Returns: false si hubo un error
+ */
+static bool map_file(int fd, const char** data, size_t* size) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        return false;
+    }
+    *size = (size_t)st.st_size;
+    *data = NULL;
+    if (*size == 0u) {
+        return true;
+    }
+    void* map = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, *size, MADV_SEQUENTIAL);
+    *data = map;
+    return true;
+}
+
+static void unmap_file(const char* data, size_t size) {
+    if (data != NULL) {
+        munmap((void*)data, size);
+    }
+}
+
+/* Lee el registro que empieza en *offset y avanza *offset. El hash se
+ * verifica solo si check: la foto se reemplaza entera con rename(), así que
+ * no puede tener registros cortados.
+ * Returns: false si no hay un registro entero y válido
+ */
+static bool next_record(const char* data, size_t size, size_t* offset,
+                        bool check, struct entry* entry) {
+    struct record_header header;
+    if (size - *offset < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data + *offset, sizeof(header));
+    const char* line = data + *offset + sizeof(header);
+    if (header.length == 0u || header.length > RECORD_MAX_LINE ||
+        size - *offset - sizeof(header) < header.length ||
+        memchr(line, '\n', header.length) != NULL ||
+        memchr(line, '\0', header.length) != NULL ||
+        (check && line_hash(line, header.length) != header.hash)) {
+        return false;
+    }
+    entry->line = line;
+    entry->length = header.length;
+    entry->hash = header.hash;
+    *offset += sizeof(header) + header.length;
+    return true;
+}
+
+/* Agrega los registros de data a entries (que crece) */
+static void collect_records(const char* data, size_t size, size_t offset,
+                            bool check, struct entry** entries, size_t* count,
+                            size_t* capacity) {
+    struct entry entry;
+    while (next_record(data, size, &offset, check, &entry)) {
+        if (*count == *capacity) {
+            *capacity = *capacity > 0u ? 2u * *capacity : 1024u;
+            *entries =
+                checked_realloc(*entries, *capacity * sizeof(struct entry));
+        }
+        (*entries)[*count] = entry;
+        (*count)++;
+    }
+}
+
+/* Offset del primer registro de la foto data.
+ * Returns: false si data no es una foto
+ */
+static bool snapshot_records(const char* data, size_t size, size_t* offset) {
+    struct snapshot_header header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    *offset = sizeof(header);
+    return header.magic == SNAPSHOT_MAGIC &&
+           header.version == SNAPSHOT_VERSION;
+}
+
+/* Mapea la foto de path (si existe) y el registro log_fd, y junta los
+ * registros de los dos, los de la foto primero.
+ * Returns: false si hubo un error (ya informado)
+ */
+static bool read_all(const char* path, int log_fd, struct entry** entries,
+                     size_t* count, const char** snapshot,
+                     size_t* snapshot_size, const char** log,
+                     size_t* log_size) {
+    size_t capacity = 0u;
+    *entries = NULL;
+    *count = 0u;
+    *snapshot = NULL;
+    *snapshot_size = 0u;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 && errno != ENOENT) {
+        perror(path);
+        return false;
+    }
+    if (fd != -1) {
+        bool mapped = map_file(fd, snapshot, snapshot_size);
+        close(fd);
+        if (!mapped) {
+            perror(path);
+            return false;
+        }
+        size_t offset = 0u;
+        if (!snapshot_records(*snapshot, *snapshot_size, &offset)) {
+            // No se pisa un archivo que no es nuestro
+            fprintf(stderr, "mybash: %s: no es un historial de mybash\n",
+                    path);
+            unmap_file(*snapshot, *snapshot_size);
+            return false;
+        }
+        collect_records(*snapshot, *snapshot_size, offset, false, entries,
+                        count, &capacity);
+    }
+    if (!map_file(log_fd, log, log_size)) {
+        perror(path);
+        unmap_file(*snapshot, *snapshot_size);
+        free(*entries);
+        return false;
+    }
+    collect_records(*log, *log_size, 0u, true, entries, count, &capacity);
+    return true;
+}
+
+/********** Compactación **********/
+
+/* Se queda con la aparición más nueva de cada línea, y con a lo sumo
+ * HISTLOG_MAX_ENTRIES líneas. Arma la foto en un buffer nuevo.
+ */
+static char* build_snapshot(const struct entry* entries, size_t count,
+                            size_t* size) {
+    // Tabla de hash de las líneas ya vistas: índice + 1, 0 es libre
+    size_t table_size = 16u;
+    while (table_size < 2u * count) {
+        table_size *= 2u;
+    }
+    uint32_t* table = calloc(table_size, sizeof(uint32_t));
+    bool* keep = calloc(count > 0u ? count : 1u, sizeof(bool));
+    if (table == NULL || keep == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    struct snapshot_header header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0u, 0u};
+    size_t length = sizeof(header);
+    for (size_t n = count; n > 0u && header.count < HISTLOG_MAX_ENTRIES;
+         n--) {
+        const struct entry* e = &entries[n - 1u];
+        size_t i = e->hash & (table_size - 1u);
+        bool seen = false;
+        while (table[i] != 0u && !seen) {
+            const struct entry* other = &entries[table[i] - 1u];
+            seen = other->hash == e->hash && other->length == e->length &&
+                   memcmp(other->line, e->line, e->length) == 0;
+            i = (i + 1u) & (table_size - 1u);
+        }
+        if (!seen) {
+            table[i] = (uint32_t)n;
+            keep[n - 1u] = true;
+            header.count++;
+            length += sizeof(struct record_header) + e->length;
+        }
+    }
+
+    char* result = checked_realloc(NULL, length);
+    memcpy(result, &header, sizeof(header));
+    size_t offset = sizeof(header);
+    for (size_t n = 0u; n < count; n++) {
+        if (keep[n]) {
+            struct record_header record = {entries[n].length, entries[n].hash};
+            memcpy(result + offset, &record, sizeof(record));
+            memcpy(result + offset + sizeof(record), entries[n].line,
+                   entries[n].length);
+            offset += sizeof(record) + entries[n].length;
+        }
+    }
+    free(keep);
+    free(table);
+    *size = length;
+    return result;
+}
+
+/* Compacta con el registro log_fd ya abierto */
+static bool compact(const char* path, int log_fd) {
+    if (flock(log_fd, LOCK_EX | LOCK_NB) == -1) {
+        return false;
+    }
+    struct entry* entries = NULL;
+    size_t count = 0u;
+    const char* snapshot = NULL;
+    const char* log = NULL;
+    size_t snapshot_size = 0u;
+    size_t log_size = 0u;
+    bool result = read_all(path, log_fd, &entries, &count, &snapshot,
+                           &snapshot_size, &log, &log_size);
+    if (result) {
+        size_t size = 0u;
+        char* data = build_snapshot(entries, count, &size);
+        free(entries);
+        unmap_file(snapshot, snapshot_size);
+        unmap_file(log, log_size);
+
+        /* La foto nueva se escribe aparte y reemplaza a la vieja de una vez,
+           así nadie lee una foto a medias. Si se corta después del rename,
+           las líneas quedan también en el registro y se sacan al volver a
+           compactar */
+        char* tmp_path = concat(path, TMP_SUFFIX);
+        int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        result = fd != -1 && write_all(fd, data, size) && fdatasync(fd) == 0;
+        if (fd != -1) {
+            result = close(fd) == 0 && result;
+        }
+        result = result && rename(tmp_path, path) == 0 &&
+                 ftruncate(log_fd, 0) == 0;
+        if (!result) {
+            perror(tmp_path);
+            unlink(tmp_path);
+        }
+        free(tmp_path);
+        free(data);
+    }
+    flock(log_fd, LOCK_UN);
+    return result;
+}
+
+bool histlog_compact(const char* path) {
+    assert(path != NULL);
+
+    char* log_path = concat(path, LOG_SUFFIX);
+    int log_fd = open(log_path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    bool result = false;
+    if (log_fd == -1) {
+        perror(log_path);
+    } else {
+        result = compact(path, log_fd);
+        close(log_fd);
+    }
+    free(log_path);
+    return result;
+}
+
+/********** Hilo que escribe **********/
+
+static void* histlog_writer(void* arg) {
+    histlog self = arg;
+
+    pthread_mutex_lock(&self->lock);
+    while (true) {
+        if (self->pending_length == 0u && !self->compact) {
+            if (self->stop) {
+                break;
+            }
+            pthread_cond_wait(&self->wakeup, &self->lock);
+            continue;
+        }
+        char* data = self->pending;
+        size_t length = self->pending_length;
+        bool compact_now = self->compact;
+        self->pending = NULL;
+        self->pending_length = 0u;
+        self->pending_capacity = 0u;
+        self->compact = false;
+        pthread_mutex_unlock(&self->lock);
+
+        /* Todos los registros pendientes van en un solo write(), que con
+           O_APPEND queda entero al final aunque escriban otras sesiones */
+        if (length > 0u) {
+            flock(self->log_fd, LOCK_SH);
+            if (!write_all(self->log_fd, data, length)) {
+                perror(self->log_path);
+            }
+            flock(self->log_fd, LOCK_UN);
+            struct stat st;
+            compact_now = compact_now ||
+                          (fstat(self->log_fd, &st) == 0 &&
+                           (size_t)st.st_size > HISTLOG_COMPACT_BYTES);
+        }
+        free(data);
+        if (compact_now) {
+            // Si otra sesión lo está haciendo, se vuelve a probar la próxima
+            compact(self->path, self->log_fd);
+        }
+
+        pthread_mutex_lock(&self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+/********** Interfaz **********/
+
+histlog histlog_open(const char* path, history hist) {
+    assert(path != NULL && hist != NULL);
+
+    histlog self = checked_realloc(NULL, sizeof(struct histlog_s));
+    self->path = concat(path, "");
+    self->log_path = concat(path, LOG_SUFFIX);
+    self->pending = NULL;
+    self->pending_length = 0u;
+    self->pending_capacity = 0u;
+    self->compact = false;
+    self->stop = false;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->wakeup, NULL);
+
+    self->log_fd =
+        open(self->log_path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (self->log_fd == -1) {
+        perror(self->log_path);
+    }
+
+    // Mientras se lee, nadie compacta
+    bool ok = self->log_fd != -1 && flock(self->log_fd, LOCK_SH) == 0;
+    if (ok) {
+        struct entry* entries = NULL;
+        size_t count = 0u;
+        const char* snapshot = NULL;
+        const char* log = NULL;
+        size_t snapshot_size = 0u;
+        size_t log_size = 0u;
+        ok = read_all(self->path, self->log_fd, &entries, &count, &snapshot,
+                      &snapshot_size, &log, &log_size);
+        flock(self->log_fd, LOCK_UN);
+        if (ok) {
+            char* line = checked_realloc(NULL, RECORD_MAX_LINE + 1u);
+            for (size_t n = 0u; n < count; n++) {
+                memcpy(line, entries[n].line, entries[n].length);
+                line[entries[n].length] = '\0';
+                history_add(hist, line);
+            }
+            free(line);
+            free(entries);
+            unmap_file(snapshot, snapshot_size);
+            unmap_file(log, log_size);
+            self->compact = log_size > HISTLOG_COMPACT_BYTES;
+        }
+    }
+
+    int error = ok ? pthread_create(&self->thread, NULL, histlog_writer, self)
+                   : 0;
+    if (error != 0) {
+        errno = error;
+        perror("mybash: historial");
+        ok = false;
+    }
+    if (!ok) {
+        if (self->log_fd != -1) {
+            close(self->log_fd);
+        }
+        pthread_cond_destroy(&self->wakeup);
+        pthread_mutex_destroy(&self->lock);
+        free(self->log_path);
+        free(self->path);
+        free(self);
+        self = NULL;
+    }
+    return self;
+}
+
+void histlog_append(histlog self, const char* line) {
+    assert(self != NULL && line != NULL && strchr(line, '\n') == NULL);
+
+    size_t length = strlen(line);
+    if (length == 0u || length > RECORD_MAX_LINE) {
+        return;
+    }
+    struct record_header header = {(uint32_t)length, line_hash(line, length)};
+
+    pthread_mutex_lock(&self->lock);
+    size_t needed = self->pending_length + sizeof(header) + length;
+    if (needed > self->pending_capacity) {
+        self->pending_capacity = needed > 2u * self->pending_capacity
+                                     ? needed
+                                     : 2u * self->pending_capacity;
+        self->pending = checked_realloc(self->pending, self->pending_capacity);
+    }
+    memcpy(self->pending + self->pending_length, &header, sizeof(header));
+    memcpy(self->pending + self->pending_length + sizeof(header), line,
+           length);
+    self->pending_length = needed;
+    pthread_cond_signal(&self->wakeup);
+    pthread_mutex_unlock(&self->lock);
+}
+
+histlog histlog_close(histlog self) {
+    assert(self != NULL);
+
+    // El hilo escribe lo pendiente antes de terminar
+    pthread_mutex_lock(&self->lock);
+    self->stop = true;
+    pthread_cond_signal(&self->wakeup);
+    pthread_mutex_unlock(&self->lock);
+    pthread_join(self->thread, NULL);
+
+    close(self->log_fd);
+    pthread_cond_destroy(&self->wakeup);
+    pthread_mutex_destroy(&self->lock);
+    free(self->pending);
+    free(self->log_path);
+    free(self->path);
+    free(self);
+    self = NULL;
+
+    return self;
+}
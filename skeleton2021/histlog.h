@@ -0,0 +1,69 @@
+/* histlog: historial persistente, compartido entre sesiones.
+ *
+ * El historial se guarda en dos archivos binarios:
+ *   <path>       la foto: las líneas sin repetir, de la más vieja a la más
+ *                nueva, con un encabezado
+ *   <path>.log   el registro: las líneas que se fueron agregando desde la
+ *                última foto, en el orden en que se agregaron
+ * Cada línea se guarda como un registro con su largo y un hash del
+ * contenido, para poder descartar un registro cortado.
+ *
+ * Todas las sesiones escriben al mismo registro, abierto con O_APPEND: cada
+ * write() agrega registros enteros al final, así que las líneas de sesiones
+ * distintas no se mezclan. Al arrancar se mapean en memoria la foto y el
+ * registro, sin parsear texto.
+ *
+ * Las escrituras las hace un hilo aparte, así que agregar una línea nunca
+ * espera al disco. Cuando el registro crece, ese mismo hilo lo compacta:
+ * arma una foto nueva con la foto y el registro sin líneas repetidas (se
+ * queda con la aparición más nueva), la reemplaza con rename() y vacía el
+ * registro. Las escrituras toman un flock compartido del registro y la
+ * compactación uno exclusivo, para que no se pierdan líneas de otras
+ * sesiones mientras se compacta.
+ */
+
+#ifndef _HISTLOG_H_
+#define _HISTLOG_H_
+
+#include <stdbool.h>
+
+#include "history.h"
+
+typedef struct histlog_s* histlog;
+
+/* Cantidad máxima de líneas que se guardan en la foto */
+#define HISTLOG_MAX_ENTRIES 100000u
+
+/* Tamaño del registro a partir del cual se compacta */
+#define HISTLOG_COMPACT_BYTES (256u * 1024u)
+
+/*
+ * Abre el historial guardado en `path' (lo crea si no existe), agrega a
+ * `hist' todas sus líneas y arranca el hilo que escribe.
+ * Returns: NULL si no se pudo abrir (ya se informó el error)
+ * Requires: path != NULL && hist != NULL
+ */
+histlog histlog_open(const char* path, history hist);
+
+/*
+ * Pide guardar `line'. No espera a que se escriba.
+ * Requires: self != NULL && line != NULL && line no tiene '\n'
+ */
+void histlog_append(histlog self, const char* line);
+
+/*
+ * Escribe las líneas pendientes, para el hilo y cierra el historial.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+histlog histlog_close(histlog self);
+
+/*
+ * Compacta el historial guardado en `path' ahora, en este hilo. Si otra
+ * sesión está compactando o escribiendo no espera, y devuelve false.
+ * Returns: true si se compactó
+ * Requires: path != NULL
+ */
+bool histlog_compact(const char* path);
+
+#endif
@@ -0,0 +1,247 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "history.h"
+
+/* Lista de las entradas que contienen un trigrama, en orden creciente (las
+ * entradas se agregan siempre al final del historial).
+ * El trigrama se guarda como sus tres bytes: las líneas no tienen '\0', así
+ * que ningún trigrama es 0, y key == 0 marca un lugar libre de la tabla.
+ */
+struct posting {
+    uint32_t key;
+    uint32_t length;
+    uint32_t capacity;
+    uint32_t* entries;
+};
+
+struct history_s {
+    char** lines;
+    unsigned int length;
+    unsigned int capacity;
+    // Tabla de hash con direccionamiento abierto (sondeo lineal)
+    struct posting* index;
+    uint32_t index_size; // potencia de 2
+    uint32_t index_used;
+    unsigned int indexed; // las líneas anteriores ya están en el índice
+};
+
+/* Las consultas más cortas que un trigrama se buscan sin el índice */
+#define TRIGRAM 3u
+
+#define INITIAL_INDEX_SIZE 1024u
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static uint32_t trigram_key(const char* s) {
+    return (uint32_t)(unsigned char)s[0] << 16 |
+           (uint32_t)(unsigned char)s[1] << 8 | (uint32_t)(unsigned char)s[2];
+}
+
+static uint32_t trigram_hash(uint32_t key) {
+    return key * 2654435761u; // hash multiplicativo de Knuth
+}
+
+history history_new(void) {
+    history self = checked_realloc(NULL, sizeof(struct history_s));
+    self->lines = NULL;
+    self->length = 0u;
+    self->capacity = 0u;
+    self->index = calloc(INITIAL_INDEX_SIZE, sizeof(struct posting));
+    if (self->index == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    self->index_size = INITIAL_INDEX_SIZE;
+    self->index_used = 0u;
+    self->indexed = 0u;
+
+    assert(self != NULL && history_length(self) == 0u);
+    return self;
+}
+
+history history_destroy(history self) {
+    assert(self != NULL);
+
+    for (unsigned int i = 0u; i < self->length; i++) {
+        free(self->lines[i]);
+    }
+    free(self->lines);
+    for (uint32_t i = 0u; i < self->index_size; i++) {
+        free(self->index[i].entries);
+    }
+    free(self->index);
+    free(self);
+    self = NULL;
+
+    return self;
+}
+
+/* Lugar de la tabla del trigrama key: el suyo, o el libre donde iría */
+static struct posting* index_slot(struct posting* index, uint32_t size,
+                                  uint32_t key) {
+    uint32_t i = trigram_hash(key) & (size - 1u);
+    while (index[i].key != 0u && index[i].key != key) {
+        i = (i + 1u) & (size - 1u);
+    }
+    return &index[i];
+}
+
+/* Duplica el tamaño de la tabla del índice */
+static void index_grow(history self) {
+    uint32_t size = 2u * self->index_size;
+    struct posting* index = calloc(size, sizeof(struct posting));
+    if (index == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t i = 0u; i < self->index_size; i++) {
+        if (self->index[i].key != 0u) {
+            *index_slot(index, size, self->index[i].key) = self->index[i];
+        }
+    }
+    free(self->index);
+    self->index = index;
+    self->index_size = size;
+}
+
+/* Agrega la entrada n a la lista del trigrama key */
+static void index_add(history self, uint32_t key, uint32_t n) {
+    // Se mantiene la tabla ocupada a lo sumo hasta la mitad
+    if (2u * (self->index_used + 1u) > self->index_size) {
+        index_grow(self);
+    }
+    struct posting* p = index_slot(self->index, self->index_size, key);
+    if (p->key == 0u) {
+        p->key = key;
+        self->index_used++;
+    }
+    // Si la línea repite el trigrama, ya está en la lista
+    if (p->length > 0u && p->entries[p->length - 1u] == n) {
+        return;
+    }
+    if (p->length == p->capacity) {
+        p->capacity = p->capacity > 0u ? 2u * p->capacity : 4u;
+        p->entries =
+            checked_realloc(p->entries, p->capacity * sizeof(uint32_t));
+    }
+    p->entries[p->length] = n;
+    p->length++;
+}
+
+bool history_add(history self, const char* line) {
+    assert(self != NULL && line != NULL && strchr(line, '\n') == NULL);
+
+    if (line[0] == '\0' ||
+        (self->length > 0u &&
+         strcmp(self->lines[self->length - 1u], line) == 0)) {
+        return false;
+    }
+    if (self->length == self->capacity) {
+        self->capacity = self->capacity > 0u ? 2u * self->capacity : 64u;
+        self->lines =
+            checked_realloc(self->lines, self->capacity * sizeof(char*));
+    }
+    size_t length = strlen(line);
+    char* copy = checked_realloc(NULL, length + 1u);
+    memcpy(copy, line, length + 1u);
+    self->lines[self->length] = copy;
+    self->length++;
+    return true;
+}
+
+/* Agrega al índice las líneas que se agregaron desde la última búsqueda.
+ * Así cargar un historial grande al arrancar no espera al índice, y se
+ * indexa de una vez en la primera búsqueda.
+ */
+static void index_catch_up(history self) {
+    for (; self->indexed < self->length; self->indexed++) {
+        const char* line = self->lines[self->indexed];
+        for (size_t i = 0u; line[i] != '\0' && line[i + 1u] != '\0' &&
+                            line[i + 2u] != '\0';
+             i++) {
+            index_add(self, trigram_key(line + i), self->indexed);
+        }
+    }
+}
+
+unsigned int history_length(const history self) {
+    assert(self != NULL);
+    return self->length;
+}
+
+const char* history_get(const history self, unsigned int n) {
+    assert(self != NULL && n < history_length(self));
+    return self->lines[n];
+}
+
+/* Búsqueda sin índice, de la más nueva a la más vieja */
+static bool search_linear(const history self, const char* query,
+                          unsigned int before, unsigned int* found) {
+    for (unsigned int n = before; n > 0u; n--) {
+        if (strstr(self->lines[n - 1u], query) != NULL) {
+            *found = n - 1u;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool history_search(const history self, const char* query, unsigned int before,
+                    unsigned int* found) {
+    assert(self != NULL && query != NULL && found != NULL &&
+           before <= history_length(self));
+
+    size_t length = strlen(query);
+    if (length < TRIGRAM) {
+        // Las consultas cortas aparecen en casi todas las líneas, así que
+        // se encuentran enseguida recorriendo desde la más nueva
+        return search_linear(self, query, before, found);
+    }
+
+    index_catch_up(self);
+
+    // La lista más corta entre los trigramas de query; si alguno no está,
+    // no hay ninguna línea que contenga a query
+    const struct posting* shortest = NULL;
+    for (size_t i = 0u; i + TRIGRAM <= length; i++) {
+        const struct posting* p =
+            index_slot(self->index, self->index_size, trigram_key(query + i));
+        if (p->key == 0u) {
+            return false;
+        }
+        if (shortest == NULL || p->length < shortest->length) {
+            shortest = p;
+        }
+    }
+
+    // Primera posición de la lista con una entrada >= before
+    uint32_t low = 0u;
+    uint32_t high = shortest->length;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2u;
+        if (shortest->entries[middle] < before) {
+            low = middle + 1u;
+        } else {
+            high = middle;
+        }
+    }
+    for (uint32_t i = low; i > 0u; i--) {
+        uint32_t n = shortest->entries[i - 1u];
+        if (strstr(self->lines[n], query) != NULL) {
+            *found = n;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+/* history: historial de comandos, con búsqueda de subcadenas indexada.
+ *
+ * Es una secuencia de líneas numeradas desde 0 (la más vieja). Para que la
+ * búsqueda incremental (Ctrl-R) sea rápida aunque el historial sea muy grande,
+ * se mantiene un índice de trigramas: para cada secuencia de tres caracteres,
+ * la lista de las entradas que la contienen. Para buscar una cadena se recorre
+ * solo la lista del trigrama menos frecuente de la cadena, y se verifica cada
+ * candidata. El índice se actualiza con las líneas nuevas en cada búsqueda,
+ * así que agregar muchas líneas de una vez (al arrancar) no lo recalcula.
+ *
+ *           ___________________________________
+ *  0 ->     | línea0 | línea1 | ... | líneaN-1 |   <- N-1 (la más nueva)
+ *           -----------------------------------
+ */
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <stdbool.h>
+
+typedef struct history_s* history;
+
+/*
+ * Nuevo historial vacío.
+ * Ensures: result != NULL && history_length(result) == 0
+ */
+history history_new(void);
+
+/*
+ * Destruye `self'.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+history history_destroy(history self);
+
+/*
+ * Agrega una copia de `line' al final del historial. Las líneas vacías y las
+ * iguales a la última no se agregan.
+ * Returns: true si se agregó
+ * Requires: self != NULL && line != NULL && line no tiene '\n'
+ */
+bool history_add(history self, const char* line);
+
+/*
+ * Cantidad de líneas del historial.
+ * Requires: self != NULL
+ */
+unsigned int history_length(const history self);
+
+/*
+ * La línea número `n' (0 es la más vieja). La cadena es del TAD.
+ * Requires: self != NULL && n < history_length(self)
+ * Ensures: result != NULL
+ */
+const char* history_get(const history self, unsigned int n);
+
+/*
+ * Busca la línea más nueva anterior a `before' que contenga a `query'.
+ *   found: dónde se guarda el número de la línea encontrada.
+ * Returns: true si se encontró alguna
+ * Requires: self != NULL && query != NULL && found != NULL
+ *     && before <= history_length(self)
+ */
+bool history_search(const history self, const char* query, unsigned int before,
+                    unsigned int* found);
+
+#endif
@@ -0,0 +1,215 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "command.h"
+#include "linecache.h"
+
+/* Cada entrada está a la vez en una lista de su bucket de la tabla de hash
+ * (chain) y en la lista doblemente enlazada del orden de uso (prev/next), que
+ * va de la usada más recientemente (newest) a la más vieja (oldest).
+ */
+struct entry {
+    uint64_t hash;
+    char* text; // copia de la línea, sin '\0'
+    size_t length;
+    pipeline apipe; // nunca se modifica; se devuelven clones
+    struct entry* chain;
+    struct entry* prev;
+    struct entry* next;
+};
+
+struct linecache_s {
+    struct entry** buckets;
+    unsigned int n_buckets; // potencia de 2
+    unsigned int capacity;
+    unsigned int length;
+    struct entry* newest;
+    struct entry* oldest;
+    unsigned long hits;
+    unsigned long misses;
+};
+
+static void* checked_calloc(size_t n, size_t size) {
+    void* result = calloc(n, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* FNV-1a de 64 bits */
+static uint64_t hash_line(const char* line, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0u; i < length; i++) {
+        hash ^= (unsigned char)line[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+linecache linecache_new(unsigned int capacity) {
+    assert(capacity > 0u);
+
+    linecache self = checked_calloc(1u, sizeof(struct linecache_s));
+    // Dos buckets por entrada, para que las cadenas sean cortas
+    self->n_buckets = 1u;
+    while (self->n_buckets < 2u * capacity) {
+        self->n_buckets *= 2u;
+    }
+    self->buckets = checked_calloc(self->n_buckets, sizeof(struct entry*));
+    self->capacity = capacity;
+    self->length = 0u;
+    self->newest = NULL;
+    self->oldest = NULL;
+    self->hits = 0ul;
+    self->misses = 0ul;
+
+    assert(self != NULL);
+    return self;
+}
+
+static struct entry** bucket_of(linecache self, uint64_t hash) {
+    return &self->buckets[hash & (self->n_buckets - 1u)];
+}
+
+/* Saca a e de la lista de uso, sin liberarla */
+static void unlink_lru(linecache self, struct entry* e) {
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        self->newest = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    } else {
+        self->oldest = e->prev;
+    }
+    e->prev = NULL;
+    e->next = NULL;
+}
+
+/* Pone a e al principio de la lista de uso */
+static void push_newest(linecache self, struct entry* e) {
+    e->prev = NULL;
+    e->next = self->newest;
+    if (self->newest != NULL) {
+        self->newest->prev = e;
+    } else {
+        self->oldest = e;
+    }
+    self->newest = e;
+}
+
+/* Saca a e del cache y la libera */
+static void remove_entry(linecache self, struct entry* e) {
+    struct entry** link = bucket_of(self, e->hash);
+    while (*link != e) {
+        link = &(*link)->chain;
+    }
+    *link = e->chain;
+    unlink_lru(self, e);
+    self->length--;
+
+    free(e->text);
+    pipeline_destroy(e->apipe);
+    free(e);
+}
+
+static struct entry* find_entry(linecache self, uint64_t hash,
+                                const char* line, size_t length) {
+    struct entry* e = *bucket_of(self, hash);
+    while (e != NULL &&
+           !(e->hash == hash && e->length == length &&
+             memcmp(e->text, line, length) == 0)) {
+        e = e->chain;
+    }
+    return e;
+}
+
+void linecache_clear(linecache self) {
+    assert(self != NULL);
+
+    while (self->oldest != NULL) {
+        remove_entry(self, self->oldest);
+    }
+
+    assert(self->length == 0u);
+}
+
+linecache linecache_destroy(linecache self) {
+    assert(self != NULL);
+
+    linecache_clear(self);
+    free(self->buckets);
+    free(self);
+    self = NULL;
+
+    return self;
+}
+
+pipeline linecache_lookup(linecache self, const char* line, size_t length) {
+    assert(self != NULL && (line != NULL || length == 0u));
+
+    struct entry* e = find_entry(self, hash_line(line, length), line, length);
+    if (e == NULL) {
+        self->misses++;
+        return NULL;
+    }
+    self->hits++;
+    unlink_lru(self, e);
+    push_newest(self, e);
+    return pipeline_clone(e->apipe);
+}
+
+void linecache_insert(linecache self, const char* line, size_t length,
+                      const pipeline apipe) {
+    assert(self != NULL && (line != NULL || length == 0u) && apipe != NULL);
+
+    if (length > LINECACHE_MAX_LINE) {
+        return;
+    }
+
+    uint64_t hash = hash_line(line, length);
+    struct entry* old = find_entry(self, hash, line, length);
+    if (old != NULL) {
+        remove_entry(self, old);
+    } else if (self->length == self->capacity) {
+        remove_entry(self, self->oldest);
+    }
+
+    struct entry* e = checked_calloc(1u, sizeof(struct entry));
+    e->hash = hash;
+    e->text = checked_calloc(length + 1u, sizeof(char));
+    memcpy(e->text, line, length);
+    e->length = length;
+    e->apipe = pipeline_clone(apipe);
+    struct entry** bucket = bucket_of(self, hash);
+    e->chain = *bucket;
+    *bucket = e;
+    push_newest(self, e);
+    self->length++;
+
+    assert(self->length <= self->capacity);
+}
+
+unsigned int linecache_length(linecache self) {
+    assert(self != NULL);
+
+    return self->length;
+}
+
+void linecache_stats(const linecache self, unsigned long* hits,
+                     unsigned long* misses) {
+    assert(self != NULL);
+
+    if (hits != NULL) {
+        *hits = self->hits;
+    }
+    if (misses != NULL) {
+        *misses = self->misses;
+    }
+}
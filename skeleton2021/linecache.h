@@ -0,0 +1,85 @@
+/* Cache de líneas ya parseadas.
+ *
+ * Asocia el texto de una línea con el pipeline que resulta de parsearla, para
+ * no volver a parsear las líneas que se repiten (historial, loops, scripts
+ * generados). Los pipelines guardados no se modifican nunca: la búsqueda
+ * devuelve un clon (pipeline_clone, que comparte el contenido con
+ * copy-on-write), así que es barata y el llamador puede hacer lo que quiera
+ * con el resultado.
+ *
+ * El cache tiene una cantidad máxima de entradas; cuando se llena se descarta
+ * la que se usó hace más tiempo (LRU). Las líneas se buscan por un hash del
+ * texto, y se compara el texto completo para confirmar.
+ *
+ * Las entradas nunca quedan viejas: el pipeline de una línea depende solo de
+ * su texto (las variables y los patrones se expanden al ejecutar, ver
+ * expand.h, y no hay alias), así que no hace falta invalidar nada.
+ */
+
+#ifndef _LINECACHE_H_
+#define _LINECACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "command.h"
+
+/* Las líneas más largas que esto no se guardan */
+#define LINECACHE_MAX_LINE 4096u
+
+typedef struct linecache_s* linecache;
+
+/*
+ * Nuevo cache vacío, con lugar para `capacity' líneas.
+ * Ensures: result != NULL
+ * Requires: capacity > 0
+ */
+linecache linecache_new(unsigned int capacity);
+
+/*
+ * Destruye `self' junto con los pipelines guardados.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+linecache linecache_destroy(linecache self);
+
+/*
+ * Busca la línea [line, line + length) en el cache, y la marca como la más
+ * recientemente usada.
+ * Returns: un clon nuevo del pipeline guardado (a liberar por el llamador), o
+ *     NULL si la línea no está. Cuenta un acierto o un fallo.
+ * Requires: self != NULL && (line != NULL || length == 0)
+ */
+pipeline linecache_lookup(linecache self, const char* line, size_t length);
+
+/*
+ * Guarda el resultado de parsear [line, line + length). El cache se queda con
+ * un clon de `apipe', así que el llamador lo sigue teniendo. Si ya había una
+ * entrada para la línea se reemplaza. Si el cache está lleno se descarta la
+ * entrada usada hace más tiempo.
+ * Requires: self != NULL && (line != NULL || length == 0) && apipe != NULL
+ */
+void linecache_insert(linecache self, const char* line, size_t length,
+                      const pipeline apipe);
+
+/*
+ * Vacía `self'. Los contadores no se tocan.
+ * Requires: self != NULL
+ */
+void linecache_clear(linecache self);
+
+/*
+ * Cantidad de entradas guardadas en `self'.
+ * Requires: self != NULL
+ */
+unsigned int linecache_length(linecache self);
+
+/*
+ * Contadores de aciertos y fallos de linecache_lookup desde que se creó
+ * `self'. Cualquiera de los punteros puede ser NULL.
+ * Requires: self != NULL
+ */
+void linecache_stats(const linecache self, unsigned long* hits,
+                     unsigned long* misses);
+
+#endif
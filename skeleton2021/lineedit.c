@@ -0,0 +1,726 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "complete.h"
+#include "history.h"
+#include "lineedit.h"
+#include "prompt.h"
+
+/* Teclas. Las que llegan como secuencias de escape se representan con
+ * valores fuera del rango de un byte.
+ */
+#define KEY_CTRL(c) ((c)&0x1f)
+#define KEY_ESC 27
+#define KEY_BACKSPACE 127
+enum {
+    KEY_NONE = 256, // secuencia de escape que no se usa
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_HOME,
+    KEY_END,
+    KEY_DELETE
+};
+
+/* Resultado de procesar una tecla */
+typedef enum { EDIT_CONTINUE, EDIT_DONE, EDIT_CANCEL, EDIT_EOF } edit_status;
+
+/* Cadena que crece, no necesariamente terminada en '\0' */
+struct text {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+/* Estado del editor. Lo usan el hilo principal (las teclas) y el hook del
+ * prompt, que puede llamarse desde el hilo de segments.h; todo va con lock.
+ */
+static struct {
+    pthread_mutex_t lock;
+    bool ready;
+    int fd;
+    struct termios cooked; // configuración de la terminal fuera del editor
+    history hist;
+
+    struct text prompt; // el último prompt que llegó por el hook
+    bool prompt_shown;  // ya se escribió entero (con sus líneas anteriores)
+    struct text line;
+    size_t cursor; // posición en line, en bytes
+
+    unsigned int hist_pos; // línea del historial que se está mostrando
+    struct text pending;   // la línea nueva, mientras se recorre el historial
+
+    bool searching;         // Ctrl-R
+    struct text query;
+    struct text original;   // la línea antes de empezar a buscar
+    bool found;
+    unsigned int match;
+
+    int last_key; // para reconocer el segundo Tab seguido
+
+    struct text out; // lo que se escribe en cada refresh
+} ed = {.lock = PTHREAD_MUTEX_INITIALIZER, .ready = false, .fd = -1};
+
+/********** Cadenas **********/
+
+static void text_reserve(struct text* t, size_t extra) {
+    if (t->length + extra + 1u > t->capacity) {
+        size_t capacity = t->capacity > 0u ? t->capacity : 64u;
+        while (t->length + extra + 1u > capacity) {
+            capacity *= 2u;
+        }
+        char* data = realloc(t->data, capacity);
+        if (data == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+        t->data = data;
+        t->capacity = capacity;
+    }
+}
+
+static void text_insert(struct text* t, size_t pos, const char* s, size_t n) {
+    assert(pos <= t->length);
+    text_reserve(t, n);
+    memmove(t->data + pos + n, t->data + pos, t->length - pos);
+    memcpy(t->data + pos, s, n);
+    t->length += n;
+    t->data[t->length] = '\0';
+}
+
+static void text_append(struct text* t, const char* s, size_t n) {
+    text_insert(t, t->length, s, n);
+}
+
+static void text_erase(struct text* t, size_t pos, size_t n) {
+    assert(pos + n <= t->length);
+    memmove(t->data + pos, t->data + pos + n, t->length - pos - n);
+    t->length -= n;
+    t->data[t->length] = '\0';
+}
+
+static void text_set(struct text* t, const char* s, size_t n) {
+    t->length = 0u;
+    text_append(t, s, n);
+}
+
+static void text_free(struct text* t) {
+    free(t->data);
+    *t = (struct text){NULL, 0u, 0u};
+}
+
+/********** Dibujo **********/
+
+/* Columnas que ocupan en pantalla los n bytes de s: no cuentan las
+ * secuencias de escape ANSI ni los bytes de continuación de UTF-8.
+ */
+static size_t display_width(const char* s, size_t n) {
+    size_t width = 0u;
+    size_t i = 0u;
+    while (i < n) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == KEY_ESC) {
+            i++;
+            if (i < n && s[i] == '[') {
+                i++;
+                while (i < n && !(s[i] >= 0x40 && s[i] <= 0x7e)) {
+                    i++;
+                }
+            }
+        } else if ((c & 0xc0) != 0x80) {
+            width++;
+        }
+        i++;
+    }
+    return width;
+}
+
+/* Posición del caracter (UTF-8) anterior o siguiente a pos en line */
+static size_t char_before(size_t pos) {
+    do {
+        pos--;
+    } while (pos > 0u && ((unsigned char)ed.line.data[pos] & 0xc0) == 0x80);
+    return pos;
+}
+
+static size_t char_after(size_t pos) {
+    do {
+        pos++;
+    } while (pos < ed.line.length &&
+             ((unsigned char)ed.line.data[pos] & 0xc0) == 0x80);
+    return pos;
+}
+
+static size_t terminal_columns(void) {
+    struct winsize ws;
+    if (ioctl(ed.fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+        return ws.ws_col;
+    }
+    return 80u;
+}
+
+static void write_all(const char* data, size_t length) {
+    while (length > 0u) {
+        ssize_t written = write(ed.fd, data, length);
+        if (written < 0) {
+            if (errno != EINTR) {
+                return;
+            }
+        } else {
+            data += written;
+            length -= (size_t)written;
+        }
+    }
+}
+
+/* Vuelve a dibujar la línea (la última línea del prompt, o el de la
+ * búsqueda, y lo que se está editando) con una sola escritura. Si la línea no
+ * entra en la terminal, se muestra la parte alrededor del cursor.
+ * Requires: ed.lock tomado
+ */
+static void refresh(void) {
+    struct text* out = &ed.out;
+    out->length = 0u;
+    text_append(out, "\r", 1u);
+
+    // Las líneas del prompt anteriores a la última solo se escriben una vez
+    const char* prompt = ed.prompt.data;
+    const char* last = memrchr(prompt, '\n', ed.prompt.length);
+    size_t last_start = last != NULL ? (size_t)(last - prompt) + 1u : 0u;
+    if (!ed.prompt_shown) {
+        text_append(out, prompt, last_start);
+        ed.prompt_shown = true;
+    }
+
+    char label[64];
+    const char* left = prompt + last_start;
+    size_t left_length = ed.prompt.length - last_start;
+    if (ed.searching) {
+        int n = snprintf(label, sizeof(label), "(%sreverse-i-search)`",
+                         ed.found || ed.query.length == 0u ? "" : "failed ");
+        left = label;
+        left_length = (size_t)n;
+    }
+    text_append(out, left, left_length);
+    size_t width = display_width(left, left_length);
+    if (ed.searching) {
+        text_append(out, ed.query.data, ed.query.length);
+        text_append(out, "': ", 3u);
+        width += display_width(ed.query.data, ed.query.length) + 3u;
+    }
+
+    // Desde dónde se muestra la línea, para que el cursor quede a la vista
+    size_t columns = terminal_columns();
+    size_t from = 0u;
+    while (from < ed.cursor &&
+           width + display_width(ed.line.data + from, ed.cursor - from) >=
+               columns) {
+        from++;
+    }
+    size_t cursor_column =
+        width + display_width(ed.line.data + from, ed.cursor - from);
+    // Y hasta dónde, para no pasarse del ancho
+    size_t to = from;
+    size_t line_width = width;
+    while (to < ed.line.length && line_width + 1u < columns) {
+        if (((unsigned char)ed.line.data[to] & 0xc0) != 0x80) {
+            line_width++;
+        }
+        to++;
+    }
+    while (to < ed.line.length &&
+           ((unsigned char)ed.line.data[to] & 0xc0) == 0x80) {
+        to++;
+    }
+    text_append(out, ed.line.data + from, to - from);
+
+    // Borra lo que quede a la derecha y pone el cursor en su lugar
+    text_append(out, "\033[K\r", 4u);
+    if (cursor_column > 0u) {
+        char move[32];
+        int n = snprintf(move, sizeof(move), "\033[%zuC", cursor_column);
+        text_append(out, move, (size_t)n);
+    }
+    write_all(out->data, out->length);
+}
+
+/* Hook del prompt (ver prompt_set_hook) */
+static void prompt_hook(const char* text, size_t length) {
+    pthread_mutex_lock(&ed.lock);
+    text_set(&ed.prompt, text, length);
+    refresh();
+    pthread_mutex_unlock(&ed.lock);
+}
+
+/********** Historial **********/
+
+static void show_history_line(unsigned int pos) {
+    unsigned int length = history_length(ed.hist);
+    if (ed.hist_pos == length) {
+        text_set(&ed.pending, ed.line.data, ed.line.length);
+    }
+    ed.hist_pos = pos;
+    if (pos == length) {
+        text_set(&ed.line, ed.pending.data, ed.pending.length);
+    } else {
+        const char* line = history_get(ed.hist, pos);
+        text_set(&ed.line, line, strlen(line));
+    }
+    ed.cursor = ed.line.length;
+}
+
+/* Busca query desde la línea before (exclusive) hacia atrás, y si la
+ * encuentra la muestra con el cursor sobre la coincidencia
+ */
+static void search_from(unsigned int before) {
+    unsigned int found = 0u;
+    if (ed.query.length == 0u) {
+        ed.found = false;
+        return;
+    }
+    ed.found = history_search(ed.hist, ed.query.data, before, &found);
+    if (ed.found) {
+        ed.match = found;
+        const char* line = history_get(ed.hist, found);
+        text_set(&ed.line, line, strlen(line));
+        ed.cursor = (size_t)(strstr(line, ed.query.data) - line);
+    }
+}
+
+/* Procesa una tecla en modo búsqueda.
+ * Returns: true si la tecla terminó la búsqueda y hay que procesarla como
+ *     una tecla normal
+ */
+static bool search_key(int key) {
+    unsigned int length = history_length(ed.hist);
+    bool pass = false;
+    if (key == KEY_CTRL('r')) {
+        // Si no hay más, se sigue mostrando la última que se encontró
+        search_from(ed.found ? ed.match : length);
+    } else if (key == KEY_CTRL('g')) {
+        text_set(&ed.line, ed.original.data, ed.original.length);
+        ed.cursor = ed.line.length;
+        ed.searching = false;
+    } else if (key == KEY_BACKSPACE || key == KEY_CTRL('h')) {
+        if (ed.query.length > 0u) {
+            ed.query.length--;
+            ed.query.data[ed.query.length] = '\0';
+        }
+        search_from(length);
+    } else if (key >= 32 && key < 256) {
+        char c = (char)key;
+        text_append(&ed.query, &c, 1u);
+        // La que se estaba mostrando puede seguir sirviendo
+        search_from(ed.found ? ed.match + 1u : length);
+    } else {
+        // Cualquier otra tecla acepta la línea encontrada
+        ed.searching = false;
+        if (ed.found) {
+            ed.hist_pos = ed.match;
+        }
+        pass = true;
+    }
+    return pass;
+}
+
+/********** Completado **********/
+
+/* Cantidad máxima de candidatos que se muestran */
+#define MAX_LISTED 100u
+
+/* Muestra los candidatos debajo de la línea, en columnas. De cada uno se
+ * muestra lo que sigue al último '/' (el nombre del archivo).
+ */
+static void show_matches(char** matches, size_t count) {
+    size_t listed = count < MAX_LISTED ? count : MAX_LISTED;
+    size_t width = 0u;
+    for (size_t i = 0u; i < listed; i++) {
+        size_t length = strlen(matches[i]);
+        const char* slash = length > 1u ? memrchr(matches[i], '/', length - 1u)
+                                        : NULL;
+        matches[i] += slash != NULL ? (size_t)(slash - matches[i]) + 1u : 0u;
+        size_t w = display_width(matches[i], strlen(matches[i]));
+        width = w > width ? w : width;
+    }
+    width += 2u;
+    size_t per_row = terminal_columns() / width > 0u
+                         ? terminal_columns() / width
+                         : 1u;
+
+    struct text* out = &ed.out;
+    out->length = 0u;
+    text_append(out, "\n", 1u);
+    for (size_t i = 0u; i < listed; i++) {
+        size_t length = strlen(matches[i]);
+        text_append(out, matches[i], length);
+        if ((i + 1u) % per_row == 0u || i + 1u == listed) {
+            text_append(out, "\n", 1u);
+        } else {
+            for (size_t w = display_width(matches[i], length); w < width;
+                 w++) {
+                text_append(out, " ", 1u);
+            }
+        }
+    }
+    if (listed < count) {
+        char more[64];
+        int n = snprintf(more, sizeof(more), "(y %zu más)\n", count - listed);
+        text_append(out, more, (size_t)n);
+    }
+    write_all(out->data, out->length);
+    // El prompt se vuelve a escribir entero debajo
+    ed.prompt_shown = false;
+}
+
+/* Completa la palabra que termina en el cursor: con el único candidato (y
+ * un espacio, salvo en los directorios), o con lo que tienen en común todos.
+ * Si no se puede agregar nada, en el segundo Tab seguido se muestran los
+ * candidatos.
+ */
+static void complete(bool again) {
+    size_t start = 0u;
+    char** matches = NULL;
+    size_t count = complete_word(ed.line.data, ed.cursor, &start, &matches);
+    if (count == 0u) {
+        write_all("\a", 1u);
+        complete_free(matches, count);
+        return;
+    }
+
+    size_t common = strlen(matches[0]);
+    for (size_t i = 1u; i < count; i++) {
+        size_t j = 0u;
+        while (j < common && matches[i][j] == matches[0][j]) {
+            j++;
+        }
+        common = j;
+    }
+    // Sin cortar un caracter de UTF-8 por la mitad
+    while (common > 0u && ((unsigned char)matches[0][common] & 0xc0) == 0x80) {
+        common--;
+    }
+
+    size_t word_length = ed.cursor - start;
+    if (common > word_length) {
+        text_erase(&ed.line, start, word_length);
+        text_insert(&ed.line, start, matches[0], common);
+        ed.cursor = start + common;
+    }
+    if (count == 1u) {
+        if (common == 0u || matches[0][common - 1u] != '/') {
+            text_insert(&ed.line, ed.cursor, " ", 1u);
+            ed.cursor++;
+        }
+    } else if (common <= word_length) {
+        if (again) {
+            char** shown = malloc(count * sizeof(char*));
+            if (shown == NULL) {
+                perror("Error fatal: malloc");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(shown, matches, count * sizeof(char*));
+            show_matches(shown, count);
+            free(shown);
+        } else {
+            write_all("\a", 1u);
+        }
+    }
+    complete_free(matches, count);
+}
+
+/********** Edición **********/
+
+/* Borra desde el cursor hacia atrás hasta el comienzo de la palabra */
+static void erase_word(void) {
+    size_t start = ed.cursor;
+    while (start > 0u && ed.line.data[start - 1u] == ' ') {
+        start--;
+    }
+    while (start > 0u && ed.line.data[start - 1u] != ' ') {
+        start--;
+    }
+    text_erase(&ed.line, start, ed.cursor - start);
+    ed.cursor = start;
+}
+
+static edit_status edit_key(int key) {
+    unsigned int length = history_length(ed.hist);
+    edit_status status = EDIT_CONTINUE;
+
+    switch (key) {
+    case '\r':
+    case '\n':
+        status = EDIT_DONE;
+        break;
+    case KEY_CTRL('c'):
+        status = EDIT_CANCEL;
+        break;
+    case KEY_CTRL('d'):
+        if (ed.line.length == 0u) {
+            status = EDIT_EOF;
+        } else if (ed.cursor < ed.line.length) {
+            text_erase(&ed.line, ed.cursor, char_after(ed.cursor) - ed.cursor);
+        }
+        break;
+    case KEY_DELETE:
+        if (ed.cursor < ed.line.length) {
+            text_erase(&ed.line, ed.cursor, char_after(ed.cursor) - ed.cursor);
+        }
+        break;
+    case KEY_BACKSPACE:
+    case KEY_CTRL('h'):
+        if (ed.cursor > 0u) {
+            size_t start = char_before(ed.cursor);
+            text_erase(&ed.line, start, ed.cursor - start);
+            ed.cursor = start;
+        }
+        break;
+    case KEY_LEFT:
+    case KEY_CTRL('b'):
+        if (ed.cursor > 0u) {
+            ed.cursor = char_before(ed.cursor);
+        }
+        break;
+    case KEY_RIGHT:
+    case KEY_CTRL('f'):
+        if (ed.cursor < ed.line.length) {
+            ed.cursor = char_after(ed.cursor);
+        }
+        break;
+    case KEY_HOME:
+    case KEY_CTRL('a'):
+        ed.cursor = 0u;
+        break;
+    case KEY_END:
+    case KEY_CTRL('e'):
+        ed.cursor = ed.line.length;
+        break;
+    case KEY_UP:
+    case KEY_CTRL('p'):
+        if (ed.hist_pos > 0u) {
+            show_history_line(ed.hist_pos - 1u);
+        }
+        break;
+    case KEY_DOWN:
+    case KEY_CTRL('n'):
+        if (ed.hist_pos < length) {
+            show_history_line(ed.hist_pos + 1u);
+        }
+        break;
+    case KEY_CTRL('k'):
+        text_erase(&ed.line, ed.cursor, ed.line.length - ed.cursor);
+        break;
+    case KEY_CTRL('u'):
+        text_erase(&ed.line, 0u, ed.cursor);
+        ed.cursor = 0u;
+        break;
+    case KEY_CTRL('w'):
+        erase_word();
+        break;
+    case '\t':
+        complete(ed.last_key == '\t');
+        break;
+    case KEY_CTRL('l'):
+        write_all("\033[H\033[2J", 7u);
+        ed.prompt_shown = false;
+        break;
+    case KEY_CTRL('r'):
+        ed.searching = true;
+        ed.found = false;
+        text_set(&ed.query, "", 0u);
+        text_set(&ed.original, ed.line.data, ed.line.length);
+        break;
+    default:
+        // Los caracteres comunes (y los bytes de UTF-8) se insertan
+        if (key >= 32 && key < 256) {
+            char c = (char)key;
+            text_insert(&ed.line, ed.cursor, &c, 1u);
+            ed.cursor++;
+        }
+    }
+    return status;
+}
+
+/* Lee un byte de la terminal
+ * Returns: el byte, o -1 en fin de archivo o error
+ */
+static int read_byte(void) {
+    unsigned char c = 0u;
+    ssize_t n = 0;
+    do {
+        n = read(ed.fd, &c, 1u);
+    } while (n < 0 && errno == EINTR);
+    return n == 1 ? c : -1;
+}
+
+/* Lee una tecla, traduciendo las secuencias de escape de las flechas y
+ * demás teclas especiales
+ * Returns: la tecla, o -1 en fin de archivo o error
+ */
+static int read_key(void) {
+    int c = read_byte();
+    if (c != KEY_ESC) {
+        return c;
+    }
+    int kind = read_byte();
+    int code = kind >= 0 ? read_byte() : -1;
+    if (code < 0) {
+        return -1;
+    }
+    int key = KEY_NONE;
+    if (kind == '[' && code >= '0' && code <= '9') {
+        // ESC [ n ~
+        if (read_byte() != '~') {
+            return KEY_NONE;
+        }
+        if (code == '1' || code == '7') {
+            key = KEY_HOME;
+        } else if (code == '4' || code == '8') {
+            key = KEY_END;
+        } else if (code == '3') {
+            key = KEY_DELETE;
+        }
+    } else if (kind == '[' || kind == 'O') {
+        switch (code) {
+        case 'A':
+            key = KEY_UP;
+            break;
+        case 'B':
+            key = KEY_DOWN;
+            break;
+        case 'C':
+            key = KEY_RIGHT;
+            break;
+        case 'D':
+            key = KEY_LEFT;
+            break;
+        case 'H':
+            key = KEY_HOME;
+            break;
+        case 'F':
+            key = KEY_END;
+            break;
+        }
+    }
+    return key;
+}
+
+/********** Interfaz **********/
+
+bool lineedit_init(int fd, history hist) {
+    assert(hist != NULL);
+
+    const char* term = getenv("TERM");
+    if (!isatty(fd) || (term != NULL && strcmp(term, "dumb") == 0) ||
+        tcgetattr(fd, &ed.cooked) != 0) {
+        return false;
+    }
+    ed.fd = fd;
+    ed.hist = hist;
+    // Las cadenas siempre tienen memoria, aunque estén vacías
+    text_set(&ed.prompt, "", 0u);
+    text_set(&ed.line, "", 0u);
+    text_set(&ed.pending, "", 0u);
+    text_set(&ed.query, "", 0u);
+    text_set(&ed.original, "", 0u);
+    text_set(&ed.out, "", 0u);
+    ed.hist_pos = history_length(hist);
+    ed.prompt_shown = false;
+    ed.ready = true;
+    prompt_set_hook(prompt_hook);
+    return true;
+}
+
+void lineedit_destroy(void) {
+    if (!ed.ready) {
+        return;
+    }
+    prompt_set_hook(NULL);
+    complete_stop();
+    ed.ready = false;
+    text_free(&ed.prompt);
+    text_free(&ed.line);
+    text_free(&ed.pending);
+    text_free(&ed.query);
+    text_free(&ed.original);
+    text_free(&ed.out);
+}
+
+char* lineedit_read(void) {
+    assert(ed.ready);
+
+    /* Modo raw: sin eco, byte a byte, sin señales por teclado ni control de
+       flujo. La salida se sigue procesando (un '\n' también vuelve al
+       comienzo de la línea), para que no cambie la salida de otros
+       procesos. */
+    struct termios raw = ed.cooked;
+    raw.c_iflag &= ~(tcflag_t)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_cflag |= CS8;
+    raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    // TCSADRAIN, no TCSAFLUSH: lo que se escribió antes de tiempo se usa
+    if (tcsetattr(ed.fd, TCSADRAIN, &raw) != 0) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&ed.lock);
+    ed.hist_pos = history_length(ed.hist);
+    ed.last_key = -1;
+    pthread_mutex_unlock(&ed.lock);
+
+    edit_status status = EDIT_CONTINUE;
+    while (status == EDIT_CONTINUE) {
+        int key = read_key();
+        pthread_mutex_lock(&ed.lock);
+        if (key < 0) {
+            status = EDIT_EOF;
+        } else if (!ed.searching || search_key(key)) {
+            status = edit_key(key);
+        }
+        ed.last_key = key;
+        if (status == EDIT_CONTINUE) {
+            refresh();
+        }
+        pthread_mutex_unlock(&ed.lock);
+    }
+
+    // Desde acá el prompt ya no se redibuja (se toma el lock del prompt, así
+    // que no puede quedar un redibujo a medias)
+    prompt_input_done();
+
+    pthread_mutex_lock(&ed.lock);
+    char* result = NULL;
+    if (status == EDIT_CANCEL) {
+        // La línea se abandona y queda en pantalla
+        write_all("^C\n", 3u);
+        result = strdup("");
+    } else if (status == EDIT_DONE) {
+        ed.searching = false;
+        ed.cursor = ed.line.length;
+        refresh();
+        write_all("\n", 1u);
+        result = strndup(ed.line.data, ed.line.length);
+    }
+    if (status != EDIT_EOF && result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    ed.line.length = 0u;
+    ed.cursor = 0u;
+    ed.prompt_shown = false;
+    pthread_mutex_unlock(&ed.lock);
+
+    tcsetattr(ed.fd, TCSADRAIN, &ed.cooked);
+    return result;
+}
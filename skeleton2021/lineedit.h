@@ -0,0 +1,51 @@
+/* Editor de línea para el modo interactivo.
+ *
+ * Lee la línea con la terminal en modo raw, y permite editarla:
+ *   ← → Ctrl-B Ctrl-F   mover el cursor      Inicio Fin Ctrl-A Ctrl-E
+ *   ↑ ↓ Ctrl-P Ctrl-N   recorrer el historial
+ *   Backspace Supr      borrar               Ctrl-K Ctrl-U Ctrl-W  cortar
+ *   Ctrl-R              búsqueda incremental hacia atrás en el historial
+ *                       (Ctrl-R otra vez: la siguiente, Ctrl-G: cancelar)
+ *   Tab                 completar comandos y archivos (complete.h); dos
+ *                       veces seguidas muestra los candidatos
+ *   Ctrl-L              limpiar la pantalla  Ctrl-C  descartar la línea
+ *   Ctrl-D              fin de archivo con la línea vacía, si no borra
+ *
+ * El prompt lo sigue mostrando show_prompt (prompt.h): el editor se registra
+ * como hook del prompt, así que cada vez que se (re)dibuja el prompt, se
+ * dibuja también la línea que se está editando.
+ *
+ * Hay un solo editor, porque hay una sola terminal.
+ */
+
+#ifndef _LINEEDIT_H_
+#define _LINEEDIT_H_
+
+#include <stdbool.h>
+
+#include "history.h"
+
+/*
+ * Prepara el editor para leer de la terminal `fd', recorriendo y buscando en
+ * `hist' (que no pasa a ser del editor, y tiene que seguir vivo mientras se
+ * use el editor).
+ * Returns: false si fd no es una terminal que se pueda usar (por ejemplo
+ *     TERM=dumb); en ese caso no hay que usar lineedit_read
+ * Requires: hist != NULL
+ */
+bool lineedit_init(int fd, history hist);
+
+/*
+ * Deja la terminal y el prompt como estaban antes de lineedit_init.
+ */
+void lineedit_destroy(void);
+
+/*
+ * Lee una línea. Antes se tiene que haber mostrado el prompt (show_prompt).
+ * Returns: la línea, sin '\n', en memoria nueva (a liberar por el llamador);
+ *     "" si se descartó con Ctrl-C; NULL en fin de archivo o error
+ * Requires: lineedit_init devolvió true
+ */
+char* lineedit_read(void);
+
+#endif
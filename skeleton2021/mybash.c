@@ -1,36 +1,282 @@
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "builtin.h"
 #include "command.h"
+#include "dirindex.h"
 #include "execute.h"
+#include "histlog.h"
+#include "history.h"
+#include "lineedit.h"
+#include "linecache.h"
+#include "parseahead.h"
 #include "parser.h"
+#include "pathindex.h"
+#include "prefetch.h"
 #include "prompt.h"
+#include "scriptcache.h"
+#include "zygote.h"
+#include "segments.h"
+#include "strextra.h"
+#include "vars.h"
+
+/* Cantidad de líneas parseadas que se recuerdan */
+#define CACHED_LINES 256u
+
+/* Archivos que se guardan entre sesiones, dentro de $HOME si no se dan con
+ * su variable
+ */
+#define HISTORY_FILE ".mybash_history" // MYBASH_HISTFILE
+#define DIRINDEX_FILE ".mybash_dirs"   // MYBASH_DIRINDEX
+
+/* Ruta del archivo `file' (en memoria nueva), o NULL si no se guarda: la
+ * variable `variable' si está definida ("" es no guardar), o $HOME/file
+ */
+static char* saved_file_path(const char* variable, const char* file) {
+    const char* path = getenv(variable);
+    if (path != NULL) {
+        return path[0] != '\0' ? strmerge(path, "") : NULL;
+    }
+    const char* home = getenv("HOME");
+    if (home == NULL || home[0] == '\0') {
+        return NULL;
+    }
+    size_t length = strlen(home) + 1u + strlen(file) + 1u;
+    char* home_path = malloc(length);
+    if (home_path == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(home_path, length, "%s/%s", home, file);
+    return home_path;
+}
+
+/* Abre el historial guardado y lo carga en hist. Devuelve NULL si no hay
+ * dónde guardarlo.
+ */
+static histlog open_saved_history(history hist) {
+    char* path = saved_file_path("MYBASH_HISTFILE", HISTORY_FILE);
+    histlog result = path != NULL ? histlog_open(path, hist) : NULL;
+    free(path);
+    return result;
+}
+
+/* Abre el índice de directorios visitados que usa cd */
+static void open_directory_index(void) {
+    char* path = saved_file_path("MYBASH_DIRINDEX", DIRINDEX_FILE);
+    if (path != NULL) {
+        dirindex_open(path);
+    }
+    free(path);
+}
+
+/* Lee una línea con el editor y la agrega al historial (y a saved, si no es
+ * NULL). Devuelve NULL en fin de archivo.
+ */
+static char* read_edited_line(history hist, histlog saved) {
+    char* line = lineedit_read();
+    if (line != NULL && history_add(hist, line) && saved != NULL) {
+        histlog_append(saved, line);
+    }
+    return line;
+}
+
+/* Lee un comando con el editor y lo parsea. Si queda abierto (un compuesto
+ * sin cerrar, o un '&&' o '||' al final) se siguen leyendo líneas con el
+ * prompt de continuación, y se parsean todas juntas.
+ * Devuelve el pipeline, o NULL si el comando está vacío o tiene un error. En
+ * `eof' se indica si se terminó la entrada.
+ */
+static pipeline read_edited_pipeline(history hist, histlog saved,
+                                     linecache cache, bool* eof) {
+    pipeline result = NULL;
+    char* text = read_edited_line(hist, saved);
+    bool more = text != NULL;
+    *eof = text == NULL;
+    while (more) {
+        more = false;
+        Parser parser = parser_new_from_buffer(text, strlen(text));
+        if (parser == NULL) {
+            perror("mybash");
+        } else {
+            parser_set_cache(parser, cache);
+            result = parse_pipeline(parser);
+            more = parser_incomplete(parser);
+            parser = parser_destroy(parser);
+        }
+        if (more) {
+            show_continuation_prompt();
+            char* line = read_edited_line(hist, saved);
+            // En fin de archivo se descarta lo que quedó abierto
+            *eof = line == NULL;
+            more = line != NULL;
+            if (more) {
+                text = str_concat(str_concat(text, "\n"), line);
+                free(line);
+                if (text == NULL) {
+                    perror("Error fatal: malloc");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+    free(text);
+    return result;
+}
 
 int main(int argc, char* argv[]) {
 
     // Inicializo exit_from_mybash para que no salga
     exit_from_mybash = false;
 
-    Parser parser = parser_new(stdin);
+    /* Los comandos externos los lanza el zygote, que se crea ahora que el
+       shell todavía es chico (si no se puede, se hace fork) */
+    zygote_start();
+
+    /* Con un argumento se ejecuta ese script, compilado (ver scriptcache.h)
+       si es un archivo regular. Si no, se lee de stdin: línea a línea si es
+       una terminal, y en bloques si es un archivo o un pipe */
+    linecache cache = linecache_new(CACHED_LINES);
+    Parser parser = NULL;
+    scriptcache script = NULL;
+    bool interactive = false;
+    int script_fd = -1;
+    if (argc > 1) {
+        script_fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (script_fd == -1) {
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+        // MYBASH_SCRIPTCACHE="" no usa el caché
+        const char* use_cache = getenv("MYBASH_SCRIPTCACHE");
+        if (use_cache == NULL || use_cache[0] != '\0') {
+            script = scriptcache_open(argv[1], script_fd, cache);
+        }
+        if (script == NULL) {
+            parser = parser_new_from_fd(script_fd);
+        }
+    } else if (isatty(STDIN_FILENO)) {
+        interactive = true;
+        parser = parser_new(stdin);
+    } else {
+        parser = parser_new_from_fd(STDIN_FILENO);
+    }
+    if (parser == NULL && script == NULL) {
+        perror("mybash");
+        return EXIT_FAILURE;
+    }
+    if (parser != NULL) {
+        parser_set_cache(parser, cache);
+    }
 
-    while (!exit_from_mybash) {
-        // exit_from_mybash es una variable global declarada en builtin.h
-        show_prompt();
-        pipeline apipe = parse_pipeline(parser);
+    /* Fuera de una terminal, el siguiente pipeline se parsea mientras se
+       ejecuta el actual, y sus comandos se precargan (si el script está
+       compilado ya están todos parseados) */
+    parseahead ahead = NULL;
+    if (!interactive) {
+        prefetch_start();
+        if (parser != NULL && !parser_at_eof(parser)) {
+            ahead = parseahead_new(parser);
+        }
+    }
 
-        /* Si se llegó a un final de archivo siginifca que hay que salir después
-           de ejecutar el comando */
-        exit_from_mybash = parser_at_eof(parser);
+    /* En una terminal se usa el editor de línea; si no se puede (TERM=dumb)
+       se lee con el parser como de cualquier archivo */
+    history hist = history_new();
+    histlog saved = NULL;
+    bool editing = false;
+    if (interactive) {
+        // El formato del prompt se puede cambiar con MYBASH_PS1
+        prompt_init(getenv("MYBASH_PS1"));
+        // Los comandos se buscan (y se completan) en el índice del PATH
+        pathindex_start();
+        // cd recuerda los directorios visitados
+        open_directory_index();
+        editing = lineedit_init(STDIN_FILENO, hist);
+        // El historial se guarda entre sesiones (MYBASH_HISTFILE="" no)
+        if (editing) {
+            saved = open_saved_history(hist);
+        }
+    }
 
+    /* Al final de la entrada se termina después de ejecutar lo último que se
+       leyó; exit_from_mybash (global, declarada en builtin.h) es solo el
+       exit, que corta también la lista que se está ejecutando */
+    bool at_eof = false;
+    while (!exit_from_mybash && !at_eof) {
+        if (interactive) {
+            show_prompt();
+        }
+        pipeline apipe = NULL;
+        pipeline next = NULL;
+        if (editing) {
+            apipe = read_edited_pipeline(hist, saved, cache, &at_eof);
+        } else if (script != NULL) {
+            apipe = scriptcache_next(script);
+            at_eof = apipe == NULL;
+            next = scriptcache_peek(script);
+        } else if (ahead != NULL) {
+            apipe = parseahead_next(ahead, &at_eof);
+            next = at_eof ? NULL : parseahead_peek(ahead);
+        } else {
+            apipe = parse_pipeline(parser);
+            /* Si se llegó a un final de archivo siginifca que hay que salir
+               después de ejecutar el comando */
+            at_eof = parser_at_eof(parser);
+        }
+        if (interactive) {
+            prompt_input_done();
+        }
+
+        if (next != NULL) {
+            execute_prefetch(next);
+        }
         if (apipe != NULL) {
+            // Cuánto tarda el comando, para el prompt (\L)
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
             execute_pipeline(apipe);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            segments_set_last_duration(
+                (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ull +
+                (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec);
             apipe = pipeline_destroy(apipe);
         }
     }
 
-    // Antes de salir se imprime un salto de linea
-    printf("\n");
-    parser = parser_destroy(parser);
-    return 0;
+    if (interactive) {
+        // Antes de salir se imprime un salto de linea
+        printf("\n");
+        lineedit_destroy();
+        prompt_destroy();
+        pathindex_stop();
+        dirindex_close();
+    }
+    if (saved != NULL) {
+        saved = histlog_close(saved);
+    }
+    hist = history_destroy(hist);
+    if (ahead != NULL) {
+        ahead = parseahead_destroy(ahead);
+    }
+    prefetch_stop();
+    if (parser != NULL) {
+        parser = parser_destroy(parser);
+    }
+    if (script != NULL) {
+        script = scriptcache_close(script);
+    }
+    cache = linecache_destroy(cache);
+    if (script_fd != -1) {
+        close(script_fd);
+    }
+    zygote_stop();
+    // Como sh, el estado del shell es el del último pipeline
+    return vars_status();
 }
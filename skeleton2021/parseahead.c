@@ -0,0 +1,139 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "parseahead.h"
+
+/* Un resultado de parse_pipeline y si después se llegó al final */
+struct parsed {
+    pipeline apipe;
+    bool eof;
+};
+
+struct parseahead_s {
+    Parser parser;
+    pthread_t thread;
+    // Lo siguiente lo protege lock
+    pthread_mutex_t lock;
+    // Se agregó o se sacó un resultado, o hay que parar
+    pthread_cond_t changed;
+    struct parsed queue[PARSEAHEAD_DEPTH];
+    unsigned int first;
+    unsigned int length;
+    bool done; // el hilo ya no agrega más resultados
+    bool stop;
+};
+
+static void* parse_thread(void* data) {
+    parseahead self = data;
+    // Solo se puede cancelar mientras espera la entrada dentro del parser
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    bool eof = false;
+    while (!eof) {
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        pipeline apipe = parse_pipeline(self->parser);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        eof = parser_at_eof(self->parser);
+
+        pthread_mutex_lock(&self->lock);
+        while (self->length == PARSEAHEAD_DEPTH && !self->stop) {
+            pthread_cond_wait(&self->changed, &self->lock);
+        }
+        if (self->stop) {
+            pthread_mutex_unlock(&self->lock);
+            if (apipe != NULL) {
+                pipeline_destroy(apipe);
+            }
+            break;
+        }
+        unsigned int last = (self->first + self->length) % PARSEAHEAD_DEPTH;
+        self->queue[last] = (struct parsed){apipe, eof};
+        self->length++;
+        pthread_cond_broadcast(&self->changed);
+        pthread_mutex_unlock(&self->lock);
+    }
+    pthread_mutex_lock(&self->lock);
+    self->done = true;
+    pthread_cond_broadcast(&self->changed);
+    pthread_mutex_unlock(&self->lock);
+    return NULL;
+}
+
+parseahead parseahead_new(Parser parser) {
+    assert(parser != NULL && !parser_at_eof(parser));
+
+    parseahead self = malloc(sizeof(struct parseahead_s));
+    if (self == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    self->parser = parser;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->changed, NULL);
+    self->first = 0u;
+    self->length = 0u;
+    self->done = false;
+    self->stop = false;
+    if (pthread_create(&self->thread, NULL, parse_thread, self) != 0) {
+        pthread_cond_destroy(&self->changed);
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+        return NULL;
+    }
+    return self;
+}
+
+parseahead parseahead_destroy(parseahead self) {
+    assert(self != NULL);
+
+    pthread_mutex_lock(&self->lock);
+    self->stop = true;
+    bool done = self->done;
+    pthread_cond_broadcast(&self->changed);
+    pthread_mutex_unlock(&self->lock);
+    /* Si está leyendo la entrada (un pipe que no se cierra) no se puede
+       esperar a que termine. Fuera del parser la cancelación queda
+       pendiente, y no pasa nada porque ya no vuelve a entrar */
+    if (!done) {
+        pthread_cancel(self->thread);
+    }
+    pthread_join(self->thread, NULL);
+    for (unsigned int i = 0u; i < self->length; i++) {
+        unsigned int n = (self->first + i) % PARSEAHEAD_DEPTH;
+        pipeline apipe = self->queue[n].apipe;
+        if (apipe != NULL) {
+            pipeline_destroy(apipe);
+        }
+    }
+    pthread_cond_destroy(&self->changed);
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+    return NULL;
+}
+
+pipeline parseahead_next(parseahead self, bool* eof) {
+    assert(self != NULL && eof != NULL);
+
+    pthread_mutex_lock(&self->lock);
+    while (self->length == 0u && !self->done) {
+        pthread_cond_wait(&self->changed, &self->lock);
+    }
+    assert(self->length > 0u);
+    struct parsed result = self->queue[self->first];
+    self->first = (self->first + 1u) % PARSEAHEAD_DEPTH;
+    self->length--;
+    pthread_cond_broadcast(&self->changed);
+    pthread_mutex_unlock(&self->lock);
+    *eof = result.eof;
+    return result.apipe;
+}
+
+pipeline parseahead_peek(const parseahead self) {
+    assert(self != NULL);
+
+    pthread_mutex_lock(&self->lock);
+    pipeline result = self->length > 0u ? self->queue[self->first].apipe : NULL;
+    pthread_mutex_unlock(&self->lock);
+    return result;
+}
@@ -0,0 +1,64 @@
+/* Parseo adelantado de la entrada.
+ *
+ * Cuando la entrada no es una terminal, el siguiente pipeline no depende
+ * de lo que haga el actual (el parser no usa el estado del shell), así que
+ * se puede parsear mientras el actual se ejecuta. Un hilo aparte parsea con
+ * el parser dado y deja los pipelines en una cola de hasta PARSEAHEAD_DEPTH;
+ * el hilo principal los toma en orden. Así también se puede mirar el
+ * siguiente antes de ejecutar el actual (para precargar sus comandos, ver
+ * execute_prefetch).
+ *
+ * El parser lee de la entrada más de lo que se ejecutó hasta el momento,
+ * como ya pasa con parser_new_from_fd.
+ */
+
+#ifndef _PARSEAHEAD_H_
+#define _PARSEAHEAD_H_
+
+#include <stdbool.h>
+
+#include "command.h"
+#include "parser.h"
+
+/* Cantidad máxima de pipelines parseados que esperan a ejecutarse */
+#define PARSEAHEAD_DEPTH 8u
+
+typedef struct parseahead_s* parseahead;
+
+/*
+ * Empieza a parsear con `parser' en otro hilo. El parser sigue siendo del
+ * llamador, pero no se puede usar hasta destruir el resultado.
+ * Returns: el lector, o NULL si no se puede crear el hilo (y hay que
+ *     parsear como siempre)
+ * Requires: parser != NULL && !parser_at_eof(parser)
+ */
+parseahead parseahead_new(Parser parser);
+
+/*
+ * Para el hilo, aunque esté esperando la entrada, y descarta los pipelines
+ * que no se tomaron.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+parseahead parseahead_destroy(parseahead self);
+
+/*
+ * El siguiente resultado de parse_pipeline, esperando a que esté. En `eof'
+ * se indica si después de él se llegó al final de la entrada (entonces no
+ * se puede volver a llamar).
+ * Returns: el pipeline (a liberar por el llamador), o NULL si la línea
+ *     tenía un error
+ * Requires: self != NULL && eof != NULL y que no se haya llegado al final
+ */
+pipeline parseahead_next(parseahead self, bool* eof);
+
+/*
+ * El pipeline que va a devolver parseahead_next, si ya se parseó, sin
+ * esperar. Sigue siendo del lector, y vale hasta la siguiente llamada.
+ * Returns: el pipeline, o NULL si todavía no está, tenía un error, o no
+ *     hay más
+ * Requires: self != NULL
+ */
+pipeline parseahead_peek(const parseahead self);
+
+#endif
@@ -0,0 +1,1330 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "linecache.h"
+#include "parser.h"
+#include "scan.h"
+
+/* Parser de pipelines.
+ *
+ * La entrada se lee de a una línea: si viene de un FILE* se usa un buffer de
+ * línea propio del parser (que se reutiliza entre líneas), y si viene de un
+ * buffer en memoria la línea es directamente un pedazo de ese buffer. Si viene
+ * de un file descriptor, los archivos regulares se mapean enteros con mmap y
+ * el resto (pipes) se lee en bloques grandes; en los dos casos la línea
+ * también es un pedazo del buffer. Los fines de línea y los caracteres
+ * especiales se buscan con scan.h (SIMD).
+ *
+ * El lexer no copia nada: cada token es un pedazo (puntero y largo) de la
+ * línea, y las cadenas solo se piden con malloc en el momento de guardarlas
+ * en un scommand.
+ *
+ * Gramática:
+ *   línea     ::= lista '\n'
+ *   lista     ::= '\n'* and_or (sep '\n'* and_or)* [sep '\n'*]
+ *   sep       ::= ';' | '\n' | (nada, después de un '&')
+ *   and_or    ::= pipeline (('&&' | '||') '\n'* pipeline)* ['&']
+ *   pipeline  ::= command ('|' command)*
+ *   command   ::= scommand | compuesto redir*
+ *   compuesto ::= '(' lista ')' | '{' lista '}'
+ *               | 'if' lista 'then' lista ('elif' lista 'then' lista)*
+ *                 ['else' lista] 'fi'
+ *               | ('while' | 'until') lista 'do' lista 'done'
+ *               | 'for' NOMBRE '\n'* 'in' WORD* (';' | '\n') '\n'*
+ *                 'do' lista 'done'
+ *               | 'case' WORD '\n'* 'in' '\n'* cláusula* 'esac'
+ *   cláusula  ::= ['('] WORD ('|' WORD)* ')' [lista] (';;' '\n'* | antes
+ *                 de 'esac')
+ *   scommand  ::= (WORD | redir)+
+ *   redir     ::= [FD] ('<' | '>' | '>>') WORD
+ *               | [FD] ('<&' | '>&') (FD | '-')
+ *   FD        ::= dígitos (un número de descriptor, hasta SCOMMAND_MAX_FD)
+ * Los blancos (' ' y '\t') separan tokens. Una palabra es cualquier secuencia
+ * de caracteres que no sean blancos, '\r', '\n', '|', '&', '<', '>', ';',
+ * '(' ni ')', salvo que estén entre comillas o escapados:
+ *   - '...': todo es literal hasta la siguiente comilla simple.
+ *   - "...": todo es literal salvo \" y \\ (y \$ y \`), que escapan el
+ *     segundo caracter.
+ *   - \c fuera de comillas es el caracter c literal.
+ *   - ${...}: todo es parte de la palabra hasta la '}' que lo cierra (las
+ *     comillas de adentro, aunque esté entre "...", son aparte).
+ *   - $(( ... )): la expresión aritmética es parte de la palabra hasta los
+ *     "))" que la cierran.
+ *   Si no se cierran en la línea es un error de sintaxis.
+ * Las comillas sin cerrar son un error de sintaxis. Las comillas y barras
+ * de escape se sacan al guardar la palabra en el scommand, salvo en las
+ * palabras con '$' o con '*', '?' o '[' sin citar, que se guardan tal cual
+ * (marcadas con SCOMMAND_EXPAND_MARK) porque se expanden al ejecutar.
+ * Si la redirección se repite vale la última. El número de una redirección
+ * va pegado al operador ("2>err"; en "echo 2 >err" el 2 es un argumento),
+ * y las demás redirecciones (ver scommand_redir_kind) se guardan en orden.
+ *
+ * '{', '}', 'if', 'then', 'elif', 'else', 'fi', 'while', 'until', 'for',
+ * 'do', 'done', 'case' y 'esac' son palabras reservadas: solo cuentan
+ * cuando son una palabra sola y sin comillas donde podría empezar un
+ * comando (por eso "{ a; }" lleva el ';', y en "echo fi" fi es un
+ * argumento), e 'in' en su lugar dentro de un for o un case. Las que
+ * cierran una lista no pueden empezar un comando. Mientras haya un
+ * compuesto abierto, el fin de línea es un separador y el lexer sigue con
+ * la línea siguiente de la entrada, así un compuesto puede ocupar varias
+ * líneas. Después de '&&' y '||' también se sigue en la línea siguiente
+ * (después de '|' no: "a |" es un error).
+ *
+ * Los compuestos se parsean una sola vez: un ciclo guarda sus listas en el
+ * scommand y las vuelve a ejecutar en cada vuelta (ver scommand_kind).
+ *
+ * La lista es una cadena de pipelines (pipeline_set_next) con sus
+ * conectores. Un '&' después de un and_or de varios pipelines pone todo el
+ * and_or en background: se guarda como el grupo "{ a && b; } &".
+ *
+ * Si el parser tiene un linecache, las líneas válidas se guardan ahí y las
+ * que se repiten no se vuelven a parsear.
+ */
+
+/********** LEXER **********/
+
+/* Clases de tokens */
+typedef enum {
+    TOKEN_WORD,
+    TOKEN_PIPE,       // |
+    TOKEN_BACKGROUND, // &
+    TOKEN_AND,        // &&
+    TOKEN_OR,         // ||
+    TOKEN_REDIR_IN,   // [n]< o [n]<&
+    TOKEN_REDIR_OUT,  // [n]>, [n]>> o [n]>&
+    TOKEN_SEMICOLON,  // ;
+    TOKEN_DSEMI,      // ;;
+    TOKEN_LPAREN,     // (
+    TOKEN_RPAREN,     // )
+    TOKEN_NEWLINE,    // fin de la línea dentro de un compuesto
+    TOKEN_END,        // fin de la línea
+    TOKEN_INVALID     // cualquier otro caracter que corte una palabra
+} token_kind;
+
+/* Un token es un pedazo de la línea, no tiene memoria propia.
+ * quoted indica si la palabra tiene comillas o escapes que hay que sacar al
+ * copiarla; si no, la palabra es directamente el texto del token.
+ */
+typedef struct {
+    token_kind kind;
+    const char* start;
+    size_t length;
+    bool quoted;
+} token;
+
+/* Cursor sobre la línea que se está parseando */
+typedef struct {
+    const char* pos;
+    const char* end;
+    Parser parser;      // de donde sacar más líneas, o NULL
+    unsigned int depth; // compuestos abiertos
+    unsigned int lines; // líneas leídas después de la primera
+} lexer;
+
+static bool parser_next_line(Parser parser, const char** line,
+                             size_t* length);
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static bool is_word_char(char c) {
+    return strchr(" \t\r\n|&<>;()", c) == NULL;
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool is_quote_char(char c) {
+    return c == '\'' || c == '"' || c == '\\';
+}
+
+/* Busca el '}' que cierra el "${" cuyo '{' está en `brace', salteando las
+ * comillas, los escapes y los ${...} de adentro (como find_brace_end en
+ * expand.c).
+ * Returns: el '}', o NULL si no se cierra en la línea
+ */
+static const char* find_brace_end(const char* brace, const char* end) {
+    unsigned int depth = 0u;
+    char quote = '\0';
+    for (const char* c = brace; c < end; c++) {
+        if (quote != '\0') {
+            if (*c == quote) {
+                quote = '\0';
+            } else if (quote == '"' && *c == '\\' && c + 1 < end) {
+                c++;
+            }
+        } else if (*c == '\'' || *c == '"') {
+            quote = *c;
+        } else if (*c == '\\' && c + 1 < end) {
+            c++;
+        } else if (*c == '{' && (c == brace || c[-1] == '$')) {
+            depth++;
+        } else if (*c == '}' && depth > 0u) {
+            depth--;
+            if (depth == 0u) {
+                return c;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Busca el cierre de las comillas que abren en quote, teniendo en cuenta
+ * los escapes si son dobles.
+ * Returns: puntero a la comilla que cierra, o NULL si no se cierran
+ * Requires: quote < end && (*quote == '\'' || *quote == '"')
+ */
+static const char* find_closing_quote(const char* quote, const char* end) {
+    assert(quote < end && (*quote == '\'' || *quote == '"'));
+
+    const char* pos = quote + 1;
+    if (*quote == '\'') {
+        return memchr(pos, '\'', (size_t)(end - pos));
+    }
+    while (pos != NULL && pos < end && *pos != '"') {
+        if (*pos == '$' && pos + 1 < end && pos[1] == '{') {
+            // Las comillas de adentro de ${...} no cierran estas
+            pos = find_brace_end(pos + 1, end);
+            pos = pos != NULL ? pos + 1 : NULL;
+        } else {
+            pos += (*pos == '\\' && pos + 1 < end) ? 2 : 1;
+        }
+    }
+    return pos != NULL && pos < end ? pos : NULL;
+}
+
+/* Busca un "${" sin escapar entre from y to, dentro de la palabra que
+ * empieza en word.
+ * Returns: el '{', o NULL si no hay
+ */
+static const char* find_brace_start(const char* word, const char* from,
+                                    const char* to) {
+    for (const char* c = from; c + 1 < to; c++) {
+        if (*c == '\\') {
+            c++;
+        } else if (c[0] == '$' && c[1] == '{' &&
+                   (c == word || c[-1] != '\\')) {
+            return c + 1;
+        }
+    }
+    return NULL;
+}
+
+/* Busca los "))" que cierran una expansión aritmética, desde `start'
+ * (después de "$(("), salteando los paréntesis de adentro. Es lo mismo que
+ * arith_find_end, para no linkear arith.o con el parser.
+ * Returns: el primero de los dos ')', o NULL si no se cierra en la línea
+ */
+static const char* find_arith_end(const char* start, const char* end) {
+    unsigned int depth = 0u;
+    for (const char* pos = start; pos < end; pos++) {
+        if (*pos == '(') {
+            depth++;
+        } else if (*pos == ')' && depth > 0u) {
+            depth--;
+        } else if (*pos == ')') {
+            return pos + 1 < end && pos[1] == ')' ? pos : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* Indica si en pos empieza el "((" de un "$((" sin escapar */
+static bool is_arith_start(const char* word, const char* pos,
+                           const char* end) {
+    return pos > word && pos[-1] == '$' && pos + 1 < end && pos[1] == '(' &&
+           (pos - 1 == word || pos[-2] != '\\');
+}
+
+/* Consume una palabra que empieza en lex->pos.
+ * El camino rápido es saltar con scan_find_special hasta el primer caracter
+ * que no sea de palabra; solo si ese caracter es de quoting se recorren las
+ * comillas, y se sigue buscando.
+ * Returns: TOKEN_WORD, o TOKEN_INVALID si hay comillas sin cerrar
+ * Requires: lex != NULL && tok != NULL
+ */
+static token_kind lexer_word(lexer* lex, token* tok) {
+    assert(lex != NULL && tok != NULL);
+
+    const char* pos = lex->pos;
+    bool done = false;
+    while (!done) {
+        const char* from = pos;
+        pos = scan_find_special(pos, lex->end);
+        // Lo que está entre las llaves de un ${...} es todo de la palabra
+        const char* brace = find_brace_start(lex->pos, from, pos);
+        if (brace != NULL) {
+            const char* close = find_brace_end(brace, lex->end);
+            if (close == NULL) {
+                lex->pos = lex->end;
+                return TOKEN_INVALID;
+            }
+            pos = close + 1;
+        } else if (pos < lex->end && is_arith_start(lex->pos, pos, lex->end)) {
+            const char* close = find_arith_end(pos + 2, lex->end);
+            if (close == NULL) {
+                lex->pos = lex->end;
+                return TOKEN_INVALID;
+            }
+            pos = close + 2;
+        } else if (pos == lex->end || !is_quote_char(*pos)) {
+            done = true;
+        } else if (*pos == '\\') {
+            tok->quoted = true;
+            pos += (pos + 1 < lex->end) ? 2 : 1;
+        } else {
+            tok->quoted = true;
+            const char* closing = find_closing_quote(pos, lex->end);
+            if (closing == NULL) {
+                lex->pos = lex->end;
+                return TOKEN_INVALID;
+            }
+            pos = closing + 1;
+        }
+    }
+    lex->pos = pos;
+    return TOKEN_WORD;
+}
+
+/* Indica si al terminar la línea hay que seguir con la siguiente */
+static bool lexer_continues(const lexer* lex) {
+    return lex->depth > 0u && lex->parser != NULL &&
+           !parser_at_eof(lex->parser);
+}
+
+static void parser_mark_incomplete(Parser parser);
+
+/* Si la línea terminó con un compuesto abierto (o después de un operador)
+ * y ya no hay más entrada, avisa al parser que faltaba una continuación
+ */
+static void lexer_check_incomplete(const lexer* lex, token tok) {
+    if (tok.kind == TOKEN_END && lex->depth > 0u && lex->parser != NULL &&
+        parser_at_eof(lex->parser)) {
+        parser_mark_incomplete(lex->parser);
+    }
+}
+
+/* Si en pos empieza el operador de una redirección ([n]<, [n]>, [n]>>,
+ * [n]<& o [n]>&, con el número pegado), devuelve su clase y pone en *op_end
+ * dónde termina. Si no, devuelve TOKEN_WORD y *op_end no cambia.
+ */
+static token_kind lexer_redirection(const char* pos, const char* end,
+                                    const char** op_end) {
+    while (pos < end && is_digit(*pos)) {
+        pos++;
+    }
+    if (pos == end || (*pos != '<' && *pos != '>')) {
+        return TOKEN_WORD;
+    }
+    char op = *pos;
+    pos++;
+    if (pos < end && (*pos == '&' || (op == '>' && *pos == '>'))) {
+        pos++;
+    }
+    *op_end = pos;
+    return op == '<' ? TOKEN_REDIR_IN : TOKEN_REDIR_OUT;
+}
+
+/* Lee el siguiente token de lex, salteando los blancos. Al final de la
+ * línea, si hay un grupo abierto, pasa a la siguiente y devuelve
+ * TOKEN_NEWLINE.
+ * Requires: lex != NULL
+ */
+static token lexer_next(lexer* lex) {
+    assert(lex != NULL);
+
+    while (lex->pos < lex->end && is_blank(*lex->pos)) {
+        lex->pos++;
+    }
+
+    token tok = {TOKEN_END, lex->pos, 0u, false};
+    if (lex->pos == lex->end) {
+        const char* line = NULL;
+        size_t length = 0u;
+        if (lexer_continues(lex) &&
+            parser_next_line(lex->parser, &line, &length)) {
+            lex->pos = line;
+            lex->end = line + length;
+            lex->lines++;
+            tok.kind = TOKEN_NEWLINE;
+        }
+        lexer_check_incomplete(lex, tok);
+        return tok;
+    }
+
+    bool doubled = lex->pos + 1 < lex->end && lex->pos[1] == lex->pos[0];
+    const char* op_end = NULL; // el final de una redirección
+    switch (*lex->pos) {
+    case '|':
+        tok.kind = doubled ? TOKEN_OR : TOKEN_PIPE;
+        break;
+    case '&':
+        tok.kind = doubled ? TOKEN_AND : TOKEN_BACKGROUND;
+        break;
+    case ';':
+        tok.kind = doubled ? TOKEN_DSEMI : TOKEN_SEMICOLON;
+        break;
+    case '(':
+        tok.kind = TOKEN_LPAREN;
+        break;
+    case ')':
+        tok.kind = TOKEN_RPAREN;
+        break;
+    default:
+        // Una palabra de dígitos pegada a '<' o '>' es el número del fd
+        tok.kind = lexer_redirection(lex->pos, lex->end, &op_end);
+        // Las comillas y la barra de escape también empiezan una palabra
+        if (tok.kind == TOKEN_WORD && !is_word_char(*lex->pos)) {
+            tok.kind = TOKEN_INVALID;
+        }
+    }
+
+    if (op_end != NULL) {
+        lex->pos = op_end;
+    } else if (tok.kind == TOKEN_WORD) {
+        tok.kind = lexer_word(lex, &tok);
+    } else {
+        lex->pos += tok.kind == TOKEN_AND || tok.kind == TOKEN_OR ||
+                            tok.kind == TOKEN_DSEMI
+                        ? 2
+                        : 1;
+    }
+    tok.length = (size_t)(lex->pos - tok.start);
+
+    return tok;
+}
+
+/* Devuelve el siguiente token sin consumirlo. No lee la línea siguiente
+ * (eso cambia la entrada), solo avisa que hay una con TOKEN_NEWLINE.
+ */
+static token lexer_peek(const lexer* lex) {
+    lexer copy = *lex;
+    copy.parser = NULL;
+    token tok = lexer_next(&copy);
+    if (tok.kind == TOKEN_END && lexer_continues(lex)) {
+        tok.kind = TOKEN_NEWLINE;
+    }
+    lexer_check_incomplete(lex, tok);
+    return tok;
+}
+
+/* Indica si tok es la palabra reservada word: sola y sin comillas */
+static bool is_reserved(token tok, const char* word) {
+    return tok.kind == TOKEN_WORD && !tok.quoted &&
+           tok.length == strlen(word) &&
+           memcmp(tok.start, word, tok.length) == 0;
+}
+
+/* Copia el texto de la palabra tok sin las comillas ni los escapes en dst,
+ * que tiene lugar para al menos tok.length + 1 caracteres.
+ * Requires: tok.kind == TOKEN_WORD && dst != NULL
+ */
+static void unquote(token tok, char* dst) {
+    assert(tok.kind == TOKEN_WORD && dst != NULL);
+
+    const char* pos = tok.start;
+    const char* end = tok.start + tok.length;
+    char quote = '\0'; // comilla abierta, o '\0' si no hay ninguna
+    while (pos < end) {
+        char c = *pos;
+        pos++;
+        if (quote == '\0' && (c == '\'' || c == '"')) {
+            quote = c;
+        } else if (c == quote) {
+            quote = '\0';
+        } else if (c == '\\' && pos < end &&
+                   (quote == '\0' ||
+                    (quote == '"' && strchr("\"\\$`", *pos) != NULL))) {
+            *dst = *pos;
+            dst++;
+            pos++;
+        } else {
+            *dst = c;
+            dst++;
+        }
+    }
+    *dst = '\0';
+}
+
+/* Indica si la palabra tok tiene algo que se expande: un '$' fuera de
+ * comillas simples, sin escapar y no al final, o un '*', '?' o '[' fuera de
+ * comillas y sin escapar (un patrón de nombres de archivo).
+ * Requires: tok.kind == TOKEN_WORD
+ */
+static bool has_expansion(token tok) {
+    assert(tok.kind == TOKEN_WORD);
+
+    const char* pos = tok.start;
+    const char* end = tok.start + tok.length;
+    char quote = '\0';
+    bool found = false;
+    while (pos < end && !found) {
+        char c = *pos;
+        pos++;
+        if (quote == '\0' && (c == '\'' || c == '"')) {
+            quote = c;
+        } else if (c == quote) {
+            quote = '\0';
+        } else if (c == '\\' && quote != '\'') {
+            pos++;
+        } else {
+            found = (c == '$' && quote != '\'' && pos < end) ||
+                    (quote == '\0' && (c == '*' || c == '?' || c == '['));
+        }
+    }
+    return found;
+}
+
+/* Copia el texto del token en memoria nueva, para guardarlo en un scommand.
+ * Si la palabra tiene expansiones se guarda tal cual, con la marca
+ * SCOMMAND_EXPAND_MARK adelante (se expande al ejecutar).
+ * Si falla la memoria termina el programa, igual que scommand_new.
+ */
+static char* token_to_string(token tok) {
+    char* result = NULL;
+    bool candidate = false; // filtro rápido antes de mirar las comillas
+    for (const char* c = "$*?["; *c != '\0' && !candidate; c++) {
+        candidate = memchr(tok.start, *c, tok.length) != NULL;
+    }
+    if (candidate && has_expansion(tok)) {
+        result = malloc(tok.length + 2u);
+        if (result != NULL) {
+            result[0] = SCOMMAND_EXPAND_MARK;
+            memcpy(result + 1, tok.start, tok.length);
+            result[tok.length + 1u] = '\0';
+        }
+    } else if (tok.quoted) {
+        result = malloc(tok.length + 1u);
+        if (result != NULL) {
+            unquote(tok, result);
+        }
+    } else {
+        result = strndup(tok.start, tok.length);
+    }
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/********** PARSER **********/
+
+/* Tamaño inicial del bloque para leer de pipes. Crece si hay líneas más
+ * largas.
+ */
+#define BLOCK_SIZE (1u << 20)
+
+struct parser_s {
+    FILE* input;        // se lee línea a línea con getline, o NULL
+    int fd;             // se lee en bloques de acá si no hay mmap, o -1
+    const char* buffer; // entrada en memoria: del llamador, mmap o block
+    size_t size;
+    size_t offset;      // cuánto de buffer ya se consumió
+    bool mapped;        // buffer es un mmap propio
+    char* block;        // bloque para leer de fd (buffer == block)
+    size_t block_capacity;
+    size_t scanned;     // hasta dónde se buscó '\n' en block sin encontrarlo
+    bool fd_eof;        // read devolvió 0
+    char* line;         // buffer de línea para input (lo maneja getline)
+    size_t line_capacity;
+    linecache cache;    // no es del parser, o NULL
+    bool at_eof;
+    bool incomplete;    // la entrada terminó antes que la última lista
+};
+
+/* Pide memoria para un parser sin entrada
+ * Devuelve NULL si malloc falla
+ */
+static Parser parser_alloc(void) {
+    scan_init();
+
+    Parser parser = malloc(sizeof(struct parser_s));
+    if (parser != NULL) {
+        parser->input = NULL;
+        parser->fd = -1;
+        parser->buffer = NULL;
+        parser->size = 0u;
+        parser->offset = 0u;
+        parser->mapped = false;
+        parser->block = NULL;
+        parser->block_capacity = 0u;
+        parser->scanned = 0u;
+        parser->fd_eof = false;
+        parser->line = NULL;
+        parser->line_capacity = 0u;
+        parser->cache = NULL;
+        parser->at_eof = false;
+        parser->incomplete = false;
+    }
+    return parser;
+}
+
+Parser parser_new(FILE* input) {
+    assert(input != NULL);
+
+    Parser parser = parser_alloc();
+    if (parser != NULL) {
+        parser->input = input;
+    }
+    return parser;
+}
+
+Parser parser_new_from_buffer(const char* buffer, size_t size) {
+    assert(buffer != NULL || size == 0u);
+
+    Parser parser = parser_alloc();
+    if (parser != NULL) {
+        parser->buffer = buffer;
+        parser->size = size;
+    }
+    return parser;
+}
+
+Parser parser_new_from_fd(int fd) {
+    assert(fd >= 0);
+
+    Parser parser = parser_alloc();
+    if (parser == NULL) {
+        return parser;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            // Archivo vacío, no hay nada que mapear
+            parser->buffer = "";
+            return parser;
+        }
+        void* map =
+            mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            parser->buffer = map;
+            parser->size = (size_t)st.st_size;
+            parser->mapped = true;
+            return parser;
+        }
+        // Si mmap falla se lee en bloques como un pipe
+    }
+
+    parser->fd = fd;
+    parser->block = malloc(BLOCK_SIZE);
+    if (parser->block == NULL) {
+        parser = parser_destroy(parser);
+    } else {
+        parser->block_capacity = BLOCK_SIZE;
+        parser->buffer = parser->block;
+    }
+    return parser;
+}
+
+Parser parser_destroy(Parser parser) {
+    assert(parser != NULL);
+
+    if (parser->mapped) {
+        munmap((void*)parser->buffer, parser->size);
+    }
+    parser->buffer = NULL;
+    free(parser->block);
+    parser->block = NULL;
+    free(parser->line);
+    parser->line = NULL;
+    free(parser);
+    parser = NULL;
+
+    return parser;
+}
+
+void parser_set_cache(Parser parser, linecache cache) {
+    assert(parser != NULL);
+
+    parser->cache = cache;
+}
+
+bool parser_at_eof(Parser parser) {
+    assert(parser != NULL);
+
+    return parser->at_eof;
+}
+
+bool parser_incomplete(Parser parser) {
+    assert(parser != NULL);
+
+    return parser->incomplete;
+}
+
+static void parser_mark_incomplete(Parser parser) {
+    parser->incomplete = true;
+}
+
+/* Lee más datos de parser->fd al final de block, moviendo primero lo que
+ * falta consumir al comienzo (o agrandando el bloque si ya está lleno con una
+ * sola línea).
+ * Returns: false si no se leyó nada (fin de archivo o error)
+ * Requires: parser != NULL && parser->fd >= 0
+ */
+static bool parser_fill_block(Parser parser) {
+    assert(parser != NULL && parser->fd >= 0);
+
+    if (parser->offset > 0u) {
+        size_t left = parser->size - parser->offset;
+        memmove(parser->block, parser->block + parser->offset, left);
+        parser->scanned -= parser->offset;
+        parser->size = left;
+        parser->offset = 0u;
+    }
+    if (parser->size == parser->block_capacity) {
+        char* bigger = realloc(parser->block, 2u * parser->block_capacity);
+        if (bigger == NULL) {
+            perror("realloc");
+            return false;
+        }
+        parser->block = bigger;
+        parser->block_capacity *= 2u;
+    }
+    parser->buffer = parser->block;
+
+    ssize_t read_bytes = 0;
+    do {
+        read_bytes = read(parser->fd, parser->block + parser->size,
+                          parser->block_capacity - parser->size);
+    } while (read_bytes < 0 && errno == EINTR);
+
+    if (read_bytes <= 0) {
+        if (read_bytes < 0) {
+            perror("read");
+        }
+        parser->fd_eof = true;
+        return false;
+    }
+    parser->size += (size_t)read_bytes;
+    return true;
+}
+
+/* Toma la siguiente línea de buffer (que se va llenando desde fd si hay uno)
+ * Returns: true si había una línea; *has_newline dice si terminaba en '\n'
+ */
+static bool parser_next_buffered_line(Parser parser, const char** line,
+                                      size_t* length, bool* has_newline) {
+    const char* newline = NULL;
+    bool more = true;
+    while (more) {
+        const char* from = parser->buffer + parser->offset;
+        if (parser->fd >= 0 && parser->scanned > parser->offset) {
+            from = parser->buffer + parser->scanned;
+        }
+        const char* end = parser->buffer + parser->size;
+        newline = scan_find_newline(from, end);
+        if (newline != end) {
+            more = false;
+        } else {
+            newline = NULL;
+            parser->scanned = parser->size;
+            more = parser->fd >= 0 && !parser->fd_eof &&
+                   parser_fill_block(parser);
+        }
+    }
+
+    if (parser->offset >= parser->size) {
+        return false;
+    }
+    const char* start = parser->buffer + parser->offset;
+    size_t left = parser->size - parser->offset;
+    *line = start;
+    *length = newline != NULL ? (size_t)(newline - start) + 1u : left;
+    parser->offset += *length;
+    *has_newline = newline != NULL;
+    return true;
+}
+
+/* Toma la siguiente línea de la entrada, sin el '\n'. Si la línea es la
+ * última (no termina en '\n') o no queda entrada, marca el fin de archivo.
+ * Returns: true si había una línea para leer
+ * Requires: parser != NULL && line != NULL && length != NULL
+ */
+static bool parser_next_line(Parser parser, const char** line,
+                             size_t* length) {
+    assert(parser != NULL && line != NULL && length != NULL);
+
+    bool has_newline = false;
+    if (parser->input != NULL) {
+        ssize_t read = getline(&parser->line, &parser->line_capacity,
+                               parser->input);
+        if (read < 0) {
+            parser->at_eof = true;
+            return false;
+        }
+        *line = parser->line;
+        *length = (size_t)read;
+        has_newline = read > 0 && parser->line[read - 1] == '\n';
+    } else if (!parser_next_buffered_line(parser, line, length,
+                                          &has_newline)) {
+        parser->at_eof = true;
+        return false;
+    }
+
+    if (has_newline) {
+        (*length)--;
+    } else {
+        parser->at_eof = true;
+    }
+    return true;
+}
+
+/* Lee el número de descriptor de los length caracteres de text.
+ * Returns: -1 si no son todos dígitos o si el número es más grande que
+ *     SCOMMAND_MAX_FD
+ */
+static int parse_fd(const char* text, size_t length) {
+    int fd = length > 0u ? 0 : -1;
+    for (size_t i = 0u; i < length && fd != -1; i++) {
+        fd = is_digit(text[i]) ? fd * 10 + (text[i] - '0') : -1;
+        fd = fd > SCOMMAND_MAX_FD ? -1 : fd;
+    }
+    return fd;
+}
+
+/* Parsea una redirección (el operador y la palabra) y la guarda en cmd.
+ * Las de siempre ('<' y '>' sin número) son la redirección de entrada y la
+ * de salida, mientras cmd no tenga ninguna general: después de una general
+ * van a la lista, para que se apliquen en el orden en que se escribieron.
+ * Returns: false si falta la palabra, si el número del descriptor es muy
+ *     grande o si después de "<&" o ">&" no viene un número o '-'
+ * Requires: lex != NULL && cmd != NULL y que el próximo token sea una
+ *     redirección
+ */
+static bool parse_redirection(lexer* lex, scommand cmd) {
+    assert(lex != NULL && cmd != NULL);
+
+    token tok = lexer_next(lex);
+    assert(tok.kind == TOKEN_REDIR_IN || tok.kind == TOKEN_REDIR_OUT);
+    token target = lexer_next(lex);
+    if (target.kind != TOKEN_WORD) {
+        return false;
+    }
+
+    size_t digits = 0u;
+    while (is_digit(tok.start[digits])) {
+        digits++;
+    }
+    const char* op = tok.start + digits;
+    size_t op_length = tok.length - digits;
+    int fd = digits > 0u ? parse_fd(tok.start, digits)
+                         : (tok.kind == TOKEN_REDIR_IN ? 0 : 1);
+    if (fd == -1) {
+        return false;
+    }
+
+    if (op_length == 2u && op[1] == '&') {
+        // La palabra es el número de otro descriptor, o '-' para cerrar
+        bool closing = !target.quoted && target.length == 1u &&
+                     target.start[0] == '-';
+        int source = target.quoted ? -1
+                                   : parse_fd(target.start, target.length);
+        if (closing) {
+            scommand_add_redir(cmd, SCOMMAND_REDIR_CLOSE, fd, -1, NULL);
+        } else if (source != -1) {
+            scommand_add_redir(cmd, SCOMMAND_REDIR_DUP, fd, source, NULL);
+        }
+        return closing || source != -1;
+    }
+
+    if (digits > 0u || op_length == 2u || scommand_redir_count(cmd) > 0u) {
+        scommand_redir_kind kind = SCOMMAND_REDIR_INPUT;
+        if (tok.kind == TOKEN_REDIR_OUT) {
+            kind = op_length == 2u ? SCOMMAND_REDIR_APPEND
+                                   : SCOMMAND_REDIR_OUTPUT;
+        }
+        scommand_add_redir(cmd, kind, fd, -1, token_to_string(target));
+    } else if (tok.kind == TOKEN_REDIR_IN) {
+        free(scommand_get_redir_in(cmd));
+        scommand_set_redir_in(cmd, token_to_string(target));
+    } else {
+        free(scommand_get_redir_out(cmd));
+        scommand_set_redir_out(cmd, token_to_string(target));
+    }
+    return true;
+}
+
+/* Parsea un comando simple. Devuelve NULL si no hay ningún comando o si hay
+ * un error de sintaxis, en cuyo caso el lexer queda en cualquier posición.
+ * Requires: lex != NULL
+ */
+static scommand parse_scommand(lexer* lex) {
+    assert(lex != NULL);
+
+    scommand cmd = scommand_new();
+    bool empty = true;
+    bool error = false;
+    bool done = false;
+
+    while (!done && !error) {
+        token tok = lexer_peek(lex);
+        if (tok.kind == TOKEN_WORD) {
+            lexer_next(lex);
+            scommand_push_back(cmd, token_to_string(tok));
+            empty = false;
+        } else if (tok.kind == TOKEN_REDIR_IN ||
+                   tok.kind == TOKEN_REDIR_OUT) {
+            error = !parse_redirection(lex, cmd);
+            empty = false;
+        } else {
+            done = true;
+        }
+    }
+
+    if (error || empty) {
+        cmd = scommand_destroy(cmd);
+    }
+    return cmd;
+}
+
+static pipeline parse_pipe(lexer* lex);
+
+/* Dónde termina una lista: en un token de la clase kind (TOKEN_END,
+ * TOKEN_RPAREN o TOKEN_DSEMI; TOKEN_WORD si no termina en ningún token), o
+ * en una de las palabras reservadas de words (terminado en NULL) donde
+ * podría empezar un comando
+ */
+typedef struct {
+    token_kind kind;
+    const char* const* words;
+} list_end;
+
+static const char* const no_words[] = {NULL};
+
+/* Palabras reservadas que cierran alguna lista: no pueden empezar un
+ * comando, pero sí seguir a un compuesto sin separador
+ */
+static const char* const closing_words[] = {"}",    "then", "elif", "else",
+                                            "fi",   "do",   "done", "esac",
+                                            NULL};
+
+static bool is_one_of(token tok, const char* const* words) {
+    bool found = false;
+    for (const char* const* w = words; *w != NULL && !found; w++) {
+        found = is_reserved(tok, *w);
+    }
+    return found;
+}
+
+static bool ends_list(token tok, list_end end) {
+    return (end.kind != TOKEN_WORD && tok.kind == end.kind) ||
+           is_one_of(tok, end.words);
+}
+
+/* Saltea los fines de línea dentro de un compuesto */
+static void skip_newlines(lexer* lex) {
+    while (lexer_peek(lex).kind == TOKEN_NEWLINE) {
+        lexer_next(lex);
+    }
+}
+
+/* Después de un operador el comando puede seguir en la línea siguiente,
+ * aunque no haya un compuesto abierto
+ */
+static void skip_newlines_after_operator(lexer* lex) {
+    lex->depth++;
+    skip_newlines(lex);
+    lex->depth--;
+}
+
+static pipeline last_of_list(pipeline p) {
+    while (pipeline_get_next(p) != NULL) {
+        p = pipeline_get_next(p);
+    }
+    return p;
+}
+
+/* Parsea un and_or, con el '&' si lo tiene.
+ * Returns: el primer pipeline de la cadena, o NULL si hay un error de
+ *     sintaxis
+ */
+static pipeline parse_and_or(lexer* lex) {
+    pipeline first = parse_pipe(lex);
+    pipeline last = first;
+    token_kind op = lexer_peek(lex).kind;
+    while (last != NULL && (op == TOKEN_AND || op == TOKEN_OR)) {
+        lexer_next(lex);
+        skip_newlines_after_operator(lex);
+        pipeline p = parse_pipe(lex);
+        if (p == NULL) {
+            first = pipeline_destroy(first);
+            last = NULL;
+        } else {
+            pipeline_set_connector(last, op == TOKEN_AND ? PIPELINE_AND
+                                                         : PIPELINE_OR);
+            pipeline_set_next(last, p);
+            last = p;
+            op = lexer_peek(lex).kind;
+        }
+    }
+
+    if (first != NULL && op == TOKEN_BACKGROUND) {
+        lexer_next(lex);
+        if (first != last) {
+            // Todo el and_or en background, como un grupo
+            scommand group = scommand_new();
+            scommand_set_body(group, SCOMMAND_BRACE_GROUP, first);
+            first = pipeline_new();
+            pipeline_push_back(first, group);
+        }
+        pipeline_set_wait(first, false);
+    }
+    return first;
+}
+
+/* Parsea una lista hasta end, sin consumir lo que la termina.
+ * Returns: el primer pipeline de la lista, o NULL si está vacía o hay un
+ *     error de sintaxis
+ */
+static pipeline parse_list(lexer* lex, list_end end) {
+    pipeline first = NULL;
+    pipeline last = NULL;
+    bool error = false;
+
+    skip_newlines(lex);
+    while (!error && !ends_list(lexer_peek(lex), end)) {
+        pipeline p = parse_and_or(lex);
+        error = p == NULL;
+        if (!error) {
+            if (last == NULL) {
+                first = p;
+            } else {
+                pipeline_set_next(last, p);
+            }
+            last = last_of_list(p);
+            token_kind sep = lexer_peek(lex).kind;
+            if (sep == TOKEN_SEMICOLON || sep == TOKEN_NEWLINE) {
+                lexer_next(lex);
+            } else if (pipeline_get_wait(last)) {
+                // Sin separador solo puede seguir el final
+                error = !ends_list(lexer_peek(lex), end);
+            }
+            skip_newlines(lex);
+        }
+    }
+    error = error || first == NULL;
+
+    if (error && first != NULL) {
+        first = pipeline_destroy(first);
+    }
+    return error ? NULL : first;
+}
+
+/* Parsea una lista que termina en alguna de las palabras reservadas words
+ * y la agrega a cmd.
+ * Returns: false si hay un error de sintaxis
+ */
+static bool parse_list_into(lexer* lex, scommand cmd,
+                            const char* const* words) {
+    pipeline list = parse_list(lex, (list_end){TOKEN_WORD, words});
+    if (list != NULL) {
+        scommand_add_list(cmd, list);
+    }
+    return list != NULL;
+}
+
+/* Consume el siguiente token.
+ * Returns: si es la palabra reservada word
+ */
+static bool expect_reserved(lexer* lex, const char* word) {
+    return is_reserved(lexer_next(lex), word);
+}
+
+/* Parsea el cuerpo de un grupo: "( lista )" o "{ lista }" */
+static bool parse_group(lexer* lex, scommand cmd) {
+    static const char* const brace_end[] = {"}", NULL};
+    list_end end = {TOKEN_WORD, brace_end};
+    if (scommand_get_kind(cmd) == SCOMMAND_SUBSHELL) {
+        end = (list_end){TOKEN_RPAREN, no_words};
+    }
+    pipeline body = parse_list(lex, end);
+    if (body == NULL) {
+        return false;
+    }
+    scommand_add_list(cmd, body);
+    return ends_list(lexer_next(lex), end);
+}
+
+/* Parsea "c1; then l1; [elif c2; then l2;]... [else l3;] fi" */
+static bool parse_if(lexer* lex, scommand cmd) {
+    static const char* const then_end[] = {"then", NULL};
+    static const char* const branch_end[] = {"elif", "else", "fi", NULL};
+    static const char* const else_end[] = {"fi", NULL};
+    bool ok = true;
+    token tok;
+    do {
+        ok = parse_list_into(lex, cmd, then_end) &&
+             expect_reserved(lex, "then") &&
+             parse_list_into(lex, cmd, branch_end);
+        tok = lexer_next(lex);
+    } while (ok && is_reserved(tok, "elif"));
+    if (ok && is_reserved(tok, "else")) {
+        ok = parse_list_into(lex, cmd, else_end) && expect_reserved(lex, "fi");
+    }
+    return ok;
+}
+
+/* Parsea "c; do l; done", de un while o un until */
+static bool parse_loop(lexer* lex, scommand cmd) {
+    static const char* const do_end[] = {"do", NULL};
+    static const char* const done_end[] = {"done", NULL};
+    return parse_list_into(lex, cmd, do_end) && expect_reserved(lex, "do") &&
+           parse_list_into(lex, cmd, done_end) &&
+           expect_reserved(lex, "done");
+}
+
+/* Indica si tok es un nombre de variable, sin comillas */
+static bool is_name(token tok) {
+    bool ok = tok.kind == TOKEN_WORD && !tok.quoted && tok.length > 0u &&
+              !(tok.start[0] >= '0' && tok.start[0] <= '9');
+    for (size_t i = 0u; i < tok.length && ok; i++) {
+        char c = tok.start[i];
+        ok = c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+             (c >= '0' && c <= '9');
+    }
+    return ok;
+}
+
+/* Parsea "x in palabras; do l; done". Las palabras se guardan como las de
+ * un comando (con sus expansiones pendientes).
+ */
+static bool parse_for(lexer* lex, scommand cmd) {
+    static const char* const done_end[] = {"done", NULL};
+    token name = lexer_next(lex);
+    if (!is_name(name)) {
+        return false;
+    }
+    scommand_push_back(cmd, token_to_string(name));
+    skip_newlines(lex);
+    if (!expect_reserved(lex, "in")) {
+        return false;
+    }
+    token tok = lexer_next(lex);
+    while (tok.kind == TOKEN_WORD) {
+        scommand_push_back(cmd, token_to_string(tok));
+        tok = lexer_next(lex);
+    }
+    if (tok.kind != TOKEN_SEMICOLON && tok.kind != TOKEN_NEWLINE) {
+        return false;
+    }
+    skip_newlines(lex);
+    return expect_reserved(lex, "do") && parse_list_into(lex, cmd, done_end) &&
+           expect_reserved(lex, "done");
+}
+
+/* Parsea los patrones de una cláusula de case, "[(] p1 | p2 )", y los
+ * agrega a cmd como una lista de un solo comando.
+ * Returns: false si hay un error de sintaxis
+ */
+static bool parse_patterns(lexer* lex, scommand cmd) {
+    if (lexer_peek(lex).kind == TOKEN_LPAREN) {
+        lexer_next(lex);
+    }
+    scommand patterns = scommand_new();
+    bool ok = true;
+    bool more = true;
+    while (ok && more) {
+        token tok = lexer_next(lex);
+        ok = tok.kind == TOKEN_WORD;
+        if (ok) {
+            scommand_push_back(patterns, token_to_string(tok));
+            tok = lexer_next(lex);
+            ok = tok.kind == TOKEN_PIPE || tok.kind == TOKEN_RPAREN;
+            more = tok.kind == TOKEN_PIPE;
+        }
+    }
+    if (!ok) {
+        scommand_destroy(patterns);
+        return false;
+    }
+    pipeline list = pipeline_new();
+    pipeline_push_back(list, patterns);
+    scommand_add_list(cmd, list);
+    return true;
+}
+
+/* Parsea "w in [patrones) lista ;;]... esac". La lista de la última
+ * cláusula no necesita el ";;", y cualquiera puede estar vacía.
+ */
+static bool parse_case(lexer* lex, scommand cmd) {
+    static const char* const esac[] = {"esac", NULL};
+    list_end end = {TOKEN_DSEMI, esac};
+    token word = lexer_next(lex);
+    if (word.kind != TOKEN_WORD) {
+        return false;
+    }
+    scommand_push_back(cmd, token_to_string(word));
+    skip_newlines(lex);
+    bool ok = expect_reserved(lex, "in");
+    skip_newlines(lex);
+    while (ok && !is_reserved(lexer_peek(lex), "esac")) {
+        ok = parse_patterns(lex, cmd);
+        skip_newlines(lex);
+        pipeline body = NULL;
+        if (ok && ends_list(lexer_peek(lex), end)) {
+            body = pipeline_new();
+        } else if (ok) {
+            body = parse_list(lex, end);
+        }
+        ok = body != NULL;
+        if (ok) {
+            scommand_add_list(cmd, body);
+            if (lexer_peek(lex).kind == TOKEN_DSEMI) {
+                lexer_next(lex);
+                skip_newlines(lex);
+            }
+        }
+    }
+    return ok && expect_reserved(lex, "esac");
+}
+
+/* Palabras reservadas que empiezan un compuesto ('(' es un token) */
+static const struct {
+    const char* word;
+    scommand_kind kind;
+} compound_words[] = {{"{", SCOMMAND_BRACE_GROUP}, {"if", SCOMMAND_IF},
+                      {"while", SCOMMAND_WHILE},   {"until", SCOMMAND_UNTIL},
+                      {"for", SCOMMAND_FOR},       {"case", SCOMMAND_CASE}};
+
+/* Parsea un compuesto de la clase kind, desde el token que lo abre, con
+ * sus redirecciones. Mientras está abierto el fin de línea es un
+ * separador. Devuelve NULL si hay un error de sintaxis.
+ */
+static scommand parse_compound(lexer* lex, scommand_kind kind) {
+    scommand cmd = scommand_new();
+    scommand_set_kind(cmd, kind);
+    lexer_next(lex);
+    lex->depth++;
+    bool ok = false;
+    switch (kind) {
+    case SCOMMAND_IF:
+        ok = parse_if(lex, cmd);
+        break;
+    case SCOMMAND_WHILE:
+    case SCOMMAND_UNTIL:
+        ok = parse_loop(lex, cmd);
+        break;
+    case SCOMMAND_FOR:
+        ok = parse_for(lex, cmd);
+        break;
+    case SCOMMAND_CASE:
+        ok = parse_case(lex, cmd);
+        break;
+    default:
+        ok = parse_group(lex, cmd);
+    }
+    lex->depth--;
+
+    token tok = lexer_peek(lex);
+    while (ok && (tok.kind == TOKEN_REDIR_IN || tok.kind == TOKEN_REDIR_OUT)) {
+        ok = parse_redirection(lex, cmd);
+        tok = lexer_peek(lex);
+    }
+    // Después del compuesto no puede venir una palabra, salvo un cierre
+    if (!ok || (tok.kind == TOKEN_WORD && !is_one_of(tok, closing_words))) {
+        cmd = scommand_destroy(cmd);
+    }
+    return cmd;
+}
+
+/* Parsea un comando: un compuesto o un comando simple. Devuelve NULL si
+ * hay un error de sintaxis (también si empieza con una palabra que cierra
+ * una lista, fuera de lugar).
+ */
+static scommand parse_command(lexer* lex) {
+    token tok = lexer_peek(lex);
+    if (tok.kind == TOKEN_LPAREN) {
+        return parse_compound(lex, SCOMMAND_SUBSHELL);
+    }
+    size_t count = sizeof(compound_words) / sizeof(compound_words[0]);
+    for (size_t i = 0u; i < count; i++) {
+        if (is_reserved(tok, compound_words[i].word)) {
+            return parse_compound(lex, compound_words[i].kind);
+        }
+    }
+    if (is_one_of(tok, closing_words)) {
+        return NULL;
+    }
+    return parse_scommand(lex);
+}
+
+/* Parsea un pipeline (sin el '&', que es del and_or).
+ * Devuelve NULL si no hay ningún comando o hay un error de sintaxis.
+ */
+static pipeline parse_pipe(lexer* lex) {
+    pipeline result = pipeline_new();
+    bool error = false;
+    bool more = true;
+
+    while (more && !error) {
+        scommand cmd = parse_command(lex);
+        if (cmd == NULL) {
+            error = true;
+        } else {
+            pipeline_push_back(result, cmd);
+            more = lexer_peek(lex).kind == TOKEN_PIPE;
+            if (more) {
+                lexer_next(lex);
+            }
+        }
+    }
+
+    if (error) {
+        result = pipeline_destroy(result);
+    }
+    return result;
+}
+
+/* Parsea la lista que empieza en la línea [line, line + length), y que
+ * puede seguir en las líneas siguientes de parser (compuestos, operadores
+ * al final de la línea).
+ * Devuelve NULL si la línea está vacía o tiene un error de sintaxis.
+ *   lines: dónde se guarda cuántas líneas se leyeron de más
+ */
+static pipeline parse_line(Parser parser, const char* line, size_t length,
+                           unsigned int* lines) {
+    lexer lex = {line, line + length, parser, 0u, 0u};
+    // La lista termina con la línea (salvo que haya compuestos abiertos)
+    pipeline result = parse_list(&lex, (list_end){TOKEN_END, no_words});
+    *lines = lex.lines;
+    return result;
+}
+
+pipeline parse_pipeline(Parser parser) {
+    assert(parser != NULL && !parser_at_eof(parser));
+
+    const char* line = NULL;
+    size_t length = 0u;
+    pipeline result = NULL;
+
+    parser->incomplete = false;
+    if (parser_next_line(parser, &line, &length)) {
+        if (parser->cache != NULL) {
+            result = linecache_lookup(parser->cache, line, length);
+        }
+        if (result == NULL) {
+            unsigned int lines = 0u;
+            result = parse_line(parser, line, length, &lines);
+            /* Los errores de sintaxis no se guardan, ni lo que ocupa varias
+               líneas (la clave es solo la primera) */
+            if (result != NULL && lines == 0u && parser->cache != NULL) {
+                linecache_insert(parser->cache, line, length, result);
+            }
+        }
+    }
+    // Solo cuenta si por eso no se pudo parsear
+    parser->incomplete = parser->incomplete && result == NULL;
+    return result;
+}
@@ -2,9 +2,11 @@
 #define PARSER_H
 
 #include <stdbool.h> /* bool */
+#include <stddef.h>  /* size_t */
 #include <stdio.h>   /* FILE */
 
-#include "command.h" /* pipeline */
+#include "command.h"   /* pipeline */
+#include "linecache.h" /* linecache */
 
 /* Tipo opaco, implementación oculta */
 typedef struct parser_s* Parser;
@@ -19,6 +21,31 @@ typedef struct parser_s* Parser;
  */
 Parser parser_new(FILE* input);
 
+/* Constructor de Parser para una entrada en memoria.
+ * Parsea los `size' bytes de `buffer' como si fueran el contenido de un
+ * archivo (no hace falta que terminen en '\0'). El buffer no se copia: tiene
+ * que seguir vivo mientras se use el parser.
+ * REQUIRES:
+ *     buffer != NULL || size == 0
+ * ENSURES:
+ *     Devuelve un Parser para el buffer
+ *     o NULL en caso de haber un error de inicialización
+ */
+Parser parser_new_from_buffer(const char* buffer, size_t size);
+
+/* Constructor de Parser para leer scripts grandes desde un file descriptor.
+ * Si `fd' es un archivo regular se mapea entero en memoria; si no (pipes),
+ * se lee en bloques grandes. A diferencia de parser_new, puede leer de `fd'
+ * más de lo que se parseó hasta el momento, así que no conviene usarlo si
+ * otros procesos van a seguir leyendo del mismo fd. El fd no se cierra.
+ * REQUIRES:
+ *     fd >= 0
+ * ENSURES:
+ *     Devuelve un Parser para el file descriptor
+ *     o NULL en caso de haber un error de inicialización
+ */
+Parser parser_new_from_fd(int fd);
+
 /* Destructor de Parser.
  * REQUIRES:
  *     parser != NULL
@@ -27,8 +54,20 @@ Parser parser_new(FILE* input);
  */
 Parser parser_destroy(Parser parser);
 
-/* Lee todo un pipeline de `parser' hasta llegar a un fin de línea (inclusive)
- * o de archivo.
+/* Hace que `parser' use `cache' para no volver a parsear líneas repetidas:
+ * antes de parsear una línea la busca en el cache, y si no está guardada
+ * guarda el resultado. El cache no pasa a ser del parser (se puede compartir
+ * entre varios) y tiene que seguir vivo mientras se use el parser; con NULL
+ * se deja de usar.
+ * REQUIRES:
+ *     parser != NULL
+ */
+void parser_set_cache(Parser parser, linecache cache);
+
+/* Lee toda una lista de pipelines de `parser' (a; b && c || d &) hasta
+ * llegar a un fin de línea (inclusive) o de archivo, y devuelve el primero
+ * (ver pipeline_get_next). Si la línea abre un grupo ("{ ..." o "( ...") o
+ * termina con '&&' o '||' se siguen leyendo líneas.
  * Devuelve un nuevo pipeline (a liberar por el llamador), o NULL en caso
  * de error.
  * REQUIRES:
@@ -48,4 +87,13 @@ pipeline parse_pipeline(Parser parser);
  */
 bool parser_at_eof(Parser parser);
 
+/* Consulta si el último parse_pipeline devolvió NULL porque la entrada se
+ * terminó con un compuesto abierto o después de '&&' o '||' (y no por un
+ * error de sintaxis): con más líneas se podría haber parseado. Sirve para
+ * seguir pidiendo líneas en una terminal.
+ * REQUIRES:
+ *     parser != NULL
+ */
+bool parser_incomplete(Parser parser);
+
 #endif /* PARSER_H */
@@ -0,0 +1,907 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <locale.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pathexp.h"
+
+/* Tamaño del buffer para getdents64 */
+#define DENTS_BUFFER (64u * 1024u)
+
+/* Lo que devuelve getdents64 */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Los nombres de un directorio, uno atrás del otro (con su '\0') en names */
+struct listing {
+    char* dir;
+    char* names;
+    uint32_t* offsets;    // count + 1, el último es el final de names
+    unsigned char* types; // d_type de cada nombre
+    size_t count;
+};
+
+struct pathexp_s {
+    GSList* listings;
+    GSList* walks; // recorridos de "**" (struct walk, más abajo)
+    unsigned int threads; // para los recorridos, 0 es uno por CPU
+};
+
+/* Resultados que se van juntando */
+struct results {
+    char** list;
+    size_t count;
+    size_t capacity;
+};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* Concatena a y los n bytes de b en memoria nueva */
+static char* concat(const char* a, const char* b, size_t n) {
+    size_t length = strlen(a);
+    char* result = checked_realloc(NULL, length + n + 1u);
+    memcpy(result, a, length);
+    memcpy(result + length, b, n);
+    result[length + n] = '\0';
+    return result;
+}
+
+/********** Patrones compilados **********/
+
+typedef enum { OP_LITERAL, OP_ANY, OP_STAR, OP_CLASS } op_kind;
+
+struct op {
+    op_kind kind;
+    uint32_t start; // del literal, en matcher.text
+    uint32_t length;
+    uint8_t set[32]; // bytes del conjunto, un bit cada uno
+};
+
+struct matcher {
+    struct op* ops;
+    size_t count;
+    char* text;        // los bytes de los literales
+    size_t min_length; // largo mínimo de un nombre que coincida
+    bool has_star;
+    bool leading_dot;  // el patrón empieza con un '.' literal
+};
+
+static void add_literal(struct matcher* m, size_t* text_length, char c) {
+    if (m->count == 0u || m->ops[m->count - 1u].kind != OP_LITERAL) {
+        m->ops[m->count] = (struct op){OP_LITERAL, (uint32_t)*text_length, 0u,
+                                       {0}};
+        m->count++;
+    }
+    m->text[*text_length] = c;
+    (*text_length)++;
+    m->ops[m->count - 1u].length++;
+    m->min_length++;
+}
+
+static void set_bit(uint8_t* set, unsigned char c) {
+    set[c / 8u] |= (uint8_t)(1u << (c % 8u));
+}
+
+static bool has_bit(const uint8_t* set, unsigned char c) {
+    return (set[c / 8u] >> (c % 8u)) & 1u;
+}
+
+/* Compila el conjunto que empieza en p[i] == '['.
+ * Returns: la posición del ']' que lo cierra, o 0 si no se cierra (y
+ *     entonces el '[' es literal)
+ */
+static size_t compile_class(const char* p, size_t n, size_t i, uint8_t* set) {
+    size_t j = i + 1u;
+    bool negate = j < n && (p[j] == '!' || p[j] == '^');
+    if (negate) {
+        j++;
+    }
+    memset(set, 0, 32u);
+    bool first = true;
+    while (j < n && (p[j] != ']' || first)) {
+        first = false;
+        unsigned char low = (unsigned char)p[j];
+        if (low == '\\' && j + 1u < n) {
+            j++;
+            low = (unsigned char)p[j];
+        }
+        unsigned char high = low;
+        if (j + 2u < n && p[j + 1u] == '-' && p[j + 2u] != ']') {
+            j += 2u;
+            if (p[j] == '\\' && j + 1u < n) {
+                j++;
+            }
+            high = (unsigned char)p[j];
+        }
+        for (unsigned int c = low; c <= high; c++) {
+            set_bit(set, (unsigned char)c);
+        }
+        j++;
+    }
+    if (j >= n) {
+        return 0u;
+    }
+    if (negate) {
+        for (unsigned int k = 0u; k < 32u; k++) {
+            set[k] = (uint8_t)~set[k];
+        }
+    }
+    return j;
+}
+
+static void matcher_compile(struct matcher* m, const char* p, size_t n) {
+    m->ops = checked_realloc(NULL, (n + 1u) * sizeof(struct op));
+    m->text = checked_realloc(NULL, n + 1u);
+    m->count = 0u;
+    m->min_length = 0u;
+    m->has_star = false;
+    size_t text_length = 0u;
+
+    for (size_t i = 0u; i < n; i++) {
+        struct op* op = &m->ops[m->count];
+        size_t close = 0u;
+        if (p[i] == '*') {
+            if (m->count == 0u || m->ops[m->count - 1u].kind != OP_STAR) {
+                *op = (struct op){OP_STAR, 0u, 0u, {0}};
+                m->count++;
+            }
+            m->has_star = true;
+        } else if (p[i] == '?') {
+            *op = (struct op){OP_ANY, 0u, 0u, {0}};
+            m->count++;
+            m->min_length++;
+        } else if (p[i] == '[' &&
+                   (close = compile_class(p, n, i, op->set)) > 0u) {
+            op->kind = OP_CLASS;
+            m->count++;
+            m->min_length++;
+            i = close;
+        } else if (p[i] == '\\' && i + 1u < n) {
+            i++;
+            add_literal(m, &text_length, p[i]);
+        } else {
+            add_literal(m, &text_length, p[i]);
+        }
+    }
+    m->leading_dot = m->count > 0u && m->ops[0].kind == OP_LITERAL &&
+                     m->text[m->ops[0].start] == '.';
+}
+
+static void matcher_free(struct matcher* m) {
+    free(m->ops);
+    free(m->text);
+}
+
+/* Compara name (de largo length) con el patrón. Los '*' se prueban del más
+ * corto al más largo, volviendo solo al último '*' cuando algo no coincide:
+ * con los patrones de archivos eso alcanza, y no hay retroceso exponencial.
+ */
+static bool matcher_match(const struct matcher* m, const char* name,
+                          size_t length) {
+    if (length < m->min_length || (!m->has_star && length != m->min_length)) {
+        return false;
+    }
+    // Si termina en un literal después de un '*', se mira primero el final
+    const struct op* last = m->count > 0u ? &m->ops[m->count - 1u] : NULL;
+    if (m->has_star && last->kind == OP_LITERAL &&
+        memcmp(name + length - last->length, m->text + last->start,
+               last->length) != 0) {
+        return false;
+    }
+
+    size_t i = 0u;
+    size_t pos = 0u;
+    size_t star_op = SIZE_MAX;
+    size_t star_pos = 0u;
+    while (true) {
+        bool ok = false;
+        if (i < m->count) {
+            const struct op* op = &m->ops[i];
+            switch (op->kind) {
+            case OP_STAR:
+                star_op = i;
+                star_pos = pos;
+                i++;
+                continue;
+            case OP_LITERAL:
+                ok = pos + op->length <= length &&
+                     memcmp(name + pos, m->text + op->start, op->length) == 0;
+                if (ok) {
+                    pos += op->length;
+                }
+                break;
+            case OP_ANY:
+                ok = pos < length;
+                pos += ok ? 1u : 0u;
+                break;
+            case OP_CLASS:
+                ok = pos < length && has_bit(op->set, (unsigned char)name[pos]);
+                pos += ok ? 1u : 0u;
+                break;
+            }
+            if (ok) {
+                i++;
+                continue;
+            }
+        } else if (pos == length) {
+            return true;
+        }
+        // No coincide: el último '*' se come un caracter más
+        if (star_op == SIZE_MAX || star_pos >= length) {
+            return false;
+        }
+        star_pos++;
+        pos = star_pos;
+        i = star_op + 1u;
+    }
+}
+
+bool pathexp_match(const char* pattern, const char* string) {
+    assert(pattern != NULL && string != NULL);
+
+    struct matcher m;
+    matcher_compile(&m, pattern, strlen(pattern));
+    bool result = matcher_match(&m, string, strlen(string));
+    matcher_free(&m);
+    return result;
+}
+
+struct pathexp_pattern_s {
+    struct matcher m;
+};
+
+pathexp_pattern pathexp_pattern_new(const char* pattern) {
+    assert(pattern != NULL);
+
+    pathexp_pattern self = checked_realloc(NULL, sizeof(*self));
+    matcher_compile(&self->m, pattern, strlen(pattern));
+    return self;
+}
+
+pathexp_pattern pathexp_pattern_destroy(pathexp_pattern self) {
+    assert(self != NULL);
+
+    matcher_free(&self->m);
+    free(self);
+    return NULL;
+}
+
+bool pathexp_pattern_match(const pathexp_pattern self, const char* string,
+                           size_t length) {
+    assert(self != NULL && (string != NULL || length == 0u));
+
+    return matcher_match(&self->m, string != NULL ? string : "", length);
+}
+
+bool pathexp_has_magic(const char* pattern) {
+    assert(pattern != NULL);
+
+    size_t n = strlen(pattern);
+    uint8_t set[32];
+    for (size_t i = 0u; i < n; i++) {
+        if (pattern[i] == '\\') {
+            i++;
+        } else if (pattern[i] == '*' || pattern[i] == '?' ||
+                   (pattern[i] == '[' &&
+                    compile_class(pattern, n, i, set) > 0u)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/********** Orden **********/
+
+/* Compara dos nombres byte a byte */
+static int compare_bytes(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* Compara dos nombres según el orden de la locale (LC_COLLATE) */
+static int compare_collate(const void* a, const void* b) {
+    return strcoll(*(char* const*)a, *(char* const*)b);
+}
+
+void pathexp_sort(char** names, size_t count) {
+    assert(names != NULL || count == 0u);
+
+    if (count < 2u) {
+        return;
+    }
+    // En "C" y "POSIX" strcoll es strcmp, pero bastante más lento
+    const char* collate = setlocale(LC_COLLATE, NULL);
+    bool bytes = collate == NULL || strcmp(collate, "C") == 0 ||
+                 strcmp(collate, "POSIX") == 0;
+    qsort(names, count, sizeof(char*), bytes ? compare_bytes : compare_collate);
+}
+
+/********** Listados **********/
+
+static void listing_free(gpointer data) {
+    struct listing* listing = data;
+    free(listing->dir);
+    free(listing->names);
+    free(listing->offsets);
+    free(listing->types);
+    free(listing);
+}
+
+/* Listado vacío del directorio dir (se queda con la cadena) */
+static struct listing* listing_new(char* dir) {
+    struct listing* listing = checked_realloc(NULL, sizeof(struct listing));
+    *listing = (struct listing){dir, NULL, NULL, NULL, 0u};
+    listing->offsets = checked_realloc(NULL, sizeof(uint32_t));
+    listing->offsets[0] = 0u;
+    return listing;
+}
+
+static bool is_dot_or_dotdot(const char* name) {
+    return name[0] == '.' &&
+           (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/* Lee con getdents64 las entradas del directorio abierto fd, salvo "." y
+ * "..", usando buffer (de DENTS_BUFFER bytes)
+ */
+static void listing_fill(struct listing* listing, int fd, char* buffer) {
+    size_t used = 0u;
+    size_t names_capacity = 0u;
+    size_t capacity = 0u;
+    long read_bytes = 0;
+    while ((read_bytes = syscall(SYS_getdents64, fd, buffer,
+                                 DENTS_BUFFER)) > 0) {
+        for (long offset = 0; offset < read_bytes;) {
+            struct linux_dirent64* d =
+                (struct linux_dirent64*)(buffer + offset);
+            offset += d->d_reclen;
+            if (is_dot_or_dotdot(d->d_name)) {
+                continue;
+            }
+            size_t length = strlen(d->d_name);
+            if (listing->count + 1u >= capacity) {
+                capacity = capacity > 0u ? 2u * capacity : 64u;
+                listing->offsets = checked_realloc(listing->offsets,
+                                                   capacity * sizeof(uint32_t));
+                listing->types = checked_realloc(listing->types, capacity);
+            }
+            if (used + length + 1u > names_capacity) {
+                while (used + length + 1u > names_capacity) {
+                    names_capacity = names_capacity > 0u ? 2u * names_capacity
+                                                         : 1024u;
+                }
+                listing->names =
+                    checked_realloc(listing->names, names_capacity);
+            }
+            memcpy(listing->names + used, d->d_name, length + 1u);
+            listing->offsets[listing->count] = (uint32_t)used;
+            listing->types[listing->count] = d->d_type;
+            listing->count++;
+            used += length + 1u;
+        }
+    }
+    // Con el final, el largo de cada nombre sale de los offsets
+    listing->offsets[listing->count] = (uint32_t)used;
+}
+
+/* Lee el directorio. Si no se puede leer queda vacío. */
+static struct listing* listing_read(const char* dir) {
+    struct listing* listing = listing_new(concat(dir, "", 0u));
+    int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd != -1) {
+        char* buffer = checked_realloc(NULL, DENTS_BUFFER);
+        listing_fill(listing, fd, buffer);
+        free(buffer);
+        close(fd);
+    }
+    return listing;
+}
+
+/* El listado de dir, leyéndolo si todavía no está */
+static const struct listing* listing_get(pathexp self, const char* dir) {
+    for (GSList* node = self->listings; node != NULL; node = node->next) {
+        struct listing* listing = node->data;
+        if (strcmp(listing->dir, dir) == 0) {
+            return listing;
+        }
+    }
+    struct listing* listing = listing_read(dir);
+    self->listings = g_slist_prepend(self->listings, listing);
+    return listing;
+}
+
+/********** Recorrido paralelo (**) **********/
+
+/* Más hilos no ayudan: el límite pasa a ser el sistema de archivos */
+#define WALK_MAX_THREADS 16u
+
+/* Con esta cantidad de directorios pendientes se crean los otros hilos (los
+ * árboles chicos se recorren sin crear ninguno)
+ */
+#define WALK_SPAWN_PENDING 8u
+
+/* Un directorio abierto. Sus subdirectorios pendientes se abren con openat
+ * relativo a él, y el último que lo usa lo cierra.
+ */
+struct walk_fd {
+    int fd;
+    atomic_uint refs;
+};
+
+/* Un directorio pendiente */
+struct walk_task {
+    char* dir;              // ruta con '/' al final, o "" (el actual)
+    size_t name_start;      // dónde empieza el nombre (relativo a parent)
+    struct walk_fd* parent; // NULL si es la raíz
+};
+
+struct walker;
+
+/* Cola de un hilo: el dueño saca del final (primero en profundidad, lo que
+ * acaba de agregar) y los demás roban del principio, donde están los
+ * directorios más altos, con más trabajo abajo
+ */
+struct walk_queue {
+    pthread_mutex_t lock;
+    struct walk_task* tasks;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+    struct walker* walker;
+    unsigned int id;
+    bool running;            // tiene un hilo (el 0 es el que llamó)
+    pthread_t thread;
+    char* buffer;            // para getdents64
+    struct listing** found;  // los directorios que leyó este hilo
+    size_t found_count;
+    size_t found_capacity;
+};
+
+struct walker {
+    struct walk_queue queues[WALK_MAX_THREADS];
+    unsigned int threads; // hilos que se pueden usar
+    bool spawned;
+    atomic_size_t pending; // tareas en una cola o procesándose
+};
+
+/* Un recorrido terminado, guardado en el pathexp */
+struct walk {
+    char* root;
+    struct listing** dirs;
+    size_t count;
+};
+
+static void walk_free(gpointer data) {
+    struct walk* walk = data;
+    for (size_t i = 0u; i < walk->count; i++) {
+        listing_free(walk->dirs[i]);
+    }
+    free(walk->dirs);
+    free(walk->root);
+    free(walk);
+}
+
+static void queue_push(struct walk_queue* q, struct walk_task task) {
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->capacity) {
+        q->capacity = q->capacity > 0u ? 2u * q->capacity : 64u;
+        q->tasks = checked_realloc(q->tasks,
+                                   q->capacity * sizeof(struct walk_task));
+    }
+    q->tasks[q->tail] = task;
+    q->tail++;
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* Saca una tarea del final (el dueño) o del principio (otro hilo) */
+static bool queue_take(struct walk_queue* q, bool steal,
+                       struct walk_task* task) {
+    pthread_mutex_lock(&q->lock);
+    bool found = q->head < q->tail;
+    if (found && steal) {
+        *task = q->tasks[q->head];
+        q->head++;
+    } else if (found) {
+        q->tail--;
+        *task = q->tasks[q->tail];
+    }
+    if (q->head == q->tail) {
+        q->head = 0u;
+        q->tail = 0u;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+static size_t queue_length(struct walk_queue* q) {
+    pthread_mutex_lock(&q->lock);
+    size_t length = q->tail - q->head;
+    pthread_mutex_unlock(&q->lock);
+    return length;
+}
+
+static void walk_fd_release(struct walk_fd* wfd) {
+    if (atomic_fetch_sub(&wfd->refs, 1u) == 1u) {
+        close(wfd->fd);
+        free(wfd);
+    }
+}
+
+/* Lee el directorio de task y agrega a la cola sus subdirectorios, salvo
+ * los ocultos y los enlaces simbólicos (como globstar en bash)
+ */
+static void walk_process(struct walk_queue* q, struct walk_task task) {
+    int fd = -1;
+    if (task.parent == NULL) {
+        fd = open(task.dir[0] != '\0' ? task.dir : ".",
+                  O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    } else {
+        fd = openat(task.parent->fd, task.dir + task.name_start,
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd == -1 && errno == EMFILE) {
+            // Demasiados directorios abiertos esperando: por la ruta entera
+            fd = open(task.dir,
+                      O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW);
+        }
+        walk_fd_release(task.parent);
+    }
+
+    struct listing* listing = listing_new(task.dir);
+    if (fd != -1) {
+        listing_fill(listing, fd, q->buffer);
+        struct walk_fd* wfd = checked_realloc(NULL, sizeof(struct walk_fd));
+        wfd->fd = fd;
+        atomic_init(&wfd->refs, 1u);
+        size_t dir_length = strlen(task.dir);
+        for (size_t i = 0u; i < listing->count; i++) {
+            const char* name = listing->names + listing->offsets[i];
+            struct stat st;
+            if (listing->types[i] == DT_UNKNOWN &&
+                fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+                listing->types[i] = IFTODT(st.st_mode);
+            }
+            if (name[0] == '.' || listing->types[i] != DT_DIR) {
+                continue;
+            }
+            size_t name_length =
+                listing->offsets[i + 1u] - listing->offsets[i] - 1u;
+            char* dir = concat(task.dir, name, name_length);
+            char* child = concat(dir, "/", 1u);
+            free(dir);
+            atomic_fetch_add(&wfd->refs, 1u);
+            atomic_fetch_add(&q->walker->pending, 1u);
+            queue_push(q, (struct walk_task){child, dir_length, wfd});
+        }
+        walk_fd_release(wfd);
+    }
+
+    if (q->found_count == q->found_capacity) {
+        q->found_capacity = q->found_capacity > 0u ? 2u * q->found_capacity
+                                                   : 64u;
+        q->found = checked_realloc(q->found,
+                                   q->found_capacity * sizeof(struct listing*));
+    }
+    q->found[q->found_count] = listing;
+    q->found_count++;
+}
+
+static void* walk_thread(void* data);
+
+/* Crea los otros hilos. Si alguno no se puede crear se sigue con menos. */
+static void walk_spawn(struct walker* w) {
+    w->spawned = true;
+    for (unsigned int i = 1u; i < w->threads; i++) {
+        w->queues[i].running = pthread_create(&w->queues[i].thread, NULL,
+                                              walk_thread, &w->queues[i]) == 0;
+    }
+}
+
+/* Procesa tareas, propias o robadas, hasta que no quede ninguna */
+static void walk_run(struct walk_queue* q) {
+    struct walker* w = q->walker;
+    struct walk_task task;
+    while (true) {
+        bool found = queue_take(q, false, &task);
+        for (unsigned int k = 1u; !found && k < w->threads; k++) {
+            found = queue_take(&w->queues[(q->id + k) % w->threads], true,
+                               &task);
+        }
+        if (found) {
+            walk_process(q, task);
+            atomic_fetch_sub(&w->pending, 1u);
+            if (q->id == 0u && !w->spawned && w->threads > 1u &&
+                queue_length(q) >= WALK_SPAWN_PENDING) {
+                walk_spawn(w);
+            }
+        } else if (atomic_load(&w->pending) == 0u) {
+            return;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void* walk_thread(void* data) {
+    walk_run(data);
+    return NULL;
+}
+
+/* Recorre el árbol que empieza en root ('/' al final, o "") con hasta
+ * threads hilos (0: uno por CPU).
+ * Returns: un listado por directorio, root incluido
+ */
+static struct walk* walk_tree(const char* root, unsigned int threads) {
+    struct walker* w = checked_realloc(NULL, sizeof(struct walker));
+    long cpus = threads > 0u ? (long)threads : sysconf(_SC_NPROCESSORS_ONLN);
+    w->threads = (unsigned int)cpus;
+    if (cpus < 1) {
+        w->threads = 1u;
+    } else if (cpus > (long)WALK_MAX_THREADS) {
+        w->threads = WALK_MAX_THREADS;
+    }
+    w->spawned = false;
+    atomic_init(&w->pending, 1u);
+    for (unsigned int i = 0u; i < w->threads; i++) {
+        struct walk_queue* q = &w->queues[i];
+        pthread_mutex_init(&q->lock, NULL);
+        q->tasks = NULL;
+        q->head = 0u;
+        q->tail = 0u;
+        q->capacity = 0u;
+        q->walker = w;
+        q->id = i;
+        q->running = i == 0u;
+        q->buffer = checked_realloc(NULL, DENTS_BUFFER);
+        q->found = NULL;
+        q->found_count = 0u;
+        q->found_capacity = 0u;
+    }
+    queue_push(&w->queues[0],
+               (struct walk_task){concat(root, "", 0u), 0u, NULL});
+    walk_run(&w->queues[0]);
+
+    struct walk* walk = checked_realloc(NULL, sizeof(struct walk));
+    *walk = (struct walk){concat(root, "", 0u), NULL, 0u};
+    for (unsigned int i = 0u; i < w->threads; i++) {
+        struct walk_queue* q = &w->queues[i];
+        if (i > 0u && q->running) {
+            pthread_join(q->thread, NULL);
+        }
+        walk->dirs = checked_realloc(
+            walk->dirs,
+            (walk->count + q->found_count + 1u) * sizeof(struct listing*));
+        memcpy(walk->dirs + walk->count, q->found,
+               q->found_count * sizeof(struct listing*));
+        walk->count += q->found_count;
+        free(q->found);
+        free(q->buffer);
+        free(q->tasks);
+        pthread_mutex_destroy(&q->lock);
+    }
+    free(w);
+    return walk;
+}
+
+/* El recorrido de root, haciéndolo si todavía no está */
+static const struct walk* walk_get(pathexp self, const char* root) {
+    for (GSList* node = self->walks; node != NULL; node = node->next) {
+        struct walk* walk = node->data;
+        if (strcmp(walk->root, root) == 0) {
+            return walk;
+        }
+    }
+    struct walk* walk = walk_tree(root, self->threads);
+    self->walks = g_slist_prepend(self->walks, walk);
+    return walk;
+}
+
+/********** Expansión **********/
+
+pathexp pathexp_new(void) {
+    pathexp self = checked_realloc(NULL, sizeof(struct pathexp_s));
+    self->listings = NULL;
+    self->walks = NULL;
+    self->threads = 0u;
+    return self;
+}
+
+pathexp pathexp_destroy(pathexp self) {
+    assert(self != NULL);
+
+    g_slist_free_full(self->listings, listing_free);
+    g_slist_free_full(self->walks, walk_free);
+    free(self);
+    return NULL;
+}
+
+void pathexp_set_threads(pathexp self, unsigned int threads) {
+    assert(self != NULL);
+
+    self->threads = threads;
+}
+
+void pathexp_free(char** matches, size_t count) {
+    for (size_t i = 0u; i < count; i++) {
+        free(matches[i]);
+    }
+    free(matches);
+}
+
+static void results_add(struct results* out, char* path) {
+    if (out->count == out->capacity) {
+        out->capacity = out->capacity > 0u ? 2u * out->capacity : 16u;
+        out->list = checked_realloc(out->list, out->capacity * sizeof(char*));
+    }
+    out->list[out->count] = path;
+    out->count++;
+}
+
+/* Copia el componente sin los escapes */
+static char* unescape(const char* component, size_t length) {
+    char* result = checked_realloc(NULL, length + 1u);
+    size_t j = 0u;
+    for (size_t i = 0u; i < length; i++) {
+        if (component[i] == '\\' && i + 1u < length) {
+            i++;
+        }
+        result[j] = component[i];
+        j++;
+    }
+    result[j] = '\0';
+    return result;
+}
+
+static bool is_directory(unsigned char type, const char* path) {
+    struct stat st;
+    if (type == DT_DIR) {
+        return true;
+    }
+    return (type == DT_UNKNOWN || type == DT_LNK) && stat(path, &st) == 0 &&
+           S_ISDIR(st.st_mode);
+}
+
+static void expand_component(pathexp self, const char* pattern,
+                             const char* prefix,
+                             const struct listing* listing,
+                             struct results* out);
+
+/* Un componente "**": prefix y todos sus subdirectorios (sin los ocultos),
+ * y en cada uno lo que sigue del patrón. Al final del patrón es todo lo que
+ * hay adentro.
+ */
+static void expand_globstar(pathexp self, const char* rest,
+                            const char* prefix, struct results* out) {
+    const struct walk* walk = walk_get(self, prefix);
+    struct stat st;
+    if (rest == NULL && prefix[0] != '\0' && lstat(prefix, &st) == 0) {
+        results_add(out, concat(prefix, "", 0u));
+    }
+    for (size_t d = 0u; d < walk->count; d++) {
+        const struct listing* listing = walk->dirs[d];
+        if (rest != NULL) {
+            expand_component(self, rest, listing->dir, listing, out);
+            continue;
+        }
+        for (size_t i = 0u; i < listing->count; i++) {
+            const char* name = listing->names + listing->offsets[i];
+            if (name[0] != '.') {
+                results_add(out, concat(listing->dir, name,
+                                        listing->offsets[i + 1u] -
+                                            listing->offsets[i] - 1u));
+            }
+        }
+    }
+}
+
+/* Busca name en el listado */
+static bool listing_contains(const struct listing* listing, const char* name) {
+    for (size_t i = 0u; i < listing->count; i++) {
+        if (strcmp(listing->names + listing->offsets[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Expande el componente que empieza en pattern (hasta el siguiente '/') y
+ * los que siguen, dentro del directorio prefix ("" es el actual). Si ya se
+ * tiene el listado de prefix (de un recorrido) se usa ese.
+ */
+static void expand_component(pathexp self, const char* pattern,
+                             const char* prefix,
+                             const struct listing* listing,
+                             struct results* out) {
+    const char* slash = strchr(pattern, '/');
+    size_t length = slash != NULL ? (size_t)(slash - pattern) : strlen(pattern);
+    char* component = concat("", pattern, length);
+
+    if (strcmp(component, "**") == 0) {
+        expand_globstar(self, slash != NULL ? slash + 1 : NULL, prefix, out);
+        free(component);
+        return;
+    }
+
+    if (!pathexp_has_magic(component)) {
+        char* literal = unescape(component, length);
+        char* path = concat(prefix, literal, strlen(literal));
+        if (slash == NULL) {
+            struct stat st;
+            if (listing != NULL && literal[0] != '\0'
+                    ? listing_contains(listing, literal)
+                    : lstat(path, &st) == 0) {
+                results_add(out, path);
+                path = NULL;
+            }
+        } else {
+            char* dir = concat(path, "/", 1u);
+            expand_component(self, slash + 1, dir, NULL, out);
+            free(dir);
+        }
+        free(path);
+        free(literal);
+        free(component);
+        return;
+    }
+
+    struct matcher m;
+    matcher_compile(&m, component, length);
+    if (listing == NULL) {
+        listing = listing_get(self, prefix[0] != '\0' ? prefix : ".");
+    }
+    for (size_t i = 0u; i < listing->count; i++) {
+        const char* name = listing->names + listing->offsets[i];
+        size_t name_length =
+            listing->offsets[i + 1u] - listing->offsets[i] - 1u;
+        if ((name[0] == '.' && !m.leading_dot) ||
+            !matcher_match(&m, name, name_length)) {
+            continue;
+        }
+        char* path = concat(prefix, name, name_length);
+        if (slash == NULL) {
+            results_add(out, path);
+        } else {
+            if (is_directory(listing->types[i], path)) {
+                char* dir = concat(path, "/", 1u);
+                expand_component(self, slash + 1, dir, NULL, out);
+                free(dir);
+            }
+            free(path);
+        }
+    }
+    matcher_free(&m);
+    free(component);
+}
+
+size_t pathexp_expand(pathexp self, const char* pattern, char*** matches) {
+    assert(self != NULL && pattern != NULL && matches != NULL);
+
+    struct results out = {NULL, 0u, 0u};
+    expand_component(self, pattern, "", NULL, &out);
+    pathexp_sort(out.list, out.count);
+    *matches = out.list;
+    return out.count;
+}
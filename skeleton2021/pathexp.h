@@ -0,0 +1,116 @@
+/* Expansión de nombres de archivo: *, ? y [...].
+ *
+ * Un patrón se separa en componentes con '/'. Los componentes sin
+ * caracteres especiales se usan tal cual, y los demás se compilan una vez
+ * (literales, ?, * y conjuntos [...] como tabla de 256 bits) y se comparan
+ * contra los nombres del directorio que corresponda, sin fnmatch.
+ *
+ * Los directorios se leen de una sola vez con getdents64 y el listado queda
+ * guardado en el pathexp: mientras se use el mismo pathexp (por ejemplo en
+ * toda una línea de comandos) varios patrones sobre el mismo directorio lo
+ * leen una sola vez.
+ *
+ * Un componente "**" es el directorio y todos sus subdirectorios, sin entrar
+ * en los ocultos ni seguir enlaces simbólicos (como globstar en bash): "**"
+ * al final es todo lo que hay adentro, y "**" seguido de un componente
+ * "*.c" son los .c de cualquier nivel. El árbol se recorre en paralelo: cada hilo tiene una
+ * cola de directorios pendientes y, cuando se le vacía, roba de las colas
+ * de los otros. Los subdirectorios se abren con openat relativo al padre
+ * ya abierto, y los tipos salen de getdents64 (solo se hace stat si el
+ * sistema de archivos no los da). El recorrido también queda guardado.
+ *
+ * Reglas, como en bash: '\c' es c literal; un nombre que empieza con '.'
+ * solo coincide si el patrón también empieza con '.', y "." y ".." nunca
+ * coinciden; [!...] y [^...] son la negación, y a-z es un rango. No hay
+ * clases ([:alpha:]). Los resultados se ordenan byte a byte (como con
+ * LC_COLLATE=C).
+ */
+
+#ifndef _PATHEXP_H_
+#define _PATHEXP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct pathexp_s* pathexp;
+
+/*
+ * Nuevo pathexp, sin ningún directorio leído.
+ * Ensures: result != NULL
+ */
+pathexp pathexp_new(void);
+
+/*
+ * Destruye `self' y los listados que guardaba.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+pathexp pathexp_destroy(pathexp self);
+
+/*
+ * Indica si `pattern' tiene algún caracter especial sin escapar.
+ * Requires: pattern != NULL
+ */
+bool pathexp_has_magic(const char* pattern);
+
+/*
+ * Cantidad de hilos para recorrer los "**" (0, lo inicial, es uno por CPU).
+ * Requires: self != NULL
+ */
+void pathexp_set_threads(pathexp self, unsigned int threads);
+
+/*
+ * Busca los archivos que coinciden con `pattern'.
+ *   matches: dónde se guarda el arreglo de rutas (memoria nueva, a liberar
+ *       con pathexp_free), ordenadas
+ * Returns: la cantidad de rutas (0 si no hay ninguna, y *matches == NULL)
+ * Requires: self != NULL && pattern != NULL && matches != NULL
+ */
+size_t pathexp_expand(pathexp self, const char* pattern, char*** matches);
+
+/*
+ * Libera las rutas de pathexp_expand.
+ */
+void pathexp_free(char** matches, size_t count);
+
+/*
+ * Indica si `string' entero coincide con `pattern' ('/' y '.' no tienen
+ * nada especial, como en los patrones de case).
+ * Requires: pattern != NULL && string != NULL
+ */
+bool pathexp_match(const char* pattern, const char* string);
+
+/* Un patrón compilado, para compararlo con muchas cadenas */
+typedef struct pathexp_pattern_s* pathexp_pattern;
+
+/*
+ * Compila `pattern', con las mismas reglas que pathexp_match.
+ * Requires: pattern != NULL
+ * Ensures: result != NULL
+ */
+pathexp_pattern pathexp_pattern_new(const char* pattern);
+
+/*
+ * Destruye `self'.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+pathexp_pattern pathexp_pattern_destroy(pathexp_pattern self);
+
+/*
+ * Indica si los `length' bytes de `string' (que no hace falta que terminen
+ * en '\0') coinciden enteros con el patrón.
+ * Requires: self != NULL && (string != NULL || length == 0)
+ */
+bool pathexp_pattern_match(const pathexp_pattern self, const char* string,
+                           size_t length);
+
+/*
+ * Ordena las cadenas con qsort según el orden de la locale (strcoll), como
+ * ordena bash los resultados de un patrón. En las locales "C" y "POSIX"
+ * compara byte a byte con strcmp.
+ * Requires: names != NULL || count == 0
+ */
+void pathexp_sort(char** names, size_t count);
+
+#endif
@@ -0,0 +1,507 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pathindex.h"
+
+/* Después de un cambio se espera un momento a que lleguen los demás (al
+ * instalar un paquete cambian muchos archivos seguidos)
+ */
+#define SETTLE_MS 50
+
+/* Cambios que pueden agregar o sacar un ejecutable de un directorio */
+#define WATCH_MASK                                                             \
+    (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB |        \
+     IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* Un comando del índice: su nombre y el directorio donde está */
+struct command {
+    const char* name;
+    uint32_t dir;
+};
+
+/* Un índice publicado. No cambia: cuando algo cambia se arma otro. */
+struct snapshot {
+    char* path_env;  // el PATH del que se armó
+    char** dirs;     // los directorios del PATH, en orden
+    size_t dir_count;
+    bool relative;   // el PATH tiene directorios relativos
+    struct command* commands; // ordenados por nombre, sin repetidos
+    size_t count;
+    char* names; // todos los nombres, uno atrás del otro
+};
+
+/* Un directorio del PATH, como lo ve el hilo del índice */
+struct directory {
+    char* path;
+    int wd; // -1 si no se puede mirar
+    bool dirty;
+    char** names; // ejecutables del directorio
+    size_t count;
+};
+
+static struct {
+    pthread_t thread;
+    bool running;
+    pid_t owner; // el proceso que arrancó el hilo (los demás son hijos)
+    int inotify_fd;
+    int wake_fd; // eventfd para avisarle al hilo que cambió algo de abajo
+    // Índice listo que el hilo principal todavía no tomó
+    _Atomic(struct snapshot*) published;
+    // Del hilo principal
+    struct snapshot* current;
+    // Lo siguiente lo protege lock
+    pthread_mutex_t lock;
+    char* wanted_path; // el PATH del que se quiere el índice
+    bool stop;
+} state = {.running = false,
+           .owner = -1,
+           .inotify_fd = -1,
+           .wake_fd = -1,
+           .published = NULL,
+           .current = NULL,
+           .lock = PTHREAD_MUTEX_INITIALIZER,
+           .wanted_path = NULL,
+           .stop = false};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static char* checked_strdup(const char* s) {
+    size_t length = strlen(s);
+    char* result = checked_realloc(NULL, length + 1u);
+    memcpy(result, s, length + 1u);
+    return result;
+}
+
+static const char* current_path_env(void) {
+    const char* path = getenv("PATH");
+    return path != NULL ? path : "";
+}
+
+/********** Índice publicado **********/
+
+static void snapshot_free(struct snapshot* snap) {
+    if (snap == NULL) {
+        return;
+    }
+    for (size_t i = 0u; i < snap->dir_count; i++) {
+        free(snap->dirs[i]);
+    }
+    free(snap->dirs);
+    free(snap->commands);
+    free(snap->names);
+    free(snap->path_env);
+    free(snap);
+}
+
+static int command_compare(const void* a, const void* b) {
+    const struct command* c1 = a;
+    const struct command* c2 = b;
+    int result = strcmp(c1->name, c2->name);
+    if (result == 0) {
+        // Con el mismo nombre, primero el del directorio que va antes
+        result = (c1->dir > c2->dir) - (c1->dir < c2->dir);
+    }
+    return result;
+}
+
+/* Arma un índice con los ejecutables de los directorios */
+static struct snapshot* snapshot_build(const char* path_env,
+                                       const struct directory* dirs,
+                                       size_t dir_count, bool relative) {
+    struct snapshot* snap = checked_realloc(NULL, sizeof(struct snapshot));
+    snap->path_env = checked_strdup(path_env);
+    snap->dirs = checked_realloc(NULL, (dir_count + 1u) * sizeof(char*));
+    snap->dir_count = dir_count;
+    snap->relative = relative;
+
+    size_t total = 0u;
+    size_t bytes = 0u;
+    for (size_t i = 0u; i < dir_count; i++) {
+        snap->dirs[i] = checked_strdup(dirs[i].path);
+        total += dirs[i].count;
+        for (size_t j = 0u; j < dirs[i].count; j++) {
+            bytes += strlen(dirs[i].names[j]) + 1u;
+        }
+    }
+
+    struct command* all =
+        checked_realloc(NULL, (total + 1u) * sizeof(struct command));
+    size_t n = 0u;
+    for (size_t i = 0u; i < dir_count; i++) {
+        for (size_t j = 0u; j < dirs[i].count; j++) {
+            all[n] = (struct command){dirs[i].names[j], (uint32_t)i};
+            n++;
+        }
+    }
+    qsort(all, total, sizeof(struct command), command_compare);
+
+    // Los nombres se copian al índice, sin los repetidos
+    snap->names = checked_realloc(NULL, bytes + 1u);
+    snap->commands = all;
+    snap->count = 0u;
+    char* next = snap->names;
+    for (size_t i = 0u; i < total; i++) {
+        if (i > 0u && strcmp(all[i].name, all[i - 1u].name) == 0) {
+            continue;
+        }
+        size_t length = strlen(all[i].name);
+        memcpy(next, all[i].name, length + 1u);
+        all[snap->count] = (struct command){next, all[i].dir};
+        snap->count++;
+        next += length + 1u;
+    }
+    return snap;
+}
+
+/* El índice que usa el hilo principal: toma el último publicado, y si
+ * cambió el PATH le pide al hilo uno nuevo. En un hijo después de fork
+ * solo se lee el que ya se estaba usando: el hilo no existe ahí, su lock
+ * pudo quedar tomado, y el eventfd es el del shell.
+ * Returns: NULL si no hay un índice del PATH actual
+ */
+static const struct snapshot* current(void) {
+    if (state.running && getpid() != state.owner) {
+        const struct snapshot* snap = state.current;
+        if (snap != NULL && strcmp(snap->path_env, current_path_env()) == 0) {
+            return snap;
+        }
+        return NULL;
+    }
+    struct snapshot* fresh = atomic_exchange(&state.published, NULL);
+    if (fresh != NULL) {
+        snapshot_free(state.current);
+        state.current = fresh;
+    }
+    if (!state.running) {
+        return NULL;
+    }
+    const char* path_env = current_path_env();
+    if (state.current != NULL && strcmp(state.current->path_env, path_env) == 0) {
+        return state.current;
+    }
+    pthread_mutex_lock(&state.lock);
+    if (strcmp(state.wanted_path, path_env) != 0) {
+        free(state.wanted_path);
+        state.wanted_path = checked_strdup(path_env);
+        uint64_t one = 1u;
+        if (write(state.wake_fd, &one, sizeof(one)) == -1) {
+            perror("mybash: PATH");
+        }
+    }
+    pthread_mutex_unlock(&state.lock);
+    return NULL;
+}
+
+/********** Hilo del índice **********/
+
+/* Lee los ejecutables de dir (archivos, o enlaces a archivos, con permiso
+ * de ejecución). Si no se puede leer queda vacío.
+ */
+static void directory_scan(struct directory* dir) {
+    for (size_t i = 0u; i < dir->count; i++) {
+        free(dir->names[i]);
+    }
+    dir->count = 0u;
+    dir->dirty = false;
+
+    DIR* d = opendir(dir->path);
+    if (d == NULL) {
+        return;
+    }
+    size_t capacity = 0u;
+    struct dirent* entry = NULL;
+    while ((entry = readdir(d)) != NULL) {
+        if (entry->d_name[0] == '.' || entry->d_type == DT_DIR) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(d), entry->d_name, &st, 0) != 0 ||
+            !S_ISREG(st.st_mode) || (st.st_mode & 0111) == 0) {
+            continue;
+        }
+        if (dir->count == capacity) {
+            capacity = capacity > 0u ? 2u * capacity : 64u;
+            dir->names =
+                checked_realloc(dir->names, capacity * sizeof(char*));
+        }
+        dir->names[dir->count] = checked_strdup(entry->d_name);
+        dir->count++;
+    }
+    closedir(d);
+}
+
+static void directories_free(struct directory* dirs, size_t count) {
+    for (size_t i = 0u; i < count; i++) {
+        if (dirs[i].wd != -1) {
+            inotify_rm_watch(state.inotify_fd, dirs[i].wd);
+        }
+        for (size_t j = 0u; j < dirs[i].count; j++) {
+            free(dirs[i].names[j]);
+        }
+        free(dirs[i].names);
+        free(dirs[i].path);
+    }
+    free(dirs);
+}
+
+/* Separa path_env en directorios, y empieza a mirar los absolutos */
+static struct directory* directories_new(const char* path_env, size_t* count,
+                                         bool* relative) {
+    struct directory* dirs = NULL;
+    *count = 0u;
+    *relative = false;
+    const char* start = path_env;
+    while (true) {
+        const char* end = strchrnul(start, ':');
+        if (end == start || start[0] != '/') {
+            // Vacío es el directorio actual, igual que "."
+            *relative = true;
+        } else {
+            dirs = checked_realloc(dirs, (*count + 1u) * sizeof(*dirs));
+            struct directory* dir = &dirs[*count];
+            dir->path = strndup(start, (size_t)(end - start));
+            if (dir->path == NULL) {
+                perror("Error fatal: malloc");
+                exit(EXIT_FAILURE);
+            }
+            dir->wd = inotify_add_watch(state.inotify_fd, dir->path,
+                                        WATCH_MASK | IN_ONLYDIR);
+            dir->dirty = true;
+            dir->names = NULL;
+            dir->count = 0u;
+            (*count)++;
+        }
+        if (*end == '\0') {
+            break;
+        }
+        start = end + 1;
+    }
+    return dirs;
+}
+
+/* Lee los eventos de inotify pendientes y marca los directorios cambiados */
+static void read_events(struct directory* dirs, size_t count) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length = 0;
+    while ((length = read(state.inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + length;) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            for (size_t i = 0u; i < count; i++) {
+                // Si se perdieron eventos, se vuelve a leer todo
+                if (dirs[i].wd == event->wd || (event->mask & IN_Q_OVERFLOW)) {
+                    dirs[i].dirty = true;
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+}
+
+static void publish(struct snapshot* snap) {
+    snapshot_free(atomic_exchange(&state.published, snap));
+}
+
+static void* pathindex_worker(void* arg) {
+    char* path_env = NULL;
+    struct directory* dirs = NULL;
+    size_t count = 0u;
+    bool relative = false;
+
+    while (true) {
+        pthread_mutex_lock(&state.lock);
+        bool stop = state.stop;
+        bool changed = path_env == NULL || strcmp(path_env, state.wanted_path) != 0;
+        if (changed && !stop) {
+            free(path_env);
+            path_env = checked_strdup(state.wanted_path);
+        }
+        pthread_mutex_unlock(&state.lock);
+        if (stop) {
+            break;
+        }
+        if (changed) {
+            directories_free(dirs, count);
+            dirs = directories_new(path_env, &count, &relative);
+        }
+
+        // Se vuelven a leer los directorios que cambiaron
+        bool dirty = false;
+        for (size_t i = 0u; i < count; i++) {
+            if (dirs[i].dirty) {
+                if (dirs[i].wd == -1) {
+                    // Puede que el directorio exista ahora
+                    dirs[i].wd = inotify_add_watch(state.inotify_fd,
+                                                   dirs[i].path,
+                                                   WATCH_MASK | IN_ONLYDIR);
+                }
+                directory_scan(&dirs[i]);
+                dirty = true;
+            }
+        }
+        if (dirty || changed) {
+            publish(snapshot_build(path_env, dirs, count, relative));
+        }
+
+        // Espera a que cambie algún directorio o a que lo llamen
+        struct pollfd fds[2] = {{state.inotify_fd, POLLIN, 0},
+                                {state.wake_fd, POLLIN, 0}};
+        if (poll(fds, 2u, -1) == -1 && errno != EINTR) {
+            perror("mybash: PATH");
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            read_events(dirs, count);
+            poll(&fds[1], 1u, SETTLE_MS);
+            read_events(dirs, count);
+            for (size_t i = 0u; i < count; i++) {
+                if (dirs[i].dirty && dirs[i].wd != -1) {
+                    // Si se borró el directorio ya no se mira
+                    struct stat st;
+                    if (stat(dirs[i].path, &st) != 0) {
+                        inotify_rm_watch(state.inotify_fd, dirs[i].wd);
+                        dirs[i].wd = -1;
+                    }
+                }
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t value = 0u;
+            if (read(state.wake_fd, &value, sizeof(value)) == -1) {
+                perror("mybash: PATH");
+            }
+        }
+    }
+    directories_free(dirs, count);
+    free(path_env);
+    return NULL;
+}
+
+/********** Interfaz **********/
+
+void pathindex_start(void) {
+    if (state.running) {
+        return;
+    }
+    state.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    state.wake_fd = eventfd(0u, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (state.inotify_fd == -1 || state.wake_fd == -1) {
+        // Sin índice los comandos se buscan como siempre
+        perror("mybash: PATH");
+        pathindex_stop();
+        return;
+    }
+    state.stop = false;
+    state.wanted_path = checked_strdup(current_path_env());
+    int error = pthread_create(&state.thread, NULL, pathindex_worker, NULL);
+    if (error != 0) {
+        errno = error;
+        perror("mybash: PATH");
+        pathindex_stop();
+        return;
+    }
+    state.owner = getpid();
+    state.running = true;
+}
+
+void pathindex_stop(void) {
+    if (state.running) {
+        pthread_mutex_lock(&state.lock);
+        state.stop = true;
+        pthread_mutex_unlock(&state.lock);
+        uint64_t one = 1u;
+        if (write(state.wake_fd, &one, sizeof(one)) == -1) {
+            perror("mybash: PATH");
+        }
+        pthread_join(state.thread, NULL);
+        state.running = false;
+    }
+    if (state.inotify_fd != -1) {
+        close(state.inotify_fd);
+        state.inotify_fd = -1;
+    }
+    if (state.wake_fd != -1) {
+        close(state.wake_fd);
+        state.wake_fd = -1;
+    }
+    snapshot_free(atomic_exchange(&state.published, NULL));
+    snapshot_free(state.current);
+    state.current = NULL;
+    free(state.wanted_path);
+    state.wanted_path = NULL;
+}
+
+bool pathindex_ready(void) {
+    return current() != NULL;
+}
+
+/* Posición del primer comando >= prefix */
+static size_t lower_bound(const struct snapshot* snap, const char* prefix) {
+    size_t low = 0u;
+    size_t high = snap->count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2u;
+        if (strcmp(snap->commands[middle].name, prefix) < 0) {
+            low = middle + 1u;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+bool pathindex_resolve(const char* name, char* path, size_t size) {
+    assert(name != NULL && path != NULL && size > 0u);
+
+    const struct snapshot* snap = current();
+    if (snap == NULL || snap->relative || strchr(name, '/') != NULL) {
+        return false;
+    }
+    size_t i = lower_bound(snap, name);
+    if (i == snap->count || strcmp(snap->commands[i].name, name) != 0) {
+        return false;
+    }
+    int length = snprintf(path, size, "%s/%s",
+                          snap->dirs[snap->commands[i].dir], name);
+    return length >= 0 && (size_t)length < size;
+}
+
+size_t pathindex_complete(const char* prefix, const char** names, size_t max) {
+    assert(prefix != NULL && (names != NULL || max == 0u));
+
+    const struct snapshot* snap = current();
+    if (snap == NULL) {
+        return 0u;
+    }
+    size_t length = strlen(prefix);
+    size_t found = 0u;
+    for (size_t i = lower_bound(snap, prefix);
+         i < snap->count && strncmp(snap->commands[i].name, prefix, length) == 0;
+         i++) {
+        if (found < max) {
+            names[found] = snap->commands[i].name;
+        }
+        found++;
+    }
+    return found;
+}
@@ -0,0 +1,63 @@
+/* Índice de los ejecutables del PATH.
+ *
+ * Buscar un comando en cada directorio del PATH cada vez (al ejecutarlo, o
+ * al completarlo con Tab) es lento si alguno de los directorios está en un
+ * disco de red. El índice guarda los nombres de todos los ejecutables del
+ * PATH, ordenados, con el directorio de cada uno (el primero del PATH, como
+ * lo encontraría execvp).
+ *
+ * El índice lo arma y lo mantiene un hilo aparte: arma el índice entero al
+ * arrancar, y después mira los directorios con inotify y vuelve a leer solo
+ * los que cambian. Cada vez que termina publica un índice nuevo, que el hilo
+ * principal empieza a usar en la siguiente consulta; así las consultas nunca
+ * esperan a que se lea un directorio. Si cambia la variable PATH se vuelve a
+ * armar todo.
+ *
+ * Las consultas se hacen desde el hilo principal, o desde un hijo después
+ * de fork: en el hijo solo se lee el índice que tenía el shell, sin locks
+ * ni avisos al hilo. Mientras no hay un índice del PATH actual, las
+ * consultas no encuentran nada.
+ */
+
+#ifndef _PATHINDEX_H_
+#define _PATHINDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Arranca el hilo que arma y mantiene el índice, si no está corriendo.
+ */
+void pathindex_start(void);
+
+/*
+ * Para el hilo y libera el índice.
+ */
+void pathindex_stop(void);
+
+/*
+ * Indica si ya hay un índice del PATH actual.
+ */
+bool pathindex_ready(void);
+
+/*
+ * Busca el comando `name' en el índice, y guarda en `path' la ruta con la
+ * que se ejecutaría. Si el PATH tiene directorios relativos (o vacíos) no
+ * se resuelve nada, porque dependen del directorio actual.
+ * Returns: false si no se encontró, o si el índice no está listo (en ese
+ *     caso hay que buscarlo como siempre)
+ * Requires: name != NULL && path != NULL && size > 0
+ */
+bool pathindex_resolve(const char* name, char* path, size_t size);
+
+/*
+ * Busca los comandos que empiezan con `prefix', en orden alfabético, y
+ * guarda a lo sumo `max' de ellos en `names'. Las cadenas son del índice, y
+ * valen hasta la siguiente llamada a alguna función de este módulo.
+ * Returns: la cantidad de comandos que empiezan con prefix (puede ser más
+ *     que max)
+ * Requires: prefix != NULL && (names != NULL || max == 0)
+ */
+size_t pathindex_complete(const char* prefix, const char** names, size_t max);
+
+#endif
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "prefetch.h"
+
+/* Comandos ya precargados que se recuerdan (por el hash del nombre y el
+ * PATH), para no volver a buscarlos
+ */
+#define RECENT 256u
+
+static struct {
+    pthread_t thread;
+    bool running;
+    // Del hilo
+    uint64_t recent[RECENT];
+    // Lo siguiente lo protege lock
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup; // hay pedidos, o hay que parar
+    // Cada pedido es el nombre y el PATH, uno atrás del otro
+    char* queue[PREFETCH_QUEUE];
+    unsigned int first;
+    unsigned int length;
+    bool stop;
+} state = {.running = false,
+           .lock = PTHREAD_MUTEX_INITIALIZER,
+           .wakeup = PTHREAD_COND_INITIALIZER,
+           .first = 0u,
+           .length = 0u,
+           .stop = false};
+
+/* FNV-1a de 64 bits de las dos cadenas del pedido. Nunca da 0, que en
+ * recent es un lugar libre.
+ */
+static uint64_t request_hash(const char* name, const char* path_env) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* s = name; *s != '\0'; s++) {
+        hash = (hash ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    hash = (hash ^ 0xffu) * 1099511628211ull;
+    for (const char* s = path_env; *s != '\0'; s++) {
+        hash = (hash ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    return hash != 0u ? hash : 1u;
+}
+
+/* Pide al kernel que lea el ejecutable `path'.
+ * Returns: false si no es un ejecutable
+ */
+static bool prefetch_file(const char* path) {
+    if (access(path, X_OK) == -1) {
+        return false;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    bool result = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (result) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+    close(fd);
+    return result;
+}
+
+/* Busca `name' en los directorios de path_env, en orden, y precarga el
+ * primero que encuentra (un directorio vacío es el actual, como en execvp)
+ */
+static void prefetch_in_path(const char* name, const char* path_env) {
+    if (strchr(name, '/') != NULL) {
+        prefetch_file(name);
+        return;
+    }
+    char path[4096];
+    const char* dir = path_env;
+    bool found = false;
+    while (!found) {
+        const char* end = strchr(dir, ':');
+        size_t length = end != NULL ? (size_t)(end - dir) : strlen(dir);
+        int n = length > 0u ? snprintf(path, sizeof(path), "%.*s/%s",
+                                       (int)length, dir, name)
+                            : snprintf(path, sizeof(path), "%s", name);
+        found = n > 0 && (size_t)n < sizeof(path) && prefetch_file(path);
+        if (end == NULL) {
+            break;
+        }
+        dir = end + 1;
+    }
+}
+
+static void* prefetch_worker(void* data) {
+    pthread_mutex_lock(&state.lock);
+    while (!state.stop) {
+        if (state.length == 0u) {
+            pthread_cond_wait(&state.wakeup, &state.lock);
+            continue;
+        }
+        char* request = state.queue[state.first];
+        state.first = (state.first + 1u) % PREFETCH_QUEUE;
+        state.length--;
+        pthread_mutex_unlock(&state.lock);
+
+        const char* path_env = request + strlen(request) + 1u;
+        uint64_t hash = request_hash(request, path_env);
+        uint64_t* slot = &state.recent[hash % RECENT];
+        if (*slot != hash) {
+            *slot = hash;
+            prefetch_in_path(request, path_env);
+        }
+        free(request);
+        pthread_mutex_lock(&state.lock);
+    }
+    pthread_mutex_unlock(&state.lock);
+    return data;
+}
+
+void prefetch_start(void) {
+    if (state.running) {
+        return;
+    }
+    memset(state.recent, 0, sizeof(state.recent));
+    state.stop = false;
+    state.running =
+        pthread_create(&state.thread, NULL, prefetch_worker, NULL) == 0;
+}
+
+void prefetch_stop(void) {
+    if (!state.running) {
+        return;
+    }
+    pthread_mutex_lock(&state.lock);
+    state.stop = true;
+    pthread_cond_signal(&state.wakeup);
+    pthread_mutex_unlock(&state.lock);
+    pthread_join(state.thread, NULL);
+    for (unsigned int i = 0u; i < state.length; i++) {
+        free(state.queue[(state.first + i) % PREFETCH_QUEUE]);
+    }
+    state.first = 0u;
+    state.length = 0u;
+    state.running = false;
+}
+
+void prefetch_command(const char* name) {
+    assert(name != NULL);
+
+    if (!state.running || name[0] == '\0') {
+        return;
+    }
+    const char* path_env = getenv("PATH");
+    if (path_env == NULL) {
+        // El PATH que usa execvp si no hay ninguno
+        path_env = "/bin:/usr/bin";
+    }
+    size_t name_length = strlen(name) + 1u;
+    size_t path_length = strlen(path_env) + 1u;
+    char* request = malloc(name_length + path_length);
+    if (request == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(request, name, name_length);
+    memcpy(request + name_length, path_env, path_length);
+
+    pthread_mutex_lock(&state.lock);
+    if (state.length < PREFETCH_QUEUE) {
+        state.queue[(state.first + state.length) % PREFETCH_QUEUE] = request;
+        state.length++;
+        request = NULL;
+        pthread_cond_signal(&state.wakeup);
+    }
+    pthread_mutex_unlock(&state.lock);
+    // Si el hilo está atrasado el pedido se descarta
+    free(request);
+}
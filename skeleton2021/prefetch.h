@@ -0,0 +1,39 @@
+/* Precarga de los ejecutables de los próximos comandos.
+ *
+ * En un script, mientras corre un pipeline ya se sabe qué comandos vienen
+ * después. Un hilo aparte busca cada uno en el PATH (como lo haría execvp,
+ * y así quedan en memoria los directorios que recorre) y le pide al kernel
+ * que empiece a leer el ejecutable con posix_fadvise(POSIX_FADV_WILLNEED).
+ * Con el disco frío, la lectura se superpone con el pipeline anterior en
+ * vez de frenar el exec.
+ *
+ * Es solo una sugerencia: si el hilo se atrasa, los pedidos se descartan,
+ * y si el comando no se encuentra no pasa nada. Los comandos que se
+ * precargaron hace poco (con el mismo PATH) no se vuelven a buscar.
+ */
+
+#ifndef _PREFETCH_H_
+#define _PREFETCH_H_
+
+/* Cantidad máxima de pedidos esperando al hilo */
+#define PREFETCH_QUEUE 64u
+
+/*
+ * Arranca el hilo, si no está corriendo.
+ */
+void prefetch_start(void);
+
+/*
+ * Para el hilo, descartando los pedidos que falten.
+ */
+void prefetch_stop(void);
+
+/*
+ * Pide precargar el ejecutable del comando `name', buscándolo en el PATH
+ * actual si no tiene '/'. No espera a que se haga; sin el hilo no hace
+ * nada. Se llama desde el hilo principal (lee el PATH con getenv).
+ * Requires: name != NULL
+ */
+void prefetch_command(const char* name);
+
+#endif
@@ -1,36 +1,442 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
 #include <pwd.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "prompt.h"
+#include "segments.h"
+
+/* Cuánto se espera a los segmentos en segundo plano antes de mostrar el
+   prompt con los valores viejos */
+#define ASYNC_WAIT_MS 10u
 
 /* Para imprimir con color se usan códigos ANSI de la forma
-   "\033[38;2;rojo;verde;azulm"
+   "\033[38;2;rojo;verde;azulm", que en el formato se escriben "\e[...m".
+   Cuando se pone un color, lo que se sigue imprimiendo, se imprime con ese
+   color, por ende, para volver al color por defecto hay que poner "\e[0m".
 */
 
-#define ANSI_NOCOLOR "\033[0m" // Esto vuelve al color por defecto
+/* Clases de segmentos del formato compilado */
+typedef enum {
+    SEGMENT_TEXT,     // texto literal
+    SEGMENT_USER,     // \u
+    SEGMENT_HOST,     // \h
+    SEGMENT_FQDN,     // \H
+    SEGMENT_CWD,      // \w
+    SEGMENT_CWD_BASE, // \W
+    SEGMENT_SIGN,     // \$
+    SEGMENT_VCS,      // \g (segments.h)
+    SEGMENT_JOBS,     // \j (segments.h)
+    SEGMENT_DURATION  // \L (segments.h)
+} segment_kind;
+
+/* Los segmentos de texto son un pedazo de prompt.literals */
+struct segment {
+    segment_kind kind;
+    size_t start;
+    size_t length;
+};
+
+/* Un valor calculado una vez (o de nuevo cuando se invalida) */
+struct cached {
+    char* text;
+    size_t length;
+    bool valid;
+};
+
+/* El prompt se puede volver a dibujar desde el hilo de segments.h, así que
+ * el armado y la escritura van con lock.
+ */
+static struct {
+    pthread_mutex_t lock;
+    bool compiled;
+    bool async;  // hay segmentos de segments.h
+    bool active; // el prompt está en pantalla esperando la entrada
+    struct segment* segments;
+    unsigned int n_segments;
+    char* literals; // el texto de todos los segmentos literales, seguido
+
+    struct cached user;
+    struct cached host;
+    struct cached cwd;
+    char sign;
+
+    char* output; // buffer donde se arma el prompt
+    size_t output_capacity;
+
+    void (*hook)(const char* text, size_t length); // ver prompt_set_hook
+} prompt = {PTHREAD_MUTEX_INITIALIZER, false, false, false, NULL, 0u, NULL, {NULL, 0u, false}, {NULL, 0u, false},
+            {NULL, 0u, false}, '$', NULL, 0u, NULL};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* Guarda text en c, que se queda con la memoria
+ * Requires: c != NULL && text != NULL
+ */
+static void cached_set(struct cached* c, char* text) {
+    assert(c != NULL && text != NULL);
+
+    free(c->text);
+    c->text = text;
+    c->length = strlen(text);
+    c->valid = true;
+}
+
+static char* checked_strdup(const char* s) {
+    char* result = strdup(s);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* Agrega un segmento a la lista; los literales seguidos se juntan en uno */
+static void add_segment(segment_kind kind, size_t start, size_t length) {
+    struct segment* last = prompt.n_segments > 0u
+                               ? &prompt.segments[prompt.n_segments - 1u]
+                               : NULL;
+    if (kind == SEGMENT_TEXT && last != NULL && last->kind == SEGMENT_TEXT &&
+        last->start + last->length == start) {
+        last->length += length;
+        return;
+    }
+    prompt.segments = checked_realloc(
+        prompt.segments, (prompt.n_segments + 1u) * sizeof(struct segment));
+    prompt.segments[prompt.n_segments] =
+        (struct segment){kind, start, length};
+    prompt.n_segments++;
+}
+
+void prompt_init(const char* format) {
+    if (format == NULL) {
+        format = PROMPT_DEFAULT_FORMAT;
+    }
+    prompt_destroy();
+
+    // Los literales nunca son más largos que el formato
+    prompt.literals = checked_realloc(NULL, strlen(format) + 1u);
+    size_t n_literals = 0u;
+    const char* pos = format;
+    while (*pos != '\0') {
+        segment_kind kind = SEGMENT_TEXT;
+        char literal = *pos;
+        bool skip = false;
+        if (pos[0] == '\\' && pos[1] != '\0') {
+            pos++;
+            switch (*pos) {
+            case 'u':
+                kind = SEGMENT_USER;
+                break;
+            case 'h':
+                kind = SEGMENT_HOST;
+                break;
+            case 'H':
+                kind = SEGMENT_FQDN;
+                break;
+            case 'w':
+                kind = SEGMENT_CWD;
+                break;
+            case 'W':
+                kind = SEGMENT_CWD_BASE;
+                break;
+            case '$':
+                kind = SEGMENT_SIGN;
+                break;
+            case 'g':
+                kind = SEGMENT_VCS;
+                break;
+            case 'j':
+                kind = SEGMENT_JOBS;
+                break;
+            case 'L':
+                kind = SEGMENT_DURATION;
+                break;
+            case 'e':
+                literal = '\033';
+                break;
+            case 'n':
+                literal = '\n';
+                break;
+            case '\\':
+                literal = '\\';
+                break;
+            case '[':
+            case ']':
+                skip = true;
+                break;
+            default:
+                // Escape desconocido: se deja la barra y se vuelve a mirar
+                // el caracter como literal
+                pos--;
+            }
+        }
+        pos++;
+        if (skip) {
+            continue;
+        }
+        if (kind == SEGMENT_TEXT) {
+            prompt.literals[n_literals] = literal;
+            add_segment(kind, n_literals, 1u);
+            n_literals++;
+        } else {
+            add_segment(kind, 0u, 0u);
+            prompt.async = prompt.async || kind >= SEGMENT_VCS;
+        }
+    }
+    prompt.literals[n_literals] = '\0';
+    prompt.sign = geteuid() == 0 ? '#' : '$';
+    prompt.compiled = true;
+
+    if (prompt.async) {
+        segments_set_update_callback(prompt_redraw);
+        segments_start();
+    }
+}
+
+void prompt_destroy(void) {
+    if (prompt.async) {
+        segments_stop();
+        segments_set_update_callback(NULL);
+        prompt.async = false;
+    }
+    free(prompt.segments);
+    prompt.segments = NULL;
+    prompt.n_segments = 0u;
+    free(prompt.literals);
+    prompt.literals = NULL;
+    free(prompt.output);
+    prompt.output = NULL;
+    prompt.output_capacity = 0u;
+    free(prompt.user.text);
+    free(prompt.host.text);
+    free(prompt.cwd.text);
+    prompt.user = prompt.host = prompt.cwd = (struct cached){NULL, 0u, false};
+    prompt.compiled = false;
+}
+
+void prompt_cwd_changed(void) {
+    pthread_mutex_lock(&prompt.lock);
+    prompt.cwd.valid = false;
+    pthread_mutex_unlock(&prompt.lock);
+}
+
+/* Valores de los segmentos, que se calculan la primera vez que hacen falta.
+   El usuario se busca por NSS (getpwuid), que puede ser muy lento, así que
+   es importante hacerlo una sola vez. */
 
-#define ANSI_GREEN "\033[38;2;0;255;0m"
-#define ANSI_BLUE "\033[38;2;14;112;255m"
+static const struct cached* get_user(void) {
+    if (!prompt.user.valid) {
+        struct passwd* password = getpwuid(geteuid());
+        if (password != NULL) {
+            cached_set(&prompt.user, checked_strdup(password->pw_name));
+        } else {
+            char uid[32];
+            snprintf(uid, sizeof(uid), "%u", (unsigned int)geteuid());
+            cached_set(&prompt.user, checked_strdup(uid));
+        }
+    }
+    return &prompt.user;
+}
+
+static const struct cached* get_host(void) {
+    if (!prompt.host.valid) {
+        char hostname[256];
+        hostname[255] = '\0'; // El último caracter es NULL
+        if (gethostname(hostname, 255) != 0) {
+            hostname[0] = '\0';
+        }
+        cached_set(&prompt.host, checked_strdup(hostname));
+    }
+    return &prompt.host;
+}
+
+static const struct cached* get_cwd(void) {
+    if (!prompt.cwd.valid) {
+        // Con NULL getcwd pide la memoria necesaria
+        char* cwd = getcwd(NULL, 0u);
+        cached_set(&prompt.cwd, cwd != NULL ? cwd : checked_strdup("?"));
+    }
+    return &prompt.cwd;
+}
+
+/* Agrega [text, text + length) al final del prompt que se está armando */
+static void append(size_t* used, const char* text, size_t length) {
+    if (*used + length + 1u > prompt.output_capacity) {
+        size_t capacity = prompt.output_capacity > 0u
+                              ? prompt.output_capacity
+                              : 128u;
+        while (*used + length + 1u > capacity) {
+            capacity *= 2u;
+        }
+        prompt.output = checked_realloc(prompt.output, capacity);
+        prompt.output_capacity = capacity;
+    }
+    memcpy(prompt.output + *used, text, length);
+    *used += length;
+}
+
+/* Arma el prompt en prompt.output, empezando con prefix */
+static const char* render(const char* prefix, size_t* length) {
+    if (!prompt.compiled) {
+        prompt_init(NULL);
+    }
+
+    size_t used = 0u;
+    append(&used, prefix, strlen(prefix));
+    for (unsigned int i = 0u; i < prompt.n_segments; i++) {
+        const struct segment* seg = &prompt.segments[i];
+        const struct cached* value = NULL;
+        char async_value[128];
+        const char* text = NULL;
+        size_t text_length = 0u;
+        switch (seg->kind) {
+        case SEGMENT_TEXT:
+            text = prompt.literals + seg->start;
+            text_length = seg->length;
+            break;
+        case SEGMENT_USER:
+            value = get_user();
+            break;
+        case SEGMENT_HOST:
+            value = get_host();
+            text = value->text;
+            text_length = strcspn(text, ".");
+            value = NULL;
+            break;
+        case SEGMENT_FQDN:
+            value = get_host();
+            break;
+        case SEGMENT_CWD:
+            value = get_cwd();
+            break;
+        case SEGMENT_CWD_BASE:
+            value = get_cwd();
+            text = strrchr(value->text, '/');
+            // En "/" se muestra "/"
+            text = (text != NULL && text[1] != '\0') ? text + 1 : value->text;
+            text_length = strlen(text);
+            value = NULL;
+            break;
+        case SEGMENT_SIGN:
+            text = &prompt.sign;
+            text_length = 1u;
+            break;
+        case SEGMENT_VCS:
+        case SEGMENT_JOBS:
+        case SEGMENT_DURATION:
+            text = async_value;
+            text_length = segments_get(
+                (segments_kind)(SEGMENTS_VCS + (seg->kind - SEGMENT_VCS)),
+                async_value, sizeof(async_value));
+            break;
+        }
+        if (value != NULL) {
+            text = value->text;
+            text_length = value->length;
+        }
+        append(&used, text, text_length);
+    }
+    prompt.output[used] = '\0';
+
+    if (length != NULL) {
+        *length = used;
+    }
+    assert(prompt.output != NULL);
+    return prompt.output;
+}
+
+const char* prompt_render(size_t* length) {
+    return render("", length);
+}
+
+/* Escribe todo text por la salida estándar */
+static void write_all(const char* text, size_t length) {
+    while (length > 0u) {
+        ssize_t written = write(STDOUT_FILENO, text, length);
+        if (written < 0) {
+            if (errno != EINTR) {
+                return;
+            }
+        } else {
+            text += written;
+            length -= (size_t)written;
+        }
+    }
+}
 
 void show_prompt(void) {
-    char hostname[256];
-    hostname[255] = '\0'; // El último caracter es NULL
-    gethostname(hostname, 256);
-
-    unsigned int user_id = geteuid();
-    struct passwd* password =
-        getpwuid(user_id); // struct passwd *getpwnam(const char *name);
-
-    char workdir[2556];
-    workdir[2555] = '\0';
-    getcwd(workdir, 2556);
-
-    printf(ANSI_GREEN "%s@%s" ANSI_NOCOLOR "/mybash>" ANSI_BLUE
-                      "%s" ANSI_NOCOLOR "$ ",
-           password->pw_name, hostname, workdir);
-    /* Cuando se pone un color, lo que se sigue imprimiendo, se imprime con ese color,
-       por ende, para usar el color por defecto hay que usar ANSI_NOCOLOR */
+    if (!prompt.compiled) {
+        prompt_init(NULL);
+    }
+    // Se les da un momento a los segmentos en segundo plano; si no llegan,
+    // se muestran los valores viejos y se redibuja cuando lleguen
+    if (prompt.async) {
+        segments_refresh(ASYNC_WAIT_MS);
+    }
+
+    // Lo que haya quedado en el buffer de stdout va antes del prompt
+    fflush(stdout);
+    pthread_mutex_lock(&prompt.lock);
+    size_t length = 0u;
+    const char* text = render("", &length);
+    if (prompt.hook != NULL) {
+        prompt.hook(text, length);
+    } else {
+        write_all(text, length);
+    }
+    prompt.active = true;
+    pthread_mutex_unlock(&prompt.lock);
+}
+
+void show_continuation_prompt(void) {
     fflush(stdout);
+    pthread_mutex_lock(&prompt.lock);
+    size_t length = strlen(PROMPT_CONTINUATION);
+    if (prompt.hook != NULL) {
+        prompt.hook(PROMPT_CONTINUATION, length);
+    } else {
+        write_all(PROMPT_CONTINUATION, length);
+    }
+    pthread_mutex_unlock(&prompt.lock);
+}
+
+void prompt_set_hook(void (*hook)(const char* text, size_t length)) {
+    pthread_mutex_lock(&prompt.lock);
+    prompt.hook = hook;
+    pthread_mutex_unlock(&prompt.lock);
+}
+
+void prompt_input_done(void) {
+    pthread_mutex_lock(&prompt.lock);
+    prompt.active = false;
+    pthread_mutex_unlock(&prompt.lock);
+}
+
+void prompt_redraw(void) {
+    pthread_mutex_lock(&prompt.lock);
+    if (prompt.active && prompt.hook != NULL) {
+        size_t length = 0u;
+        const char* text = render("", &length);
+        prompt.hook(text, length);
+    } else if (prompt.active) {
+        size_t length = 0u;
+        // Vuelve al comienzo de la línea y la borra antes de escribir
+        const char* text = render("\r\033[K", &length);
+        write_all(text, length);
+    }
+    pthread_mutex_unlock(&prompt.lock);
 }
@@ -1,6 +1,95 @@
+/* Prompt del modo interactivo.
+ *
+ * El formato es como el PS1 de bash: texto literal con secuencias de escape
+ *   \u  usuario efectivo        \h  nombre del host hasta el primer '.'
+ *   \H  nombre del host         \w  directorio actual
+ *   \W  último componente de \w \$  '#' si el usuario es root, si no '$'
+ *   \g  rama de git, con '*'    \j  cantidad de pipelines en background
+ *       si hay cambios          \L  duración del último comando
+ *   \e  ESC (para los colores)  \n  salto de línea
+ *   \\  una barra               \[ \]  se ignoran (como en bash marcan lo
+ *                                       que no ocupa lugar en pantalla)
+ * Cualquier otra barra se imprime tal cual.
+ *
+ * El formato se compila una sola vez en una lista de segmentos. El usuario y
+ * el host se buscan una sola vez, y el directorio actual solo se vuelve a
+ * calcular después de prompt_cwd_changed.
+ *
+ * \g, \j y \L se calculan en segundo plano (ver segments.h): si el formato
+ * los usa, el prompt sale con el último valor conocido y se vuelve a dibujar
+ * cuando llega uno nuevo, mientras se esté esperando la entrada (entre
+ * show_prompt y prompt_input_done).
+ */
+
 #ifndef _PROMPT_H_
 #define _PROMPT_H_
 
+#include <stddef.h>
+
+/* Prompt de las líneas que continúan un comando (el PS2 de bash) */
+#define PROMPT_CONTINUATION "> "
+
+/* Formato que se usa si no se pide otro */
+#define PROMPT_DEFAULT_FORMAT                                                  \
+    "\\[\\e[38;2;0;255;0m\\]\\u@\\H\\[\\e[0m\\]/mybash>"                       \
+    "\\[\\e[38;2;14;112;255m\\]\\w\\[\\e[0m\\]$ "
+
+/*
+ * Compila `format' y lo deja como formato del prompt. Con NULL se usa
+ * PROMPT_DEFAULT_FORMAT. Si ya había un formato se reemplaza.
+ */
+void prompt_init(const char* format);
+
+/*
+ * Libera el formato compilado y los valores guardados.
+ */
+void prompt_destroy(void);
+
+/*
+ * Avisa que cambió el directorio actual, para que el próximo prompt lo vuelva
+ * a calcular.
+ */
+void prompt_cwd_changed(void);
+
+/*
+ * Arma el prompt en un buffer interno del módulo, que vale hasta la próxima
+ * llamada. Si no se llamó a prompt_init se usa el formato por defecto. No se
+ * puede usar a la vez que show_prompt o prompt_redraw.
+ *   length: si no es NULL, se guarda el largo del prompt.
+ * Ensures: result != NULL
+ */
+const char* prompt_render(size_t* length);
+
+/*
+ * Muestra el prompt por la salida estándar, con una sola escritura.
+ */
 void show_prompt(void);
 
+/*
+ * Muestra el prompt de las líneas que continúan un comando que quedó
+ * abierto (PROMPT_CONTINUATION), como show_prompt pero sin formato: no se
+ * vuelve a dibujar.
+ */
+void show_continuation_prompt(void);
+
+/*
+ * Hace que show_prompt y prompt_redraw, en lugar de escribir el prompt, se
+ * lo pasen a `hook' (por ejemplo un editor de línea, que tiene que dibujar
+ * también lo que se está escribiendo). El texto vale solo durante la llamada.
+ * Con NULL se vuelve a escribir directamente.
+ */
+void prompt_set_hook(void (*hook)(const char* text, size_t length));
+
+/*
+ * Avisa que ya se leyó la línea, así que el prompt ya no se puede volver a
+ * dibujar.
+ */
+void prompt_input_done(void);
+
+/*
+ * Vuelve a dibujar el prompt al comienzo de la línea, si todavía se está
+ * esperando la entrada. Se puede llamar desde cualquier hilo.
+ */
+void prompt_redraw(void);
+
 #endif
@@ -0,0 +1,234 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+#include "scan.h"
+
+/* Firma de las funciones de búsqueda */
+typedef const char* (*scan_fn)(const char* start, const char* end);
+
+/* Una implementación de las búsquedas */
+struct scan_impl {
+    const char* name;
+    bool (*supported)(void);
+    scan_fn find_newline;
+    scan_fn find_special;
+};
+
+/********** Implementación escalar **********/
+
+/* Tabla de los caracteres que busca scan_find_special */
+static const bool special_table[256] = {
+    [' '] = true, ['\t'] = true, ['\r'] = true, ['\n'] = true,
+    ['|'] = true, ['&'] = true,  ['<'] = true,  ['>'] = true,
+    [';'] = true, ['('] = true,  [')'] = true,
+    ['\''] = true, ['"'] = true, ['\\'] = true,
+};
+
+static bool scalar_supported(void) {
+    return true;
+}
+
+static const char* scalar_find_newline(const char* start, const char* end) {
+    const char* result = memchr(start, '\n', (size_t)(end - start));
+    return result != NULL ? result : end;
+}
+
+static const char* scalar_find_special(const char* start, const char* end) {
+    while (start < end && !special_table[(unsigned char)*start]) {
+        start++;
+    }
+    return start;
+}
+
+#ifdef SCAN_X86
+
+/********** Implementación SSE2 (16 bytes por iteración) **********/
+
+static bool sse2_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+
+__attribute__((target("sse2"))) static const char*
+sse2_find_newline(const char* start, const char* end) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - start >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)start);
+        unsigned int mask =
+            (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        if (mask != 0u) {
+            return start + __builtin_ctz(mask);
+        }
+        start += 16;
+    }
+    // Los últimos bytes (menos de 16) se buscan de a uno, para no leer
+    // después de end
+    return scalar_find_newline(start, end);
+}
+
+/* Marca con 0xff los bytes de chunk que están en special_table */
+__attribute__((target("sse2"))) static __m128i sse2_special_mask(__m128i chunk) {
+    __m128i m = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('|')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('&')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('<')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('>')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(';')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('(')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(')')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\'')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+    return m;
+}
+
+__attribute__((target("sse2"))) static const char*
+sse2_find_special(const char* start, const char* end) {
+    while (end - start >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)start);
+        unsigned int mask =
+            (unsigned int)_mm_movemask_epi8(sse2_special_mask(chunk));
+        if (mask != 0u) {
+            return start + __builtin_ctz(mask);
+        }
+        start += 16;
+    }
+    return scalar_find_special(start, end);
+}
+
+/********** Implementación AVX2 (32 bytes por iteración) **********/
+
+static bool avx2_supported(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2"))) static const char*
+avx2_find_newline(const char* start, const char* end) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - start >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)start);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(chunk, newline));
+        if (mask != 0u) {
+            return start + __builtin_ctz(mask);
+        }
+        start += 32;
+    }
+    return scalar_find_newline(start, end);
+}
+
+/* Marca con 0xff los bytes de chunk que están en special_table */
+__attribute__((target("avx2"))) static __m256i
+avx2_special_mask(__m256i chunk) {
+    __m256i m = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('|')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('&')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('<')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('>')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(';')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('(')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(')')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\'')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')));
+    return m;
+}
+
+__attribute__((target("avx2"))) static const char*
+avx2_find_special(const char* start, const char* end) {
+    while (end - start >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)start);
+        unsigned int mask =
+            (unsigned int)_mm256_movemask_epi8(avx2_special_mask(chunk));
+        if (mask != 0u) {
+            return start + __builtin_ctz(mask);
+        }
+        start += 32;
+    }
+    // Puede quedar un bloque de 16 antes de terminar de a uno
+    return sse2_find_special(start, end);
+}
+
+#endif /* SCAN_X86 */
+
+/********** Selección de la implementación **********/
+
+/* Implementaciones disponibles; la primera es la de siempre. Las palabras
+ * de un comando son cortas y las vectoriales no le ganan a la escalar (ver
+ * bench-parser), así que solo se usan si se piden con MYBASH_SCAN
+ */
+static const struct scan_impl implementations[] = {
+    {"scalar", scalar_supported, scalar_find_newline, scalar_find_special},
+#ifdef SCAN_X86
+    {"sse2", sse2_supported, sse2_find_newline, sse2_find_special},
+    {"avx2", avx2_supported, avx2_find_newline, avx2_find_special},
+#endif
+};
+
+#define IMPLEMENTATIONS (sizeof(implementations) / sizeof(implementations[0]))
+
+static const struct scan_impl* current = NULL;
+
+bool scan_select(const char* name) {
+    assert(name != NULL);
+
+    for (unsigned int i = 0u; i < IMPLEMENTATIONS; i++) {
+        if (strcmp(implementations[i].name, name) == 0) {
+            if (implementations[i].supported()) {
+                current = &implementations[i];
+                return true;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+void scan_init(void) {
+    if (current != NULL) {
+        return;
+    }
+
+    const char* forced = getenv("MYBASH_SCAN");
+    if (forced != NULL && scan_select(forced)) {
+        return;
+    }
+    // La escalar siempre está
+    current = &implementations[0];
+}
+
+const char* scan_impl_name(void) {
+    scan_init();
+    return current->name;
+}
+
+const char* scan_find_newline(const char* start, const char* end) {
+    assert(start != NULL && end != NULL && start <= end);
+
+    if (current == NULL) {
+        scan_init();
+    }
+    return current->find_newline(start, end);
+}
+
+const char* scan_find_special(const char* start, const char* end) {
+    assert(start != NULL && end != NULL && start <= end);
+
+    if (current == NULL) {
+        scan_init();
+    }
+    return current->find_special(start, end);
+}
@@ -0,0 +1,52 @@
+/* Búsqueda rápida de caracteres especiales en la entrada del parser.
+ *
+ * Hay tres implementaciones de cada búsqueda: una escalar, una con SSE2 (de a
+ * 16 bytes) y una con AVX2 (de a 32 bytes). La que se usa se elige una sola
+ * vez en tiempo de ejecución: la escalar, o la que pida la variable de
+ * entorno MYBASH_SCAN ("scalar", "sse2" o "avx2") si el procesador la
+ * soporta.
+ */
+
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+#include <stdbool.h>
+
+/*
+ * Elige la implementación a usar, si todavía no se eligió. La llaman los
+ * constructores del parser; llamarla más de una vez no hace nada.
+ * Se tiene que llamar antes de empezar a usar el módulo desde varios hilos.
+ */
+void scan_init(void);
+
+/*
+ * Fuerza una implementación: "scalar", "sse2" o "avx2".
+ * Returns: true si la implementación existe y el procesador la soporta
+ *     (si no, queda la que estaba).
+ * Requires: name != NULL
+ */
+bool scan_select(const char* name);
+
+/*
+ * Nombre de la implementación que se está usando.
+ * Ensures: result != NULL
+ */
+const char* scan_impl_name(void);
+
+/*
+ * Busca el primer '\n' en [start, end).
+ * Returns: puntero al '\n', o end si no hay ninguno.
+ * Requires: start != NULL && end != NULL && start <= end
+ */
+const char* scan_find_newline(const char* start, const char* end);
+
+/*
+ * Busca el primer caracter que no puede ser parte de una palabra simple, es
+ * decir un blanco, '\r', '\n', un operador ('|', '&', '<', '>', ';', '(',
+ * ')') o un caracter de quoting ('\'', '"', '\\').
+ * Returns: puntero a ese caracter, o end si no hay ninguno.
+ * Requires: start != NULL && end != NULL && start <= end
+ */
+const char* scan_find_special(const char* start, const char* end);
+
+#endif
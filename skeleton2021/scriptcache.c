@@ -0,0 +1,341 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parser.h"
+#include "scriptcache.h"
+
+/* Encabezado del caché: el script del que sale y la cantidad de pipelines.
+ * Después viene cada pipeline como un entry_header seguido de su
+ * serialización, rellenada con ceros hasta un múltiplo de 8 bytes.
+ */
+struct cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t hash; // del contenido del script
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct entry_header {
+    uint32_t size;
+    uint32_t reserved;
+};
+
+#define CACHE_MAGIC 0x4342594du // "MYBC"
+#define CACHE_VERSION 1u
+
+#define TMP_SUFFIX ".tmp"
+
+struct scriptcache_s {
+    GSList* pipelines; // los que faltan ejecutar, en orden
+    void* map;         // el caché mapeado, o NULL si se parseó el script
+    size_t map_size;
+};
+
+/* FNV-1a de 64 bits */
+static uint64_t content_hash(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0u; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static size_t padded(size_t length) {
+    return (length + 7u) & ~(size_t)7u;
+}
+
+static void void_pipeline_destroy(void* apipe) {
+    pipeline_destroy(apipe);
+}
+
+char* scriptcache_path(const char* path) {
+    assert(path != NULL);
+
+    const char* slash = strrchr(path, '/');
+    size_t dir = slash != NULL ? (size_t)(slash - path) + 1u : 0u;
+    size_t length = dir + 1u + strlen(path + dir) + strlen(SCRIPTCACHE_SUFFIX) +
+                    1u;
+    char* result = malloc(length);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(result, path, dir);
+    snprintf(result + dir, length - dir, ".%s%s", path + dir,
+             SCRIPTCACHE_SUFFIX);
+    return result;
+}
+
+/* Mapea los `size' bytes del archivo abierto en fd, o NULL si no se puede */
+static void* map_file(int fd, size_t size) {
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    return map != MAP_FAILED ? map : NULL;
+}
+
+/* Un caché de otro usuario, o que otros pueden modificar, podría ejecutar
+ * cualquier cosa en lugar del script
+ */
+static bool trusted(const struct stat* st, const struct stat* script) {
+    return S_ISREG(st->st_mode) && (st->st_mode & (S_IWGRP | S_IWOTH)) == 0 &&
+           (st->st_uid == geteuid() || st->st_uid == script->st_uid);
+}
+
+static bool same_script(const struct cache_header* a,
+                        const struct cache_header* b) {
+    return a->magic == b->magic && a->version == b->version &&
+           a->device == b->device && a->inode == b->inode &&
+           a->size == b->size && a->mtime_sec == b->mtime_sec &&
+           a->mtime_nsec == b->mtime_nsec && a->hash == b->hash;
+}
+
+/* Arma los pipelines del caché mapeado en self->map.
+ * Returns: false si está mal formado (y no queda ningún pipeline)
+ */
+static bool load_pipelines(scriptcache self, const struct cache_header* key) {
+    const char* data = self->map;
+    size_t size = self->map_size;
+    struct cache_header header;
+    memcpy(&header, data, sizeof(header));
+    if (!same_script(&header, key)) {
+        return false;
+    }
+    size_t offset = sizeof(header);
+    bool ok = true;
+    for (uint32_t i = 0u; i < header.count && ok; i++) {
+        struct entry_header entry = {0u, 0u};
+        ok = size - offset >= sizeof(entry);
+        if (ok) {
+            memcpy(&entry, data + offset, sizeof(entry));
+            offset += sizeof(entry);
+            ok = padded(entry.size) <= size - offset;
+        }
+        pipeline apipe =
+            ok ? pipeline_deserialize(data + offset, entry.size) : NULL;
+        ok = apipe != NULL;
+        if (ok) {
+            self->pipelines = g_slist_prepend(self->pipelines, apipe);
+            offset += padded(entry.size);
+        }
+    }
+    self->pipelines = g_slist_reverse(self->pipelines);
+    if (!ok || offset != size) {
+        g_slist_free_full(self->pipelines, void_pipeline_destroy);
+        self->pipelines = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* Abre el caché de `cache_path' si es del script `key'.
+ * Returns: false si no hay caché válido
+ */
+static bool open_cache(scriptcache self, const char* cache_path,
+                       const struct cache_header* key,
+                       const struct stat* script) {
+    int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && trusted(&st, script) &&
+              (size_t)st.st_size >= sizeof(struct cache_header);
+    if (ok) {
+        self->map_size = (size_t)st.st_size;
+        self->map = map_file(fd, self->map_size);
+    }
+    close(fd);
+    if (self->map == NULL) {
+        return false;
+    }
+    if (!load_pipelines(self, key)) {
+        munmap(self->map, self->map_size);
+        self->map = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* Parsea todo el texto del script.
+ * Returns: los pipelines, en orden (sin los que tienen errores)
+ */
+static GSList* parse_script(const char* text, size_t size, linecache cache) {
+    Parser parser = parser_new_from_buffer(text, size);
+    if (parser == NULL) {
+        perror("mybash");
+        exit(EXIT_FAILURE);
+    }
+    parser_set_cache(parser, cache);
+    GSList* result = NULL;
+    while (!parser_at_eof(parser)) {
+        pipeline apipe = parse_pipeline(parser);
+        if (apipe != NULL) {
+            result = g_slist_prepend(result, apipe);
+        }
+    }
+    parser = parser_destroy(parser);
+    return g_slist_reverse(result);
+}
+
+static bool write_all(int fd, const void* data, size_t length) {
+    const char* next = data;
+    while (length > 0u) {
+        ssize_t n = write(fd, next, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        next += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+/* Escribe en fd el encabezado y la serialización de cada pipeline */
+static bool write_cache(int fd, struct cache_header header,
+                        GSList* pipelines) {
+    static const char zeros[8] = {0};
+    header.count = g_slist_length(pipelines);
+    bool ok = write_all(fd, &header, sizeof(header));
+    for (GSList* node = pipelines; node != NULL && ok; node = node->next) {
+        size_t size = 0u;
+        void* data = pipeline_serialize(node->data, &size);
+        ok = data != NULL && size <= UINT32_MAX;
+        if (ok) {
+            struct entry_header entry = {(uint32_t)size, 0u};
+            ok = write_all(fd, &entry, sizeof(entry)) &&
+                 write_all(fd, data, size) &&
+                 write_all(fd, zeros, padded(size) - size);
+        }
+        free(data);
+    }
+    return ok;
+}
+
+/* Guarda el caché, si se puede: se escribe aparte y reemplaza al anterior
+ * de una vez, así nadie lee uno a medias
+ */
+static void save_cache(const char* cache_path,
+                       const struct cache_header* header, GSList* pipelines,
+                       mode_t mode) {
+    size_t length = strlen(cache_path) + 32u;
+    char* tmp_path = malloc(length);
+    if (tmp_path == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    snprintf(tmp_path, length, "%s.%ld%s", cache_path, (long)getpid(),
+             TMP_SUFFIX);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                  mode & 0644);
+    if (fd != -1) {
+        bool ok = write_cache(fd, *header, pipelines);
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmp_path, cache_path) == -1) {
+            unlink(tmp_path);
+        }
+    }
+    free(tmp_path);
+}
+
+scriptcache scriptcache_open(const char* path, int fd, linecache cache) {
+    assert(path != NULL && fd >= 0);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    const char* text = "";
+    void* map = NULL;
+    if (size > 0u) {
+        map = map_file(fd, size);
+        if (map == NULL) {
+            return NULL;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        text = map;
+    }
+
+    scriptcache self = malloc(sizeof(struct scriptcache_s));
+    if (self == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    self->pipelines = NULL;
+    self->map = NULL;
+    self->map_size = 0u;
+
+    struct cache_header key = {CACHE_MAGIC,
+                               CACHE_VERSION,
+                               (uint64_t)st.st_dev,
+                               (uint64_t)st.st_ino,
+                               (uint64_t)size,
+                               (int64_t)st.st_mtim.tv_sec,
+                               (int64_t)st.st_mtim.tv_nsec,
+                               content_hash(text, size),
+                               0u,
+                               0u};
+    char* cache_path = scriptcache_path(path);
+    if (!open_cache(self, cache_path, &key, &st)) {
+        self->pipelines = parse_script(text, size, cache);
+        save_cache(cache_path, &key, self->pipelines, st.st_mode);
+    }
+    free(cache_path);
+    if (map != NULL) {
+        munmap(map, size);
+    }
+    return self;
+}
+
+scriptcache scriptcache_close(scriptcache self) {
+    assert(self != NULL);
+
+    g_slist_free_full(self->pipelines, void_pipeline_destroy);
+    if (self->map != NULL) {
+        munmap(self->map, self->map_size);
+    }
+    free(self);
+    return NULL;
+}
+
+pipeline scriptcache_next(scriptcache self) {
+    assert(self != NULL);
+
+    if (self->pipelines == NULL) {
+        return NULL;
+    }
+    pipeline result = self->pipelines->data;
+    self->pipelines = g_slist_delete_link(self->pipelines, self->pipelines);
+    return result;
+}
+
+pipeline scriptcache_peek(const scriptcache self) {
+    assert(self != NULL);
+
+    return self->pipelines != NULL ? self->pipelines->data : NULL;
+}
+
+bool scriptcache_is_cached(const scriptcache self) {
+    assert(self != NULL);
+
+    return self->map != NULL;
+}
@@ -0,0 +1,83 @@
+/* scriptcache: scripts compilados, guardados al lado del script.
+ *
+ * La primera vez que se ejecuta un script se parsea entero y se guarda el
+ * resultado en <dir>/.<nombre>.mybc: la serialización de cada pipeline
+ * (pipeline_serialize, que incluye las redirecciones y, en los compuestos,
+ * las listas de las condiciones y los cuerpos), uno atrás del otro. Las
+ * veces siguientes se mapea en memoria ese archivo y los pipelines se
+ * arman con pipeline_deserialize, que no copia las cadenas ni vuelve a
+ * leer el texto del script.
+ *
+ * El caché se identifica por el script: el dispositivo y el inodo, el
+ * tamaño, la fecha de modificación (con nanosegundos) y un hash del
+ * contenido. Si algo no coincide, o el caché está mal formado, se vuelve a
+ * parsear y se reemplaza. El caché nuevo se escribe aparte y se renombra,
+ * así que dos ejecuciones a la vez no leen uno a medias; si no se puede
+ * escribir (un directorio de solo lectura) se sigue sin caché.
+ *
+ * Los errores de sintaxis se descartan al compilar, igual que cuando se
+ * parsea línea a línea: se ejecutan los demás pipelines.
+ */
+
+#ifndef _SCRIPTCACHE_H_
+#define _SCRIPTCACHE_H_
+
+#include <stdbool.h>
+
+#include "command.h"
+#include "linecache.h"
+
+typedef struct scriptcache_s* scriptcache;
+
+/* Sufijo de los archivos de caché */
+#define SCRIPTCACHE_SUFFIX ".mybc"
+
+/*
+ * Abre el script `path', ya abierto en `fd', desde el caché o
+ * compilándolo (y guardando el caché). El fd no se cierra.
+ *   cache: si no es NULL, se usa al parsear para no repetir líneas
+ * Returns: el script, o NULL si no es un archivo regular (un pipe, una
+ *     terminal) o no se puede leer, y hay que parsearlo a medida que se
+ *     ejecuta
+ * Requires: path != NULL && fd >= 0
+ */
+scriptcache scriptcache_open(const char* path, int fd, linecache cache);
+
+/*
+ * Cierra `self' (y deja de mapear el caché).
+ * Requires: self != NULL y que ya se hayan destruido los pipelines que
+ *     devolvió scriptcache_next
+ * Ensures: result == NULL
+ */
+scriptcache scriptcache_close(scriptcache self);
+
+/*
+ * El siguiente pipeline del script, en orden.
+ * Returns: un pipeline (a destruir por el llamador antes de cerrar
+ *     `self'), o NULL si no quedan
+ * Requires: self != NULL
+ */
+pipeline scriptcache_next(scriptcache self);
+
+/*
+ * El pipeline que va a devolver scriptcache_next, sin sacarlo. Sigue
+ * siendo de `self', y vale hasta la siguiente llamada a scriptcache_next.
+ * Returns: el pipeline, o NULL si no quedan
+ * Requires: self != NULL
+ */
+pipeline scriptcache_peek(const scriptcache self);
+
+/*
+ * Indica si los pipelines salen del caché (y no se parseó el script).
+ * Requires: self != NULL
+ */
+bool scriptcache_is_cached(const scriptcache self);
+
+/*
+ * Ruta del caché del script `path', en memoria nueva.
+ * Requires: path != NULL
+ * Ensures: result != NULL
+ */
+char* scriptcache_path(const char* path);
+
+#endif
@@ -0,0 +1,469 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "execute.h"
+#include "segments.h"
+
+/* Largo máximo de un segmento, con el '\0' */
+#define SEGMENT_SIZE 128u
+
+/* Un proveedor calcula el valor de un segmento en buffer. Tiene que
+ * terminar antes de deadline; si no llega, devuelve false y se sigue
+ * mostrando el valor anterior.
+ */
+struct provider {
+    unsigned int budget_ms; // tiempo máximo para calcular el segmento
+    bool (*compute)(char* buffer, size_t size, const struct timespec* deadline);
+};
+
+static bool vcs_compute(char* buffer, size_t size,
+                        const struct timespec* deadline);
+static bool jobs_compute(char* buffer, size_t size,
+                         const struct timespec* deadline);
+static bool duration_compute(char* buffer, size_t size,
+                             const struct timespec* deadline);
+
+/* En el orden de segments_kind */
+static const struct provider providers[SEGMENTS_COUNT] = {
+    {300u, vcs_compute},
+    {20u, jobs_compute},
+    {5u, duration_compute},
+};
+
+/* Estado compartido entre el hilo principal y el de los proveedores. Todo lo
+ * protege lock, salvo last_duration que es atómica.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup; // hay una vuelta pedida, o hay que parar
+    pthread_cond_t done;   // terminó una vuelta
+    pthread_t thread;
+    bool running;
+    bool stop;
+    bool waiting;            // segments_refresh está esperando
+    unsigned long requested; // vueltas pedidas
+    unsigned long completed; // última vuelta pedida que se terminó
+    char values[SEGMENTS_COUNT][SEGMENT_SIZE];
+    void (*callback)(void);
+} state = {PTHREAD_MUTEX_INITIALIZER,
+           PTHREAD_COND_INITIALIZER,
+           PTHREAD_COND_INITIALIZER,
+           0,
+           false,
+           false,
+           false,
+           0ul,
+           0ul,
+           {{'\0'}},
+           NULL};
+
+/* UINT64_MAX: todavía no se ejecutó ningún comando */
+static _Atomic uint64_t last_duration = UINT64_MAX;
+
+/********** Plazos **********/
+
+static void deadline_after(struct timespec* deadline, unsigned int ms) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += ms / 1000u;
+    deadline->tv_nsec += (long)(ms % 1000u) * 1000000l;
+    if (deadline->tv_nsec >= 1000000000l) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000l;
+    }
+}
+
+static bool deadline_passed(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/********** Proveedores **********/
+
+/* Lee el archivo path entero en buffer, terminado en '\0'
+ * Returns: false si no se pudo leer
+ */
+static bool read_small_file(const char* path, char* buffer, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    ssize_t n = read(fd, buffer, size - 1u);
+    close(fd);
+    if (n < 0) {
+        return false;
+    }
+    buffer[n] = '\0';
+    return true;
+}
+
+/* Busca el repositorio de git que contiene al directorio actual.
+ * Deja en worktree el directorio de trabajo y en gitdir el directorio con
+ * los datos (que puede no ser worktree/.git si .git es un archivo).
+ * Returns: false si no hay repositorio
+ */
+static bool find_git(char* worktree, size_t worktree_size, char* gitdir,
+                     size_t gitdir_size) {
+    if (getcwd(worktree, worktree_size) == NULL) {
+        return false;
+    }
+    bool found = false;
+    bool done = false;
+    while (!found && !done) {
+        struct stat st;
+        int n = snprintf(gitdir, gitdir_size, "%s/.git",
+                         strcmp(worktree, "/") == 0 ? "" : worktree);
+        if (n > 0 && (size_t)n < gitdir_size && stat(gitdir, &st) == 0) {
+            if (S_ISDIR(st.st_mode)) {
+                found = true;
+            } else if (S_ISREG(st.st_mode)) {
+                // Worktrees y submódulos: el archivo dice "gitdir: <path>"
+                char link[PATH_MAX];
+                if (read_small_file(gitdir, link, sizeof(link)) &&
+                    strncmp(link, "gitdir: ", 8u) == 0) {
+                    link[strcspn(link, "\n")] = '\0';
+                    const char* target = link + 8;
+                    if (target[0] == '/') {
+                        n = snprintf(gitdir, gitdir_size, "%s", target);
+                    } else {
+                        n = snprintf(gitdir, gitdir_size, "%s/%s", worktree,
+                                     target);
+                    }
+                    found = n > 0 && (size_t)n < gitdir_size;
+                }
+            }
+        }
+        if (!found) {
+            char* slash = strrchr(worktree, '/');
+            if (slash == NULL || strcmp(worktree, "/") == 0) {
+                done = true;
+            } else if (slash == worktree) {
+                worktree[1] = '\0'; // sigue por "/"
+            } else {
+                *slash = '\0';
+            }
+        }
+    }
+    return found;
+}
+
+/* Lee un entero big endian de 32 o 16 bits */
+static uint32_t be32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 |
+           (uint32_t)p[3];
+}
+
+static uint16_t be16(const unsigned char* p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+/* Formato de una entrada del índice de git (versiones 2 y 3) */
+#define INDEX_ENTRY_MTIME 8u
+#define INDEX_ENTRY_MODE 24u
+#define INDEX_ENTRY_SIZE 36u
+#define INDEX_ENTRY_FLAGS 60u
+#define INDEX_ENTRY_NAME 62u
+#define INDEX_FLAG_EXTENDED 0x4000u
+#define INDEX_FLAG_SKIP_WORKTREE 0x4000u // en los flags extendidos
+#define INDEX_NAME_MASK 0x0fffu
+#define INDEX_STAGE_MASK 0x3000u
+#define GITLINK_MODE 0160000u
+
+/* Cada cuántas entradas se mira el reloj */
+#define INDEX_DEADLINE_STRIDE 256u
+
+/* Compara cada archivo del índice de git con el archivo del directorio de
+ * trabajo, usando solo fecha de modificación y tamaño (como hace git antes de
+ * mirar el contenido). Es una aproximación: un archivo tocado pero con el
+ * mismo contenido cuenta como modificado hasta que git actualice el índice.
+ * Los archivos sin seguimiento no cuentan.
+ * Returns: 1 si hay cambios, 0 si no, -1 si no se pudo saber (índice en un
+ *     formato que no se entiende, o se pasó el plazo)
+ */
+static int index_dirty(const char* worktree, const char* gitdir,
+                       const struct timespec* deadline) {
+    char path[PATH_MAX];
+    int n = snprintf(path, sizeof(path), "%s/index", gitdir);
+    if (n < 0 || (size_t)n >= sizeof(path)) {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno == ENOENT ? 0 : -1; // sin índice no hay nada agregado
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12) {
+        close(fd);
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    const unsigned char* index = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (index == MAP_FAILED) {
+        return -1;
+    }
+    int worktree_fd = open(worktree, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    int result = -1;
+    uint32_t version = be32(index + 4);
+    if (worktree_fd != -1 && memcmp(index, "DIRC", 4u) == 0 &&
+        (version == 2u || version == 3u)) {
+        uint32_t entries = be32(index + 8);
+        size_t pos = 12u;
+        result = 0;
+        for (uint32_t i = 0u; i < entries && result == 0; i++) {
+            if (i % INDEX_DEADLINE_STRIDE == 0u && deadline_passed(deadline)) {
+                result = -1;
+                break;
+            }
+            if (pos + INDEX_ENTRY_NAME + 2u > size) {
+                result = -1;
+                break;
+            }
+            const unsigned char* entry = index + pos;
+            uint16_t flags = be16(entry + INDEX_ENTRY_FLAGS);
+            size_t name_offset = INDEX_ENTRY_NAME;
+            bool skip = false;
+            if (flags & INDEX_FLAG_EXTENDED) {
+                skip = be16(entry + INDEX_ENTRY_NAME) & INDEX_FLAG_SKIP_WORKTREE;
+                name_offset += 2u;
+            }
+            const unsigned char* name = entry + name_offset;
+            const unsigned char* nul = memchr(name, '\0', size - pos - name_offset);
+            if (nul == NULL) {
+                result = -1;
+                break;
+            }
+            size_t name_length = (size_t)(nul - name);
+            // Si el largo no coincide, el formato no es el esperado (por
+            // ejemplo hashes de otro tamaño)
+            if ((flags & INDEX_NAME_MASK) != INDEX_NAME_MASK &&
+                (flags & INDEX_NAME_MASK) != name_length) {
+                result = -1;
+                break;
+            }
+            pos += (name_offset + name_length + 8u) & ~(size_t)7u;
+
+            if ((flags & INDEX_STAGE_MASK) != 0u) {
+                result = 1; // conflicto sin resolver
+            } else if (!skip && be32(entry + INDEX_ENTRY_MODE) != GITLINK_MODE) {
+                struct stat file;
+                if (fstatat(worktree_fd, (const char*)name, &file,
+                            AT_SYMLINK_NOFOLLOW) != 0) {
+                    result = 1; // borrado
+                } else {
+                    uint32_t mtime = be32(entry + INDEX_ENTRY_MTIME);
+                    uint32_t mtime_ns = be32(entry + INDEX_ENTRY_MTIME + 4u);
+                    if (mtime != (uint32_t)file.st_mtim.tv_sec ||
+                        (mtime_ns != 0u &&
+                         mtime_ns != (uint32_t)file.st_mtim.tv_nsec) ||
+                        be32(entry + INDEX_ENTRY_SIZE) !=
+                            (uint32_t)file.st_size) {
+                        result = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (worktree_fd != -1) {
+        close(worktree_fd);
+    }
+    munmap((void*)index, size);
+    return result;
+}
+
+static bool vcs_compute(char* buffer, size_t size,
+                        const struct timespec* deadline) {
+    char worktree[PATH_MAX];
+    char gitdir[PATH_MAX];
+    buffer[0] = '\0';
+    if (!find_git(worktree, sizeof(worktree), gitdir, sizeof(gitdir))) {
+        return true;
+    }
+
+    char head[256];
+    char path[PATH_MAX + 8u];
+    snprintf(path, sizeof(path), "%s/HEAD", gitdir);
+    if (!read_small_file(path, head, sizeof(head))) {
+        return true;
+    }
+    head[strcspn(head, "\n")] = '\0';
+    const char* branch = head;
+    if (strncmp(head, "ref: refs/heads/", 16u) == 0) {
+        branch = head + 16;
+    } else if (strncmp(head, "ref: ", 5u) == 0) {
+        branch = head + 5;
+    } else {
+        head[7] = '\0'; // HEAD suelto: el comienzo del hash
+    }
+
+    int dirty = index_dirty(worktree, gitdir, deadline);
+    if (dirty < 0 && deadline_passed(deadline)) {
+        return false;
+    }
+    snprintf(buffer, size, "%s%s", branch, dirty > 0 ? "*" : "");
+    return true;
+}
+
+static bool jobs_compute(char* buffer, size_t size,
+                         const struct timespec* deadline) {
+    snprintf(buffer, size, "%u", execute_background_jobs());
+    return true;
+}
+
+static bool duration_compute(char* buffer, size_t size,
+                             const struct timespec* deadline) {
+    uint64_t ns = atomic_load(&last_duration);
+    if (ns == UINT64_MAX) {
+        buffer[0] = '\0';
+    } else if (ns < 1000000000ull) {
+        snprintf(buffer, size, "%lums", (unsigned long)(ns / 1000000ull));
+    } else {
+        snprintf(buffer, size, "%.2fs", (double)ns / 1e9);
+    }
+    return true;
+}
+
+/********** Hilo de los proveedores **********/
+
+static void* segments_worker(void* arg) {
+    pthread_mutex_lock(&state.lock);
+    while (!state.stop) {
+        if (state.completed == state.requested) {
+            pthread_cond_wait(&state.wakeup, &state.lock);
+            continue;
+        }
+        unsigned long round = state.requested;
+        pthread_mutex_unlock(&state.lock);
+
+        // Los proveedores corren sin el lock, cada uno con su plazo
+        bool changed = false;
+        for (unsigned int i = 0u; i < SEGMENTS_COUNT; i++) {
+            char value[SEGMENT_SIZE];
+            struct timespec deadline;
+            deadline_after(&deadline, providers[i].budget_ms);
+            if (providers[i].compute(value, sizeof(value), &deadline)) {
+                pthread_mutex_lock(&state.lock);
+                if (strcmp(state.values[i], value) != 0) {
+                    strcpy(state.values[i], value);
+                    changed = true;
+                }
+                pthread_mutex_unlock(&state.lock);
+            }
+        }
+
+        pthread_mutex_lock(&state.lock);
+        state.completed = round;
+        pthread_cond_broadcast(&state.done);
+        /* Si segments_refresh sigue esperando, el prompt todavía no se
+           dibujó y va a salir con los valores nuevos: no hace falta avisar */
+        void (*callback)(void) = state.callback;
+        if (changed && !state.waiting && callback != NULL) {
+            pthread_mutex_unlock(&state.lock);
+            callback();
+            pthread_mutex_lock(&state.lock);
+        }
+    }
+    pthread_mutex_unlock(&state.lock);
+    return NULL;
+}
+
+void segments_start(void) {
+    if (state.running) {
+        return;
+    }
+    // Los plazos de segments_refresh se miden con el mismo reloj que el
+    // resto
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_destroy(&state.done);
+    pthread_cond_init(&state.done, &attr);
+    pthread_condattr_destroy(&attr);
+
+    state.stop = false;
+    state.requested = 0ul;
+    state.completed = 0ul;
+    int error = pthread_create(&state.thread, NULL, segments_worker, NULL);
+    if (error != 0) {
+        // Sin hilo los segmentos quedan vacíos
+        errno = error;
+        perror("mybash: prompt");
+        return;
+    }
+    state.running = true;
+}
+
+void segments_stop(void) {
+    if (!state.running) {
+        return;
+    }
+    pthread_mutex_lock(&state.lock);
+    state.stop = true;
+    pthread_cond_broadcast(&state.wakeup);
+    pthread_mutex_unlock(&state.lock);
+    pthread_join(state.thread, NULL);
+    state.running = false;
+    for (unsigned int i = 0u; i < SEGMENTS_COUNT; i++) {
+        state.values[i][0] = '\0';
+    }
+}
+
+void segments_refresh(unsigned int wait_ms) {
+    if (!state.running) {
+        return;
+    }
+    struct timespec deadline;
+    deadline_after(&deadline, wait_ms);
+
+    pthread_mutex_lock(&state.lock);
+    state.requested++;
+    unsigned long round = state.requested;
+    pthread_cond_signal(&state.wakeup);
+    state.waiting = true;
+    int error = 0;
+    while (state.completed < round && error != ETIMEDOUT) {
+        error = pthread_cond_timedwait(&state.done, &state.lock, &deadline);
+    }
+    state.waiting = false;
+    pthread_mutex_unlock(&state.lock);
+}
+
+size_t segments_get(segments_kind kind, char* buffer, size_t size) {
+    assert(kind < SEGMENTS_COUNT && buffer != NULL && size > 0u);
+
+    pthread_mutex_lock(&state.lock);
+    size_t length = strlen(state.values[kind]);
+    if (length >= size) {
+        length = size - 1u;
+    }
+    memcpy(buffer, state.values[kind], length);
+    buffer[length] = '\0';
+    pthread_mutex_unlock(&state.lock);
+    return length;
+}
+
+void segments_set_update_callback(void (*callback)(void)) {
+    pthread_mutex_lock(&state.lock);
+    state.callback = callback;
+    pthread_mutex_unlock(&state.lock);
+}
+
+void segments_set_last_duration(uint64_t nanoseconds) {
+    atomic_store(&last_duration, nanoseconds);
+}
@@ -0,0 +1,69 @@
+/* Segmentos del prompt que se calculan en segundo plano.
+ *
+ * Algunos segmentos del prompt pueden tardar en calcularse (el estado del
+ * repositorio en un repositorio grande, por ejemplo). Para que escribir no se
+ * sienta lento, cada segmento tiene un proveedor que corre en un hilo aparte,
+ * con un tiempo máximo por segmento. El prompt muestra siempre el último
+ * valor conocido (que puede estar desactualizado), y cuando llega un valor
+ * nuevo se avisa con una función de aviso para que se vuelva a dibujar.
+ *
+ * Los proveedores son:
+ *   SEGMENTS_VCS       rama de git del directorio actual, con '*' si hay
+ *                      archivos modificados ("" fuera de un repositorio)
+ *   SEGMENTS_JOBS      cantidad de pipelines en segundo plano que siguen
+ *                      corriendo
+ *   SEGMENTS_DURATION  cuánto tardó el último comando ("" si no hubo)
+ */
+
+#ifndef _SEGMENTS_H_
+#define _SEGMENTS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    SEGMENTS_VCS,
+    SEGMENTS_JOBS,
+    SEGMENTS_DURATION,
+    SEGMENTS_COUNT // cantidad de segmentos, no es un segmento
+} segments_kind;
+
+/*
+ * Arranca el hilo de los proveedores, si todavía no está corriendo.
+ * Se usa desde el hilo principal.
+ */
+void segments_start(void);
+
+/*
+ * Para el hilo de los proveedores y libera los valores guardados.
+ */
+void segments_stop(void);
+
+/*
+ * Pide que se vuelvan a calcular todos los segmentos, y espera a lo sumo
+ * `wait_ms' milisegundos a que estén listos. Si no llegan, se siguen
+ * calculando en segundo plano y se avisa con la función de aviso.
+ * Si el hilo no está corriendo no hace nada.
+ */
+void segments_refresh(unsigned int wait_ms);
+
+/*
+ * Copia el último valor conocido del segmento `kind' en `buffer', terminado
+ * en '\0' y cortado si no entra.
+ * Returns: el largo de lo copiado
+ * Requires: kind < SEGMENTS_COUNT && buffer != NULL && size > 0
+ */
+size_t segments_get(segments_kind kind, char* buffer, size_t size);
+
+/*
+ * Función a llamar cuando cambia el valor de algún segmento. Se llama desde
+ * el hilo de los proveedores. Con NULL no se avisa.
+ */
+void segments_set_update_callback(void (*callback)(void));
+
+/*
+ * Registra cuánto tardó el último comando, en nanosegundos.
+ */
+void segments_set_last_duration(uint64_t nanoseconds);
+
+#endif
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "argbatch.h"
+#include "spawnplan.h"
+
+extern char** environ;
+
+struct stage {
+    char* path;  // NULL: se busca en el PATH
+    char** argv; // NULL: la etapa no se lanza
+    int in;      // redirección, o -1
+    int out;
+    int err;     // redirección, SPAWNPLAN_OUTPUT o -1
+    pid_t pid;
+    int error; // de posix_spawn, si no se pudo lanzar
+    posix_spawn_file_actions_t actions;
+};
+
+struct spawnplan_s {
+    struct stage* stages;
+    unsigned int count;
+    unsigned int threads;
+    int* pipes; // 2 por cada par de etapas vecinas
+    bool ran;
+    atomic_uint next; // la próxima etapa que hay que lanzar
+    atomic_uint launched;
+};
+
+spawnplan spawnplan_new(unsigned int stages) {
+    assert(stages > 0u);
+
+    spawnplan self = malloc(sizeof(struct spawnplan_s));
+    struct stage* array = calloc(stages, sizeof(struct stage));
+    if (self == NULL || array == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (unsigned int i = 0u; i < stages; i++) {
+        array[i].in = -1;
+        array[i].out = -1;
+        array[i].err = -1;
+        array[i].pid = -1;
+    }
+    self->stages = array;
+    self->count = stages;
+    self->threads = 0u;
+    self->pipes = NULL;
+    self->ran = false;
+    atomic_init(&self->next, 0u);
+    atomic_init(&self->launched, 0u);
+    return self;
+}
+
+/* Cierra las redirecciones de la etapa, una vez cada una (el error puede
+ * ser la misma que la entrada o la salida)
+ */
+static void close_redirections(struct stage* stage) {
+    if (stage->err >= 0 && stage->err != stage->in &&
+        stage->err != stage->out) {
+        close(stage->err);
+    }
+    stage->err = -1;
+    if (stage->in != -1) {
+        close(stage->in);
+        stage->in = -1;
+    }
+    if (stage->out != -1) {
+        close(stage->out);
+        stage->out = -1;
+    }
+}
+
+spawnplan spawnplan_destroy(spawnplan self) {
+    assert(self != NULL);
+
+    for (unsigned int i = 0u; i < self->count; i++) {
+        close_redirections(&self->stages[i]);
+        free(self->stages[i].path);
+        free(self->stages[i].argv);
+    }
+    free(self->stages);
+    free(self);
+    return NULL;
+}
+
+void spawnplan_set_stage(spawnplan self, unsigned int stage, const char* path,
+                         char** argv, int in, int out) {
+    assert(self != NULL && stage < self->count && argv != NULL &&
+           argv[0] != NULL && self->stages[stage].argv == NULL);
+
+    struct stage* s = &self->stages[stage];
+    s->path = NULL;
+    if (path != NULL) {
+        s->path = strdup(path);
+        if (s->path == NULL) {
+            perror("Error fatal: malloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->argv = argv;
+    s->in = in;
+    s->out = out;
+}
+
+void spawnplan_set_error(spawnplan self, unsigned int stage, int err) {
+    assert(self != NULL && stage < self->count &&
+           self->stages[stage].argv != NULL &&
+           (err >= 0 || err == SPAWNPLAN_OUTPUT));
+
+    self->stages[stage].err = err;
+}
+
+void spawnplan_set_threads(spawnplan self, unsigned int threads) {
+    assert(self != NULL);
+
+    self->threads = threads;
+}
+
+/* Arma las acciones de la etapa i: la entrada, la salida y el error. Los
+ * pipes tienen O_CLOEXEC, así que los que no pasan por dup2 se cierran solos
+ * en el exec.
+ */
+static void prepare_stage(spawnplan self, unsigned int i) {
+    struct stage* s = &self->stages[i];
+    int in = s->in;
+    if (in == -1 && i > 0u) {
+        in = self->pipes[2u * (i - 1u)];
+    }
+    int out = s->out;
+    if (out == -1 && i + 1u < self->count) {
+        out = self->pipes[2u * i + 1u];
+    }
+    posix_spawn_file_actions_init(&s->actions);
+    if (in != -1) {
+        posix_spawn_file_actions_adddup2(&s->actions, in, STDIN_FILENO);
+    }
+    if (out != -1) {
+        posix_spawn_file_actions_adddup2(&s->actions, out, STDOUT_FILENO);
+    }
+    int err = s->err;
+    if (err == SPAWNPLAN_OUTPUT) {
+        // La salida sin la redirección: el pipe o la del shell
+        err = STDOUT_FILENO;
+        if (i + 1u < self->count) {
+            err = self->pipes[2u * i + 1u];
+        }
+    }
+    if (err != -1) {
+        posix_spawn_file_actions_adddup2(&s->actions, err, STDERR_FILENO);
+    }
+}
+
+/* Lanza la etapa i (ya preparada) e imprime el error si no se puede */
+static void launch_stage(spawnplan self, unsigned int i) {
+    struct stage* s = &self->stages[i];
+    pid_t pid = -1;
+    int error = 0;
+    if (s->path != NULL) {
+        error = posix_spawn(&pid, s->path, &s->actions, NULL, s->argv,
+                            environ);
+    } else {
+        error = posix_spawnp(&pid, s->argv[0], &s->actions, NULL, s->argv,
+                             environ);
+    }
+    if (error != 0) {
+        // Como perror, pero el errno es de este hilo
+        fprintf(stderr, "%s: %s\n", s->argv[0], strerror(error));
+        if (error == E2BIG) {
+            fprintf(stderr, ARGBATCH_HINT, s->argv[0]);
+        }
+        pid = -1;
+    } else {
+        atomic_fetch_add(&self->launched, 1u);
+    }
+    s->pid = pid;
+    s->error = error;
+}
+
+/* Toma etapas en orden hasta que no quede ninguna */
+static void* launch_thread(void* data) {
+    spawnplan self = data;
+    unsigned int i = atomic_fetch_add(&self->next, 1u);
+    while (i < self->count) {
+        if (self->stages[i].argv != NULL) {
+            launch_stage(self, i);
+        }
+        i = atomic_fetch_add(&self->next, 1u);
+    }
+    return NULL;
+}
+
+unsigned int spawnplan_run(spawnplan self, pid_t* pids) {
+    assert(self != NULL && !self->ran);
+
+    self->ran = true;
+    unsigned int pipes = self->count - 1u;
+    self->pipes = malloc((2u * pipes + 1u) * sizeof(int));
+    if (self->pipes == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    unsigned int created = 0u;
+    while (created < pipes &&
+           pipe2(self->pipes + 2u * created, O_CLOEXEC) == 0) {
+        created++;
+    }
+    if (created < pipes) {
+        // Sin todos los pipes no se lanza nada
+        perror("pipe");
+        atomic_store(&self->next, self->count);
+    }
+
+    // Todas las acciones se arman antes de lanzar la primera etapa
+    for (unsigned int i = 0u; i < self->count && created == pipes; i++) {
+        if (self->stages[i].argv != NULL) {
+            prepare_stage(self, i);
+        }
+    }
+
+    unsigned int threads = self->threads;
+    if (threads == 0u) {
+        threads = (self->count + SPAWNPLAN_STAGES_PER_THREAD - 1u) /
+                  SPAWNPLAN_STAGES_PER_THREAD;
+        threads = threads > SPAWNPLAN_MAX_THREADS ? SPAWNPLAN_MAX_THREADS
+                                                  : threads;
+    }
+    threads = threads > self->count ? self->count : threads;
+    // El hilo que llama también lanza etapas
+    pthread_t helpers[SPAWNPLAN_MAX_THREADS];
+    unsigned int running = 0u;
+    while (running + 1u < threads && running < SPAWNPLAN_MAX_THREADS &&
+           pthread_create(&helpers[running], NULL, launch_thread, self) == 0) {
+        running++;
+    }
+    launch_thread(self);
+    for (unsigned int k = 0u; k < running; k++) {
+        pthread_join(helpers[k], NULL);
+    }
+
+    // Los extremos de los pipes y las redirecciones ya son de las etapas
+    for (unsigned int i = 0u; i < 2u * created; i++) {
+        close(self->pipes[i]);
+    }
+    free(self->pipes);
+    self->pipes = NULL;
+    for (unsigned int i = 0u; i < self->count; i++) {
+        struct stage* s = &self->stages[i];
+        if (s->argv != NULL && created == pipes) {
+            posix_spawn_file_actions_destroy(&s->actions);
+        }
+        close_redirections(s);
+        if (pids != NULL) {
+            pids[i] = s->pid;
+        }
+    }
+    return atomic_load(&self->launched);
+}
+
+int spawnplan_failure_status(spawnplan self, unsigned int stage) {
+    assert(self != NULL && stage < self->count && self->ran &&
+           self->stages[stage].pid == -1);
+
+    const struct stage* s = &self->stages[stage];
+    if (s->argv == NULL || s->error == 0) {
+        return EXIT_FAILURE;
+    }
+    return ARGBATCH_EXEC_STATUS(s->error);
+}
@@ -0,0 +1,106 @@
+/* Lanzamiento concurrente de las etapas de un pipeline.
+ *
+ * Primero se arma el plan de cada etapa: el argv, la ruta y la entrada, la
+ * salida y el error (si tiene redirecciones, ya abiertas). Después
+ * spawnplan_run crea todos los pipes de una vez, arma las acciones de
+ * archivo de cada etapa (dup2 del pipe o de la redirección a la entrada, a
+ * la salida y al error) y lanza las etapas con posix_spawn desde varios
+ * hilos a la vez, sin que el shell tenga que hacer nada entre una y otra. En
+ * un pipeline largo la primera etapa arranca enseguida, y las demás en
+ * paralelo.
+ *
+ * Los pipes se crean con O_CLOEXEC: cada etapa se queda solo con los
+ * extremos que le tocan (los que pasan por dup2), sin cerrar el resto uno
+ * por uno, y una etapa lanzada en otro hilo no hereda los pipes de las
+ * demás.
+ *
+ * posix_spawn no copia la memoria del shell (glibc usa clone con
+ * CLONE_VM | CLONE_VFORK), así que tampoco depende de lo grande que sea.
+ * Los procesos son hijos del que llama a spawnplan_run.
+ */
+
+#ifndef _SPAWNPLAN_H_
+#define _SPAWNPLAN_H_
+
+#include <sys/types.h>
+
+typedef struct spawnplan_s* spawnplan;
+
+/*
+ * Nuevo plan para un pipeline de `stages' etapas, sin ninguna armada.
+ * Requires: stages > 0
+ * Ensures: result != NULL
+ */
+spawnplan spawnplan_new(unsigned int stages);
+
+/*
+ * Destruye `self', cerrando las redirecciones que no se llegaron a usar.
+ * Requires: self != NULL
+ * Ensures: result == NULL
+ */
+spawnplan spawnplan_destroy(spawnplan self);
+
+/*
+ * Arma la etapa `stage'.
+ *   path: ruta del ejecutable (se copia), o NULL para buscar argv[0] en el
+ *       PATH
+ *   argv: terminado en NULL. El arreglo pasa a ser del plan (las cadenas
+ *       no, y tienen que seguir siendo válidas hasta spawnplan_run)
+ *   in, out: redirecciones ya abiertas (pasan a ser del plan), o -1 para
+ *       usar el pipe con la etapa anterior o la siguiente (o la entrada o
+ *       la salida del shell en los extremos)
+ * Una etapa que no se arma no se lanza, pero sus pipes se crean igual (las
+ * vecinas ven el final del archivo).
+ * Requires: self != NULL && stage < cantidad de etapas && argv != NULL &&
+ *     argv[0] != NULL && la etapa no estaba armada
+ */
+void spawnplan_set_stage(spawnplan self, unsigned int stage, const char* path,
+                         char** argv, int in, int out);
+
+/* Para spawnplan_set_error: el error va a donde iría la salida de la etapa
+ * sin su redirección (el pipe con la siguiente, o la salida del shell en la
+ * última), como en "a 2>&1 | b"
+ */
+#define SPAWNPLAN_OUTPUT (-2)
+
+/*
+ * Redirige el error de la etapa `stage' (si no, es el del shell).
+ *   err: redirección ya abierta (pasa a ser del plan, y puede ser la misma
+ *       que la entrada o la salida de la etapa, como en "a > f 2>&1"), o
+ *       SPAWNPLAN_OUTPUT
+ * Requires: self != NULL && stage < cantidad de etapas && la etapa está
+ *     armada && (err >= 0 || err == SPAWNPLAN_OUTPUT)
+ */
+void spawnplan_set_error(spawnplan self, unsigned int stage, int err);
+
+/*
+ * Cantidad máxima de hilos para lanzar las etapas (0, lo inicial, es uno
+ * cada SPAWNPLAN_STAGES_PER_THREAD etapas, hasta SPAWNPLAN_MAX_THREADS).
+ * Requires: self != NULL
+ */
+void spawnplan_set_threads(spawnplan self, unsigned int threads);
+
+#define SPAWNPLAN_STAGES_PER_THREAD 8u
+#define SPAWNPLAN_MAX_THREADS 4u
+
+/*
+ * Lanza las etapas armadas. Si alguna no se puede lanzar se imprime el
+ * error y las demás siguen igual.
+ *   pids: si no es NULL, dónde se guarda el pid de cada etapa (-1 si no se
+ *       lanzó)
+ * Returns: la cantidad de procesos lanzados
+ * Requires: self != NULL y que no se haya lanzado antes
+ */
+unsigned int spawnplan_run(spawnplan self, pid_t* pids);
+
+/*
+ * Estado de la etapa `stage' que no se lanzó, como el de un hijo que no
+ * llega a ejecutar el comando: ARGBATCH_EXEC_STATUS (argbatch.h) del error
+ * de posix_spawn, o EXIT_FAILURE si la etapa no estaba armada (o no se
+ * pudieron crear los pipes).
+ * Requires: self != NULL && stage < cantidad de etapas && ya se lanzó y
+ *     el pid de la etapa es -1
+ */
+int spawnplan_failure_status(spawnplan self, unsigned int stage);
+
+#endif
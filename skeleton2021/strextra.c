@@ -3,7 +3,7 @@
 #include <stdlib.h>   /* calloc()...                        */
 #include <string.h>   /* strlen(), strncat, strcopy()...    */
 
-char* strmerge(char* s1, char* s2) {
+char* strmerge(const char* s1, const char* s2) {
     char* merge = NULL;
     size_t len_s1 = strlen(s1);
     size_t len_s2 = strlen(s2);
@@ -16,7 +16,7 @@
  *     merge != NULL && strlen(merge) == strlen(s1) + strlen(s2)
  *
  */
-char* strmerge(char* s1, char* s2);
+char* strmerge(const char* s1, const char* s2);
 
 /*
  * Concatena 2 cadenas re-allocando la primera para agregar el espacio
@@ -14,6 +14,52 @@
 #include "test_execute.h"
 #endif /* TEST_EXECUTE */
 
+#ifdef TEST_HISTORY
+#include "test_history.h"
+#endif /* TEST_HISTORY */
+
+#ifdef TEST_PATHINDEX
+#include "test_pathindex.h"
+#endif /* TEST_PATHINDEX */
+
+#ifdef TEST_DIRINDEX
+#include "test_dirindex.h"
+#endif /* TEST_DIRINDEX */
+#ifdef TEST_VARS
+#include "test_vars.h"
+#endif /* TEST_VARS */
+#ifdef TEST_PATHEXP
+#include "test_pathexp.h"
+#endif /* TEST_PATHEXP */
+#ifdef TEST_ARGBATCH
+#include "test_argbatch.h"
+#endif /* TEST_ARGBATCH */
+#ifdef TEST_ZYGOTE
+#include "test_zygote.h"
+#endif /* TEST_ZYGOTE */
+#ifdef TEST_SPAWNPLAN
+#include "test_spawnplan.h"
+#endif /* TEST_SPAWNPLAN */
+#ifdef TEST_SCRIPTCACHE
+#include "test_scriptcache.h"
+#endif /* TEST_SCRIPTCACHE */
+#ifdef TEST_PARSEAHEAD
+#include "test_parseahead.h"
+#endif /* TEST_PARSEAHEAD */
+#ifdef TEST_PREFETCH
+#include "test_prefetch.h"
+#endif /* TEST_PREFETCH */
+
+#ifdef TEST_ARITH
+#include "test_arith.h"
+#endif /* TEST_ARITH */
+#ifdef TEST_PROMPT
+#include "test_prompt.h"
+#endif /* TEST_PROMPT */
+#ifdef TEST_SEGMENTS
+#include "test_segments.h"
+#endif /* TEST_SEGMENTS */
+
 int main (void)
 {
     int number_failed;
@@ -32,6 +78,52 @@ int main (void)
     srunner_add_suite(sr, execute_suite());
 #endif /* TEST_EXECUTE */
 
+#ifdef TEST_HISTORY
+    srunner_add_suite(sr, history_suite());
+#endif /* TEST_HISTORY */
+
+#ifdef TEST_PATHINDEX
+    srunner_add_suite(sr, pathindex_suite());
+#endif /* TEST_PATHINDEX */
+
+#ifdef TEST_DIRINDEX
+    srunner_add_suite(sr, dirindex_suite());
+#endif /* TEST_DIRINDEX */
+#ifdef TEST_VARS
+    srunner_add_suite(sr, vars_suite());
+#endif /* TEST_VARS */
+#ifdef TEST_PATHEXP
+    srunner_add_suite(sr, pathexp_suite());
+#endif /* TEST_PATHEXP */
+#ifdef TEST_ARGBATCH
+    srunner_add_suite(sr, argbatch_suite());
+#endif /* TEST_ARGBATCH */
+#ifdef TEST_ZYGOTE
+    srunner_add_suite(sr, zygote_suite());
+#endif /* TEST_ZYGOTE */
+#ifdef TEST_SPAWNPLAN
+    srunner_add_suite(sr, spawnplan_suite());
+#endif /* TEST_SPAWNPLAN */
+#ifdef TEST_SCRIPTCACHE
+    srunner_add_suite(sr, scriptcache_suite());
+#endif /* TEST_SCRIPTCACHE */
+#ifdef TEST_PARSEAHEAD
+    srunner_add_suite(sr, parseahead_suite());
+#endif /* TEST_PARSEAHEAD */
+#ifdef TEST_PREFETCH
+    srunner_add_suite(sr, prefetch_suite());
+#endif /* TEST_PREFETCH */
+
+#ifdef TEST_ARITH
+    srunner_add_suite(sr, arith_suite());
+#endif /* TEST_ARITH */
+#ifdef TEST_PROMPT
+    srunner_add_suite(sr, prompt_suite());
+#endif /* TEST_PROMPT */
+#ifdef TEST_SEGMENTS
+    srunner_add_suite(sr, segments_suite());
+#endif /* TEST_SEGMENTS */
+
     srunner_set_log(sr, "test.log");
     srunner_run_all(sr, CK_NORMAL);
     number_failed = srunner_ntests_failed(sr);
@@ -0,0 +1,260 @@
+#include <check.h>
+#include "test_argbatch.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "argbatch.h"
+#include "command.h"
+
+/* Archivo donde escriben los comandos de las pruebas */
+static char output[] = "/tmp/mybash-argbatch-XXXXXX";
+
+static void setup (void) {
+    int fd = mkstemp (strcpy (output, "/tmp/mybash-argbatch-XXXXXX"));
+    fail_unless (fd != -1, NULL);
+    close (fd);
+}
+
+static void teardown (void) {
+    unlink (output);
+}
+
+/* Arma un comando con las palabras de words (separadas por espacios) */
+static scommand command (const char *words) {
+    char buffer[512];
+    scommand cmd = scommand_new ();
+    strcpy (buffer, words);
+    for (char *w = strtok (buffer, " "); w != NULL; w = strtok (NULL, " ")) {
+        scommand_push_back (cmd, strdup (w));
+    }
+    return cmd;
+}
+
+/* Comando batch que agrega a output una línea por invocación con la
+ * cantidad de argumentos que recibió, y después los argumentos 1..count
+ */
+static scommand count_command (const char *options, unsigned int count) {
+    char script[128];
+    sprintf (script, "echo $# >> %s", output);
+    scommand cmd = command ("batch");
+    if (options[0] != '\0') {
+        scommand extra = command (options);
+        while (!scommand_is_empty (extra)) {
+            scommand_push_back (cmd, strdup (scommand_front (extra)));
+            scommand_pop_front (extra);
+        }
+        scommand_destroy (extra);
+    }
+    scommand_push_back (cmd, strdup ("sh"));
+    scommand_push_back (cmd, strdup ("-c"));
+    scommand_push_back (cmd, strdup (script));
+    scommand_push_back (cmd, strdup ("sh"));
+    char number[16];
+    for (unsigned int i = 1; i <= count; i++) {
+        sprintf (number, "%u", i);
+        scommand_push_back (cmd, strdup (number));
+    }
+    return cmd;
+}
+
+/* Lee las líneas de output como números.
+ * Returns: cuántas hay
+ */
+static unsigned int read_counts (unsigned int *counts, unsigned int max) {
+    FILE *file = fopen (output, "r");
+    unsigned int lines = 0;
+    fail_unless (file != NULL, NULL);
+    while (lines < max && fscanf (file, "%u", &counts[lines]) == 1) {
+        lines++;
+    }
+    fclose (file);
+    return lines;
+}
+
+/* Precondiciones */
+START_TEST (test_fit_null)
+{
+    argbatch_fit (NULL, 1, 100);
+}
+END_TEST
+
+START_TEST (test_exec_null)
+{
+    argbatch_exec (NULL);
+}
+END_TEST
+
+START_TEST (test_exec_not_batch)
+{
+    scommand cmd = command ("echo batch");
+    argbatch_exec (cmd);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_is_prefix)
+{
+    scommand cmd = command ("batch ls");
+    fail_unless (argbatch_is_prefix (cmd), NULL);
+    scommand_destroy (cmd);
+    cmd = command ("ls batch");
+    fail_if (argbatch_is_prefix (cmd), NULL);
+    scommand_destroy (cmd);
+    cmd = scommand_new ();
+    fail_if (argbatch_is_prefix (cmd), NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_fit)
+{
+    char *args[] = {"uno", "dos", "tres", "cuatro"};
+    size_t each = sizeof (char *) + 1;
+    fail_unless (argbatch_fit (args, 4, 0) == 0, NULL);
+    fail_unless (argbatch_fit (args, 4, 3 + each) == 1, NULL);
+    fail_unless (argbatch_fit (args, 4, 3 + each + 2) == 1, NULL);
+    fail_unless (argbatch_fit (args, 4, 6 + 2 * each) == 2, NULL);
+    fail_unless (argbatch_fit (args, 4, 1000) == 4, NULL);
+    fail_unless (argbatch_fit (NULL, 0, 1000) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_limit)
+{
+    long arg_max = sysconf (_SC_ARG_MAX);
+    size_t limit = argbatch_limit ();
+    fail_unless (limit > 0, NULL);
+    fail_unless (arg_max <= 0 || limit < (size_t)arg_max, NULL);
+}
+END_TEST
+
+/* Ejecución */
+START_TEST (test_single_batch)
+{
+    unsigned int counts[64];
+    scommand cmd = count_command ("-f 3", 10);
+    fail_unless (argbatch_exec (cmd) == 0, NULL);
+    fail_unless (read_counts (counts, 64) == 1, NULL);
+    fail_unless (counts[0] == 10, NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_split)
+{
+    unsigned int counts[256];
+    scommand cmd = count_command ("-f 3 -s 200", 100);
+    fail_unless (argbatch_exec (cmd) == 0, NULL);
+    unsigned int lines = read_counts (counts, 256);
+    unsigned int total = 0;
+    fail_unless (lines > 1, NULL);
+    for (unsigned int i = 0; i < lines; i++) {
+        /* Cada invocación lleva al menos un argumento */
+        fail_unless (counts[i] > 0, NULL);
+        total += counts[i];
+    }
+    fail_unless (total == 100, NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_parallel)
+{
+    unsigned int counts[256];
+    scommand cmd = count_command ("-j 4 -f 3 -s 200", 100);
+    fail_unless (argbatch_exec (cmd) == 0, NULL);
+    unsigned int lines = read_counts (counts, 256);
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < lines; i++) {
+        total += counts[i];
+    }
+    fail_unless (total == 100, NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_status)
+{
+    scommand cmd = command ("batch -s 60 true a b c d e f g h");
+    fail_unless (argbatch_exec (cmd) == 0, NULL);
+    scommand_destroy (cmd);
+
+    /* Fallan */
+    cmd = command ("batch -s 60 false a b c d e f g h");
+    fail_unless (argbatch_exec (cmd) == ARGBATCH_FAILED, NULL);
+    scommand_destroy (cmd);
+
+    /* No se puede ejecutar */
+    cmd = command ("batch mybash-no-existe a b");
+    fail_unless (argbatch_exec (cmd) == 127, NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_status_not_found_quiet)
+{
+    /* Con stderr cerrado el mensaje de error no se puede escribir (y eso
+     * cambia errno): igual es 127, porque no se encontró el comando
+     */
+    int saved = dup (STDERR_FILENO);
+    close (STDERR_FILENO);
+    scommand cmd = command ("batch mybash-no-existe a b");
+    int status = argbatch_exec (cmd);
+    dup2 (saved, STDERR_FILENO);
+    close (saved);
+    fail_unless (status == 127, NULL);
+    scommand_destroy (cmd);
+}
+END_TEST
+
+START_TEST (test_usage)
+{
+    const char *wrong[] = {"batch", "batch -j", "batch -x ls", "batch -j x ls",
+                           "batch -f 1 ls", NULL};
+    for (unsigned int i = 0; wrong[i] != NULL; i++) {
+        scommand cmd = command (wrong[i]);
+        fail_unless (argbatch_exec (cmd) == ARGBATCH_USAGE, wrong[i]);
+        scommand_destroy (cmd);
+    }
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *argbatch_suite (void)
+{
+    Suite *s = suite_create ("argbatch");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+    TCase *tc_execution = tcase_create ("Execution");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_fit_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_exec_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_exec_not_batch, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_test (tc_functionality, test_is_prefix);
+    tcase_add_test (tc_functionality, test_fit);
+    tcase_add_test (tc_functionality, test_limit);
+    suite_add_tcase (s, tc_functionality);
+
+    /* Ejecución */
+    tcase_add_checked_fixture (tc_execution, setup, teardown);
+    tcase_add_test (tc_execution, test_single_batch);
+    tcase_add_test (tc_execution, test_split);
+    tcase_add_test (tc_execution, test_parallel);
+    tcase_add_test (tc_execution, test_status);
+    tcase_add_test (tc_execution, test_status_not_found_quiet);
+    tcase_add_test (tc_execution, test_usage);
+    suite_add_tcase (s, tc_execution);
+
+    return s;
+}
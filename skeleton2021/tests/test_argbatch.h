@@ -0,0 +1,8 @@
+#ifndef TEST_ARGBATCH_H
+#define TEST_ARGBATCH_H
+
+#include <check.h>
+
+Suite *argbatch_suite (void);
+
+#endif
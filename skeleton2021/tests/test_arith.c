@@ -0,0 +1,258 @@
+#include <check.h>
+#include "test_arith.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "arith.h"
+#include "vars.h"
+
+/* Evalúa text y compara con expected */
+static void check_value (const char *text, int64_t expected) {
+    int64_t result = -12345;
+    char message[256];
+    bool ok = arith_eval (text, strlen (text), &result);
+    sprintf (message, "%s = %" PRId64 " (ok: %d)", text, result, ok);
+    fail_unless (ok && result == expected, message);
+}
+
+/* text tiene un error: no cambia el resultado */
+static void check_error (const char *text) {
+    int64_t result = -12345;
+    fail_unless (!arith_eval (text, strlen (text), &result), text);
+    fail_unless (result == -12345, text);
+}
+
+static void setup (void) {
+    arith_clear ();
+}
+
+/* Precondiciones */
+START_TEST (test_eval_null)
+{
+    int64_t result = 0;
+    arith_eval (NULL, 1, &result);
+}
+END_TEST
+
+START_TEST (test_eval_null_result)
+{
+    arith_eval ("1", 1, NULL);
+}
+END_TEST
+
+START_TEST (test_find_end_null)
+{
+    arith_find_end (NULL, NULL);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_numbers)
+{
+    check_value ("", 0);
+    check_value ("  \t ", 0);
+    check_value ("42", 42);
+    check_value ("010", 8);
+    check_value ("0x1F", 31);
+    check_value ("0XfF", 255);
+    check_value ("9223372036854775807", INT64_MAX);
+    check_value ("9223372036854775807 + 1", INT64_MIN);
+    check_value ("-9223372036854775807 - 1", INT64_MIN);
+    check_error ("08");
+    check_error ("0x");
+    check_error ("12abc");
+    /* Solo se usan los primeros `length' bytes */
+    int64_t result = 0;
+    fail_unless (arith_eval ("12+3", 2, &result) && result == 12, NULL);
+}
+END_TEST
+
+START_TEST (test_operators)
+{
+    check_value ("1 + 2 * 3", 7);
+    check_value ("(1 + 2) * 3", 9);
+    check_value ("10 - 4 - 3", 3);
+    check_value ("7 / 2", 3);
+    check_value ("-7 / 2", -3);
+    check_value ("-7 % 3", -1);
+    check_value ("2 ** 10", 1024);
+    check_value ("2 ** 3 ** 2", 512);
+    check_value ("-2 ** 2", 4);
+    check_value ("1 << 4 | 1", 17);
+    check_value ("-16 >> 2", -4);
+    check_value ("6 & 3 ^ 1", 3);
+    check_value ("~0", -1);
+    check_value ("!0 + !5", 1);
+    check_value ("- -3", 3);
+    check_value ("+3", 3);
+    check_value ("3 < 4 == 1", 1);
+    check_value ("3 >= 4", 0);
+    check_value ("4 <= 4 && 2 != 2", 0);
+    check_value ("0 || 7", 1);
+    check_value ("1 ? 2 : 3", 2);
+    check_value ("0 ? 2 : 0 ? 3 : 4", 4);
+    check_value ("1, 2, 3", 3);
+    check_value ("$((1 + 1)) * 2", 4);
+    check_value ("(-9223372036854775807 - 1) / -1", INT64_MIN);
+    check_value ("(-9223372036854775807 - 1) % -1", 0);
+    check_value ("1 << 64", 1);
+}
+END_TEST
+
+START_TEST (test_errors)
+{
+    check_error ("1 / 0");
+    check_error ("1 % (2 - 2)");
+    check_error ("2 ** -1");
+    check_error ("1 +");
+    check_error ("(1 + 2");
+    check_error ("1 2");
+    check_error ("1 ? 2");
+    check_error ("3 = 4");
+    check_error ("1 @ 2");
+    check_error ("++3");
+}
+END_TEST
+
+START_TEST (test_variables)
+{
+    vars_set ("X", "5");
+    vars_set ("Y", " -0x10 ");
+    vars_unset ("NADA");
+    vars_set ("VACIA", "");
+    check_value ("X + $X + ${X}", 15);
+    check_value ("Y", -16);
+    check_value ("NADA + VACIA", 0);
+    /* Un valor que no es un número se evalúa */
+    vars_set ("E", "X * 2");
+    vars_set ("F", "E + 1");
+    check_value ("F", 11);
+    vars_set ("R", "R");
+    check_error ("R + 1");
+    vars_set ("MAL", "1 +");
+    check_error ("MAL");
+    vars_set_status (3);
+    check_value ("$? * 2", 6);
+    vars_set_status (0);
+    check_value ("$$", (int64_t)getpid ());
+}
+END_TEST
+
+START_TEST (test_assignments)
+{
+    vars_unset ("A");
+    check_value ("A = 3", 3);
+    fail_unless (strcmp (vars_get ("A"), "3") == 0, NULL);
+    check_value ("A += 4", 7);
+    check_value ("A *= 2, A -= 1", 13);
+    check_value ("A <<= 2", 52);
+    check_value ("A %= 10", 2);
+    check_value ("A |= 5", 7);
+    check_value ("B = A = 1", 1);
+    fail_unless (strcmp (vars_get ("B"), "1") == 0, NULL);
+    check_value ("A++ + A", 3);
+    check_value ("++A", 3);
+    check_value ("A--", 3);
+    check_value ("--A", 1);
+    fail_unless (strcmp (vars_get ("A"), "1") == 0, NULL);
+    check_error ("A /= 0");
+    fail_unless (strcmp (vars_get ("A"), "1") == 0, NULL);
+}
+END_TEST
+
+/* && || y ?: no evalúan lo que no hace falta */
+START_TEST (test_short_circuit)
+{
+    vars_set ("C", "0");
+    check_value ("0 && (C = 1)", 0);
+    check_value ("1 || (C = 1)", 1);
+    check_value ("1 ? 5 : (C = 1)", 5);
+    check_value ("0 ? (C = 1) : 6", 6);
+    check_value ("0 || 1 / 1", 1);
+    check_value ("0 && 1 / 0", 0);
+    fail_unless (strcmp (vars_get ("C"), "0") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_cache)
+{
+    unsigned long hits = 0, misses = 0, hits2 = 0, misses2 = 0;
+    vars_set ("I", "0");
+    arith_stats (&hits, &misses);
+    for (unsigned int i = 0; i < 10; i++) {
+        check_value ("I += 1", i + 1);
+    }
+    arith_stats (&hits2, &misses2);
+    fail_unless (misses2 - misses == 1, NULL);
+    fail_unless (hits2 - hits == 9, NULL);
+    arith_stats (NULL, NULL);
+    /* Las expresiones con errores no se guardan */
+    arith_stats (&hits, &misses);
+    check_error ("1 +");
+    check_error ("1 +");
+    arith_stats (&hits2, &misses2);
+    fail_unless (misses2 - misses == 2 && hits2 == hits, NULL);
+    /* Una variable que se evalúa como la misma expresión */
+    vars_set ("S", "S2 + 1");
+    vars_set ("S2", "4");
+    check_value ("S + 1", 6);
+    check_value ("S + 1", 6);
+    /* Muchas expresiones distintas */
+    char text[32];
+    for (unsigned int i = 0; i < 4 * ARITH_CACHE; i++) {
+        sprintf (text, "%u + 1", i);
+        check_value (text, i + 1);
+    }
+    arith_clear ();
+    check_value ("I", 10);
+}
+END_TEST
+
+START_TEST (test_find_end)
+{
+    const char *text = "1 + (2 * 3))) x";
+    fail_unless (arith_find_end (text, text + strlen (text)) == text + 11, NULL);
+    text = "1)";
+    fail_unless (arith_find_end (text, text + 1) == NULL, NULL);
+    fail_unless (arith_find_end (text, text + 2) == NULL, NULL);
+    text = "(1) + (2))) x";
+    fail_unless (arith_find_end (text, text + strlen (text)) == text + 9, NULL);
+    text = "((1)";
+    fail_unless (arith_find_end (text, text + strlen (text)) == NULL, NULL);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *arith_suite (void)
+{
+    Suite *s = suite_create ("arith");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_eval_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_eval_null_result, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_find_end_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, NULL);
+    tcase_add_test (tc_functionality, test_numbers);
+    tcase_add_test (tc_functionality, test_operators);
+    tcase_add_test (tc_functionality, test_errors);
+    tcase_add_test (tc_functionality, test_variables);
+    tcase_add_test (tc_functionality, test_assignments);
+    tcase_add_test (tc_functionality, test_short_circuit);
+    tcase_add_test (tc_functionality, test_cache);
+    tcase_add_test (tc_functionality, test_find_end);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
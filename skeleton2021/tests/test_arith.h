@@ -0,0 +1,8 @@
+#ifndef TEST_ARITH_H
+#define TEST_ARITH_H
+
+#include <check.h>
+
+Suite *arith_suite (void);
+
+#endif
@@ -0,0 +1,238 @@
+#include <check.h>
+#include "test_dirindex.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dirindex.h"
+
+/* Un árbol de directorios temporal, y el índice dentro de él */
+static char root[] = "/tmp/mybash-dirindex-XXXXXX";
+static char index_path[64];
+static const char *tree[] = {"proyectos", "proyectos/mybash", "proyectos/mybash/src",
+                             "proyectos/otro", "proyectos/otro/src",
+                             "documentos", "documentos/informes", NULL};
+
+/* Ruta absoluta de un directorio del árbol, en memoria estática */
+static const char *dir (const char *name) {
+    static char path[128];
+    sprintf (path, "%s/%s", root, name);
+    return path;
+}
+
+static void setup (void) {
+    fail_unless (mkdtemp (strcpy (root, "/tmp/mybash-dirindex-XXXXXX")) != NULL, NULL);
+    for (unsigned int i = 0; tree[i] != NULL; i++) {
+        mkdir (dir (tree[i]), 0755);
+    }
+    sprintf (index_path, "%s/index", root);
+    fail_unless (dirindex_open (index_path), NULL);
+}
+
+static void teardown (void) {
+    dirindex_close ();
+    unlink (index_path);
+    /* En orden inverso, para que los directorios estén vacíos */
+    unsigned int count = 0;
+    while (tree[count] != NULL) {
+        count++;
+    }
+    for (unsigned int i = count; i > 0; i--) {
+        rmdir (dir (tree[i - 1]));
+    }
+    rmdir (root);
+}
+
+/* Busca las palabras de words (separadas por espacios) y compara con el
+ * directorio expected del árbol (NULL: que no encuentre nada)
+ */
+static void check_query (const char *words, const char *expected) {
+    char buffer[128], result[256];
+    char *list[8];
+    size_t count = 0;
+    strcpy (buffer, words);
+    for (char *w = strtok (buffer, " "); w != NULL; w = strtok (NULL, " ")) {
+        list[count] = w;
+        count++;
+    }
+    bool found = dirindex_query (list, count, result, sizeof (result));
+    if (expected == NULL) {
+        fail_if (found, NULL);
+    } else {
+        fail_unless (found, NULL);
+        fail_unless (strcmp (result, dir (expected)) == 0, NULL);
+    }
+}
+
+static void visit (const char *name, unsigned int times) {
+    for (unsigned int i = 0; i < times; i++) {
+        dirindex_visit (dir (name));
+    }
+}
+
+/* Precondiciones */
+START_TEST (test_open_null)
+{
+    dirindex_open (NULL);
+}
+END_TEST
+
+START_TEST (test_visit_relative)
+{
+    dirindex_visit ("proyectos");
+}
+END_TEST
+
+START_TEST (test_query_empty)
+{
+    char result[16];
+    dirindex_query (NULL, 0, result, sizeof (result));
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_visit)
+{
+    fail_unless (dirindex_length () == 0, NULL);
+    visit ("proyectos/mybash/src", 1);
+    visit ("documentos", 2);
+    visit ("proyectos/mybash/src", 1);
+    fail_unless (dirindex_length () == 2, NULL);
+}
+END_TEST
+
+START_TEST (test_query)
+{
+    visit ("proyectos/mybash/src", 1);
+    visit ("documentos/informes", 1);
+    check_query ("informes", "documentos/informes");
+    check_query ("INFOR", "documentos/informes");
+    check_query ("mybash src", "proyectos/mybash/src");
+    /* La última palabra tiene que estar en el último componente */
+    check_query ("mybash", NULL);
+    /* Las palabras en orden */
+    check_query ("src mybash", NULL);
+    check_query ("nada", NULL);
+}
+END_TEST
+
+/* Entre varios que coinciden, gana el más visitado */
+START_TEST (test_query_rank)
+{
+    visit ("proyectos/mybash/src", 3);
+    visit ("proyectos/otro/src", 1);
+    check_query ("src", "proyectos/mybash/src");
+    check_query ("otro src", "proyectos/otro/src");
+    visit ("proyectos/otro/src", 5);
+    check_query ("src", "proyectos/otro/src");
+}
+END_TEST
+
+/* Con las letras salteadas, si no hay otro */
+START_TEST (test_query_fuzzy)
+{
+    visit ("documentos/informes", 1);
+    visit ("documentos", 1);
+    check_query ("dcm", "documentos");
+    check_query ("infs", "documentos/informes");
+    check_query ("xyz", NULL);
+}
+END_TEST
+
+/* No se elige el directorio actual, ni uno que ya no existe */
+START_TEST (test_query_skips)
+{
+    char *cwd = getcwd (NULL, 0);
+    visit ("proyectos/mybash/src", 3);
+    visit ("proyectos/otro/src", 1);
+    fail_unless (chdir (dir ("proyectos/mybash/src")) == 0, NULL);
+    check_query ("src", "proyectos/otro/src");
+    fail_unless (chdir (cwd) == 0, NULL);
+    free (cwd);
+    rmdir (dir ("proyectos/mybash/src"));
+    check_query ("src", "proyectos/otro/src");
+}
+END_TEST
+
+/* El índice queda en el archivo, y crece */
+START_TEST (test_persistent)
+{
+    char name[64];
+    for (unsigned int i = 0; i < 1000; i++) {
+        sprintf (name, "proyectos/no-existe-%u", i);
+        visit (name, 1);
+    }
+    visit ("documentos/informes", 1);
+    dirindex_close ();
+    fail_unless (dirindex_length () == 0, NULL);
+    fail_unless (dirindex_open (index_path), NULL);
+    fail_unless (dirindex_length () == 1001, NULL);
+    check_query ("informes", "documentos/informes");
+}
+END_TEST
+
+/* Al pasar el máximo se olvidan los poco visitados */
+START_TEST (test_aging)
+{
+    char name[64];
+    for (unsigned int i = 0; i < 200; i++) {
+        sprintf (name, "proyectos/no-existe-%u", i);
+        visit (name, 1);
+    }
+    visit ("documentos/informes", (unsigned int) DIRINDEX_MAX_RANK);
+    fail_unless (dirindex_length () < 201, NULL);
+    check_query ("informes", "documentos/informes");
+}
+END_TEST
+
+/* No se usa (ni se pisa) un archivo que no es un índice */
+START_TEST (test_foreign)
+{
+    char path[80];
+    sprintf (path, "%s/otro", root);
+    int fd = open (path, O_WRONLY | O_CREAT, 0600);
+    fail_unless (write (fd, "/home/usuario\n/tmp\n/usr/local/lib/algo\n", 39) == 39, NULL);
+    close (fd);
+    fail_if (dirindex_open (path), NULL);
+    fail_unless (dirindex_length () == 0, NULL);
+    struct stat st;
+    fail_unless (stat (path, &st) == 0 && st.st_size == 39, NULL);
+    unlink (path);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *dirindex_suite (void)
+{
+    Suite *s = suite_create ("dirindex");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_checked_fixture (tc_preconditions, setup, teardown);
+    tcase_add_test_raise_signal (tc_preconditions, test_open_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_visit_relative, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_query_empty, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_visit);
+    tcase_add_test (tc_functionality, test_query);
+    tcase_add_test (tc_functionality, test_query_rank);
+    tcase_add_test (tc_functionality, test_query_fuzzy);
+    tcase_add_test (tc_functionality, test_query_skips);
+    tcase_add_test (tc_functionality, test_persistent);
+    tcase_add_test (tc_functionality, test_aging);
+    tcase_add_test (tc_functionality, test_foreign);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
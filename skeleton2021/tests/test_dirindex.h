@@ -0,0 +1,8 @@
+#ifndef TEST_DIRINDEX_H
+#define TEST_DIRINDEX_H
+
+#include <check.h>
+
+Suite *dirindex_suite (void);
+
+#endif
@@ -1,11 +1,19 @@
 #include <check.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <time.h>
+#include <unistd.h>
 #include "test_execute.h"
 
 #include "syscall_mock.h"
+#include "../builtin.h"
 #include "../execute.h"
+#include "../parser.h"
+#include "../pathindex.h"
+#include "../vars.h"
+#include "../zygote.h"
 
 /* Precondiciones */
 
@@ -69,6 +77,79 @@ START_TEST (test_builtin_exit)
 }
 END_TEST
 
+/* Arma en test_pipe un exit con el argumento arg, o sin argumentos si es
+ * NULL
+ */
+static void push_exit (const char *arg)
+{
+    scommand exit_cmd = scommand_new ();
+    scommand_push_back (exit_cmd, strdup ("exit"));
+    if (arg != NULL) {
+        scommand_push_back (exit_cmd, strdup (arg));
+    }
+    pipeline_push_back (test_pipe, exit_cmd);
+}
+
+START_TEST (test_builtin_exit_keeps_status)
+{
+    /* "false; exit": sin argumento, el estado es el del último pipeline */
+    vars_set_status (EXIT_FAILURE);
+    push_exit (NULL);
+
+    fail_unless (execute_pipeline (test_pipe)==EXIT_FAILURE, NULL);
+    fail_unless (vars_status ()==EXIT_FAILURE, NULL);
+    fail_unless (exit_from_mybash, NULL);
+}
+END_TEST
+
+START_TEST (test_builtin_exit_status)
+{
+    /* "exit 3", y el estado es módulo 256 */
+    push_exit ("3");
+    fail_unless (execute_pipeline (test_pipe)==3, NULL);
+    fail_unless (vars_status ()==3, NULL);
+    fail_unless (exit_from_mybash, NULL);
+
+    exit_from_mybash = false;
+    pipeline_pop_front (test_pipe);
+    push_exit ("257");
+    fail_unless (execute_pipeline (test_pipe)==1, NULL);
+}
+END_TEST
+
+START_TEST (test_builtin_exit_not_numeric)
+{
+    /* "exit abc" sale con 2; "exit 1 2" no sale */
+    push_exit ("abc");
+    fail_unless (execute_pipeline (test_pipe)==2, NULL);
+    fail_unless (exit_from_mybash, NULL);
+
+    exit_from_mybash = false;
+    vars_set_status (EXIT_SUCCESS);
+    pipeline_pop_front (test_pipe);
+    push_exit ("1");
+    scommand_push_back (pipeline_front (test_pipe), strdup ("2"));
+    fail_unless (execute_pipeline (test_pipe)==EXIT_FAILURE, NULL);
+    fail_unless (!exit_from_mybash, NULL);
+}
+END_TEST
+
+START_TEST (test_subshell_exit_status)
+{
+    /* "( exit 3 )": el subshell termina con 3 y el shell sigue */
+    pipeline body = test_pipe;
+    test_pipe = pipeline_new ();
+    push_exit ("3");
+    scommand group = scommand_new ();
+    scommand_set_body (group, SCOMMAND_SUBSHELL, test_pipe);
+    test_pipe = body;
+    pipeline_push_back (test_pipe, group);
+
+    fail_unless (execute_pipeline (test_pipe)==3, NULL);
+    fail_unless (!exit_from_mybash, NULL);
+}
+END_TEST
+
 START_TEST (test_builtin_chdir)
 {
     /* Ejecuta un chdir,que debería pasar a una sola syscall de chdir sin crear
@@ -542,6 +623,217 @@ START_TEST (test_redir_inout_child)
 }
 END_TEST
 
+/* Arma en test_pipe "( echo word > /dev/null )". Los mocks no llegan a
+ * execute.c, así que el subshell, si no corre en el shell, es un hijo de
+ * verdad
+ */
+static void push_subshell_echo (const char *word)
+{
+    scommand echo = scommand_new ();
+    scommand_push_back (echo, strdup ("echo"));
+    scommand_push_back (echo, strdup (word));
+    scommand_set_redir_out (echo, strdup ("/dev/null"));
+    pipeline body = pipeline_new ();
+    pipeline_push_back (body, echo);
+    scommand group = scommand_new ();
+    scommand_set_body (group, SCOMMAND_SUBSHELL, body);
+    pipeline_push_back (test_pipe, group);
+}
+
+START_TEST (test_subshell_arith_assign)
+{
+    /* "( echo $((y=7)) ); echo $y": la asignación no se ve afuera, así que
+     * el subshell tiene que correr en un hijo
+     */
+    push_subshell_echo ("\001$((y=7))");
+
+    execute_pipeline (test_pipe);
+
+    fail_unless (vars_get ("y")==NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_subshell_arith_increment)
+{
+    /* Lo mismo con ++ */
+    vars_set ("y", "1");
+    push_subshell_echo ("\001$((y++))");
+
+    execute_pipeline (test_pipe);
+
+    fail_unless (strcmp (vars_get ("y"), "1")==0, NULL);
+}
+END_TEST
+
+START_TEST (test_subshell_default_assign)
+{
+    /* "( echo ${z:=9} ); echo ${z-unset}": ${z:=9} asigna, así que el
+     * subshell tiene que correr en un hijo
+     */
+    push_subshell_echo ("\001${z:=9}");
+
+    execute_pipeline (test_pipe);
+
+    fail_unless (vars_get ("z")==NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_subshell_substring_assign)
+{
+    /* Los índices de ${P:i:n} son expresiones, y también pueden asignar */
+    push_subshell_echo ("\001${z:y=1:2}");
+
+    execute_pipeline (test_pipe);
+
+    fail_unless (vars_get ("y")==NULL, NULL);
+}
+END_TEST
+
+
+/* Parsea y ejecuta la línea text (sin mocks: los comandos son internos).
+ * Devuelve el estado
+ */
+static int run_line (const char *text)
+{
+    Parser parser = parser_new_from_buffer (text, strlen (text));
+    pipeline line = parse_pipeline (parser);
+    fail_unless (line != NULL, NULL);
+    int status = execute_pipeline (line);
+    pipeline_destroy (line);
+    parser_destroy (parser);
+    return status;
+}
+
+START_TEST (test_loop_break)
+{
+    run_line ("for i in 1 2 3; do x=$i; break; y=$i; done\n");
+    fail_unless (strcmp (vars_get ("x"), "1")==0, NULL);
+    fail_unless (vars_get ("y")==NULL, NULL);
+    /* Termina, aunque la condición se cumpla siempre */
+    run_line ("while true; do break; done; z=1\n");
+    fail_unless (strcmp (vars_get ("z"), "1")==0, NULL);
+    fail_unless (builtin_loop_jumps==0 && builtin_loop_depth==0, NULL);
+}
+END_TEST
+
+START_TEST (test_loop_break_levels)
+{
+    /* break 2 corta los dos ciclos; un n mayor, todos los que hay */
+    run_line ("for i in 1 2; do for j in a b; do x=$i$j; break 2; done; "
+              "y=$i; done\n");
+    fail_unless (strcmp (vars_get ("x"), "1a")==0, NULL);
+    fail_unless (vars_get ("y")==NULL, NULL);
+    run_line ("while true; do until false; do break 9; done; done; z=1\n");
+    fail_unless (strcmp (vars_get ("z"), "1")==0, NULL);
+    /* Con un n inválido se corta igual un ciclo, con error */
+    fail_unless (run_line ("while true; do break 0; done\n")==EXIT_FAILURE,
+                 NULL);
+    fail_unless (builtin_loop_jumps==0 && builtin_loop_depth==0, NULL);
+}
+END_TEST
+
+START_TEST (test_loop_continue)
+{
+    run_line ("for i in 1 2 3; do x=$i; continue; y=$i; done\n");
+    fail_unless (strcmp (vars_get ("x"), "3")==0, NULL);
+    fail_unless (vars_get ("y")==NULL, NULL);
+    /* continue 2 sigue con la próxima vuelta del ciclo de afuera */
+    run_line ("for i in 1 2; do for j in a b; do x=$i$j; continue 2; "
+              "y=$j; done; y=$i; done\n");
+    fail_unless (strcmp (vars_get ("x"), "2a")==0, NULL);
+    fail_unless (vars_get ("y")==NULL, NULL);
+    fail_unless (builtin_loop_jumps==0 && builtin_loop_depth==0, NULL);
+}
+END_TEST
+
+START_TEST (test_loop_jump_outside)
+{
+    /* Fuera de un ciclo no hacen nada, y lo que sigue se ejecuta */
+    fail_unless (run_line ("break; continue; x=1\n")==EXIT_SUCCESS, NULL);
+    fail_unless (strcmp (vars_get ("x"), "1")==0, NULL);
+    fail_unless (builtin_loop_jumps==0, NULL);
+}
+END_TEST
+
+/* Lee el archivo path entero en buffer */
+static void read_file (const char *path, char *buffer, size_t size)
+{
+    FILE *file = fopen (path, "r");
+    fail_unless (file != NULL, NULL);
+    size_t length = fread (buffer, 1, size - 1, file);
+    buffer[length] = '\0';
+    fclose (file);
+}
+
+/* '>' y 'n>' vacían el archivo antes de escribir (no queda la cola de uno
+ * más largo), y '>>' agrega al final
+ */
+START_TEST (test_redir_out_truncates)
+{
+    char path[] = "/tmp/mybash-truncate-XXXXXX";
+    char line[128];
+    char content[64];
+    int fd = mkstemp (path);
+    fail_unless (fd != -1, NULL);
+    /* close es el de syscall_mock.h */
+    fclose (fdopen (fd, "w"));
+
+    sprintf (line, "echo longline > %s\n", path);
+    run_line (line);
+    sprintf (line, "echo x > %s\n", path);
+    run_line (line);
+    read_file (path, content, sizeof (content));
+    fail_unless (strcmp (content, "x\n") == 0, NULL);
+
+    sprintf (line, "echo longline 1> %s; echo y 1> %s\n", path, path);
+    run_line (line);
+    read_file (path, content, sizeof (content));
+    fail_unless (strcmp (content, "y\n") == 0, NULL);
+
+    sprintf (line, "echo z >> %s\n", path);
+    run_line (line);
+    read_file (path, content, sizeof (content));
+    fail_unless (strcmp (content, "y\nz\n") == 0, NULL);
+    unlink (path);
+}
+END_TEST
+
+/* Un comando que no se encuentra termina con 127, y uno que no se puede
+ * ejecutar con 126, como en sh (también la última etapa de un pipeline
+ * largo, que se lanza con spawnplan)
+ */
+START_TEST (test_exec_failure_status)
+{
+    fail_unless (run_line ("mybash-no-existe 2> /dev/null\n")==127, NULL);
+    fail_unless (vars_status ()==127, NULL);
+    fail_unless (run_line ("/dev/null 2> /dev/null\n")==126, NULL);
+    fail_unless (run_line ("true | true | true | mybash-no-existe 2> /dev/null\n")==127,
+                 NULL);
+    fail_unless (run_line ("mybash-no-existe 2> /dev/null | true\n")==EXIT_SUCCESS,
+                 NULL);
+}
+END_TEST
+
+/* Con el zygote y el índice del PATH andando (como en una terminal), un
+ * PATH=... antes del comando se usa para buscarlo, no el índice del shell
+ */
+START_TEST (test_prefix_path)
+{
+    struct timespec ten_ms = {0, 10000000l};
+    fail_unless (zygote_start (), NULL);
+    pathindex_start ();
+    for (unsigned int i = 0; i < 200 && !pathindex_ready (); i++) {
+        nanosleep (&ten_ms, NULL);
+    }
+    fail_unless (pathindex_ready (), NULL);
+
+    fail_unless (run_line ("ls / > /dev/null\n")==EXIT_SUCCESS, NULL);
+    fail_unless (run_line ("PATH=/nonexistent ls / > /dev/null 2>&1\n")==127,
+                 NULL);
+    pathindex_stop ();
+    zygote_stop ();
+}
+END_TEST
 
 /* TODO:
  * background process, hijo?
@@ -573,6 +865,10 @@ Suite *execute_suite (void)
     tcase_add_checked_fixture (tc_functionality, setup, teardown);
     tcase_add_test (tc_functionality, test_null);
     tcase_add_test (tc_functionality, test_builtin_exit);
+    tcase_add_test (tc_functionality, test_builtin_exit_keeps_status);
+    tcase_add_test (tc_functionality, test_builtin_exit_status);
+    tcase_add_test (tc_functionality, test_builtin_exit_not_numeric);
+    tcase_add_test (tc_functionality, test_subshell_exit_status);
     tcase_add_test (tc_functionality, test_builtin_chdir);
     tcase_add_test (tc_functionality, test_external_1_simple_parent);
     tcase_add_test (tc_functionality, test_external_1_simple_child);
@@ -585,6 +881,17 @@ Suite *execute_suite (void)
     tcase_add_test (tc_functionality, test_redir_out_child);
     tcase_add_test (tc_functionality, test_redir_in_child);
     tcase_add_test (tc_functionality, test_redir_inout_child);
+    tcase_add_test (tc_functionality, test_subshell_arith_assign);
+    tcase_add_test (tc_functionality, test_subshell_arith_increment);
+    tcase_add_test (tc_functionality, test_subshell_default_assign);
+    tcase_add_test (tc_functionality, test_subshell_substring_assign);
+    tcase_add_test (tc_functionality, test_loop_break);
+    tcase_add_test (tc_functionality, test_loop_break_levels);
+    tcase_add_test (tc_functionality, test_loop_continue);
+    tcase_add_test (tc_functionality, test_loop_jump_outside);
+    tcase_add_test (tc_functionality, test_redir_out_truncates);
+    tcase_add_test (tc_functionality, test_exec_failure_status);
+    tcase_add_test (tc_functionality, test_prefix_path);
     suite_add_tcase (s, tc_functionality);
 
     return s;
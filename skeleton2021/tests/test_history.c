@@ -0,0 +1,353 @@
+#include <check.h>
+#include "test_history.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "histlog.h"
+#include "history.h"
+
+static history hist = NULL;
+
+static void setup (void) {
+    hist = history_new ();
+}
+
+static void teardown (void) {
+    if (hist != NULL) {
+        history_destroy (hist); hist = NULL;
+    }
+}
+
+/* Historial guardado, en un directorio temporal */
+static char dir[] = "/tmp/mybash-histlog-XXXXXX";
+static char path[64];
+static char log_path[64];
+
+static void setup_saved (void) {
+    setup ();
+    fail_unless (mkdtemp (strcpy (dir, "/tmp/mybash-histlog-XXXXXX")) != NULL, NULL);
+    sprintf (path, "%s/history", dir);
+    sprintf (log_path, "%s/history.log", dir);
+}
+
+static void teardown_saved (void) {
+    teardown ();
+    unlink (path);
+    unlink (log_path);
+    rmdir (dir);
+}
+
+/* Vuelve a leer el historial guardado en un historial nuevo */
+static void reload (void) {
+    histlog saved = NULL;
+    history_destroy (hist);
+    hist = history_new ();
+    saved = histlog_open (path, hist);
+    fail_unless (saved != NULL, NULL);
+    histlog_close (saved);
+}
+
+static off_t file_size (const char *name) {
+    struct stat st;
+    fail_unless (stat (name, &st) == 0, NULL);
+    return st.st_size;
+}
+
+/* Busca query antes de before, y comprueba que se encuentre la línea
+ * expected (o ninguna, si expected es -1)
+ */
+static void check_search (const char *query, unsigned int before, int expected) {
+    unsigned int found = 0;
+    bool result = history_search (hist, query, before, &found);
+    if (expected < 0) {
+        fail_if (result, NULL);
+    } else {
+        fail_unless (result, NULL);
+        fail_unless (found == (unsigned int) expected, NULL);
+    }
+}
+
+/* Precondiciones */
+START_TEST (test_destroy_null)
+{
+    history_destroy (NULL);
+}
+END_TEST
+
+START_TEST (test_add_null)
+{
+    history_add (hist, NULL);
+}
+END_TEST
+
+START_TEST (test_add_newline)
+{
+    history_add (hist, "ls\n");
+}
+END_TEST
+
+START_TEST (test_get_out_of_range)
+{
+    history_add (hist, "ls");
+    history_get (hist, 1);
+}
+END_TEST
+
+START_TEST (test_search_out_of_range)
+{
+    unsigned int found = 0;
+    history_search (hist, "ls", 1, &found);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_add_get)
+{
+    fail_unless (history_length (hist) == 0, NULL);
+    fail_unless (history_add (hist, "ls -l"), NULL);
+    fail_unless (history_add (hist, "echo hola"), NULL);
+    fail_unless (history_length (hist) == 2, NULL);
+    fail_unless (strcmp (history_get (hist, 0), "ls -l") == 0, NULL);
+    fail_unless (strcmp (history_get (hist, 1), "echo hola") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_add_copies)
+{
+    char line[] = "ls -l";
+    history_add (hist, line);
+    line[0] = 'X';
+    fail_unless (strcmp (history_get (hist, 0), "ls -l") == 0, NULL);
+}
+END_TEST
+
+/* Las líneas vacías y las repetidas seguidas no se guardan */
+START_TEST (test_add_ignored)
+{
+    fail_if (history_add (hist, ""), NULL);
+    history_add (hist, "ls");
+    fail_if (history_add (hist, "ls"), NULL);
+    history_add (hist, "pwd");
+    fail_unless (history_add (hist, "ls"), NULL);
+    fail_unless (history_length (hist) == 3, NULL);
+}
+END_TEST
+
+START_TEST (test_search)
+{
+    history_add (hist, "make test");
+    history_add (hist, "ls -l | grep foo");
+    history_add (hist, "make bench");
+    history_add (hist, "echo hola");
+
+    check_search ("make", 4, 2);
+    check_search ("make", 2, 0);
+    check_search ("make", 0, -1);
+    check_search ("grep foo", 4, 1);
+    check_search ("grep bar", 4, -1);
+    check_search ("hola", 3, -1);
+    /* Consultas más cortas que un trigrama, y la vacía */
+    check_search ("ls", 4, 1);
+    check_search ("e", 2, 1);
+    check_search ("", 4, 3);
+    /* Toda la línea, y más que la línea */
+    check_search ("echo hola", 4, 3);
+    check_search ("echo hola!", 4, -1);
+}
+END_TEST
+
+/* Los trigramas de query están en la línea, pero no juntos */
+START_TEST (test_search_verifies)
+{
+    history_add (hist, "abcd xbcde");
+    check_search ("abcde", 1, -1);
+    check_search ("bcde", 1, 0);
+}
+END_TEST
+
+/* Muchas líneas con trigramas repetidos, y la buscada bien atrás */
+START_TEST (test_search_many)
+{
+    char line[64];
+    for (unsigned int i = 0; i < 20000; i++) {
+        sprintf (line, "echo linea numero %u", i);
+        history_add (hist, line);
+    }
+    check_search ("numero 123", 20000, 12399);
+    check_search ("numero 123 ", 20000, -1);
+    check_search ("numero 77", 20000, 7799);
+    check_search ("numero 7", 7, -1);
+    check_search ("echo", 1, 0);
+}
+END_TEST
+
+START_TEST (test_saved_new)
+{
+    histlog saved = histlog_open (path, hist);
+    fail_unless (saved != NULL, NULL);
+    fail_unless (history_length (hist) == 0, NULL);
+    saved = histlog_close (saved);
+    fail_unless (saved == NULL, NULL);
+    fail_unless (file_size (log_path) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_saved_reload)
+{
+    histlog saved = histlog_open (path, hist);
+    histlog_append (saved, "ls -l");
+    histlog_append (saved, "echo hola");
+    histlog_close (saved);
+    reload ();
+    fail_unless (history_length (hist) == 2, NULL);
+    fail_unless (strcmp (history_get (hist, 0), "ls -l") == 0, NULL);
+    fail_unless (strcmp (history_get (hist, 1), "echo hola") == 0, NULL);
+}
+END_TEST
+
+/* Dos sesiones a la vez escriben en el mismo registro */
+START_TEST (test_saved_shared)
+{
+    history other = history_new ();
+    histlog saved1 = histlog_open (path, hist);
+    histlog saved2 = histlog_open (path, other);
+    char line[32];
+    for (unsigned int i = 0; i < 1000; i++) {
+        sprintf (line, "cmd %u", i);
+        histlog_append (i % 2 == 0 ? saved1 : saved2, line);
+    }
+    histlog_close (saved1);
+    histlog_close (saved2);
+    history_destroy (other);
+    reload ();
+    fail_unless (history_length (hist) == 1000, NULL);
+    for (unsigned int i = 0; i < 1000; i++) {
+        unsigned int found = 0;
+        sprintf (line, "cmd %u", i);
+        fail_unless (history_search (hist, line, 1000, &found), NULL);
+    }
+}
+END_TEST
+
+/* Al compactar queda la aparición más nueva de cada línea, y el registro
+ * vacío */
+START_TEST (test_saved_compact)
+{
+    histlog saved = histlog_open (path, hist);
+    histlog_append (saved, "ls");
+    histlog_append (saved, "pwd");
+    histlog_append (saved, "ls");
+    histlog_append (saved, "make");
+    histlog_append (saved, "pwd");
+    histlog_close (saved);
+    fail_unless (histlog_compact (path), NULL);
+    fail_unless (file_size (log_path) == 0, NULL);
+    saved = histlog_open (path, hist);
+    histlog_append (saved, "echo");
+    histlog_close (saved);
+    reload ();
+    fail_unless (history_length (hist) == 4, NULL);
+    fail_unless (strcmp (history_get (hist, 0), "ls") == 0, NULL);
+    fail_unless (strcmp (history_get (hist, 1), "make") == 0, NULL);
+    fail_unless (strcmp (history_get (hist, 2), "pwd") == 0, NULL);
+    fail_unless (strcmp (history_get (hist, 3), "echo") == 0, NULL);
+}
+END_TEST
+
+/* Un registro cortado al final no se lee */
+START_TEST (test_saved_truncated)
+{
+    histlog saved = histlog_open (path, hist);
+    histlog_append (saved, "ls");
+    histlog_close (saved);
+    int fd = open (log_path, O_WRONLY | O_APPEND);
+    fail_unless (fd != -1, NULL);
+    fail_unless (write (fd, "\x20\0\0\0\0\0\0\0abc", 11) == 11, NULL);
+    close (fd);
+    reload ();
+    fail_unless (history_length (hist) == 1, NULL);
+}
+END_TEST
+
+/* No se usa (ni se pisa) un archivo que no es un historial de mybash */
+START_TEST (test_saved_foreign)
+{
+    int fd = open (path, O_WRONLY | O_CREAT, 0600);
+    fail_unless (write (fd, "ls -l\necho hola\n", 16) == 16, NULL);
+    close (fd);
+    fail_unless (histlog_open (path, hist) == NULL, NULL);
+    fail_if (histlog_compact (path), NULL);
+    fail_unless (file_size (path) == 16, NULL);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *history_suite (void)
+{
+    Suite *s = suite_create ("history");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+    TCase *tc_saved = tcase_create ("Saved");
+
+    /* Precondiciones */
+    tcase_add_checked_fixture (tc_preconditions, setup, teardown);
+    tcase_add_test_raise_signal (tc_preconditions, test_destroy_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_add_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_add_newline, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_get_out_of_range, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_search_out_of_range, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_add_get);
+    tcase_add_test (tc_functionality, test_add_copies);
+    tcase_add_test (tc_functionality, test_add_ignored);
+    tcase_add_test (tc_functionality, test_search);
+    tcase_add_test (tc_functionality, test_search_verifies);
+    tcase_add_test (tc_functionality, test_search_many);
+    suite_add_tcase (s, tc_functionality);
+
+    /* Historial guardado */
+    tcase_add_checked_fixture (tc_saved, setup_saved, teardown_saved);
+    tcase_add_test (tc_saved, test_saved_new);
+    tcase_add_test (tc_saved, test_saved_reload);
+    tcase_add_test (tc_saved, test_saved_shared);
+    tcase_add_test (tc_saved, test_saved_compact);
+    tcase_add_test (tc_saved, test_saved_truncated);
+    tcase_add_test (tc_saved, test_saved_foreign);
+    suite_add_tcase (s, tc_saved);
+
+    return s;
+}
+
+/* Para testing de memoria */
+void history_memory_test (void) {
+    unsigned int found = 0;
+
+    setup ();
+    for (unsigned int i = 0; i < 2000; i++) {
+        char line[32];
+        sprintf (line, "cmd %u", i);
+        history_add (hist, line);
+    }
+    history_search (hist, "cmd 12", history_length (hist), &found);
+    teardown ();
+
+    setup_saved ();
+    histlog saved = histlog_open (path, hist);
+    histlog_append (saved, "ls");
+    histlog_append (saved, "ls");
+    histlog_close (saved);
+    histlog_compact (path);
+    reload ();
+    teardown_saved ();
+}
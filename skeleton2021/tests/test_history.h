@@ -0,0 +1,10 @@
+#ifndef TEST_HISTORY_H
+#define TEST_HISTORY_H
+
+#include <check.h>
+
+Suite *history_suite (void);
+
+void history_memory_test (void);
+
+#endif
@@ -0,0 +1,184 @@
+#include <check.h>
+#include "test_parseahead.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "parseahead.h"
+#include "parser.h"
+
+static Parser parser = NULL;
+static parseahead ahead = NULL;
+
+static void start (const char *text) {
+    parser = parser_new_from_buffer (text, strlen (text));
+    fail_unless (parser != NULL, NULL);
+    ahead = parseahead_new (parser);
+    fail_unless (ahead != NULL, NULL);
+}
+
+static void teardown (void) {
+    if (ahead != NULL) {
+        ahead = parseahead_destroy (ahead);
+    }
+    if (parser != NULL) {
+        parser = parser_destroy (parser);
+    }
+}
+
+/* Toma el siguiente pipeline y lo compara con expected (NULL: un error) */
+static bool check_next (const char *expected) {
+    bool eof = false;
+    pipeline apipe = parseahead_next (ahead, &eof);
+    if (expected == NULL) {
+        fail_unless (apipe == NULL, NULL);
+    } else {
+        fail_unless (apipe != NULL, NULL);
+        char *str = pipeline_to_string (apipe);
+        fail_unless (strcmp (str, expected) == 0, NULL);
+        free (str);
+        pipeline_destroy (apipe);
+    }
+    return eof;
+}
+
+/* Precondiciones */
+START_TEST (test_new_null)
+{
+    parseahead_new (NULL);
+}
+END_TEST
+
+START_TEST (test_next_null)
+{
+    bool eof = false;
+    parseahead_next (NULL, &eof);
+}
+END_TEST
+
+START_TEST (test_peek_null)
+{
+    parseahead_peek (NULL);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_order)
+{
+    start ("echo a\nls | wc\nif true; then cd; fi\nexit\n");
+    fail_unless (!check_next ("echo a"), NULL);
+    fail_unless (!check_next ("ls | wc"), NULL);
+    fail_unless (!check_next ("if true; then cd; fi"), NULL);
+    fail_unless (!check_next ("exit"), NULL);
+    /* Después del último fin de línea queda una línea vacía */
+    fail_unless (check_next (NULL), NULL);
+}
+END_TEST
+
+START_TEST (test_errors)
+{
+    /* Las líneas con errores llegan como NULL, en su lugar */
+    start ("echo a\nls |\nfi\necho b");
+    fail_unless (!check_next ("echo a"), NULL);
+    fail_unless (!check_next (NULL), NULL);
+    fail_unless (!check_next (NULL), NULL);
+    fail_unless (check_next ("echo b"), NULL);
+}
+END_TEST
+
+START_TEST (test_peek)
+{
+    start ("echo a\necho b\n");
+    fail_unless (!check_next ("echo a"), NULL);
+    /* Se espera a que el hilo parsee el siguiente */
+    pipeline next = parseahead_peek (ahead);
+    for (unsigned int i = 0; i < 1000 && next == NULL; i++) {
+        usleep (1000);
+        next = parseahead_peek (ahead);
+    }
+    fail_unless (next != NULL, NULL);
+    fail_unless (strcmp (scommand_get_nth (pipeline_front (next), 1), "b") == 0, NULL);
+    fail_unless (!check_next ("echo b"), NULL);
+    fail_unless (check_next (NULL), NULL);
+    fail_unless (parseahead_peek (ahead) == NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_many)
+{
+    /* Más líneas que las que entran en la cola */
+    char text[PARSEAHEAD_DEPTH * 40];
+    text[0] = '\0';
+    for (unsigned int i = 0; i < 4 * PARSEAHEAD_DEPTH; i++) {
+        strcat (text, "echo x\n");
+    }
+    start (text);
+    for (unsigned int i = 0; i < 4 * PARSEAHEAD_DEPTH; i++) {
+        fail_unless (!check_next ("echo x"), NULL);
+    }
+    fail_unless (check_next (NULL), NULL);
+}
+END_TEST
+
+START_TEST (test_destroy_early)
+{
+    /* Se destruye sin tomar todo (la cola llena) */
+    char text[PARSEAHEAD_DEPTH * 40];
+    text[0] = '\0';
+    for (unsigned int i = 0; i < 4 * PARSEAHEAD_DEPTH; i++) {
+        strcat (text, "echo x\n");
+    }
+    start (text);
+    fail_unless (!check_next ("echo x"), NULL);
+    ahead = parseahead_destroy (ahead);
+    fail_unless (ahead == NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_destroy_waiting)
+{
+    /* El hilo espera la entrada de un pipe que no se cierra */
+    int fds[2];
+    fail_unless (pipe (fds) == 0, NULL);
+    fail_unless (write (fds[1], "echo a\n", 7) == 7, NULL);
+    parser = parser_new_from_fd (fds[0]);
+    fail_unless (parser != NULL, NULL);
+    ahead = parseahead_new (parser);
+    fail_unless (ahead != NULL, NULL);
+    fail_unless (!check_next ("echo a"), NULL);
+    ahead = parseahead_destroy (ahead);
+    parser = parser_destroy (parser);
+    close (fds[0]);
+    close (fds[1]);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *parseahead_suite (void)
+{
+    Suite *s = suite_create ("parseahead");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_new_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_next_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_peek_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, NULL, teardown);
+    tcase_add_test (tc_functionality, test_order);
+    tcase_add_test (tc_functionality, test_errors);
+    tcase_add_test (tc_functionality, test_peek);
+    tcase_add_test (tc_functionality, test_many);
+    tcase_add_test (tc_functionality, test_destroy_early);
+    tcase_add_test (tc_functionality, test_destroy_waiting);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_PARSEAHEAD_H
+#define TEST_PARSEAHEAD_H
+
+#include <check.h>
+
+Suite *parseahead_suite (void);
+
+#endif
@@ -7,33 +7,37 @@
 #include <assert.h>
 #include <string.h>
 
+#include <unistd.h>
+
 #include "parser.h"
+#include "scan.h"
 
 /* Algunas variables/funciones auxiliares para ser usadas por el resto de los
  * tests
  */
 
-static Lexer lexer = NULL;
+static Parser parser = NULL;
 static FILE *input = NULL;
 static pipeline output = NULL;
+static linecache cache = NULL;
 
-static void init_lexer(char *content) {
-    /* Inicializa `lexer' con un archivo simulado con `content' de
+static void init_parser(char *content) {
+    /* Inicializa `parser' con un archivo simulado con `content' de
      * contenido. Para no crear un archivo temporal, usa extensiones de GNU
      */
-    assert (lexer==NULL);
+    assert (parser==NULL);
     assert (input==NULL);
 
     input = fmemopen(content, strlen(content), "r");
-    lexer = lexer_new (input);
+    parser = parser_new (input);
 }
 
 static void setup (void) {
 }
 
 static void teardown (void) {
-    if (lexer != NULL) {
-        lexer_destroy (lexer); lexer = NULL;
+    if (parser != NULL) {
+        parser_destroy (parser); parser = NULL;
     }
     if (input != NULL) {
         fclose (input); input = NULL;
@@ -41,14 +45,15 @@ static void teardown (void) {
     if (output != NULL) {
         pipeline_destroy (output); output = NULL;
     }
+    if (cache != NULL) {
+        linecache_destroy (cache); cache = NULL;
+    }
 }
 
 static void check_newline (void) {
-    /* Comprueba que el lexer esté parado en un newline */
-    fail_if (lexer_is_off (lexer), NULL);
-    lexer_next_char (lexer, "\n");
-    fail_unless (blength (lexer_item (lexer)) == 1, NULL);
-    bdestroy (lexer_item (lexer));
+    /* Comprueba que el parser haya consumido la línea entera, y nada más */
+    fail_if (parser_at_eof (parser), NULL);
+    fail_unless (fgetc (input) == EOF, NULL);
 }
 
 static void check_argument (scommand cmd, const char *first) {
@@ -76,14 +81,14 @@ END_TEST
 
 START_TEST (test_parse_closed)
 {
-    init_lexer("x");
-    /* forzamos estado de is_off en el lexer */
-    lexer_skip (lexer, ALPHA);
-    lexer_skip (lexer, ALPHA);
-    assert (lexer_is_off (lexer));
+    init_parser("x");
+    /* llegamos al fin de archivo */
+    output = parse_pipeline (parser);
+    assert (parser_at_eof (parser));
 
     /* Y tratamos de usar el parser (debería fallar) */
-    output = parse_pipeline (lexer);
+    pipeline_destroy (output);
+    output = parse_pipeline (parser);
 }
 END_TEST
 
@@ -92,30 +97,27 @@ END_TEST
  */
 START_TEST (test_consumes_until_newline)
 {
-    char* after = NULL;
+    char after[16];
 
-    init_lexer("ls\n--------\n\n\n");
-    output = parse_pipeline (lexer);
+    init_parser("ls\n--------\n\n\n");
+    output = parse_pipeline (parser);
 
-    /* Debería haber quedado justo listo para consumir el '\n' */
-    check_newline();
+    /* Debería haber quedado justo después del '\n' */
+    fail_if (parser_at_eof (parser), NULL);
 
     /* Consumió hasta el \n equivocado? */
-    fail_if (lexer_is_off (lexer), NULL);
-    lexer_next (lexer, "-");
-    after = lexer_item (lexer);
+    fail_unless (fgets (after, sizeof (after), input) != NULL, NULL);
     /* Debería leer 8 veces "-", o sea que fue el primer \n: */
-    fail_unless (blength(after) == 8, NULL);
-    bdestroy(after);
+    fail_unless (strcmp (after, "--------\n") == 0, NULL);
 }
 END_TEST
 
 START_TEST (test_consumes_until_eof)
 {
-    init_lexer("ls");
-    output = parse_pipeline (lexer);
+    init_parser("ls");
+    output = parse_pipeline (parser);
 
-    fail_unless (lexer_is_off (lexer), NULL); /* No consumió todo! debería */
+    fail_unless (parser_at_eof (parser), NULL); /* No consumió todo! debería */
     fail_unless (feof (input), NULL);
 }
 END_TEST
@@ -126,24 +128,13 @@ END_TEST
 
 START_TEST (test_empty)
 {
-    scommand s = NULL;
-
-    init_lexer("\n");
-    output = parse_pipeline (lexer);
+    init_parser("\n");
+    output = parse_pipeline (parser);
     check_newline();
-    /* Esto debería generar un pipeline de un elemento, con un comando
-     * vacío adentro
-     */
-    fail_unless (pipeline_length (output) == 1, NULL);
-    s = pipeline_front (output);
-    fail_unless (scommand_length (s) == 0, NULL);
-    /* Y no es en background */
-    fail_unless (pipeline_get_wait (output), NULL);
-    /*
-     * Según como hagan el parser, una alternativa es hacer que esto genere un
-     * parser de 0 elementos. Si lo prefieren lo pueden cambiar, pero tienen
-     * que cambiar este test para que se corresponda con eso.
+    /* Igual que el parser precompilado, una línea vacía no genera ningún
+     * pipeline
      */
+    fail_unless (output == NULL, NULL);
 }
 END_TEST
 
@@ -151,8 +142,8 @@ START_TEST (test_command)
 {
     scommand s = NULL;
 
-    init_lexer("comando\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de un elemento, con un comando
      * de un elemento adentro
@@ -173,8 +164,8 @@ START_TEST (test_command_with_args)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 arg2\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 arg2\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de un elemento, con un comando
      * de 3 elementos adentro
@@ -197,8 +188,8 @@ START_TEST (test_command_background)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 &\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 &\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline con el flag de no esperar */
     fail_unless (pipeline_length (output) == 1, NULL);
@@ -218,8 +209,8 @@ START_TEST (test_command_redir_in)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 < entrada\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 < entrada\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de un elemento, con un comando
      * redirigido adentro
@@ -241,8 +232,8 @@ START_TEST (test_command_redir_out)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 > salida\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 > salida\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de un elemento, con un comando
      * redirigido adentro
@@ -264,8 +255,8 @@ START_TEST (test_command_redir_both)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 < entrada > salida\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 < entrada > salida\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de un elemento, con un comando
      * redirigido adentro
@@ -287,8 +278,8 @@ START_TEST (test_pipe_simple)
 {
     scommand s = NULL;
 
-    init_lexer("comando | filtro\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando | filtro\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de 2 elementos, cada uno con un comando
      * simple adentro
@@ -316,8 +307,8 @@ START_TEST (test_pipe_with_args)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 | filtro arg2\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 | filtro arg2\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de 2 elementos, cada uno con un comando
      * y argumento adentro
@@ -347,8 +338,8 @@ START_TEST (test_pipe_background)
 {
     scommand s = NULL;
 
-    init_lexer("comando arg1 | filtro arg2 &\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando arg1 | filtro arg2 &\n");
+    output = parse_pipeline (parser);
     check_newline();
     /* Esto debería generar un pipeline de 2 elementos, cada uno con un comando
      * y argumento adentro
@@ -381,8 +372,8 @@ START_TEST (test_non_alphabetic_args)
      * caracter que no signifique algo especial. Guiones, barras, igual,
      * números son ejemplos de cosas que suelen ir en argumentos.
      */
-    init_lexer("comando --size=11 /etc/passwd\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando --size=11 /etc/passwd\n");
+    output = parse_pipeline (parser);
     check_newline();
     fail_unless (pipeline_length (output) == 1, NULL);
     s = pipeline_front (output);
@@ -401,8 +392,8 @@ START_TEST (test_many_args)
 #define ARGLIST_100 ARGLIST_10 ARGLIST_10 ARGLIST_10 ARGLIST_10 ARGLIST_10 \
                     ARGLIST_10 ARGLIST_10 ARGLIST_10 ARGLIST_10 ARGLIST_10
 
-    init_lexer("comando" ARGLIST_100 ARGLIST_100 "\n");
-    output = parse_pipeline (lexer);
+    init_parser("comando" ARGLIST_100 ARGLIST_100 "\n");
+    output = parse_pipeline (parser);
     check_newline();
     fail_unless (pipeline_length (output) == 1, NULL);
     s = pipeline_front (output);
@@ -413,6 +404,781 @@ START_TEST (test_many_args)
 }
 END_TEST
 
+/* Entradas inválidas: no generan pipeline, pero consumen la línea entera */
+
+static void check_invalid (char *content) {
+    init_parser (content);
+    output = parse_pipeline (parser);
+    fail_unless (output == NULL, NULL);
+    check_newline ();
+}
+
+START_TEST (test_invalid_pipe_at_end)
+{
+    check_invalid ("comando |\n");
+}
+END_TEST
+
+START_TEST (test_invalid_pipe_at_start)
+{
+    check_invalid ("| comando\n");
+}
+END_TEST
+
+START_TEST (test_invalid_empty_stage)
+{
+    check_invalid ("comando | | filtro\n");
+}
+END_TEST
+
+START_TEST (test_invalid_redir_without_file)
+{
+    check_invalid ("comando >\n");
+}
+END_TEST
+
+START_TEST (test_invalid_after_background)
+{
+    check_invalid ("comando & | filtro\n");
+}
+END_TEST
+
+/* Entradas válidas, más difíciles */
+
+START_TEST (test_redir_before_command)
+{
+    scommand s = NULL;
+
+    init_parser("> salida comando<entrada arg1\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 1, NULL);
+    s = pipeline_front (output);
+    fail_unless (scommand_length (s) == 2, NULL);
+    check_argument (s, "comando");
+    check_argument (s, "arg1");
+    fail_unless (strcmp (scommand_get_redir_in (s), "entrada") == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (s), "salida") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_no_spaces)
+{
+    init_parser("comando|filtro>salida&\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 2, NULL);
+    fail_unless (! pipeline_get_wait (output), NULL);
+    fail_unless (strcmp (scommand_get_redir_out (pipeline_get_nth (output, 1)),
+                         "salida") == 0, NULL);
+}
+END_TEST
+
+/* parser_new_from_buffer parsea línea por línea, sin necesitar '\0' */
+START_TEST (test_from_buffer)
+{
+    const char content[] = "ls -l | wc\n\necho hola &XXXX";
+    parser = parser_new_from_buffer (content, strlen (content) - 4);
+
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL && pipeline_length (output) == 2, NULL);
+    fail_if (parser_at_eof (parser), NULL);
+    pipeline_destroy (output);
+
+    output = parse_pipeline (parser);
+    fail_unless (output == NULL, NULL);
+    fail_if (parser_at_eof (parser), NULL);
+
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL && ! pipeline_get_wait (output), NULL);
+    check_argument (pipeline_front (output), "echo");
+    check_argument (pipeline_front (output), "hola");
+    fail_unless (scommand_is_empty (pipeline_front (output)), NULL);
+    fail_unless (parser_at_eof (parser), NULL);
+}
+END_TEST
+
+/* Las comillas agrupan y se sacan; los escapes se respetan */
+START_TEST (test_quotes)
+{
+    scommand s = NULL;
+
+    init_parser("echo 'a | b' \"c > \\\"d\\\"\" e\\ f x'y'\"z\" '' > 'sal ida'\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 1, NULL);
+    s = pipeline_front (output);
+    fail_unless (scommand_length (s) == 6, NULL);
+    check_argument (s, "echo");
+    check_argument (s, "a | b");
+    check_argument (s, "c > \"d\"");
+    check_argument (s, "e f");
+    check_argument (s, "xyz");
+    check_argument (s, "");
+    fail_unless (strcmp (scommand_get_redir_out (s), "sal ida") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_invalid_unterminated_quote)
+{
+    check_invalid ("echo 'hola | wc\n");
+}
+END_TEST
+
+/* $(( )) es parte de la palabra aunque tenga blancos, '(', '>' o '|' */
+START_TEST (test_arithmetic)
+{
+    scommand s = NULL;
+
+    init_parser("echo x$((1 + (2 > 1) | 3))y>sal\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 1, NULL);
+    s = pipeline_front (output);
+    fail_unless (scommand_length (s) == 2, NULL);
+    check_argument (s, "echo");
+    check_argument (s, "\001x$((1 + (2 > 1) | 3))y");
+    fail_unless (strcmp (scommand_get_redir_out (s), "sal") == 0, NULL);
+}
+END_TEST
+
+/* ${...} también, y sus comillas son aparte de las de afuera */
+START_TEST (test_parameter_braces)
+{
+    scommand s = NULL;
+
+    init_parser("echo ${a:-x y}|wc \"${b/\"(\"/)}\"\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 2, NULL);
+    s = pipeline_front (output);
+    fail_unless (scommand_length (s) == 2, NULL);
+    check_argument (s, "echo");
+    check_argument (s, "\001${a:-x y}");
+    s = pipeline_get_nth (output, 1);
+    fail_unless (scommand_length (s) == 2, NULL);
+    check_argument (s, "wc");
+    check_argument (s, "\001\"${b/\"(\"/)}\"");
+}
+END_TEST
+
+START_TEST (test_invalid_unterminated_braces)
+{
+    check_invalid ("echo ${a:-x y\n");
+}
+END_TEST
+
+START_TEST (test_invalid_unterminated_arithmetic)
+{
+    check_invalid ("echo $((1 + (2)\n");
+}
+END_TEST
+
+/* Comprueba que la redirección general n de cmd sea (kind, fd, source,
+ * target); target NULL si no abre un archivo */
+static void check_redir (scommand cmd, unsigned int n,
+                         scommand_redir_kind kind, int fd, int source,
+                         const char *target) {
+    const scommand_redir *redir = NULL;
+
+    fail_unless (n < scommand_redir_count (cmd), NULL);
+    redir = scommand_get_redir (cmd, n);
+    fail_unless (redir->kind == kind, NULL);
+    fail_unless (redir->fd == fd, NULL);
+    fail_unless (redir->source == source, NULL);
+    if (target == NULL) {
+        fail_unless (redir->target == NULL, NULL);
+    } else {
+        fail_unless (strcmp (redir->target, target) == 0, NULL);
+    }
+}
+
+START_TEST (test_general_redirections)
+{
+    scommand s = NULL;
+    char *text = NULL;
+
+    /* '<' y '>' sin número van a redir_in y redir_out hasta la primera
+     * general; después, a la lista en orden */
+    init_parser("cmd <in >out 2>err echo 2 2>&1 >>log 3<&- <in2 12< x\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 1, NULL);
+    s = pipeline_front (output);
+    fail_unless (strcmp (scommand_get_redir_in (s), "in") == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (s), "out") == 0, NULL);
+    fail_unless (scommand_redir_count (s) == 6, NULL);
+    check_redir (s, 0, SCOMMAND_REDIR_OUTPUT, 2, -1, "err");
+    check_redir (s, 1, SCOMMAND_REDIR_DUP, 2, 1, NULL);
+    check_redir (s, 2, SCOMMAND_REDIR_APPEND, 1, -1, "log");
+    check_redir (s, 3, SCOMMAND_REDIR_CLOSE, 3, -1, NULL);
+    check_redir (s, 4, SCOMMAND_REDIR_INPUT, 0, -1, "in2");
+    check_redir (s, 5, SCOMMAND_REDIR_INPUT, 12, -1, "x");
+    text = scommand_to_string (s);
+    fail_unless (strcmp (text, "cmd echo 2 > out < in 2> err 2>&1 >> log "
+                         "3>&- < in2 12< x") == 0, NULL);
+    free (text);
+    /* El 2 separado del '>' es un argumento */
+    fail_unless (scommand_length (s) == 3, NULL);
+    check_argument (s, "cmd");
+    check_argument (s, "echo");
+    check_argument (s, "2");
+}
+END_TEST
+
+START_TEST (test_general_redirections_compound)
+{
+    scommand s = NULL;
+
+    init_parser("{ ls; } 2>&1 >\"$f\" | cat\n");
+    output = parse_pipeline (parser);
+    check_newline();
+    fail_unless (pipeline_length (output) == 2, NULL);
+    s = pipeline_front (output);
+    fail_unless (scommand_get_kind (s) == SCOMMAND_BRACE_GROUP, NULL);
+    fail_unless (scommand_get_redir_out (s) == NULL, NULL);
+    fail_unless (scommand_redir_count (s) == 2, NULL);
+    check_redir (s, 0, SCOMMAND_REDIR_DUP, 2, 1, NULL);
+    /* El archivo se expande al ejecutar, como las otras redirecciones */
+    check_redir (s, 1, SCOMMAND_REDIR_OUTPUT, 1, -1, "\001\"$f\"");
+    fail_unless (scommand_has_expansions (s), NULL);
+}
+END_TEST
+
+START_TEST (test_invalid_general_redirections)
+{
+    const char *cases[] = {"cmd 2>&x\n", "cmd >&\n", "cmd 2>&'1'\n",
+                           "cmd 256>f\n", "cmd 2>>&1\n", "cmd 2>&-1\n"};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        Parser p = parser_new_from_buffer (cases[i], strlen (cases[i]));
+        fail_unless (parse_pipeline (p) == NULL, NULL);
+        parser_destroy (p);
+    }
+}
+END_TEST
+
+/* parser_new_from_fd, leyendo de un pipe y de un archivo regular */
+static void check_from_fd (int fd) {
+    unsigned int count = 0;
+
+    parser = parser_new_from_fd (fd);
+    fail_unless (parser != NULL, NULL);
+    while (!parser_at_eof (parser)) {
+        output = parse_pipeline (parser);
+        if (output != NULL) {
+            fail_unless (pipeline_length (output) == 2, NULL);
+            check_argument (pipeline_front (output), "ls");
+            pipeline_destroy (output); output = NULL;
+            count++;
+        }
+    }
+    fail_unless (count == 1000, NULL);
+}
+
+START_TEST (test_from_fd_pipe)
+{
+    int fds[2];
+    const char line[] = "ls -l | wc\n";
+
+    fail_unless (pipe (fds) == 0, NULL);
+    if (fork () == 0) {
+        close (fds[0]);
+        for (unsigned int i = 0; i < 1000; i++) {
+            fail_unless (write (fds[1], line, strlen (line)) > 0, NULL);
+        }
+        _exit (0);
+    }
+    close (fds[1]);
+    check_from_fd (fds[0]);
+    close (fds[0]);
+}
+END_TEST
+
+START_TEST (test_from_fd_file)
+{
+    FILE *file = tmpfile ();
+    for (unsigned int i = 0; i < 999; i++) {
+        fputs ("ls -l | wc\n", file);
+    }
+    /* La última línea sin '\n' */
+    fputs ("ls -l | wc", file);
+    fflush (file);
+    check_from_fd (fileno (file));
+    fclose (file);
+}
+END_TEST
+
+/* Todas las implementaciones de scan encuentran lo mismo, en todas las
+ * posiciones y alineaciones
+ */
+START_TEST (test_scan_implementations)
+{
+    const char *impls[] = {"scalar", "sse2", "avx2"};
+    char text[200];
+
+    for (unsigned int i = 0; i < sizeof (text); i++) {
+        text[i] = (char) ('a' + i % 26);
+    }
+    for (unsigned int pos = 0; pos < sizeof (text); pos++) {
+        const char *special = text + pos;
+        text[pos] = (pos % 2 == 0) ? '\n' : '"';
+        for (unsigned int i = 0; i < 3; i++) {
+            if (!scan_select (impls[i])) {
+                continue;
+            }
+            for (unsigned int from = 0; from <= pos; from += 7) {
+                fail_unless (scan_find_special (text + from, text + sizeof (text)) == special, NULL);
+                fail_unless (scan_find_special (text + from, special) == special, NULL);
+                fail_unless (scan_find_newline (text + from, text + sizeof (text))
+                             == (pos % 2 == 0 ? special : text + sizeof (text)), NULL);
+            }
+        }
+        text[pos] = 'x';
+    }
+}
+END_TEST
+
+/* Una línea con ';', '&&' y '||' es una lista de pipelines con sus
+ * conectores
+ */
+START_TEST (test_list)
+{
+    pipeline p = NULL;
+    char *str = NULL;
+
+    init_parser ("a | b && c || d; e & f;\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    fail_unless (pipeline_length (output) == 2, NULL);
+    fail_unless (pipeline_get_connector (output) == PIPELINE_AND, NULL);
+    p = pipeline_get_next (output);
+    fail_unless (pipeline_get_connector (p) == PIPELINE_OR, NULL);
+    p = pipeline_get_next (p);
+    fail_unless (pipeline_get_connector (p) == PIPELINE_SEQUENCE, NULL);
+    p = pipeline_get_next (p);
+    fail_unless (!pipeline_get_wait (p), NULL);
+    p = pipeline_get_next (p);
+    fail_unless (pipeline_get_wait (p) && pipeline_get_next (p) == NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "a | b && c || d; e & f") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+/* Un '&' después de un and_or lo manda entero a background, como grupo */
+START_TEST (test_list_background)
+{
+    char *str = NULL;
+
+    init_parser ("a && b & c\n");
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    fail_unless (!pipeline_get_wait (output), NULL);
+    fail_unless (scommand_get_kind (pipeline_front (output)) == SCOMMAND_BRACE_GROUP, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "{ a && b; } & c") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+/* Después de un operador se sigue en la línea siguiente */
+START_TEST (test_list_continues)
+{
+    char *str = NULL;
+
+    init_parser ("a &&\n\n b | c ||\n e\nd\n");
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "a && b | c || e") == 0, NULL);
+    free (str);
+    pipeline_destroy (output);
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL && pipeline_get_next (output) == NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_invalid_lists)
+{
+    const char *cases[] = {"; a\n", "a ;; b\n", "a && || b\n", "&& a\n",
+                           "a || \n", "a & & b\n", "a |\n"};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        Parser p = parser_new_from_buffer (cases[i], strlen (cases[i]));
+        fail_unless (parse_pipeline (p) == NULL, NULL);
+        parser_destroy (p);
+    }
+}
+END_TEST
+
+/* Un grupo es un comando más del pipeline, con sus redirecciones, y su
+ * cuerpo es una lista de pipelines
+ */
+START_TEST (test_brace_group)
+{
+    scommand group = NULL;
+    pipeline body = NULL;
+
+    init_parser ("{ ls -l; wc & } > out | cat\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    fail_unless (pipeline_length (output) == 2, NULL);
+    group = pipeline_get_nth (output, 0);
+    fail_unless (scommand_get_kind (group) == SCOMMAND_BRACE_GROUP, NULL);
+    fail_unless (scommand_is_empty (group), NULL);
+    fail_unless (strcmp (scommand_get_redir_out (group), "out") == 0, NULL);
+    body = scommand_get_body (group);
+    fail_unless (pipeline_length (body) == 1, NULL);
+    fail_unless (strcmp (scommand_front (pipeline_get_nth (body, 0)), "ls") == 0, NULL);
+    fail_unless (pipeline_get_wait (body), NULL);
+    body = pipeline_get_next (body);
+    fail_unless (body != NULL && !pipeline_get_wait (body), NULL);
+    fail_unless (strcmp (scommand_front (pipeline_get_nth (body, 0)), "wc") == 0, NULL);
+    fail_unless (pipeline_get_next (body) == NULL, NULL);
+    fail_unless (scommand_get_kind (pipeline_get_nth (output, 1)) == SCOMMAND_SIMPLE, NULL);
+}
+END_TEST
+
+/* Con un grupo abierto el parser sigue en las líneas siguientes, y se
+ * detiene después del cierre
+ */
+START_TEST (test_group_multiline)
+{
+    char after[16];
+    char *str = NULL;
+
+    init_parser ("( cd /\n\n  echo '{' }\n) < in\nrest\n");
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    fail_unless (scommand_get_kind (pipeline_front (output)) == SCOMMAND_SUBSHELL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "( cd /; echo { } ) < in") == 0, NULL);
+    free (str);
+
+    fail_unless (fgets (after, sizeof (after), input) != NULL, NULL);
+    fail_unless (strcmp (after, "rest\n") == 0, NULL);
+}
+END_TEST
+
+/* Parsea `text' (sin '\n' al final, como lo deja el editor de línea) y
+ * devuelve si faltaban líneas para terminar
+ */
+static bool parse_incomplete (const char *text) {
+    Parser p = parser_new_from_buffer (text, strlen (text));
+    pipeline result = parse_pipeline (p);
+    bool incomplete = parser_incomplete (p);
+    fail_unless (!incomplete || result == NULL, NULL);
+    if (result != NULL) {
+        pipeline_destroy (result);
+    }
+    parser_destroy (p);
+    return incomplete;
+}
+
+/* Un compuesto abierto o un operador al final piden más líneas, que se
+ * agregan a la entrada de antes y se parsea todo junto (como en una terminal)
+ */
+START_TEST (test_incomplete)
+{
+    const char *if_lines = "if true; then\necho x\nfi";
+    const char *and_lines = "echo a &&\necho b";
+    char *str = NULL;
+
+    fail_unless (parse_incomplete ("if true; then"), NULL);
+    fail_unless (parse_incomplete ("if true; then\necho x"), NULL);
+    fail_unless (!parse_incomplete (if_lines), NULL);
+    fail_unless (parse_incomplete ("echo a &&"), NULL);
+    fail_unless (parse_incomplete ("echo a ||\n"), NULL);
+    fail_unless (!parse_incomplete (and_lines), NULL);
+    fail_unless (parse_incomplete ("for i in a b; do\ncase $i in"), NULL);
+    fail_unless (parse_incomplete ("( {"), NULL);
+
+    parser = parser_new_from_buffer (if_lines, strlen (if_lines));
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "if true; then echo x; fi") == 0, NULL);
+    free (str);
+    pipeline_destroy (output);
+    parser_destroy (parser);
+
+    parser = parser_new_from_buffer (and_lines, strlen (and_lines));
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "echo a && echo b") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+/* Los errores de sintaxis y lo que se parsea bien no piden más líneas */
+START_TEST (test_not_incomplete)
+{
+    const char *cases[] = {"", "echo a", "echo |", "a && || b", "fi",
+                           "( ls ) arg", "{ ls; )", "if a; then b; fi",
+                           "echo 'a", "echo ${a"};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        fail_unless (!parse_incomplete (cases[i]), NULL);
+    }
+}
+END_TEST
+
+/* Los grupos se pueden anidar, y '{' y '}' entre comillas son palabras */
+START_TEST (test_group_nested)
+{
+    char *str = NULL;
+
+    init_parser ("{ { a; } ; ( b | '}' ) }\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "{ { a; }; ( b | } ); }") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+START_TEST (test_invalid_groups)
+{
+    const char *cases[] = {"( )\n", "{ ; }\n", "( ls ) arg\n", "{ ls; )\n",
+                           "ls (x)\n", "( ls\n", "{ ls }\n", ")\n"};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        Parser p = parser_new_from_buffer (cases[i], strlen (cases[i]));
+        fail_unless (parse_pipeline (p) == NULL, NULL);
+        parser_destroy (p);
+    }
+}
+END_TEST
+
+/* if con elif y else: las listas son las condiciones y las ramas, en orden */
+START_TEST (test_if)
+{
+    scommand cmd = NULL;
+    char *str = NULL;
+
+    init_parser ("if a; then b; elif c\nthen d; else e; fi > out\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    cmd = pipeline_get_nth (output, 0);
+    fail_unless (scommand_get_kind (cmd) == SCOMMAND_IF, NULL);
+    fail_unless (scommand_list_count (cmd) == 5, NULL);
+    fail_unless (strcmp (scommand_front (pipeline_front (scommand_get_list (cmd, 2))), "c") == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (cmd), "out") == 0, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "if a; then b; elif c; then d; else e; fi > out") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+START_TEST (test_while_until)
+{
+    char *str = NULL;
+
+    init_parser ("while a && b; do c | d; done; until e; do f & done\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    fail_unless (scommand_get_kind (pipeline_front (output)) == SCOMMAND_WHILE, NULL);
+    fail_unless (scommand_list_count (pipeline_front (output)) == 2, NULL);
+    fail_unless (scommand_get_kind (pipeline_front (pipeline_get_next (output))) == SCOMMAND_UNTIL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "while a && b; do c | d; done; until e; do f & done") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+/* Las palabras del for quedan como las de un comando, para expandirlas al
+ * ejecutar, y el cuerpo puede ocupar varias líneas
+ */
+START_TEST (test_for)
+{
+    scommand cmd = NULL;
+    char *str = NULL;
+
+    init_parser ("for x in a 'b c' *.c\ndo\n  echo $x\ndone\nrest\n");
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    cmd = pipeline_front (output);
+    fail_unless (scommand_get_kind (cmd) == SCOMMAND_FOR, NULL);
+    fail_unless (scommand_length (cmd) == 4, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 0), "x") == 0, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 2), "b c") == 0, NULL);
+    fail_unless (scommand_get_nth (cmd, 3)[0] == SCOMMAND_EXPAND_MARK, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "for x in a b c *.c; do echo $x; done") == 0, NULL);
+    free (str);
+    pipeline_destroy (output);
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (strcmp (scommand_front (pipeline_front (output)), "rest") == 0, NULL);
+}
+END_TEST
+
+/* Cada cláusula del case son dos listas: los patrones y lo que se ejecuta
+ * (vacío en la segunda); la última no necesita el ";;"
+ */
+START_TEST (test_case)
+{
+    scommand cmd = NULL;
+    scommand patterns = NULL;
+    char *str = NULL;
+
+    init_parser ("case $f in\n  *.c | '*') echo c;;\n  (x) ;;\n  *) a; b\nesac\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    cmd = pipeline_front (output);
+    fail_unless (scommand_get_kind (cmd) == SCOMMAND_CASE, NULL);
+    fail_unless (scommand_length (cmd) == 1, NULL);
+    fail_unless (scommand_list_count (cmd) == 6, NULL);
+    patterns = pipeline_front (scommand_get_list (cmd, 0));
+    fail_unless (scommand_length (patterns) == 2, NULL);
+    fail_unless (strcmp (scommand_get_nth (patterns, 1), "*") == 0, NULL);
+    fail_unless (pipeline_is_empty (scommand_get_list (cmd, 3)), NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "case $f in *.c | *) echo c ;; x) ;; *) a; b ;; esac") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+/* Las palabras reservadas solo cuentan al comienzo de un comando, y sin
+ * comillas
+ */
+START_TEST (test_reserved_words)
+{
+    char *str = NULL;
+
+    init_parser ("if 'if' fi; then echo done esac; fi\n");
+    output = parse_pipeline (parser);
+    check_newline ();
+    fail_unless (output != NULL, NULL);
+    str = pipeline_to_string (output);
+    fail_unless (strcmp (str, "if if fi; then echo done esac; fi") == 0, NULL);
+    free (str);
+}
+END_TEST
+
+START_TEST (test_invalid_compounds)
+{
+    const char *cases[] = {"if a; then fi\n", "if a; fi\n",
+                           "while a; do done\n", "for 1x in a; do b; done\n",
+                           "for x in a do b; done\n", "for x; do b; done\n",
+                           "case a in a) b;;\n", "case a in a b) c;; esac\n",
+                           "fi\n", "a; done\n", "if a; then b; fi c\n",
+                           "while a; do b; done arg\n", "then\n"};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        Parser p = parser_new_from_buffer (cases[i], strlen (cases[i]));
+        fail_unless (parse_pipeline (p) == NULL, NULL);
+        parser_destroy (p);
+    }
+}
+END_TEST
+
+/* Las líneas repetidas salen del cache, y modificar lo que devuelve el
+ * parser no cambia lo que está guardado
+ */
+START_TEST (test_cache_hit)
+{
+    unsigned long hits = 0, misses = 0;
+    pipeline second = NULL;
+
+    init_parser ("ls -l | wc\nls -l | wc\necho x\nls -l | wc\n");
+    cache = linecache_new (8);
+    parser_set_cache (parser, cache);
+
+    output = parse_pipeline (parser);
+    fail_unless (pipeline_length (output) == 2, NULL);
+    check_argument (pipeline_front (output), "ls");
+    second = parse_pipeline (parser);
+    fail_unless (pipeline_length (second) == 2, NULL);
+    fail_unless (scommand_length (pipeline_front (second)) == 2, NULL);
+    check_argument (pipeline_front (second), "ls");
+    pipeline_destroy (second);
+    pipeline_destroy (output); output = NULL;
+
+    output = parse_pipeline (parser);
+    pipeline_destroy (output); output = NULL;
+    output = parse_pipeline (parser);
+    check_argument (pipeline_front (output), "ls");
+    check_argument (pipeline_front (output), "-l");
+
+    linecache_stats (cache, &hits, &misses);
+    fail_unless (hits == 2 && misses == 2, NULL);
+    fail_unless (linecache_length (cache) == 2, NULL);
+}
+END_TEST
+
+/* Un grupo de varias líneas no se guarda: la clave sería solo la primera */
+START_TEST (test_cache_not_multiline)
+{
+    init_parser ("{ a\n}\n{ a\n}\n");
+    cache = linecache_new (8);
+    parser_set_cache (parser, cache);
+
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    pipeline_destroy (output);
+    output = parse_pipeline (parser);
+    fail_unless (output != NULL, NULL);
+    fail_unless (linecache_length (cache) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_cache_not_errors)
+{
+    init_parser ("ls |\nls |\n");
+    cache = linecache_new (8);
+    parser_set_cache (parser, cache);
+
+    fail_unless (parse_pipeline (parser) == NULL, NULL);
+    fail_unless (parse_pipeline (parser) == NULL, NULL);
+    fail_unless (linecache_length (cache) == 0, NULL);
+}
+END_TEST
+
+/* Con el cache lleno se descarta la línea usada hace más tiempo */
+START_TEST (test_cache_eviction)
+{
+    pipeline p = pipeline_new ();
+
+    pipeline_push_back (p, scommand_new ());
+    cache = linecache_new (2);
+    linecache_insert (cache, "a", 1, p);
+    linecache_insert (cache, "b", 1, p);
+    output = linecache_lookup (cache, "a", 1);
+    fail_unless (output != NULL && output != p, NULL);
+    linecache_insert (cache, "c", 1, p);
+    pipeline_destroy (p);
+
+    fail_unless (linecache_length (cache) == 2, NULL);
+    fail_unless (linecache_lookup (cache, "b", 1) == NULL, NULL);
+    p = linecache_lookup (cache, "c", 1);
+    fail_unless (p != NULL, NULL);
+    pipeline_destroy (p);
+}
+END_TEST
+
+START_TEST (test_cache_clear)
+{
+    pipeline p = pipeline_new ();
+
+    cache = linecache_new (4);
+    linecache_insert (cache, "a b", 3, p);
+    pipeline_destroy (p);
+    linecache_clear (cache);
+    fail_unless (linecache_length (cache) == 0, NULL);
+    fail_unless (linecache_lookup (cache, "a b", 3) == NULL, NULL);
+}
+END_TEST
+
 /* Armado de la test suite */
 
 Suite *parser_suite (void)
@@ -424,6 +1190,7 @@ Suite *parser_suite (void)
     TCase *tc_invalid = tcase_create ("Invalid");
     TCase *tc_valid2 = tcase_create ("Valid(hard)");
     TCase *tc_invalid2 = tcase_create ("Invalid(hard)");
+    TCase *tc_cache = tcase_create ("Cache");
 
     /* Precondiciones */
     tcase_add_checked_fixture (tc_preconditions, setup, teardown);
@@ -455,16 +1222,61 @@ Suite *parser_suite (void)
 
     /* Chequeos de error básicos */
     tcase_add_checked_fixture (tc_invalid, setup, teardown);
+    tcase_add_test (tc_invalid, test_invalid_pipe_at_end);
+    tcase_add_test (tc_invalid, test_invalid_pipe_at_start);
+    tcase_add_test (tc_invalid, test_invalid_empty_stage);
+    tcase_add_test (tc_invalid, test_invalid_redir_without_file);
+    tcase_add_test (tc_invalid, test_invalid_after_background);
+    tcase_add_test (tc_invalid, test_invalid_unterminated_quote);
+    tcase_add_test (tc_invalid, test_invalid_unterminated_arithmetic);
+    tcase_add_test (tc_invalid, test_invalid_unterminated_braces);
     suite_add_tcase (s, tc_invalid);
 
     /* Entradas válidas, complejas */
     tcase_add_checked_fixture (tc_valid2, setup, teardown);
+    tcase_add_test (tc_valid2, test_redir_before_command);
+    tcase_add_test (tc_valid2, test_no_spaces);
+    tcase_add_test (tc_valid2, test_from_buffer);
+    tcase_add_test (tc_valid2, test_quotes);
+    tcase_add_test (tc_valid2, test_arithmetic);
+    tcase_add_test (tc_valid2, test_parameter_braces);
+    tcase_add_test (tc_valid2, test_general_redirections);
+    tcase_add_test (tc_valid2, test_general_redirections_compound);
+    tcase_add_test (tc_valid2, test_from_fd_pipe);
+    tcase_add_test (tc_valid2, test_from_fd_file);
+    tcase_add_test (tc_valid2, test_scan_implementations);
+    tcase_add_test (tc_valid2, test_list);
+    tcase_add_test (tc_valid2, test_list_background);
+    tcase_add_test (tc_valid2, test_list_continues);
+    tcase_add_test (tc_valid2, test_brace_group);
+    tcase_add_test (tc_valid2, test_group_multiline);
+    tcase_add_test (tc_valid2, test_incomplete);
+    tcase_add_test (tc_valid2, test_not_incomplete);
+    tcase_add_test (tc_valid2, test_group_nested);
+    tcase_add_test (tc_valid2, test_if);
+    tcase_add_test (tc_valid2, test_while_until);
+    tcase_add_test (tc_valid2, test_for);
+    tcase_add_test (tc_valid2, test_case);
+    tcase_add_test (tc_valid2, test_reserved_words);
     suite_add_tcase (s, tc_valid2);
 
     /* Entradas inválidas, complejas */
     tcase_add_checked_fixture (tc_invalid2, setup, teardown);
+    tcase_add_test (tc_invalid2, test_invalid_groups);
+    tcase_add_test (tc_invalid2, test_invalid_lists);
+    tcase_add_test (tc_invalid2, test_invalid_compounds);
+    tcase_add_test (tc_invalid2, test_invalid_general_redirections);
     suite_add_tcase (s, tc_invalid2);
 
+    /* Cache de líneas parseadas */
+    tcase_add_checked_fixture (tc_cache, setup, teardown);
+    tcase_add_test (tc_cache, test_cache_hit);
+    tcase_add_test (tc_cache, test_cache_not_errors);
+    tcase_add_test (tc_cache, test_cache_not_multiline);
+    tcase_add_test (tc_cache, test_cache_eviction);
+    tcase_add_test (tc_cache, test_cache_clear);
+    suite_add_tcase (s, tc_cache);
+
     return s;
 }
 
@@ -473,8 +1285,16 @@ void parser_memory_test (void) {
     /* Las siguientes operaciones deberían poder hacer sin leaks ni doble 
      * frees.
      */
-    init_lexer ("ls");
-    output = parse_pipeline (lexer);
+    init_parser ("ls");
+    output = parse_pipeline (parser);
+    teardown();
+
+    init_parser ("ls | wc\nls | wc\n");
+    cache = linecache_new (1);
+    parser_set_cache (parser, cache);
+    output = parse_pipeline (parser);
+    pipeline_destroy (output);
+    output = parse_pipeline (parser);
     teardown();
 }
 
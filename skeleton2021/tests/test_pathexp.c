@@ -0,0 +1,395 @@
+#include <check.h>
+#include "test_pathexp.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "command.h"
+#include "expand.h"
+#include "parser.h"
+#include "pathexp.h"
+#include "vars.h"
+
+/* Un árbol temporal de archivos; los que terminan en '/' son directorios */
+static char root[] = "/tmp/mybash-pathexp-XXXXXX";
+static char cwd[1024];
+static const char *tree[] = {"a.c", "b.c", "ab.c", ".oculto.c", "c.h", "x y.c",
+                             "Z.c", "[a].c", "src/", "src/main.c",
+                             "src/util.c", "src/util.h", "src/sub/",
+                             "src/sub/deep.c", "doc/", "doc/a.c",
+                             ".git/", ".git/config.c", "src/.cache/",
+                             "src/.cache/x.c", NULL};
+
+/* Ruta de un archivo del árbol, en memoria estática */
+static const char *path (const char *name) {
+    static char result[128];
+    sprintf (result, "%s/%s", root, name);
+    return result;
+}
+
+static void setup (void) {
+    fail_unless (mkdtemp (strcpy (root, "/tmp/mybash-pathexp-XXXXXX")) != NULL, NULL);
+    for (unsigned int i = 0; tree[i] != NULL; i++) {
+        if (tree[i][strlen (tree[i]) - 1] == '/') {
+            mkdir (path (tree[i]), 0755);
+        } else {
+            close (open (path (tree[i]), O_CREAT | O_WRONLY, 0644));
+        }
+    }
+    fail_unless (getcwd (cwd, sizeof (cwd)) != NULL, NULL);
+    fail_unless (chdir (root) == 0, NULL);
+}
+
+static void teardown (void) {
+    fail_unless (chdir (cwd) == 0, NULL);
+    /* En orden inverso, para que los directorios estén vacíos */
+    unsigned int count = 0;
+    while (tree[count] != NULL) {
+        count++;
+    }
+    for (unsigned int i = count; i > 0; i--) {
+        remove (path (tree[i - 1]));
+    }
+    rmdir (root);
+}
+
+/* Expande pattern y compara con las rutas separadas por '|' en expected
+ * ("" si no tiene que haber ninguna)
+ */
+static void check_expand (pathexp self, const char *pattern, const char *expected) {
+    char **matches = NULL;
+    size_t count = pathexp_expand (self, pattern, &matches);
+    char buffer[256] = "";
+    for (size_t i = 0; i < count; i++) {
+        strcat (buffer, i > 0 ? "|" : "");
+        strcat (buffer, matches[i]);
+    }
+    fail_unless (strcmp (buffer, expected) == 0, buffer);
+    fail_unless ((count == 0) == (matches == NULL), NULL);
+    pathexp_free (matches, count);
+}
+
+/* Precondiciones */
+START_TEST (test_expand_null)
+{
+    pathexp self = pathexp_new ();
+    char **matches = NULL;
+    pathexp_expand (self, NULL, &matches);
+}
+END_TEST
+
+START_TEST (test_match_null)
+{
+    pathexp_match ("*", NULL);
+}
+END_TEST
+
+START_TEST (test_pattern_match_null)
+{
+    pathexp_pattern_match (NULL, "x", 1);
+}
+END_TEST
+
+START_TEST (test_destroy_null)
+{
+    pathexp_destroy (NULL);
+}
+END_TEST
+
+/* Patrones */
+START_TEST (test_match)
+{
+    fail_unless (pathexp_match ("*", ""), NULL);
+    fail_unless (pathexp_match ("*.c", "main.c"), NULL);
+    fail_if (pathexp_match ("*.c", "main.h"), NULL);
+    fail_unless (pathexp_match ("a*b*c", "aXbYbZc"), NULL);
+    fail_if (pathexp_match ("a*b*c", "aXbYcZ"), NULL);
+    fail_unless (pathexp_match ("?", "x"), NULL);
+    fail_if (pathexp_match ("?", ""), NULL);
+    fail_if (pathexp_match ("??", "x"), NULL);
+    fail_unless (pathexp_match ("ab", "ab"), NULL);
+    fail_if (pathexp_match ("ab", "abc"), NULL);
+    /* En case '/' y '.' no son especiales */
+    fail_unless (pathexp_match ("*", ".oculto/x"), NULL);
+}
+END_TEST
+
+START_TEST (test_classes)
+{
+    fail_unless (pathexp_match ("[abc]", "b"), NULL);
+    fail_if (pathexp_match ("[abc]", "d"), NULL);
+    fail_unless (pathexp_match ("[a-c]x", "bx"), NULL);
+    fail_if (pathexp_match ("[a-c]x", "Bx"), NULL);
+    fail_unless (pathexp_match ("[!a-c]", "d"), NULL);
+    fail_if (pathexp_match ("[^a-c]", "a"), NULL);
+    /* ']' al comienzo es parte del conjunto, y '-' al final es literal */
+    fail_unless (pathexp_match ("[]]", "]"), NULL);
+    fail_unless (pathexp_match ("[a-]", "-"), NULL);
+    /* Sin cerrar, '[' es literal */
+    fail_unless (pathexp_match ("[a", "[a"), NULL);
+    fail_if (pathexp_match ("[a", "a"), NULL);
+}
+END_TEST
+
+START_TEST (test_escapes)
+{
+    fail_unless (pathexp_match ("\\*", "*"), NULL);
+    fail_if (pathexp_match ("\\*", "x"), NULL);
+    fail_unless (pathexp_match ("a\\?*", "a?bc"), NULL);
+    fail_unless (pathexp_has_magic ("a*"), NULL);
+    fail_unless (pathexp_has_magic ("[ab]"), NULL);
+    fail_if (pathexp_has_magic ("a\\*"), NULL);
+    fail_if (pathexp_has_magic ("abc"), NULL);
+}
+END_TEST
+
+/* Un patrón compilado se compara con pedazos de cadenas */
+START_TEST (test_compiled_pattern)
+{
+    pathexp_pattern p = pathexp_pattern_new ("*.[ch]");
+    const char *text = "main.c.o";
+    fail_unless (pathexp_pattern_match (p, text, 6), NULL);
+    fail_if (pathexp_pattern_match (p, text, 8), NULL);
+    fail_unless (pathexp_pattern_match (p, "x.h", 3), NULL);
+    fail_if (pathexp_pattern_match (p, NULL, 0), NULL);
+    p = pathexp_pattern_destroy (p);
+    fail_unless (p == NULL, NULL);
+
+    p = pathexp_pattern_new ("");
+    fail_unless (pathexp_pattern_match (p, NULL, 0), NULL);
+    fail_unless (pathexp_pattern_match (p, text, 0), NULL);
+    fail_if (pathexp_pattern_match (p, text, 1), NULL);
+    pathexp_pattern_destroy (p);
+}
+END_TEST
+
+START_TEST (test_sort)
+{
+    char *names[64];
+    char text[64][8];
+    /* Con prefijos comunes y repetidos */
+    for (unsigned int i = 0; i < 64; i++) {
+        sprintf (text[i], "%c%u", (i * 7) % 3 == 0 ? 'b' : 'a', (i * 37) % 64);
+        names[i] = text[i];
+    }
+    pathexp_sort (names, 64);
+    for (unsigned int i = 1; i < 64; i++) {
+        fail_unless (strcmp (names[i - 1], names[i]) <= 0, names[i]);
+    }
+    pathexp_sort (NULL, 0);
+}
+END_TEST
+
+/* Archivos */
+START_TEST (test_expand)
+{
+    pathexp self = pathexp_new ();
+    check_expand (self, "*.c", "Z.c|[a].c|a.c|ab.c|b.c|x y.c");
+    check_expand (self, "?.c", "Z.c|a.c|b.c");
+    check_expand (self, "[ab]*.h", "");
+    check_expand (self, "*.h", "c.h");
+    check_expand (self, "[!ab].*", "Z.c|c.h");
+    check_expand (self, "\\[a\\].c", "[a].c");
+    check_expand (self, "*.txt", "");
+    self = pathexp_destroy (self);
+    fail_unless (self == NULL, NULL);
+}
+END_TEST
+
+START_TEST (test_hidden)
+{
+    pathexp self = pathexp_new ();
+    check_expand (self, "*oculto*", "");
+    check_expand (self, ".*", ".git|.oculto.c");
+    check_expand (self, ".*.c", ".oculto.c");
+    pathexp_destroy (self);
+}
+END_TEST
+
+START_TEST (test_components)
+{
+    pathexp self = pathexp_new ();
+    check_expand (self, "*/*.c", "doc/a.c|src/main.c|src/util.c");
+    check_expand (self, "src/*", "src/main.c|src/sub|src/util.c|src/util.h");
+    check_expand (self, "*/", "doc/|src/");
+    check_expand (self, "src/*/deep.c", "src/sub/deep.c");
+    check_expand (self, "*/sub/*", "src/sub/deep.c");
+    check_expand (self, "*/nada", "");
+    char absolute[128];
+    strcpy (absolute, path ("src/util.h"));
+    check_expand (self, path ("src/u*.h"), absolute);
+    pathexp_destroy (self);
+}
+END_TEST
+
+START_TEST (test_cached_listing)
+{
+    /* Con el mismo pathexp el directorio se lee una sola vez */
+    pathexp self = pathexp_new ();
+    check_expand (self, "src/*.h", "src/util.h");
+    close (open (path ("src/nuevo.h"), O_CREAT | O_WRONLY, 0644));
+    check_expand (self, "src/*.h", "src/util.h");
+    pathexp_destroy (self);
+
+    self = pathexp_new ();
+    check_expand (self, "src/*.h", "src/nuevo.h|src/util.h");
+    pathexp_destroy (self);
+    unlink (path ("src/nuevo.h"));
+}
+END_TEST
+
+START_TEST (test_globstar)
+{
+    pathexp self = pathexp_new ();
+    check_expand (self, "**/*.c",
+                  "Z.c|[a].c|a.c|ab.c|b.c|doc/a.c|src/main.c|src/sub/deep.c|src/util.c|x y.c");
+    check_expand (self, "src/**/*.c", "src/main.c|src/sub/deep.c|src/util.c");
+    check_expand (self, "src/**", "src/|src/main.c|src/sub|src/sub/deep.c|src/util.c|src/util.h");
+    check_expand (self, "**/", "doc/|src/|src/sub/");
+    check_expand (self, "**/deep.c", "src/sub/deep.c");
+    check_expand (self, "**/sub/*.c", "src/sub/deep.c");
+    /* Los ocultos se pueden nombrar, pero no se entra en los directorios */
+    check_expand (self, "**/.*", ".git|.oculto.c|src/.cache");
+    check_expand (self, "**/x.c", "");
+    check_expand (self, "nada/**", "");
+    pathexp_destroy (self);
+}
+END_TEST
+
+START_TEST (test_globstar_threads)
+{
+    /* Un árbol con suficientes directorios para repartirlos entre hilos */
+    char name[128];
+    for (unsigned int i = 0; i < 40; i++) {
+        sprintf (name, "%s/t%02u", root, i);
+        mkdir (name, 0755);
+        for (unsigned int j = 0; j < 5; j++) {
+            sprintf (name, "%s/t%02u/s%u", root, i, j);
+            mkdir (name, 0755);
+            strcat (name, "/f.c");
+            close (open (name, O_CREAT | O_WRONLY, 0644));
+        }
+    }
+    char **one = NULL, **many = NULL;
+    pathexp self = pathexp_new ();
+    pathexp_set_threads (self, 1);
+    size_t count = pathexp_expand (self, "t*/**/*.c", &one);
+    pathexp_destroy (self);
+    self = pathexp_new ();
+    pathexp_set_threads (self, 8);
+    fail_unless (pathexp_expand (self, "t*/**/*.c", &many) == count, NULL);
+    fail_unless (count == 200, NULL);
+    for (size_t i = 0; i < count; i++) {
+        fail_unless (strcmp (one[i], many[i]) == 0, many[i]);
+    }
+    pathexp_destroy (self);
+    pathexp_free (one, count);
+    pathexp_free (many, count);
+
+    self = pathexp_new ();
+    pathexp_set_threads (self, 8);
+    count = pathexp_expand (self, "t*/**", &many);
+    for (size_t i = 0; i < count; i++) {
+        remove (many[i]);
+    }
+    /* Los directorios después de sus archivos */
+    for (size_t i = count; i > 0; i--) {
+        remove (many[i - 1]);
+    }
+    pathexp_free (many, count);
+    pathexp_destroy (self);
+}
+END_TEST
+
+/* Expansión de las palabras de un comando */
+static void check_words (const char *line, const char *expected) {
+    Parser parser = parser_new_from_buffer (line, strlen (line));
+    pipeline p = parse_pipeline (parser);
+    parser_destroy (parser);
+    fail_unless (p != NULL, NULL);
+    pipeline expanded = expand_pipeline (p);
+    scommand cmd = pipeline_get_nth (expanded != NULL ? expanded : p, 0);
+    char buffer[256] = "";
+    for (unsigned int i = 0; i < scommand_length (cmd); i++) {
+        strcat (buffer, i > 0 ? "|" : "");
+        strcat (buffer, scommand_get_nth (cmd, i));
+    }
+    fail_unless (strcmp (buffer, expected) == 0, buffer);
+    if (expanded != NULL) {
+        pipeline_destroy (expanded);
+    }
+    pipeline_destroy (p);
+}
+
+START_TEST (test_words)
+{
+    check_words ("ls *.h src/*.h\n", "ls|c.h|src/util.h");
+    check_words ("ls nada*\n", "ls|nada*");
+    /* Lo citado no es un patrón */
+    check_words ("ls '*.h' \"*.h\" \\*.h\n", "ls|*.h|*.h|*.h");
+    check_words ("ls \"src\"/*.h 'x '*\n", "ls|src/util.h|x y.c");
+    /* El resultado de una expansión sin comillas sí */
+    vars_set ("P", "*.h src/*.h");
+    check_words ("ls $P \"$P\"\n", "ls|c.h|src/util.h|*.h src/*.h");
+}
+END_TEST
+
+START_TEST (test_redirection_not_globbed)
+{
+    Parser parser = parser_new_from_buffer ("cat < *.h > *.c\n", 16);
+    pipeline p = parse_pipeline (parser);
+    parser_destroy (parser);
+    pipeline expanded = expand_pipeline (p);
+    fail_unless (expanded != NULL, NULL);
+    scommand cmd = pipeline_get_nth (expanded, 0);
+    fail_unless (strcmp (scommand_get_redir_in (cmd), "*.h") == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (cmd), "*.c") == 0, NULL);
+    pipeline_destroy (expanded);
+    pipeline_destroy (p);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *pathexp_suite (void)
+{
+    Suite *s = suite_create ("pathexp");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_patterns = tcase_create ("Patterns");
+    TCase *tc_files = tcase_create ("Files");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_expand_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_match_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_pattern_match_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_destroy_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Patrones */
+    tcase_add_test (tc_patterns, test_match);
+    tcase_add_test (tc_patterns, test_classes);
+    tcase_add_test (tc_patterns, test_escapes);
+    tcase_add_test (tc_patterns, test_compiled_pattern);
+    tcase_add_test (tc_patterns, test_sort);
+    suite_add_tcase (s, tc_patterns);
+
+    /* Archivos */
+    tcase_add_checked_fixture (tc_files, setup, teardown);
+    tcase_add_test (tc_files, test_expand);
+    tcase_add_test (tc_files, test_hidden);
+    tcase_add_test (tc_files, test_components);
+    tcase_add_test (tc_files, test_cached_listing);
+    tcase_add_test (tc_files, test_globstar);
+    tcase_add_test (tc_files, test_globstar_threads);
+    tcase_add_test (tc_files, test_words);
+    tcase_add_test (tc_files, test_redirection_not_globbed);
+    suite_add_tcase (s, tc_files);
+
+    return s;
+}
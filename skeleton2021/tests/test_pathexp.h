@@ -0,0 +1,8 @@
+#ifndef TEST_PATHEXP_H
+#define TEST_PATHEXP_H
+
+#include <check.h>
+
+Suite *pathexp_suite (void);
+
+#endif
@@ -0,0 +1,308 @@
+#include <check.h>
+#include "test_pathindex.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "complete.h"
+#include "pathindex.h"
+
+/* Dos directorios temporales para usar de PATH */
+static char dir1[] = "/tmp/mybash-path1-XXXXXX";
+static char dir2[] = "/tmp/mybash-path2-XXXXXX";
+static char *old_path = NULL;
+
+/* Ruta de name en dir, en memoria estática */
+static const char *file_path (const char *dir, const char *name) {
+    static char path[128];
+    sprintf (path, "%s/%s", dir, name);
+    return path;
+}
+
+static void make_file (const char *dir, const char *name, mode_t mode) {
+    const char *path = file_path (dir, name);
+    int fd = open (path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    fail_unless (fd != -1, NULL);
+    close (fd);
+    chmod (path, mode);
+}
+
+static void remove_file (const char *dir, const char *name) {
+    unlink (file_path (dir, name));
+    rmdir (file_path (dir, name));
+}
+
+static void sleep_ms (long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000l};
+    nanosleep (&ts, NULL);
+}
+
+/* Espera a lo sumo dos segundos a que el índice esté listo y `name' se
+ * resuelva (o no, según expected)
+ */
+static bool wait_resolve (const char *name, bool expected) {
+    char path[256];
+    for (unsigned int i = 0; i < 200; i++) {
+        if (pathindex_ready () && pathindex_resolve (name, path, sizeof (path)) == expected) {
+            return true;
+        }
+        sleep_ms (10);
+    }
+    return false;
+}
+
+static void set_path (const char *value) {
+    setenv ("PATH", value, 1);
+}
+
+static void setup (void) {
+    const char *env = getenv ("PATH");
+    old_path = env != NULL ? strdup (env) : NULL;
+    fail_unless (mkdtemp (strcpy (dir1, "/tmp/mybash-path1-XXXXXX")) != NULL, NULL);
+    fail_unless (mkdtemp (strcpy (dir2, "/tmp/mybash-path2-XXXXXX")) != NULL, NULL);
+    make_file (dir1, "uno", 0755);
+    make_file (dir1, "dos", 0755);
+    make_file (dir1, "datos", 0644); /* no es ejecutable */
+    make_file (dir2, "dos", 0755);
+    make_file (dir2, "doce", 0755);
+    mkdir (file_path (dir2, "dir"), 0755);
+    char path[128];
+    sprintf (path, "%s:%s", dir1, dir2);
+    set_path (path);
+}
+
+static void teardown (void) {
+    const char *names[] = {"uno", "dos", "datos", "doce", "dir", "tres", NULL};
+    pathindex_stop ();
+    complete_stop ();
+    for (unsigned int i = 0; names[i] != NULL; i++) {
+        remove_file (dir1, names[i]);
+        remove_file (dir2, names[i]);
+    }
+    rmdir (dir1);
+    rmdir (dir2);
+    if (old_path != NULL) {
+        set_path (old_path);
+        free (old_path);
+        old_path = NULL;
+    }
+}
+
+/* Precondiciones */
+START_TEST (test_resolve_null)
+{
+    char path[16];
+    pathindex_resolve (NULL, path, sizeof (path));
+}
+END_TEST
+
+START_TEST (test_complete_null)
+{
+    pathindex_complete (NULL, NULL, 0);
+}
+END_TEST
+
+START_TEST (test_complete_word_null)
+{
+    size_t start;
+    char **matches;
+    complete_word (NULL, 0, &start, &matches);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_not_started)
+{
+    char path[256];
+    fail_if (pathindex_ready (), NULL);
+    fail_if (pathindex_resolve ("uno", path, sizeof (path)), NULL);
+    fail_unless (pathindex_complete ("", NULL, 0) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_resolve)
+{
+    char path[256], expected[256];
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    pathindex_resolve ("uno", path, sizeof (path));
+    sprintf (expected, "%s/uno", dir1);
+    fail_unless (strcmp (path, expected) == 0, NULL);
+    /* Gana el primer directorio del PATH */
+    pathindex_resolve ("dos", path, sizeof (path));
+    sprintf (expected, "%s/dos", dir1);
+    fail_unless (strcmp (path, expected) == 0, NULL);
+    pathindex_resolve ("doce", path, sizeof (path));
+    sprintf (expected, "%s/doce", dir2);
+    fail_unless (strcmp (path, expected) == 0, NULL);
+    /* Ni los que no son ejecutables, ni los directorios */
+    fail_if (pathindex_resolve ("datos", path, sizeof (path)), NULL);
+    fail_if (pathindex_resolve ("dir", path, sizeof (path)), NULL);
+    fail_if (pathindex_resolve ("nada", path, sizeof (path)), NULL);
+    /* Los que tienen '/' no se buscan en el PATH */
+    fail_if (pathindex_resolve ("./uno", path, sizeof (path)), NULL);
+}
+END_TEST
+
+START_TEST (test_complete)
+{
+    const char *names[4];
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    fail_unless (pathindex_complete ("do", names, 4) == 2, NULL);
+    fail_unless (strcmp (names[0], "doce") == 0, NULL);
+    fail_unless (strcmp (names[1], "dos") == 0, NULL);
+    fail_unless (pathindex_complete ("", names, 1) == 3, NULL);
+    fail_unless (strcmp (names[0], "doce") == 0, NULL);
+    fail_unless (pathindex_complete ("x", names, 4) == 0, NULL);
+}
+END_TEST
+
+/* Los cambios en los directorios llegan por inotify */
+START_TEST (test_inotify)
+{
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    make_file (dir2, "tres", 0755);
+    fail_unless (wait_resolve ("tres", true), NULL);
+    remove_file (dir1, "uno");
+    fail_unless (wait_resolve ("uno", false), NULL);
+    chmod (file_path (dir1, "datos"), 0755);
+    fail_unless (wait_resolve ("datos", true), NULL);
+}
+END_TEST
+
+/* Si cambia el PATH se arma otro índice */
+START_TEST (test_path_changed)
+{
+    char path[256];
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    set_path (dir2);
+    fail_unless (wait_resolve ("uno", false), NULL);
+    fail_unless (pathindex_resolve ("dos", path, sizeof (path)), NULL);
+    fail_unless (strncmp (path, dir2, strlen (dir2)) == 0, NULL);
+}
+END_TEST
+
+/* En un hijo después de fork se usa el índice del shell tal cual: con otro
+ * PATH no se encuentra nada (y no se le pide un índice nuevo al hilo)
+ */
+START_TEST (test_resolve_in_child)
+{
+    char path[256];
+    int status = 0;
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    pid_t pid = fork ();
+    fail_unless (pid != -1, NULL);
+    if (pid == 0) {
+        bool ok = pathindex_resolve ("uno", path, sizeof (path));
+        set_path (dir2);
+        ok = ok && !pathindex_resolve ("dos", path, sizeof (path));
+        _exit (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    fail_unless (waitpid (pid, &status, 0) == pid, NULL);
+    fail_unless (WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS, NULL);
+    /* El índice del shell sigue siendo el de su PATH */
+    fail_unless (pathindex_resolve ("uno", path, sizeof (path)), NULL);
+}
+END_TEST
+
+/* Con directorios relativos en el PATH no se resuelve nada */
+START_TEST (test_relative_path)
+{
+    char path[256];
+    sprintf (path, ".:%s", dir1);
+    set_path (path);
+    pathindex_start ();
+    for (unsigned int i = 0; i < 200 && !pathindex_ready (); i++) {
+        sleep_ms (10);
+    }
+    fail_unless (pathindex_ready (), NULL);
+    fail_if (pathindex_resolve ("uno", path, sizeof (path)), NULL);
+    fail_unless (pathindex_complete ("uno", NULL, 0) == 1, NULL);
+}
+END_TEST
+
+START_TEST (test_complete_word_command)
+{
+    size_t start = 0;
+    char **matches = NULL;
+    pathindex_start ();
+    fail_unless (wait_resolve ("uno", true), NULL);
+    size_t count = complete_word ("ls | do", 7, &start, &matches);
+    fail_unless (start == 5, NULL);
+    fail_unless (count == 2, NULL);
+    fail_unless (strcmp (matches[0], "doce") == 0, NULL);
+    fail_unless (strcmp (matches[1], "dos") == 0, NULL);
+    complete_free (matches, count);
+    /* Los comandos internos también */
+    count = complete_word ("c", 1, &start, &matches);
+    fail_unless (count == 2 && strcmp (matches[0], "cd") == 0, NULL);
+    fail_unless (strcmp (matches[1], "continue") == 0, NULL);
+    complete_free (matches, count);
+}
+END_TEST
+
+START_TEST (test_complete_word_file)
+{
+    size_t start = 0;
+    char **matches = NULL;
+    char line[128];
+    sprintf (line, "cat %s/d", dir2);
+    size_t count = complete_word (line, strlen (line), &start, &matches);
+    fail_unless (start == 4, NULL);
+    fail_unless (count == 3, NULL);
+    /* Los directorios terminan en '/' */
+    fail_unless (strcmp (matches[0] + strlen (dir2) + 1, "dir/") == 0, NULL);
+    fail_unless (strcmp (matches[1] + strlen (dir2) + 1, "doce") == 0, NULL);
+    fail_unless (strcmp (matches[2] + strlen (dir2) + 1, "dos") == 0, NULL);
+    complete_free (matches, count);
+    /* Una palabra con '/' en lugar de comando es un archivo */
+    sprintf (line, "%s/u", dir1);
+    count = complete_word (line, strlen (line), &start, &matches);
+    fail_unless (count == 1, NULL);
+    fail_unless (strcmp (matches[0] + strlen (dir1) + 1, "uno") == 0, NULL);
+    complete_free (matches, count);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *pathindex_suite (void)
+{
+    Suite *s = suite_create ("pathindex");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_checked_fixture (tc_preconditions, setup, teardown);
+    tcase_add_test_raise_signal (tc_preconditions, test_resolve_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_complete_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_complete_word_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_not_started);
+    tcase_add_test (tc_functionality, test_resolve);
+    tcase_add_test (tc_functionality, test_complete);
+    tcase_add_test (tc_functionality, test_inotify);
+    tcase_add_test (tc_functionality, test_path_changed);
+    tcase_add_test (tc_functionality, test_resolve_in_child);
+    tcase_add_test (tc_functionality, test_relative_path);
+    tcase_add_test (tc_functionality, test_complete_word_command);
+    tcase_add_test (tc_functionality, test_complete_word_file);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
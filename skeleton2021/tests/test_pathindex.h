@@ -0,0 +1,8 @@
+#ifndef TEST_PATHINDEX_H
+#define TEST_PATHINDEX_H
+
+#include <check.h>
+
+Suite *pathindex_suite (void);
+
+#endif
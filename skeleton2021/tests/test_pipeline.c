@@ -251,6 +251,318 @@ START_TEST (test_to_string)
 }
 END_TEST
 
+/* Serializar y deserializar da un pipeline equivalente, que apunta adentro
+ * del buffer
+ */
+START_TEST (test_serialize_roundtrip)
+{
+    char *before = NULL, *after = NULL;
+    void *buf = NULL;
+    size_t size = 0;
+    pipeline copy = NULL;
+    scommand cmd = scommand_new ();
+    scommand_push_back (cmd, strdup ("ls"));
+    scommand_push_back (cmd, strdup ("-l"));
+    scommand_set_redir_in (cmd, strdup ("in"));
+    pipeline_push_back (pipe, cmd);
+    cmd = scommand_new ();
+    scommand_push_back (cmd, strdup ("wc"));
+    scommand_set_redir_out (cmd, strdup ("out"));
+    pipeline_push_back (pipe, cmd);
+    pipeline_push_back (pipe, scommand_new ());
+    pipeline_set_wait (pipe, false);
+
+    buf = pipeline_serialize (pipe, &size);
+    fail_unless (buf != NULL && size > 0, NULL);
+    copy = pipeline_deserialize (buf, size);
+    fail_unless (copy != NULL, NULL);
+    fail_unless (pipeline_length (copy) == 3, NULL);
+    fail_unless (!pipeline_get_wait (copy), NULL);
+    cmd = pipeline_front (copy);
+    fail_unless (scommand_length (cmd) == 2, NULL);
+    fail_unless ((char *) buf <= scommand_front (cmd)
+                 && scommand_front (cmd) < (char *) buf + size, NULL);
+
+    before = pipeline_to_string (pipe);
+    after = pipeline_to_string (copy);
+    fail_unless (strcmp (before, after) == 0, NULL);
+    free (before);
+    free (after);
+    pipeline_destroy (copy);
+    free (buf);
+}
+END_TEST
+
+/* Un buffer truncado o que no es un pipeline se rechaza */
+START_TEST (test_deserialize_malformed)
+{
+    void *buf = NULL;
+    size_t size = 0;
+    scommand cmd = scommand_new ();
+    scommand_push_back (cmd, strdup ("echo"));
+    scommand_push_back (cmd, strdup ("hola"));
+    pipeline_push_back (pipe, cmd);
+
+    buf = pipeline_serialize (pipe, &size);
+    for (size_t i = 0; i < size; i++) {
+        fail_unless (pipeline_deserialize (buf, i) == NULL, NULL);
+    }
+    memset (buf, 'x', 4);
+    fail_unless (pipeline_deserialize (buf, size) == NULL, NULL);
+    free (buf);
+}
+END_TEST
+
+/* Arma "{ echo a; ( ls ) | wc; } > out" */
+static scommand group_example (void)
+{
+    scommand cmd = scommand_new ();
+    scommand group = scommand_new ();
+    pipeline body = pipeline_new ();
+    pipeline second = pipeline_new ();
+    pipeline inner = pipeline_new ();
+
+    scommand_push_back (cmd, strdup ("echo"));
+    scommand_push_back (cmd, strdup ("a"));
+    pipeline_push_back (body, cmd);
+    cmd = scommand_new ();
+    scommand_push_back (cmd, strdup ("ls"));
+    pipeline_push_back (inner, cmd);
+    cmd = scommand_new ();
+    scommand_set_body (cmd, SCOMMAND_SUBSHELL, inner);
+    pipeline_push_back (second, cmd);
+    cmd = scommand_new ();
+    scommand_push_back (cmd, strdup ("wc"));
+    pipeline_push_back (second, cmd);
+    pipeline_set_next (body, second);
+    scommand_set_body (group, SCOMMAND_BRACE_GROUP, body);
+    scommand_set_redir_out (group, strdup ("out"));
+    return group;
+}
+
+/* Los grupos y la lista de pipelines también se serializan */
+START_TEST (test_serialize_groups)
+{
+    char *before = NULL, *after = NULL;
+    void *buf = NULL;
+    size_t size = 0;
+    pipeline copy = NULL, next = NULL;
+    scommand cmd = scommand_new ();
+
+    pipeline_push_back (pipe, group_example ());
+    scommand_push_back (cmd, strdup ("pwd"));
+    next = pipeline_new ();
+    pipeline_push_back (next, cmd);
+    pipeline_set_wait (next, false);
+    pipeline_set_next (pipe, next);
+    pipeline_set_connector (pipe, PIPELINE_OR);
+
+    before = pipeline_to_string (pipe);
+    fail_unless (strcmp (before, "{ echo a; ( ls ) | wc; } > out || pwd &") == 0, NULL);
+    buf = pipeline_serialize (pipe, &size);
+    fail_unless (buf != NULL, NULL);
+    copy = pipeline_deserialize (buf, size);
+    fail_unless (copy != NULL, NULL);
+    after = pipeline_to_string (copy);
+    fail_unless (strcmp (before, after) == 0, NULL);
+    cmd = pipeline_front (copy);
+    fail_unless (scommand_get_kind (cmd) == SCOMMAND_BRACE_GROUP, NULL);
+    fail_unless (pipeline_get_next (scommand_get_body (cmd)) != NULL, NULL);
+    fail_unless (!pipeline_get_wait (pipeline_get_next (copy)), NULL);
+    fail_unless (pipeline_get_connector (copy) == PIPELINE_OR, NULL);
+    for (size_t i = 0; i < size; i++) {
+        fail_unless (pipeline_deserialize (buf, i) == NULL, NULL);
+    }
+
+    free (before);
+    free (after);
+    pipeline_destroy (copy);
+    free (buf);
+}
+END_TEST
+
+/* Las redirecciones generales se serializan con sus archivos, en orden */
+START_TEST (test_serialize_redirections)
+{
+    char *before = NULL, *after = NULL;
+    void *buf = NULL;
+    size_t size = 0;
+    pipeline copy = NULL;
+    scommand cmd = scommand_new ();
+
+    scommand_push_back (cmd, strdup ("ls"));
+    scommand_set_redir_in (cmd, strdup ("in"));
+    scommand_add_redir (cmd, SCOMMAND_REDIR_OUTPUT, 2, -1, strdup ("err"));
+    scommand_add_redir (cmd, SCOMMAND_REDIR_DUP, 1, 2, NULL);
+    scommand_add_redir (cmd, SCOMMAND_REDIR_APPEND, 1, -1, strdup ("log"));
+    scommand_add_redir (cmd, SCOMMAND_REDIR_CLOSE, 3, -1, NULL);
+    pipeline_push_back (pipe, cmd);
+    pipeline_push_back (pipe, group_example ());
+
+    before = pipeline_to_string (pipe);
+    fail_unless (strcmp (before, "ls < in 2> err >&2 >> log 3>&- | { echo a; ( ls ) | wc; } > out") == 0, NULL);
+    buf = pipeline_serialize (pipe, &size);
+    fail_unless (buf != NULL, NULL);
+    copy = pipeline_deserialize (buf, size);
+    fail_unless (copy != NULL, NULL);
+    after = pipeline_to_string (copy);
+    fail_unless (strcmp (before, after) == 0, NULL);
+    cmd = pipeline_front (copy);
+    fail_unless (scommand_redir_count (cmd) == 4, NULL);
+    fail_unless ((char *) buf <= scommand_get_redir (cmd, 2)->target
+                 && scommand_get_redir (cmd, 2)->target < (char *) buf + size, NULL);
+    for (size_t i = 0; i < size; i++) {
+        fail_unless (pipeline_deserialize (buf, i) == NULL, NULL);
+    }
+
+    free (before);
+    free (after);
+    pipeline_destroy (copy);
+    free (buf);
+}
+END_TEST
+
+/* Un pipeline de un solo comando con la palabra word */
+static pipeline word_pipeline (const char *word)
+{
+    pipeline result = pipeline_new ();
+    scommand cmd = scommand_new ();
+    scommand_push_back (cmd, strdup (word));
+    pipeline_push_back (result, cmd);
+    return result;
+}
+
+/* Los demás compuestos se serializan con todas sus listas y sus cadenas */
+START_TEST (test_serialize_compounds)
+{
+    char *before = NULL, *after = NULL;
+    void *buf = NULL;
+    size_t size = 0;
+    pipeline copy = NULL;
+    scommand loop = scommand_new ();
+    scommand choice = scommand_new ();
+    pipeline patterns = word_pipeline ("*.c");
+
+    scommand_set_kind (loop, SCOMMAND_FOR);
+    scommand_push_back (loop, strdup ("x"));
+    scommand_push_back (loop, strdup ("a"));
+    scommand_push_back (loop, strdup ("b"));
+    scommand_add_list (loop, word_pipeline ("pwd"));
+    pipeline_push_back (pipe, loop);
+    scommand_set_kind (choice, SCOMMAND_CASE);
+    scommand_push_back (choice, strdup ("w"));
+    scommand_push_back (pipeline_front (patterns), strdup ("x"));
+    scommand_add_list (choice, patterns);
+    scommand_add_list (choice, word_pipeline ("ls"));
+    scommand_add_list (choice, word_pipeline ("*"));
+    scommand_add_list (choice, pipeline_new ());
+    pipeline_push_back (pipe, choice);
+
+    before = pipeline_to_string (pipe);
+    fail_unless (strcmp (before, "for x in a b; do pwd; done | case w in *.c | x) ls ;; *) ;; esac") == 0, NULL);
+    buf = pipeline_serialize (pipe, &size);
+    fail_unless (buf != NULL, NULL);
+    copy = pipeline_deserialize (buf, size);
+    fail_unless (copy != NULL, NULL);
+    after = pipeline_to_string (copy);
+    fail_unless (strcmp (before, after) == 0, NULL);
+    fail_unless (scommand_get_kind (pipeline_get_nth (copy, 0)) == SCOMMAND_FOR, NULL);
+    fail_unless (scommand_list_count (pipeline_get_nth (copy, 1)) == 4, NULL);
+    for (size_t i = 0; i < size; i++) {
+        fail_unless (pipeline_deserialize (buf, i) == NULL, NULL);
+    }
+
+    free (before);
+    free (after);
+    pipeline_destroy (copy);
+    free (buf);
+}
+END_TEST
+
+/* Un clon comparte la lista y los cuerpos; modificar uno no afecta al otro */
+START_TEST (test_clone_list)
+{
+    pipeline clone = NULL;
+    scommand group = group_example ();
+    pipeline_push_back (pipe, group);
+    pipeline_set_next (pipe, pipeline_new ());
+
+    clone = pipeline_clone (pipe);
+    pipeline_set_wait (clone, false);
+    fail_unless (pipeline_get_nth (clone, 0) != group, NULL);
+    fail_unless (pipeline_get_next (clone) != NULL, NULL);
+    fail_unless (pipeline_get_next (clone) != pipeline_get_next (pipe), NULL);
+    fail_unless (pipeline_get_wait (pipe), NULL);
+    pipeline_destroy (pipe);
+    pipe = clone;
+    fail_unless (scommand_get_kind (pipeline_get_nth (pipe, 0)) == SCOMMAND_BRACE_GROUP, NULL);
+}
+END_TEST
+
+/* La lista se arma una sola vez */
+START_TEST (test_set_next_twice)
+{
+    pipe = pipeline_new ();
+    pipeline_set_next (pipe, pipeline_new ());
+    pipeline_set_next (pipe, pipeline_new ());
+}
+END_TEST
+
+/* Un pipeline deserializado es de solo lectura */
+START_TEST (test_deserialized_read_only)
+{
+    void *buf = NULL;
+    size_t size = 0;
+    pipeline copy = NULL;
+    pipe = pipeline_new ();
+    pipeline_push_back (pipe, scommand_new ());
+    buf = pipeline_serialize (pipe, &size);
+    copy = pipeline_deserialize (buf, size);
+    pipeline_pop_front (copy);
+}
+END_TEST
+
+/* Un clon comparte los comandos, y modificar uno no afecta al otro */
+START_TEST (test_clone_copy_on_write)
+{
+    pipeline clone = NULL;
+    scommand scmd = scommand_new ();
+    scommand_push_back (scmd, strdup ("ls"));
+    pipeline_push_back (pipe, scmd);
+
+    clone = pipeline_clone (pipe);
+    fail_unless (clone != pipe, NULL);
+    fail_unless (pipeline_length (clone) == 1, NULL);
+    fail_unless (pipeline_get_nth (clone, 0) == scmd, NULL);
+
+    pipeline_push_back (clone, scommand_new ());
+    pipeline_set_wait (clone, false);
+    fail_unless (pipeline_length (clone) == 2, NULL);
+    fail_unless (pipeline_length (pipe) == 1, NULL);
+    fail_unless (pipeline_get_wait (pipe), NULL);
+    fail_unless (pipeline_get_nth (pipe, 0) == scmd, NULL);
+    fail_unless (pipeline_get_nth (clone, 0) != scmd, NULL);
+    fail_unless (strcmp (scommand_front (pipeline_get_nth (clone, 0)), "ls") == 0, NULL);
+
+    pipeline_destroy (clone);
+}
+END_TEST
+
+/* El original se puede destruir antes que el clon */
+START_TEST (test_clone_outlives_original)
+{
+    pipeline clone = NULL;
+    scommand scmd = scommand_new ();
+    scommand_push_back (scmd, strdup ("ls"));
+    pipeline_push_back (pipe, scmd);
+
+    clone = pipeline_clone (pipe);
+    pipeline_destroy (pipe);
+    pipe = clone;
+    fail_unless (pipeline_front (pipe) == scmd, NULL);
+}
+END_TEST
+
 /* Armado de la test suite */
 
 Suite *pipeline_suite (void)
@@ -273,6 +585,8 @@ Suite *pipeline_suite (void)
     tcase_add_test_raise_signal (tc_preconditions, test_front_empty, SIGABRT);
     tcase_add_test_raise_signal (tc_preconditions, test_get_wait_null, SIGABRT);
     tcase_add_test_raise_signal (tc_preconditions, test_to_string_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_deserialized_read_only, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_next_twice, SIGABRT);
     suite_add_tcase (s, tc_preconditions);
 
     /* Creation */
@@ -290,6 +604,14 @@ Suite *pipeline_suite (void)
     tcase_add_test (tc_functionality, test_wait);
     tcase_add_test (tc_functionality, test_to_string_empty);
     tcase_add_test (tc_functionality, test_to_string);
+    tcase_add_test (tc_functionality, test_serialize_roundtrip);
+    tcase_add_test (tc_functionality, test_deserialize_malformed);
+    tcase_add_test (tc_functionality, test_serialize_groups);
+    tcase_add_test (tc_functionality, test_serialize_compounds);
+    tcase_add_test (tc_functionality, test_serialize_redirections);
+    tcase_add_test (tc_functionality, test_clone_list);
+    tcase_add_test (tc_functionality, test_clone_copy_on_write);
+    tcase_add_test (tc_functionality, test_clone_outlives_original);
     suite_add_tcase (s, tc_functionality);
 
     return s;
@@ -298,6 +620,7 @@ Suite *pipeline_suite (void)
 /* Para testing de memoria */
 void pipeline_memory_test (void) {
     char* s = NULL;
+    pipeline clone = NULL;
     /* Las siguientes operaciones deberían poder hacer sin leaks ni doble 
      * frees.
      */
@@ -363,5 +686,13 @@ void pipeline_memory_test (void) {
     pipeline_push_back (pipe, scommand_new ());
     scommand_push_back (pipeline_front (pipe), strdup ("test"));
     pipeline_destroy (pipe);
+    /* Clonar, modificar el clon y destruir los dos en cualquier orden */
+    pipe = pipeline_new ();
+    pipeline_push_back (pipe, scommand_new ());
+    scommand_push_back (pipeline_front (pipe), strdup ("test"));
+    clone = pipeline_clone (pipe);
+    pipeline_pop_front (clone);
+    pipeline_destroy (pipe);
+    pipeline_destroy (clone);
 }
 
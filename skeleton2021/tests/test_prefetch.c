@@ -0,0 +1,80 @@
+#include <check.h>
+#include "test_prefetch.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+
+#include "prefetch.h"
+
+static void teardown (void) {
+    prefetch_stop ();
+}
+
+/* Precondiciones */
+START_TEST (test_command_null)
+{
+    prefetch_command (NULL);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_not_started)
+{
+    /* Sin el hilo no hace nada */
+    prefetch_command ("sh");
+    prefetch_stop ();
+}
+END_TEST
+
+START_TEST (test_start_stop)
+{
+    prefetch_start ();
+    prefetch_start ();
+    prefetch_command ("sh");
+    prefetch_command ("/bin/sh");
+    prefetch_command ("mybash-no-existe");
+    prefetch_command ("");
+    prefetch_stop ();
+    prefetch_stop ();
+    /* Se puede volver a arrancar */
+    prefetch_start ();
+    prefetch_command ("ls");
+}
+END_TEST
+
+START_TEST (test_many)
+{
+    /* Nunca espera al hilo: lo que no entra en la cola se descarta */
+    char name[32];
+    prefetch_start ();
+    for (unsigned int i = 0; i < 20 * PREFETCH_QUEUE; i++) {
+        sprintf (name, "mybash-no-existe-%u", i);
+        prefetch_command (name);
+    }
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *prefetch_suite (void)
+{
+    Suite *s = suite_create ("prefetch");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_command_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, NULL, teardown);
+    tcase_add_test (tc_functionality, test_not_started);
+    tcase_add_test (tc_functionality, test_start_stop);
+    tcase_add_test (tc_functionality, test_many);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
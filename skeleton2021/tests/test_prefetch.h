@@ -0,0 +1,8 @@
+#ifndef TEST_PREFETCH_H
+#define TEST_PREFETCH_H
+
+#include <check.h>
+
+Suite *prefetch_suite (void);
+
+#endif
@@ -0,0 +1,153 @@
+#include <check.h>
+#include "test_prompt.h"
+
+#include <pwd.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "prompt.h"
+
+/* Directorio temporal para \w y \W, y el directorio donde se estaba */
+static char root[] = "/tmp/mybash-prompt-XXXXXX";
+static char *previous = NULL;
+
+static void setup (void) {
+    previous = getcwd (NULL, 0);
+    fail_unless (mkdtemp (strcpy (root, "/tmp/mybash-prompt-XXXXXX")) != NULL, NULL);
+}
+
+static void teardown (void) {
+    prompt_destroy ();
+    if (previous != NULL) {
+        chdir (previous);
+        free (previous);
+        previous = NULL;
+    }
+    char path[64];
+    sprintf (path, "%s/sub", root);
+    rmdir (path);
+    rmdir (root);
+}
+
+/* Compila format y devuelve el prompt, verificando el largo */
+static const char *render (const char *format) {
+    size_t length = 0;
+    prompt_init (format);
+    const char *result = prompt_render (&length);
+    fail_unless (result != NULL && length == strlen (result), NULL);
+    return result;
+}
+
+/* Funcionalidad */
+
+START_TEST (test_literal)
+{
+    fail_unless (strcmp (render ("mybash> "), "mybash> ") == 0, NULL);
+    fail_unless (strcmp (render (""), "") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_escapes)
+{
+    /* \e es ESC, \n salto de línea, \\ una barra, \[ y \] no quedan */
+    fail_unless (strcmp (render ("a\\eb\\nc\\\\d\\[x\\]"), "a\033b\nc\\dx") == 0, NULL);
+    fail_unless (strcmp (render ("\\[\\e[0m\\]>"), "\033[0m>") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_unknown_escape)
+{
+    /* Una barra con otro caracter, o al final, se imprime tal cual */
+    fail_unless (strcmp (render ("\\q\\"), "\\q\\") == 0, NULL);
+    /* Y el caracter se vuelve a mirar: "\\\\" sigue siendo una barra */
+    fail_unless (strcmp (render ("\\x\\\\"), "\\x\\") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_user_sign)
+{
+    struct passwd *password = getpwuid (geteuid ());
+    fail_unless (password != NULL, NULL);
+    char expected[256];
+    sprintf (expected, "[%s]%c", password->pw_name, geteuid () == 0 ? '#' : '$');
+    fail_unless (strcmp (render ("[\\u]\\$"), expected) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_host)
+{
+    char host[256];
+    host[255] = '\0';
+    fail_unless (gethostname (host, 255) == 0, NULL);
+    char expected[600];
+    /* \h es hasta el primer '.', \H completo */
+    sprintf (expected, "%.*s %s", (int) strcspn (host, "."), host, host);
+    fail_unless (strcmp (render ("\\h \\H"), expected) == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_cwd)
+{
+    char path[64];
+    sprintf (path, "%s/sub", root);
+    fail_unless (mkdir (path, 0755) == 0, NULL);
+    fail_unless (chdir (path) == 0, NULL);
+    /* root puede tener un enlace simbólico en el medio (/tmp) */
+    char *cwd = getcwd (NULL, 0);
+    char expected[256];
+    sprintf (expected, "%s:sub", cwd);
+    free (cwd);
+    fail_unless (strcmp (render ("\\w:\\W"), expected) == 0, NULL);
+
+    /* Sin prompt_cwd_changed se sigue mostrando el directorio guardado */
+    fail_unless (chdir ("/") == 0, NULL);
+    fail_unless (strcmp (prompt_render (NULL), expected) == 0, NULL);
+    /* En "/" \W también es "/" */
+    prompt_cwd_changed ();
+    fail_unless (strcmp (prompt_render (NULL), "/:/") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_default_format)
+{
+    /* Sin prompt_init se usa el formato por defecto */
+    char *implicit = strdup (prompt_render (NULL));
+    fail_unless (strcmp (render (PROMPT_DEFAULT_FORMAT), implicit) == 0, NULL);
+    fail_unless (strcmp (render (NULL), implicit) == 0, NULL);
+    free (implicit);
+}
+END_TEST
+
+START_TEST (test_replace)
+{
+    /* Un prompt_init nuevo reemplaza al anterior */
+    render ("uno\\$ ");
+    fail_unless (strcmp (render ("dos> "), "dos> ") == 0, NULL);
+}
+END_TEST
+
+
+/* Armado de la test suite */
+
+Suite *prompt_suite (void)
+{
+    Suite *s = suite_create ("prompt");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_literal);
+    tcase_add_test (tc_functionality, test_escapes);
+    tcase_add_test (tc_functionality, test_unknown_escape);
+    tcase_add_test (tc_functionality, test_user_sign);
+    tcase_add_test (tc_functionality, test_host);
+    tcase_add_test (tc_functionality, test_cwd);
+    tcase_add_test (tc_functionality, test_default_format);
+    tcase_add_test (tc_functionality, test_replace);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_PROMPT_H
+#define TEST_PROMPT_H
+
+#include <check.h>
+
+Suite *prompt_suite (void);
+
+#endif
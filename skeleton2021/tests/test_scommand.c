@@ -108,6 +108,32 @@ START_TEST (test_to_string_null)
 }
 END_TEST
 
+/* Un comando con argumentos no puede ser un grupo */
+START_TEST (test_set_body_not_empty)
+{
+    scmd = scommand_new ();
+    scommand_push_back (scmd, strdup ("ls"));
+    scommand_set_body (scmd, SCOMMAND_SUBSHELL, pipeline_new ());
+}
+END_TEST
+
+/* Un comando simple no tiene listas */
+START_TEST (test_add_list_simple)
+{
+    pipeline list = pipeline_new ();
+    scmd = scommand_new ();
+    scommand_add_list (scmd, list);
+}
+END_TEST
+
+/* Una copia sin de qué descriptor */
+START_TEST (test_add_redir_dup_no_source)
+{
+    scmd = scommand_new ();
+    scommand_add_redir (scmd, SCOMMAND_REDIR_DUP, 2, -1, NULL);
+}
+END_TEST
+
 
 /* Crear y destruir */
 START_TEST (test_new_destroy)
@@ -283,6 +309,36 @@ START_TEST (test_independent_redirs)
 }
 END_TEST
 
+/* Las redirecciones generales quedan en orden, aparte de las otras dos, y
+ * la copia tiene las suyas */
+START_TEST (test_general_redirs)
+{
+    scommand copy = NULL;
+    char *str = NULL;
+
+    scommand_push_back (scmd, strdup ("ls"));
+    scommand_set_redir_out (scmd, strdup ("out"));
+    scommand_add_redir (scmd, SCOMMAND_REDIR_APPEND, 2, -1, strdup ("log"));
+    scommand_add_redir (scmd, SCOMMAND_REDIR_DUP, 1, 2, NULL);
+    scommand_add_redir (scmd, SCOMMAND_REDIR_CLOSE, 0, -1, NULL);
+    fail_unless (scommand_redir_count (scmd) == 3, NULL);
+    fail_unless (scommand_get_redir (scmd, 0)->kind == SCOMMAND_REDIR_APPEND, NULL);
+    fail_unless (scommand_get_redir (scmd, 1)->source == 2, NULL);
+    fail_unless (scommand_get_redir (scmd, 2)->fd == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (scmd), "out") == 0, NULL);
+
+    copy = scommand_copy (scmd);
+    fail_unless (scommand_redir_count (copy) == 3, NULL);
+    fail_unless (scommand_get_redir (copy, 0)->target !=
+                 scommand_get_redir (scmd, 0)->target, NULL);
+    fail_unless (strcmp (scommand_get_redir (copy, 0)->target, "log") == 0, NULL);
+
+    str = scommand_to_string (copy);
+    fail_unless (strcmp (str, "ls > out 2>> log >&2 0>&-") == 0, NULL);
+    free (str);
+    scommand_destroy (copy);
+}
+END_TEST
 
 /* Comando nuevo, string vacío */
 START_TEST (test_to_string_empty)
@@ -357,6 +413,9 @@ Suite *scommand_suite (void)
     tcase_add_test_raise_signal (tc_preconditions, test_get_redir_in_null, SIGABRT);
     tcase_add_test_raise_signal (tc_preconditions, test_get_redir_out_null, SIGABRT);
     tcase_add_test_raise_signal (tc_preconditions, test_to_string_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_body_not_empty, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_add_list_simple, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_add_redir_dup_no_source, SIGABRT);
     suite_add_tcase (s, tc_preconditions);
 
     /* Creation */
@@ -374,6 +433,7 @@ Suite *scommand_suite (void)
     tcase_add_test (tc_functionality, test_front_is_not_back);
     tcase_add_test (tc_functionality, test_redir);
     tcase_add_test (tc_functionality, test_independent_redirs);
+    tcase_add_test (tc_functionality, test_general_redirs);
     tcase_add_test (tc_functionality, test_to_string_empty);
     tcase_add_test (tc_functionality, test_to_string);
     suite_add_tcase (s, tc_functionality);
@@ -0,0 +1,198 @@
+#include <check.h>
+#include "test_scriptcache.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "scriptcache.h"
+
+/* Un directorio temporal con el script y su caché */
+static char root[] = "/tmp/mybash-scriptcache-XXXXXX";
+static char script_path[64];
+static char cache_path[64];
+
+static const char *script =
+    "echo uno > a\n"
+    "if true; then\n"
+    "    cd /tmp\n"
+    "fi\n"
+    "for x in a b; do ls $x | wc; done\n";
+
+static const char *expected[] = {
+    "echo uno > a",
+    "if true; then cd /tmp; fi",
+    "for x in a b; do ls $x | wc; done",
+    NULL};
+
+static void write_script (const char *text) {
+    int fd = open (script_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    fail_unless (fd != -1, NULL);
+    fail_unless (write (fd, text, strlen (text)) == (ssize_t) strlen (text), NULL);
+    close (fd);
+}
+
+static void setup (void) {
+    fail_unless (mkdtemp (strcpy (root, "/tmp/mybash-scriptcache-XXXXXX")) != NULL, NULL);
+    sprintf (script_path, "%s/script.sh", root);
+    sprintf (cache_path, "%s/.script.sh" SCRIPTCACHE_SUFFIX, root);
+    write_script (script);
+}
+
+static void teardown (void) {
+    unlink (cache_path);
+    unlink (script_path);
+    rmdir (root);
+}
+
+/* Abre el script y compara sus pipelines con lines (terminado en NULL).
+ * Returns: si salieron del caché
+ */
+static bool check_script (const char **lines) {
+    int fd = open (script_path, O_RDONLY);
+    fail_unless (fd != -1, NULL);
+    scriptcache cache = scriptcache_open (script_path, fd, NULL);
+    fail_unless (cache != NULL, NULL);
+    bool cached = scriptcache_is_cached (cache);
+    for (unsigned int i = 0; lines[i] != NULL; i++) {
+        pipeline next = scriptcache_peek (cache);
+        pipeline apipe = scriptcache_next (cache);
+        fail_unless (apipe != NULL && apipe == next, NULL);
+        char *str = pipeline_to_string (apipe);
+        fail_unless (strcmp (str, lines[i]) == 0, NULL);
+        free (str);
+        pipeline_destroy (apipe);
+    }
+    fail_unless (scriptcache_peek (cache) == NULL, NULL);
+    fail_unless (scriptcache_next (cache) == NULL, NULL);
+    cache = scriptcache_close (cache);
+    close (fd);
+    return cached;
+}
+
+/* Precondiciones */
+START_TEST (test_open_null)
+{
+    scriptcache_open (NULL, 0, NULL);
+}
+END_TEST
+
+START_TEST (test_next_null)
+{
+    scriptcache_next (NULL);
+}
+END_TEST
+
+/* Funcionalidad */
+START_TEST (test_path)
+{
+    char *path = scriptcache_path ("dir/sub/script.sh");
+    fail_unless (strcmp (path, "dir/sub/.script.sh" SCRIPTCACHE_SUFFIX) == 0, NULL);
+    free (path);
+    path = scriptcache_path ("script");
+    fail_unless (strcmp (path, ".script" SCRIPTCACHE_SUFFIX) == 0, NULL);
+    free (path);
+}
+END_TEST
+
+START_TEST (test_not_regular)
+{
+    int fds[2];
+    fail_unless (pipe (fds) == 0, NULL);
+    fail_unless (scriptcache_open ("script", fds[0], NULL) == NULL, NULL);
+    close (fds[0]);
+    close (fds[1]);
+}
+END_TEST
+
+START_TEST (test_compile)
+{
+    /* La primera vez se parsea y se guarda, después sale del caché */
+    fail_unless (!check_script (expected), NULL);
+    fail_unless (access (cache_path, R_OK) == 0, NULL);
+    fail_unless (check_script (expected), NULL);
+    fail_unless (check_script (expected), NULL);
+}
+END_TEST
+
+START_TEST (test_changed)
+{
+    const char *changed[] = {"echo dos", NULL};
+    fail_unless (!check_script (expected), NULL);
+    write_script ("echo dos\n");
+    fail_unless (!check_script (changed), NULL);
+    fail_unless (check_script (changed), NULL);
+}
+END_TEST
+
+START_TEST (test_syntax_errors)
+{
+    /* Los pipelines con errores no se guardan, los demás sí */
+    const char *lines[] = {"echo a", "echo b", NULL};
+    write_script ("echo a\nls |\n\necho b\nfi\n");
+    fail_unless (!check_script (lines), NULL);
+    fail_unless (check_script (lines), NULL);
+}
+END_TEST
+
+START_TEST (test_empty)
+{
+    const char *lines[] = {NULL};
+    write_script ("");
+    fail_unless (!check_script (lines), NULL);
+    fail_unless (check_script (lines), NULL);
+}
+END_TEST
+
+START_TEST (test_corrupted)
+{
+    fail_unless (!check_script (expected), NULL);
+    /* Se corta el caché: se vuelve a parsear y se reemplaza */
+    fail_unless (truncate (cache_path, 100) == 0, NULL);
+    fail_unless (!check_script (expected), NULL);
+    fail_unless (check_script (expected), NULL);
+}
+END_TEST
+
+START_TEST (test_untrusted)
+{
+    /* Un caché que cualquiera puede modificar no se usa */
+    fail_unless (!check_script (expected), NULL);
+    fail_unless (chmod (cache_path, 0666) == 0, NULL);
+    fail_unless (!check_script (expected), NULL);
+    fail_unless (check_script (expected), NULL);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *scriptcache_suite (void)
+{
+    Suite *s = suite_create ("scriptcache");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_open_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_next_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_path);
+    tcase_add_test (tc_functionality, test_not_regular);
+    tcase_add_test (tc_functionality, test_compile);
+    tcase_add_test (tc_functionality, test_changed);
+    tcase_add_test (tc_functionality, test_syntax_errors);
+    tcase_add_test (tc_functionality, test_empty);
+    tcase_add_test (tc_functionality, test_corrupted);
+    tcase_add_test (tc_functionality, test_untrusted);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
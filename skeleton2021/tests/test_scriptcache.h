@@ -0,0 +1,8 @@
+#ifndef TEST_SCRIPTCACHE_H
+#define TEST_SCRIPTCACHE_H
+
+#include <check.h>
+
+Suite *scriptcache_suite (void);
+
+#endif
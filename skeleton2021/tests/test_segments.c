@@ -0,0 +1,272 @@
+#include <check.h>
+#include "test_segments.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "segments.h"
+
+/* Cuánto se espera a los proveedores; en las pruebas siempre llegan */
+#define WAIT_MS 5000u
+
+/* Un repositorio de git falso en un directorio temporal: solo lo que lee
+ * segments.c (HEAD, index), armado a mano para no depender de git
+ */
+static char root[] = "/tmp/mybash-segments-XXXXXX";
+static char *previous = NULL;
+
+/* Ruta de name dentro de root, en memoria estática */
+static const char *path (const char *name) {
+    static char result[128];
+    sprintf (result, "%s/%s", root, name);
+    return result;
+}
+
+static void write_file (const char *name, const char *content, size_t length) {
+    int fd = open (path (name), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    fail_unless (fd != -1, NULL);
+    fail_unless (write (fd, content, length) == (ssize_t) length, NULL);
+    close (fd);
+}
+
+static void setup (void) {
+    previous = getcwd (NULL, 0);
+    fail_unless (mkdtemp (strcpy (root, "/tmp/mybash-segments-XXXXXX")) != NULL, NULL);
+    fail_unless (chdir (root) == 0, NULL);
+    segments_start ();
+}
+
+static void teardown (void) {
+    segments_stop ();
+    if (previous != NULL) {
+        chdir (previous);
+        free (previous);
+        previous = NULL;
+    }
+    const char *files[] = {".git/HEAD", ".git/index", ".git", "real/HEAD",
+                           "a.txt", "sub", "real", NULL};
+    for (unsigned int i = 0; files[i] != NULL; i++) {
+        if (unlink (path (files[i])) != 0) {
+            rmdir (path (files[i]));
+        }
+    }
+    rmdir (root);
+}
+
+/* Pide una vuelta de los proveedores y devuelve el valor de kind, en
+ * memoria estática
+ */
+static const char *segment (segments_kind kind) {
+    static char value[128];
+    segments_refresh (WAIT_MS);
+    size_t length = segments_get (kind, value, sizeof (value));
+    fail_unless (length == strlen (value), NULL);
+    return value;
+}
+
+/* Arma .git con HEAD */
+static void make_repository (const char *head) {
+    fail_unless (mkdir (path (".git"), 0755) == 0, NULL);
+    write_file (".git/HEAD", head, strlen (head));
+}
+
+static void put32 (unsigned char *p, uint32_t value) {
+    p[0] = value >> 24; p[1] = value >> 16; p[2] = value >> 8; p[3] = value;
+}
+
+/* Arma .git/index (versión `version') con una entrada para name, con la
+ * fecha y el tamaño de st y los flags de etapa `stage'
+ */
+static void make_index (uint32_t version, const char *name,
+                        const struct stat *st, unsigned int stage) {
+    unsigned char index[256];
+    size_t name_length = strlen (name);
+    size_t entry_length = (62 + name_length + 8) & ~(size_t) 7;
+    assert (12 + entry_length + 20 <= sizeof (index));
+    memset (index, 0, sizeof (index));
+    memcpy (index, "DIRC", 4);
+    put32 (index + 4, version);
+    put32 (index + 8, 1);
+    unsigned char *entry = index + 12;
+    put32 (entry + 8, (uint32_t) st->st_mtim.tv_sec);
+    put32 (entry + 12, (uint32_t) st->st_mtim.tv_nsec);
+    put32 (entry + 24, 0100644);
+    put32 (entry + 36, (uint32_t) st->st_size);
+    entry[60] = (unsigned char) ((stage << 4) | (name_length >> 8));
+    entry[61] = (unsigned char) name_length;
+    memcpy (entry + 62, name, name_length);
+    /* El hash del final no se mira */
+    write_file (".git/index", (const char *) index, 12 + entry_length + 20);
+}
+
+/* Funcionalidad */
+
+START_TEST (test_vcs_none)
+{
+    /* Fuera de un repositorio no hay nada */
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_branch)
+{
+    make_repository ("ref: refs/heads/main\n");
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+    /* Desde un subdirectorio se encuentra igual */
+    fail_unless (mkdir (path ("sub"), 0755) == 0, NULL);
+    fail_unless (chdir (path ("sub")) == 0, NULL);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+    /* Una referencia que no es una rama queda entera */
+    write_file (".git/HEAD", "ref: refs/remotes/origin/x\n", 27);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "refs/remotes/origin/x") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_detached)
+{
+    /* HEAD suelto: el comienzo del hash */
+    make_repository ("0123456789abcdef0123456789abcdef01234567\n");
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "0123456") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_gitdir_file)
+{
+    /* .git puede ser un archivo que dice dónde están los datos */
+    fail_unless (mkdir (path ("real"), 0755) == 0, NULL);
+    write_file ("real/HEAD", "ref: refs/heads/otra\n", 21);
+    write_file (".git", "gitdir: real\n", 13);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "otra") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_index_clean)
+{
+    struct stat st;
+    make_repository ("ref: refs/heads/main\n");
+    write_file ("a.txt", "hola\n", 5);
+    fail_unless (stat (path ("a.txt"), &st) == 0, NULL);
+    make_index (2, "a.txt", &st, 0);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+    /* La versión 3 tiene las mismas entradas */
+    make_index (3, "a.txt", &st, 0);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_index_dirty)
+{
+    struct stat st;
+    make_repository ("ref: refs/heads/main\n");
+    write_file ("a.txt", "hola\n", 5);
+    fail_unless (stat (path ("a.txt"), &st) == 0, NULL);
+    make_index (2, "a.txt", &st, 0);
+
+    /* Otro tamaño */
+    write_file ("a.txt", "chau, hola\n", 11);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main*") == 0, NULL);
+    /* Borrado */
+    unlink (path ("a.txt"));
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main*") == 0, NULL);
+    /* Un conflicto sin resolver (etapa distinta de 0) */
+    write_file ("a.txt", "hola\n", 5);
+    fail_unless (stat (path ("a.txt"), &st) == 0, NULL);
+    make_index (2, "a.txt", &st, 2);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main*") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_vcs_index_unknown)
+{
+    /* Un índice que no se entiende no dice que haya cambios */
+    struct stat st;
+    make_repository ("ref: refs/heads/main\n");
+    write_file ("a.txt", "hola\n", 5);
+    fail_unless (stat (path ("a.txt"), &st) == 0, NULL);
+    st.st_size = 99;
+    make_index (4, "a.txt", &st, 0);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+    write_file (".git/index", "DIRC", 4);
+    fail_unless (strcmp (segment (SEGMENTS_VCS), "main") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_duration)
+{
+    /* Sin ningún comando no hay nada */
+    segments_set_last_duration (UINT64_MAX);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "") == 0, NULL);
+    /* Menos de un segundo, en milisegundos enteros */
+    segments_set_last_duration (0);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "0ms") == 0, NULL);
+    segments_set_last_duration (5999999);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "5ms") == 0, NULL);
+    segments_set_last_duration (999999999);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "999ms") == 0, NULL);
+    /* Desde un segundo, en segundos con dos decimales */
+    segments_set_last_duration (1000000000);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "1.00s") == 0, NULL);
+    segments_set_last_duration (61250000000ull);
+    fail_unless (strcmp (segment (SEGMENTS_DURATION), "61.25s") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_jobs)
+{
+    fail_unless (strcmp (segment (SEGMENTS_JOBS), "0") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_get_truncates)
+{
+    /* segments_get corta lo que no entra */
+    char small[3];
+    segments_set_last_duration (123000000);
+    segments_refresh (WAIT_MS);
+    fail_unless (segments_get (SEGMENTS_DURATION, small, sizeof (small)) == 2, NULL);
+    fail_unless (strcmp (small, "12") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_stopped)
+{
+    /* Sin el hilo, refresh no hace nada y los valores quedan vacíos */
+    char value[16];
+    segments_stop ();
+    segments_set_last_duration (5000000);
+    segments_refresh (WAIT_MS);
+    fail_unless (segments_get (SEGMENTS_DURATION, value, sizeof (value)) == 0, NULL);
+}
+END_TEST
+
+
+/* Armado de la test suite */
+
+Suite *segments_suite (void)
+{
+    Suite *s = suite_create ("segments");
+    TCase *tc_functionality = tcase_create ("Functionality");
+
+    /* Funcionalidad */
+    tcase_add_checked_fixture (tc_functionality, setup, teardown);
+    tcase_add_test (tc_functionality, test_vcs_none);
+    tcase_add_test (tc_functionality, test_vcs_branch);
+    tcase_add_test (tc_functionality, test_vcs_detached);
+    tcase_add_test (tc_functionality, test_vcs_gitdir_file);
+    tcase_add_test (tc_functionality, test_vcs_index_clean);
+    tcase_add_test (tc_functionality, test_vcs_index_dirty);
+    tcase_add_test (tc_functionality, test_vcs_index_unknown);
+    tcase_add_test (tc_functionality, test_duration);
+    tcase_add_test (tc_functionality, test_jobs);
+    tcase_add_test (tc_functionality, test_get_truncates);
+    tcase_add_test (tc_functionality, test_stopped);
+    suite_add_tcase (s, tc_functionality);
+
+    return s;
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_SEGMENTS_H
+#define TEST_SEGMENTS_H
+
+#include <check.h>
+
+Suite *segments_suite (void);
+
+#endif
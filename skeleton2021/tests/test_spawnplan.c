@@ -0,0 +1,319 @@
+#include <check.h>
+#include "test_spawnplan.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "spawnplan.h"
+
+/* Archivos de entrada y salida de los pipelines de las pruebas */
+static char input[] = "/tmp/mybash-spawnplan-XXXXXX";
+static char output[] = "/tmp/mybash-spawnplan-XXXXXX";
+
+static void setup (void) {
+    int fd = mkstemp (strcpy (input, "/tmp/mybash-spawnplan-XXXXXX"));
+    fail_unless (fd != -1, NULL);
+    fail_unless (write (fd, "uno\ndos\ntres\n", 13) == 13, NULL);
+    close (fd);
+    fd = mkstemp (strcpy (output, "/tmp/mybash-spawnplan-XXXXXX"));
+    fail_unless (fd != -1, NULL);
+    close (fd);
+}
+
+static void teardown (void) {
+    unlink (input);
+    unlink (output);
+}
+
+/* argv nuevo con las palabras de words (separadas por espacios). Las
+ * cadenas son de un buffer estático por etapa, que dura toda la prueba.
+ */
+static char **words_argv (const char *words) {
+    static char buffers[64][128];
+    static unsigned int next = 0;
+    char *buffer = buffers[next % 64];
+    char **argv = calloc (16, sizeof (char *));
+    unsigned int count = 0;
+    next++;
+    strcpy (buffer, words);
+    for (char *w = strtok (buffer, " "); w != NULL; w = strtok (NULL, " ")) {
+        argv[count] = w;
+        count++;
+    }
+    return argv;
+}
+
+/* Espera a los procesos lanzados.
+ * Returns: cuántos terminaron con 0
+ */
+static unsigned int wait_all (const pid_t *pids, unsigned int count) {
+    unsigned int succeeded = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        int wstatus = -1;
+        if (pids[i] > 0 && waitpid (pids[i], &wstatus, 0) == pids[i] &&
+            WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 0) {
+            succeeded++;
+        }
+    }
+    return succeeded;
+}
+
+static void read_output (char *buffer, size_t size) {
+    int fd = open (output, O_RDONLY);
+    ssize_t n = read (fd, buffer, size - 1);
+    fail_unless (n >= 0, NULL);
+    buffer[n] = '\0';
+    close (fd);
+}
+
+/* Pipeline de `stages' etapas: la primera lee input, las del medio son
+ * cat y la última agrega un número de línea y escribe en output
+ */
+static spawnplan cat_pipeline (unsigned int stages) {
+    spawnplan plan = spawnplan_new (stages);
+    int in = open (input, O_RDONLY | O_CLOEXEC);
+    int out = open (output, O_WRONLY | O_TRUNC | O_CLOEXEC);
+    for (unsigned int i = 0; i < stages; i++) {
+        const char *words = i + 1 < stages ? "cat" : "sed -n $=";
+        spawnplan_set_stage (plan, i, NULL, words_argv (words),
+                             i == 0 ? in : -1, i + 1 == stages ? out : -1);
+    }
+    return plan;
+}
+
+/* Precondiciones */
+START_TEST (test_new_empty)
+{
+    spawnplan_new (0);
+}
+END_TEST
+
+START_TEST (test_set_out_of_range)
+{
+    spawnplan plan = spawnplan_new (2);
+    spawnplan_set_stage (plan, 2, NULL, words_argv ("true"), -1, -1);
+}
+END_TEST
+
+START_TEST (test_set_null_argv)
+{
+    spawnplan plan = spawnplan_new (2);
+    spawnplan_set_stage (plan, 0, NULL, NULL, -1, -1);
+}
+END_TEST
+
+START_TEST (test_set_twice)
+{
+    spawnplan plan = spawnplan_new (2);
+    spawnplan_set_stage (plan, 0, NULL, words_argv ("true"), -1, -1);
+    spawnplan_set_stage (plan, 0, NULL, words_argv ("true"), -1, -1);
+}
+END_TEST
+
+START_TEST (test_run_twice)
+{
+    spawnplan plan = spawnplan_new (1);
+    pid_t pid = -1;
+    spawnplan_set_stage (plan, 0, "/bin/true", words_argv ("true"), -1, -1);
+    spawnplan_run (plan, &pid);
+    wait_all (&pid, 1);
+    spawnplan_run (plan, NULL);
+}
+END_TEST
+
+/* El error solo se redirige en una etapa armada */
+START_TEST (test_error_unset_stage)
+{
+    spawnplan plan = spawnplan_new (2);
+    spawnplan_set_error (plan, 1, SPAWNPLAN_OUTPUT);
+}
+END_TEST
+
+START_TEST (test_destroy_null)
+{
+    spawnplan_destroy (NULL);
+}
+END_TEST
+
+/* Ejecución */
+START_TEST (test_single)
+{
+    char buffer[64];
+    pid_t pid = -1;
+    spawnplan plan = cat_pipeline (1);
+    fail_unless (spawnplan_run (plan, &pid) == 1, NULL);
+    fail_unless (wait_all (&pid, 1) == 1, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strcmp (buffer, "3\n") == 0, NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+START_TEST (test_wide)
+{
+    /* Con uno y con varios hilos el resultado es el mismo */
+    unsigned int threads[] = {1, 4, 0};
+    for (unsigned int k = 0; k < 3; k++) {
+        char buffer[64];
+        pid_t pids[40];
+        spawnplan plan = cat_pipeline (40);
+        spawnplan_set_threads (plan, threads[k]);
+        fail_unless (spawnplan_run (plan, pids) == 40, NULL);
+        fail_unless (wait_all (pids, 40) == 40, NULL);
+        read_output (buffer, sizeof (buffer));
+        fail_unless (strcmp (buffer, "3\n") == 0, NULL);
+        plan = spawnplan_destroy (plan);
+    }
+}
+END_TEST
+
+START_TEST (test_path)
+{
+    char buffer[64];
+    pid_t pids[2];
+    spawnplan plan = spawnplan_new (2);
+    int out = open (output, O_WRONLY | O_CLOEXEC);
+    spawnplan_set_stage (plan, 0, "/bin/sh", words_argv ("sh -c pwd"), -1,
+                         -1);
+    spawnplan_set_stage (plan, 1, "/bin/cat", words_argv ("cat"), -1, out);
+    fail_unless (spawnplan_run (plan, pids) == 2, NULL);
+    fail_unless (wait_all (pids, 2) == 2, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (buffer[0] == '/', NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+START_TEST (test_not_found)
+{
+    char buffer[64];
+    pid_t pids[3];
+    spawnplan plan = spawnplan_new (3);
+    int out = open (output, O_WRONLY | O_CLOEXEC);
+    int null = open ("/dev/null", O_WRONLY);
+    int saved = dup (STDERR_FILENO);
+    spawnplan_set_stage (plan, 0, NULL, words_argv ("echo hola"), -1, -1);
+    spawnplan_set_stage (plan, 1, NULL, words_argv ("mybash-no-existe"), -1,
+                         -1);
+    spawnplan_set_stage (plan, 2, NULL, words_argv ("cat"), -1, out);
+    /* El error va a stderr */
+    dup2 (null, STDERR_FILENO);
+    unsigned int launched = spawnplan_run (plan, pids);
+    dup2 (saved, STDERR_FILENO);
+    close (saved);
+    close (null);
+    fail_unless (launched == 2, NULL);
+    fail_unless (pids[1] == -1, NULL);
+    fail_unless (spawnplan_failure_status (plan, 1) == 127, NULL);
+    /* Las demás terminan igual: cat ve el final del archivo */
+    fail_unless (wait_all (pids, 3) >= 1, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (buffer[0] == '\0', NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+START_TEST (test_unset_stage)
+{
+    pid_t pids[3];
+    spawnplan plan = spawnplan_new (3);
+    int out = open (output, O_WRONLY | O_CLOEXEC);
+    spawnplan_set_stage (plan, 0, NULL, words_argv ("cat"), -1, -1);
+    spawnplan_set_stage (plan, 2, NULL, words_argv ("cat"), -1, out);
+    /* La primera lee de /dev/null para no esperar la terminal */
+    int null = open ("/dev/null", O_RDONLY);
+    int saved = dup (STDIN_FILENO);
+    dup2 (null, STDIN_FILENO);
+    fail_unless (spawnplan_run (plan, pids) == 2, NULL);
+    dup2 (saved, STDIN_FILENO);
+    close (saved);
+    close (null);
+    fail_unless (pids[1] == -1, NULL);
+    fail_unless (spawnplan_failure_status (plan, 1) == EXIT_FAILURE, NULL);
+    fail_unless (wait_all (pids, 3) == 2, NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+/* "cat input no-existe 2>&1 | wc -l": el error va por el pipe */
+START_TEST (test_error_to_pipe)
+{
+    char buffer[64];
+    char words[128];
+    pid_t pids[2];
+    spawnplan plan = spawnplan_new (2);
+    int out = open (output, O_WRONLY | O_CLOEXEC);
+    snprintf (words, sizeof (words), "cat %s /mybash-no-existe", input);
+    spawnplan_set_stage (plan, 0, NULL, words_argv (words), -1, -1);
+    spawnplan_set_error (plan, 0, SPAWNPLAN_OUTPUT);
+    spawnplan_set_stage (plan, 1, NULL, words_argv ("wc -l"), -1, out);
+    fail_unless (spawnplan_run (plan, pids) == 2, NULL);
+    wait_all (pids, 2);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strcmp (buffer, "4\n") == 0, NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+/* "cat input no-existe > output 2>&1": el error es la misma redirección
+ * que la salida, y se cierra una sola vez */
+START_TEST (test_error_same_as_output)
+{
+    char buffer[256];
+    char words[128];
+    pid_t pid = -1;
+    spawnplan plan = spawnplan_new (1);
+    int out = open (output, O_WRONLY | O_CLOEXEC);
+    snprintf (words, sizeof (words), "cat %s /mybash-no-existe", input);
+    spawnplan_set_stage (plan, 0, NULL, words_argv (words), -1, out);
+    spawnplan_set_error (plan, 0, out);
+    fail_unless (spawnplan_run (plan, &pid) == 1, NULL);
+    fail_unless (wait_all (&pid, 1) == 0, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strncmp (buffer, "uno\ndos\ntres\n", 13) == 0, NULL);
+    fail_unless (strstr (buffer, "/mybash-no-existe") != NULL, NULL);
+    /* El plan ya lo cerró */
+    fail_unless (fcntl (out, F_GETFD) == -1, NULL);
+    plan = spawnplan_destroy (plan);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *spawnplan_suite (void)
+{
+    Suite *s = suite_create ("spawnplan");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_execution = tcase_create ("Execution");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_new_empty, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_out_of_range,
+                                 SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_null_argv, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_twice, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_run_twice, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_error_unset_stage,
+                                 SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_destroy_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Ejecución */
+    tcase_add_checked_fixture (tc_execution, setup, teardown);
+    tcase_add_test (tc_execution, test_single);
+    tcase_add_test (tc_execution, test_wide);
+    tcase_add_test (tc_execution, test_path);
+    tcase_add_test (tc_execution, test_not_found);
+    tcase_add_test (tc_execution, test_unset_stage);
+    tcase_add_test (tc_execution, test_error_to_pipe);
+    tcase_add_test (tc_execution, test_error_same_as_output);
+    suite_add_tcase (s, tc_execution);
+
+    return s;
+}
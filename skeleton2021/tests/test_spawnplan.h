@@ -0,0 +1,8 @@
+#ifndef TEST_SPAWNPLAN_H
+#define TEST_SPAWNPLAN_H
+
+#include <check.h>
+
+Suite *spawnplan_suite (void);
+
+#endif
@@ -0,0 +1,419 @@
+#include <check.h>
+#include "test_vars.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h> /* para sprintf */
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "command.h"
+#include "expand.h"
+#include "parser.h"
+#include "vars.h"
+
+/* Indica si "name=value" está en el entorno de vars_envp */
+static bool in_envp (const char *name, const char *value) {
+    char text[256];
+    sprintf (text, "%s=%s", name, value);
+    char *const *envp = vars_envp ();
+    bool found = false;
+    for (unsigned int i = 0; envp[i] != NULL && !found; i++) {
+        found = strcmp (envp[i], text) == 0;
+    }
+    return found;
+}
+
+static unsigned int envp_length (void) {
+    char *const *envp = vars_envp ();
+    unsigned int length = 0;
+    while (envp[length] != NULL) {
+        length++;
+    }
+    return length;
+}
+
+/* Parsea line (una línea) */
+static pipeline parse (const char *line) {
+    Parser parser = parser_new_from_buffer (line, strlen (line));
+    pipeline result = parse_pipeline (parser);
+    parser_destroy (parser);
+    fail_unless (result != NULL, NULL);
+    return result;
+}
+
+/* Expande el primer comando de line y compara sus palabras, separadas por
+ * '|' en expected
+ */
+static void check_expansion (const char *line, const char *expected) {
+    pipeline p = parse (line);
+    pipeline expanded = expand_pipeline (p);
+    fail_unless (expanded != NULL, NULL);
+    scommand cmd = pipeline_get_nth (expanded, 0);
+    char buffer[256] = "";
+    for (unsigned int i = 0; i < scommand_length (cmd); i++) {
+        strcat (buffer, i > 0 ? "|" : "");
+        strcat (buffer, scommand_get_nth (cmd, i));
+    }
+    fail_unless (strcmp (buffer, expected) == 0, buffer);
+    pipeline_destroy (expanded);
+    pipeline_destroy (p);
+}
+
+/* Precondiciones */
+START_TEST (test_get_null)
+{
+    vars_get (NULL);
+}
+END_TEST
+
+START_TEST (test_set_invalid)
+{
+    vars_set ("1A", "valor");
+}
+END_TEST
+
+START_TEST (test_export_invalid)
+{
+    vars_export ("A-B");
+}
+END_TEST
+
+START_TEST (test_expand_null)
+{
+    scommand cmd = scommand_new ();
+    expand_word (NULL, cmd);
+}
+END_TEST
+
+/* Variables */
+START_TEST (test_names)
+{
+    fail_unless (vars_name_length ("HOME") == 4, NULL);
+    fail_unless (vars_name_length ("_a1=b") == 3, NULL);
+    fail_unless (vars_name_length ("1a") == 0, NULL);
+    fail_unless (vars_name_length ("") == 0, NULL);
+    fail_unless (vars_is_assignment ("A=1"), NULL);
+    fail_unless (vars_is_assignment ("A="), NULL);
+    fail_if (vars_is_assignment ("=1"), NULL);
+    fail_if (vars_is_assignment ("A-B=1"), NULL);
+    fail_if (vars_is_assignment ("A"), NULL);
+}
+END_TEST
+
+START_TEST (test_set_get)
+{
+    fail_unless (vars_get ("MYBASH_TEST") == NULL, NULL);
+    vars_set ("MYBASH_TEST", "uno");
+    fail_unless (strcmp (vars_get ("MYBASH_TEST"), "uno") == 0, NULL);
+    vars_set ("MYBASH_TEST", "dos");
+    fail_unless (strcmp (vars_get ("MYBASH_TEST"), "dos") == 0, NULL);
+    fail_unless (vars_assign ("MYBASH_TEST=tres=3", false), NULL);
+    fail_unless (strcmp (vars_get ("MYBASH_TEST"), "tres=3") == 0, NULL);
+    fail_if (vars_assign ("MYBASH TEST=4", false), NULL);
+    vars_unset ("MYBASH_TEST");
+    fail_unless (vars_get ("MYBASH_TEST") == NULL, NULL);
+    /* Borrar una que no existe no hace nada */
+    vars_unset ("MYBASH_TEST");
+}
+END_TEST
+
+START_TEST (test_many)
+{
+    /* Muchas variables, para que la tabla crezca, y borrar la mitad para que
+       se muevan las que siguen en las cadenas de sondeo */
+    char name[32], value[32];
+    size_t before = vars_count ();
+    for (unsigned int i = 0; i < 5000; i++) {
+        sprintf (name, "V%u", i);
+        sprintf (value, "%u", i * 7);
+        vars_set (name, value);
+    }
+    fail_unless (vars_count () == before + 5000, NULL);
+    for (unsigned int i = 0; i < 5000; i += 2) {
+        sprintf (name, "V%u", i);
+        vars_unset (name);
+    }
+    fail_unless (vars_count () == before + 2500, NULL);
+    for (unsigned int i = 0; i < 5000; i++) {
+        sprintf (name, "V%u", i);
+        sprintf (value, "%u", i * 7);
+        if (i % 2 == 0) {
+            fail_unless (vars_get (name) == NULL, name);
+        } else {
+            fail_unless (vars_get (name) != NULL && strcmp (vars_get (name), value) == 0, name);
+        }
+    }
+}
+END_TEST
+
+/* Entorno */
+START_TEST (test_imported)
+{
+    /* Lo que ya estaba en el entorno se importa exportado */
+    fail_unless (setenv ("MYBASH_IMPORTED", "si", 1) == 0, NULL);
+    fail_unless (strcmp (vars_get ("MYBASH_IMPORTED"), "si") == 0, NULL);
+    fail_unless (in_envp ("MYBASH_IMPORTED", "si"), NULL);
+    /* Si alguien cambia environ por otro arreglo se vuelve a importar */
+    fail_unless (setenv ("MYBASH_IMPORTED_LATER", "otra", 1) == 0, NULL);
+    fail_unless (strcmp (vars_get ("MYBASH_IMPORTED_LATER"), "otra") == 0, NULL);
+    fail_unless (in_envp ("MYBASH_IMPORTED", "si"), NULL);
+}
+END_TEST
+
+START_TEST (test_export)
+{
+    unsigned int length = envp_length ();
+    vars_set ("MYBASH_LOCAL", "local");
+    fail_if (in_envp ("MYBASH_LOCAL", "local"), NULL);
+    fail_unless (envp_length () == length, NULL);
+    vars_export ("MYBASH_LOCAL");
+    fail_unless (in_envp ("MYBASH_LOCAL", "local"), NULL);
+    fail_unless (strcmp (getenv ("MYBASH_LOCAL"), "local") == 0, NULL);
+    fail_unless (envp_length () == length + 1, NULL);
+
+    /* Exportada sin valor: no está en el entorno hasta que se le da uno */
+    vars_export ("MYBASH_LATER");
+    fail_unless (vars_get ("MYBASH_LATER") == NULL, NULL);
+    fail_unless (envp_length () == length + 1, NULL);
+    vars_set ("MYBASH_LATER", "ahora");
+    fail_unless (in_envp ("MYBASH_LATER", "ahora"), NULL);
+
+    fail_unless (vars_assign ("MYBASH_NEW=nueva", true), NULL);
+    fail_unless (in_envp ("MYBASH_NEW", "nueva"), NULL);
+    fail_unless (envp_length () == length + 3, NULL);
+
+    vars_unset ("MYBASH_LOCAL");
+    fail_if (in_envp ("MYBASH_LOCAL", "local"), NULL);
+    fail_unless (getenv ("MYBASH_LOCAL") == NULL, NULL);
+    fail_unless (in_envp ("MYBASH_LATER", "ahora"), NULL);
+    fail_unless (in_envp ("MYBASH_NEW", "nueva"), NULL);
+    fail_unless (envp_length () == length + 2, NULL);
+}
+END_TEST
+
+START_TEST (test_envp_cached)
+{
+    extern char **environ;
+    vars_assign ("MYBASH_CACHED=1", true);
+    char *const *envp = vars_envp ();
+    fail_unless (envp == environ, NULL);
+    /* Cambiar el valor de una exportada, o una que no lo está, no cambia
+       el arreglo */
+    vars_set ("MYBASH_CACHED", "2");
+    vars_set ("MYBASH_NOT_EXPORTED", "x");
+    fail_unless (vars_envp () == envp, NULL);
+    fail_unless (in_envp ("MYBASH_CACHED", "2"), NULL);
+    fail_unless (strcmp (getenv ("MYBASH_CACHED"), "2") == 0, NULL);
+}
+END_TEST
+
+/* Expansión */
+START_TEST (test_not_marked)
+{
+    /* Sin '$' (o con '$' literal) las palabras no tienen expansiones */
+    pipeline p = parse ("echo 'a b' c\\$d '$e' f$\n");
+    fail_if (scommand_has_expansions (pipeline_get_nth (p, 0)), NULL);
+    fail_unless (expand_pipeline (p) == NULL, NULL);
+    pipeline_destroy (p);
+
+    p = parse ("echo \"$A\" > $B\n");
+    fail_unless (scommand_has_expansions (pipeline_get_nth (p, 0)), NULL);
+    /* Al mostrarlo se ve lo que se escribió */
+    char *text = pipeline_to_string (p);
+    fail_unless (strcmp (text, "echo \"$A\" > $B") == 0, text);
+    free (text);
+    pipeline_destroy (p);
+}
+END_TEST
+
+START_TEST (test_expand)
+{
+    vars_set ("A", "uno");
+    vars_unset ("NADA");
+    check_expansion ("echo $A ${A}x \"$A\" '$A' \\$A $A$A\n",
+                     "echo|uno|unox|uno|$A|$A|unouno");
+    check_expansion ("echo a$NADA b \"$NADA\" $NADA c\n", "echo|a|b||c");
+    check_expansion ("echo $ a$ \"$\" $1\n", "echo|$|a$|$|$1");
+    char pid[64];
+    sprintf (pid, "echo|%ld", (long)getpid ());
+    check_expansion ("echo $$\n", pid);
+    vars_set_status (127);
+    check_expansion ("echo $? \"[$?]\" '$?'\n", "echo|127|[127]|$?");
+    vars_set_status (0);
+}
+END_TEST
+
+START_TEST (test_arithmetic)
+{
+    vars_set ("N", "4");
+    vars_unset ("IFS");
+    check_expansion ("echo $((1 + 2)) \"$((N*3))\" x$(( (N+1) * (2) ))y\n",
+                     "echo|3|12|x10y");
+    check_expansion ("echo $((N > 3 ? N : 3)) $((N<<1|1)) $(($N&&0))\n",
+                     "echo|4|9|0");
+    check_expansion ("echo $((N = N + 1)) '$((N))' \"\\$((N))\"\n",
+                     "echo|5|$((N))|$((N))");
+    check_expansion ("echo a$((1 / 0))b $((1 +))\n", "echo|ab");
+    check_expansion ("echo $((-1)) $(( ))\n", "echo|-1|0");
+}
+END_TEST
+
+/* ${...} con operadores */
+START_TEST (test_parameter_operators)
+{
+    vars_set ("F", "/usr/src/archivo.tar.gz");
+    vars_set ("V", "");
+    vars_unset ("NADA");
+    vars_unset ("IFS");
+    check_expansion ("echo ${F#*/} ${F##*/} ${F%.*} ${F%%.*} ${F#x}\n",
+                     "echo|usr/src/archivo.tar.gz|archivo.tar.gz|/usr/src/archivo.tar|/usr/src/archivo|/usr/src/archivo.tar.gz");
+    check_expansion ("echo ${#F} ${#NADA} ${#V}\n", "echo|23|0|0");
+    check_expansion ("echo ${F:5} ${F:5:3} ${F:(-6)} ${F:1:-3} x${F:100}\n",
+                     "echo|src/archivo.tar.gz|src|tar.gz|usr/src/archivo.tar|x");
+    check_expansion ("echo ${NADA:-a} ${NADA-b} ${V:-c} x${V-d} x${V:+e} ${F:+f}\n",
+                     "echo|a|b|c|x|x|f");
+    check_expansion ("echo ${F/a/A} ${F//a/A} ${F/#\\/usr/X} ${F/%gz/bz2}\n",
+                     "echo|/usr/src/Archivo.tar.gz|/usr/src/Archivo.tAr.gz|X/src/archivo.tar.gz|/usr/src/archivo.tar.bz2");
+    check_expansion ("echo ${F//[aeiou]/} ${F/tar/\"*\"} ${F/nada/x} ${F/#/>}\n",
+                     "echo|/sr/src/rchv.tr.gz|/usr/src/archivo.*.gz|/usr/src/archivo.tar.gz|>/usr/src/archivo.tar.gz");
+    /* Lo citado del patrón es literal; el patrón se expande */
+    vars_set ("E", ".*");
+    check_expansion ("echo ${F%$E} ${F%\"$E\"} \"${NADA:-a b}\" ${NADA:-a b}\n",
+                     "echo|/usr/src/archivo.tar|/usr/src/archivo.tar.gz|a b|a|b");
+    check_expansion ("echo \"${F/archivo/\"un } archivo\"}\"\n",
+                     "echo|/usr/src/un } archivo.tar.gz");
+    /* := asigna */
+    check_expansion ("echo ${V:=nueva} ${NADA=otra}\n", "echo|nueva|otra");
+    fail_unless (strcmp (vars_get ("V"), "nueva") == 0, NULL);
+    fail_unless (strcmp (vars_get ("NADA"), "otra") == 0, NULL);
+    vars_unset ("NADA");
+    /* Errores: se imprimen y no queda nada */
+    check_expansion ("echo ${NADA:?falta} ${F:3:-30} ${F@} ${#F:1} ${?=x} z\n",
+                     "echo|0|z");
+    vars_set_status (2);
+    check_expansion ("echo ${?:-x} ${#?}\n", "echo|2|1");
+    vars_set_status (0);
+}
+END_TEST
+
+START_TEST (test_split)
+{
+    vars_set ("L", "  uno  dos\ttres ");
+    vars_unset ("IFS");
+    check_expansion ("echo [$L]\n", "echo|[|uno|dos|tres|]");
+    check_expansion ("echo \"[$L]\"\n", "echo|[  uno  dos\ttres ]");
+    vars_set ("IFS", ":");
+    vars_set ("P", "/bin:/usr/bin");
+    check_expansion ("echo $P\n", "echo|/bin|/usr/bin");
+    vars_set ("IFS", "");
+    check_expansion ("echo $P\n", "echo|/bin:/usr/bin");
+}
+END_TEST
+
+START_TEST (test_assignments_not_split)
+{
+    vars_set ("L", "a b");
+    vars_unset ("IFS");
+    pipeline p = parse ("X=$L Y=\"$L\" cmd $L > $L\n");
+    pipeline expanded = expand_pipeline (p);
+    scommand cmd = pipeline_get_nth (expanded, 0);
+    fail_unless (scommand_length (cmd) == 5, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 0), "X=a b") == 0, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 1), "Y=a b") == 0, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 2), "cmd") == 0, NULL);
+    fail_unless (strcmp (scommand_get_redir_out (cmd), "a b") == 0, NULL);
+    fail_unless (pipeline_get_wait (expanded), NULL);
+    pipeline_destroy (expanded);
+    pipeline_destroy (p);
+}
+END_TEST
+
+/* Las palabras de un for se separan como las de un comando, la de un case
+ * no; las listas no se expanden hasta ejecutarlas
+ */
+START_TEST (test_compounds)
+{
+    vars_set ("L", "a b");
+    vars_unset ("IFS");
+    pipeline p = parse ("for x in $L \"$L\"; do echo $x; done\n");
+    pipeline expanded = expand_pipeline (p);
+    scommand cmd = pipeline_get_nth (expanded, 0);
+    fail_unless (scommand_get_kind (cmd) == SCOMMAND_FOR, NULL);
+    fail_unless (scommand_length (cmd) == 4, NULL);
+    fail_unless (strcmp (scommand_get_nth (cmd, 3), "a b") == 0, NULL);
+    fail_unless (scommand_has_expansions (pipeline_front (scommand_get_body (cmd))), NULL);
+    pipeline_destroy (expanded);
+    pipeline_destroy (p);
+
+    p = parse ("case $L in a) ;; esac\n");
+    expanded = expand_pipeline (p);
+    cmd = pipeline_get_nth (expanded, 0);
+    fail_unless (scommand_length (cmd) == 1, NULL);
+    fail_unless (strcmp (scommand_front (cmd), "a b") == 0, NULL);
+    fail_unless (scommand_list_count (cmd) == 2, NULL);
+    pipeline_destroy (expanded);
+    pipeline_destroy (p);
+}
+END_TEST
+
+/* En los patrones de un case lo citado queda escapado */
+START_TEST (test_patterns)
+{
+    vars_set ("S", "*.[ch]");
+    const char *cases[][2] = {{"a*", "a\\*"},
+                              {"\001*.c", "*.c"},
+                              {"\001'*'$S\"$S\"", "\\**.[ch]\\*.\\[ch\\]"},
+                              {"\001\\?x", "\\?x"}};
+
+    for (unsigned int i = 0; i < sizeof (cases) / sizeof (cases[0]); i++) {
+        char *pattern = expand_pattern (cases[i][0]);
+        fail_unless (strcmp (pattern, cases[i][1]) == 0, pattern);
+        free (pattern);
+    }
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *vars_suite (void)
+{
+    Suite *s = suite_create ("vars");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+    TCase *tc_environment = tcase_create ("Environment");
+    TCase *tc_expansion = tcase_create ("Expansion");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_get_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_set_invalid, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_export_invalid, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_expand_null, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_test (tc_functionality, test_names);
+    tcase_add_test (tc_functionality, test_set_get);
+    tcase_add_test (tc_functionality, test_many);
+    suite_add_tcase (s, tc_functionality);
+
+    /* Entorno */
+    tcase_add_test (tc_environment, test_imported);
+    tcase_add_test (tc_environment, test_export);
+    tcase_add_test (tc_environment, test_envp_cached);
+    suite_add_tcase (s, tc_environment);
+
+    /* Expansión */
+    tcase_add_test (tc_expansion, test_not_marked);
+    tcase_add_test (tc_expansion, test_expand);
+    tcase_add_test (tc_expansion, test_arithmetic);
+    tcase_add_test (tc_expansion, test_parameter_operators);
+    tcase_add_test (tc_expansion, test_split);
+    tcase_add_test (tc_expansion, test_assignments_not_split);
+    tcase_add_test (tc_expansion, test_compounds);
+    tcase_add_test (tc_expansion, test_patterns);
+    suite_add_tcase (s, tc_expansion);
+
+    return s;
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_VARS_H
+#define TEST_VARS_H
+
+#include <check.h>
+
+Suite *vars_suite (void);
+
+#endif
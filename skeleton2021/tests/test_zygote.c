@@ -0,0 +1,223 @@
+#include <check.h>
+#include "test_zygote.h"
+
+#include <signal.h>
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "zygote.h"
+
+/* Archivo donde escriben los comandos de las pruebas */
+static char output[] = "/tmp/mybash-zygote-XXXXXX";
+static int output_fd = -1;
+
+static void setup (void) {
+    output_fd = mkstemp (strcpy (output, "/tmp/mybash-zygote-XXXXXX"));
+    fail_unless (output_fd != -1, NULL);
+    fail_unless (zygote_start (), NULL);
+}
+
+static void teardown (void) {
+    zygote_stop ();
+    close (output_fd);
+    unlink (output);
+}
+
+/* Lanza argv con la salida en output y espera a que termine.
+ * Returns: el estado de wait
+ */
+static int spawn_and_wait (const char *path, char *const *argv,
+                           char *const *envp) {
+    int fds[3] = {STDIN_FILENO, output_fd, STDERR_FILENO};
+    int wstatus = -1;
+    pid_t pid = zygote_spawn (path, argv, envp, fds);
+    fail_unless (pid > 0, NULL);
+    /* Es hijo de este proceso, no del zygote */
+    fail_unless (waitpid (pid, &wstatus, 0) == pid, NULL);
+    return wstatus;
+}
+
+/* Lee lo que escribieron los comandos en output */
+static void read_output (char *buffer, size_t size) {
+    ssize_t n = pread (output_fd, buffer, size - 1, 0);
+    fail_unless (n >= 0, NULL);
+    buffer[n] = '\0';
+}
+
+/* Precondiciones */
+START_TEST (test_spawn_null)
+{
+    char *envp[] = {NULL};
+    int fds[3] = {0, 1, 2};
+    zygote_spawn (NULL, NULL, envp, fds);
+}
+END_TEST
+
+START_TEST (test_spawn_empty)
+{
+    char *argv[] = {NULL};
+    char *envp[] = {NULL};
+    int fds[3] = {0, 1, 2};
+    zygote_spawn (NULL, argv, envp, fds);
+}
+END_TEST
+
+/* Sin zygote */
+START_TEST (test_not_started)
+{
+    char *argv[] = {"true", NULL};
+    char *envp[] = {NULL};
+    int fds[3] = {0, 1, 2};
+    fail_if (zygote_available (), NULL);
+    fail_unless (zygote_spawn (NULL, argv, envp, fds) == -1, NULL);
+}
+END_TEST
+
+START_TEST (test_stopped)
+{
+    char *argv[] = {"true", NULL};
+    char *envp[] = {NULL};
+    int fds[3] = {0, 1, 2};
+    fail_unless (zygote_start (), NULL);
+    fail_unless (zygote_available (), NULL);
+    zygote_stop ();
+    fail_if (zygote_available (), NULL);
+    fail_unless (zygote_spawn (NULL, argv, envp, fds) == -1, NULL);
+    /* Parar dos veces no hace nada */
+    zygote_stop ();
+}
+END_TEST
+
+/* Ejecución */
+START_TEST (test_output)
+{
+    char buffer[256];
+    char *argv[] = {"sh", "-c", "echo hola $0", "mundo", NULL};
+    char *envp[] = {"PATH=/bin:/usr/bin", NULL};
+    int wstatus = spawn_and_wait ("/bin/sh", argv, envp);
+    fail_unless (WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 0, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strcmp (buffer, "hola mundo\n") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_search_path)
+{
+    char buffer[256];
+    char *argv[] = {"sh", "-c", "echo $A$B; exit 3", NULL};
+    char *envp[] = {"PATH=/usr/bin:/bin", "A=uno", "B=dos", NULL};
+    int wstatus = spawn_and_wait (NULL, argv, envp);
+    fail_unless (WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 3, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strcmp (buffer, "unodos\n") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_directory)
+{
+    char buffer[256];
+    char previous[4096];
+    char *argv[] = {"sh", "-c", "pwd", NULL};
+    char *envp[] = {"PATH=/usr/bin:/bin", NULL};
+    fail_unless (getcwd (previous, sizeof (previous)) != NULL, NULL);
+    /* El comando corre en el directorio de este proceso, no del zygote */
+    fail_unless (chdir ("/") == 0, NULL);
+    int wstatus = spawn_and_wait (NULL, argv, envp);
+    fail_unless (chdir (previous) == 0, NULL);
+    fail_unless (WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 0, NULL);
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strcmp (buffer, "/\n") == 0, NULL);
+}
+END_TEST
+
+START_TEST (test_not_found)
+{
+    char *argv[] = {"mybash-no-existe", NULL};
+    char *envp[] = {"PATH=/usr/bin:/bin", NULL};
+    int null = open ("/dev/null", O_WRONLY);
+    int fds[3] = {STDIN_FILENO, output_fd, null};
+    int wstatus = -1;
+    pid_t pid = zygote_spawn (NULL, argv, envp, fds);
+    close (null);
+    fail_unless (pid > 0, NULL);
+    fail_unless (waitpid (pid, &wstatus, 0) == pid, NULL);
+    fail_unless (WIFEXITED (wstatus), NULL);
+    fail_unless (WEXITSTATUS (wstatus) == 127, NULL);
+}
+END_TEST
+
+/* Un archivo sin permiso de ejecución se encuentra, pero no se ejecuta */
+START_TEST (test_not_executable)
+{
+    char *argv[] = {output, NULL};
+    char *envp[] = {NULL};
+    int null = open ("/dev/null", O_WRONLY);
+    int fds[3] = {STDIN_FILENO, output_fd, null};
+    int wstatus = -1;
+    pid_t pid = zygote_spawn (output, argv, envp, fds);
+    close (null);
+    fail_unless (pid > 0, NULL);
+    fail_unless (waitpid (pid, &wstatus, 0) == pid, NULL);
+    fail_unless (WIFEXITED (wstatus), NULL);
+    fail_unless (WEXITSTATUS (wstatus) == 126, NULL);
+}
+END_TEST
+
+START_TEST (test_many)
+{
+    char buffer[256];
+    char *argv[] = {"sh", "-c", "echo x", NULL};
+    char *envp[] = {"PATH=/usr/bin:/bin", NULL};
+    int fds[3] = {STDIN_FILENO, output_fd, STDERR_FILENO};
+    pid_t pids[20];
+    /* Varios a la vez, y se esperan después */
+    for (unsigned int i = 0; i < 20; i++) {
+        pids[i] = zygote_spawn ("/bin/sh", argv, envp, fds);
+        fail_unless (pids[i] > 0, NULL);
+    }
+    for (unsigned int i = 0; i < 20; i++) {
+        int wstatus = -1;
+        fail_unless (waitpid (pids[i], &wstatus, 0) == pids[i], NULL);
+        fail_unless (WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 0, NULL);
+    }
+    read_output (buffer, sizeof (buffer));
+    fail_unless (strlen (buffer) == 40, NULL);
+}
+END_TEST
+
+/* Armado de la test suite */
+
+Suite *zygote_suite (void)
+{
+    Suite *s = suite_create ("zygote");
+    TCase *tc_preconditions = tcase_create ("Precondition");
+    TCase *tc_functionality = tcase_create ("Functionality");
+    TCase *tc_execution = tcase_create ("Execution");
+
+    /* Precondiciones */
+    tcase_add_test_raise_signal (tc_preconditions, test_spawn_null, SIGABRT);
+    tcase_add_test_raise_signal (tc_preconditions, test_spawn_empty, SIGABRT);
+    suite_add_tcase (s, tc_preconditions);
+
+    /* Funcionalidad */
+    tcase_add_test (tc_functionality, test_not_started);
+    tcase_add_test (tc_functionality, test_stopped);
+    suite_add_tcase (s, tc_functionality);
+
+    /* Ejecución */
+    tcase_add_checked_fixture (tc_execution, setup, teardown);
+    tcase_add_test (tc_execution, test_output);
+    tcase_add_test (tc_execution, test_search_path);
+    tcase_add_test (tc_execution, test_directory);
+    tcase_add_test (tc_execution, test_not_found);
+    tcase_add_test (tc_execution, test_not_executable);
+    tcase_add_test (tc_execution, test_many);
+    suite_add_tcase (s, tc_execution);
+
+    return s;
+}
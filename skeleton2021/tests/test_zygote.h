@@ -0,0 +1,8 @@
+#ifndef TEST_ZYGOTE_H
+#define TEST_ZYGOTE_H
+
+#include <check.h>
+
+Suite *zygote_suite (void);
+
+#endif
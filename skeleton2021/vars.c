@@ -0,0 +1,359 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vars.h"
+
+extern char** environ;
+
+/* Capacidad inicial de la tabla (siempre es una potencia de 2) */
+#define INITIAL_CAPACITY 64u
+
+/* Una variable. text es "NOMBRE=valor", o solo "NOMBRE" si se exportó sin
+ * valor; NULL indica un lugar libre de la tabla.
+ */
+struct entry {
+    char* text;
+    uint32_t name_length;
+    uint32_t hash;
+    bool exported;
+    size_t envp_index; // posición en envp, si está exportada y tiene valor
+};
+
+static struct {
+    struct entry* table;
+    size_t capacity;
+    size_t count;
+    char** envp; // terminado en NULL, environ apunta acá
+    size_t envp_count;
+    size_t envp_capacity;
+    int status; // $?
+} store = {NULL, 0u, 0u, NULL, 0u, 0u, 0};
+
+static void* checked_realloc(void* ptr, size_t size) {
+    void* result = realloc(ptr, size);
+    if (result == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/* FNV-1a */
+static uint32_t name_hash(const char* name, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0u; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static bool has_value(const struct entry* e) {
+    return e->text[e->name_length] == '=';
+}
+
+size_t vars_name_length(const char* s) {
+    assert(s != NULL);
+
+    size_t length = 0u;
+    if (s[0] == '_' || (s[0] >= 'a' && s[0] <= 'z') ||
+        (s[0] >= 'A' && s[0] <= 'Z')) {
+        length = 1u;
+        while (s[length] == '_' || (s[length] >= 'a' && s[length] <= 'z') ||
+               (s[length] >= 'A' && s[length] <= 'Z') ||
+               (s[length] >= '0' && s[length] <= '9')) {
+            length++;
+        }
+    }
+    return length;
+}
+
+bool vars_is_assignment(const char* word) {
+    assert(word != NULL);
+
+    size_t length = vars_name_length(word);
+    return length > 0u && word[length] == '=';
+}
+
+/********** Entorno **********/
+
+/* environ tiene que apuntar siempre a envp, que puede cambiar de lugar */
+static void envp_add(struct entry* e) {
+    if (store.envp_count + 1u >= store.envp_capacity) {
+        store.envp_capacity =
+            store.envp_capacity > 0u ? 2u * store.envp_capacity : 64u;
+        store.envp =
+            checked_realloc(store.envp, store.envp_capacity * sizeof(char*));
+    }
+    e->envp_index = store.envp_count;
+    store.envp[store.envp_count] = e->text;
+    store.envp_count++;
+    store.envp[store.envp_count] = NULL;
+    environ = store.envp;
+}
+
+/********** Tabla **********/
+
+/* Busca el lugar de la variable, o el lugar libre donde iría */
+static size_t find_slot(const char* name, size_t length, uint32_t hash) {
+    size_t mask = store.capacity - 1u;
+    size_t i = hash & mask;
+    while (store.table[i].text != NULL &&
+           (store.table[i].hash != hash ||
+            store.table[i].name_length != length ||
+            memcmp(store.table[i].text, name, length) != 0)) {
+        i = (i + 1u) & mask;
+    }
+    return i;
+}
+
+static void table_grow(void) {
+    struct entry* old = store.table;
+    size_t old_capacity = store.capacity;
+    store.capacity = old_capacity > 0u ? 2u * old_capacity : INITIAL_CAPACITY;
+    store.table = calloc(store.capacity, sizeof(struct entry));
+    if (store.table == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0u; i < old_capacity; i++) {
+        if (old[i].text != NULL) {
+            size_t mask = store.capacity - 1u;
+            size_t j = old[i].hash & mask;
+            while (store.table[j].text != NULL) {
+                j = (j + 1u) & mask;
+            }
+            store.table[j] = old[i];
+        }
+    }
+    free(old);
+}
+
+static void import_environ(void);
+
+/* Deja la tabla lista para usar. La primera vez importa environ, y lo vuelve
+ * a importar si alguien lo cambió por otro arreglo.
+ */
+static void ensure_ready(void) {
+    if (store.table == NULL) {
+        table_grow();
+        import_environ();
+    } else if (environ != store.envp) {
+        import_environ();
+    }
+}
+
+/* Busca una variable.
+ * Returns: la entrada, o NULL si no existe
+ */
+static struct entry* lookup(const char* name, size_t length) {
+    ensure_ready();
+    uint32_t hash = name_hash(name, length);
+    struct entry* e = &store.table[find_slot(name, length, hash)];
+    return e->text != NULL ? e : NULL;
+}
+
+/* Cambia el texto de la variable name (que tiene length bytes), creándola si
+ * no existe. text es memoria nueva que pasa a ser de la tabla.
+ */
+static struct entry* store_text(const char* name, size_t length, char* text) {
+    if ((store.count + 1u) * 2u > store.capacity) {
+        table_grow();
+    }
+    uint32_t hash = name_hash(name, length);
+    struct entry* e = &store.table[find_slot(name, length, hash)];
+    if (e->text == NULL) {
+        *e = (struct entry){text, (uint32_t)length, hash, false, 0u};
+        store.count++;
+        return e;
+    }
+
+    bool was_in_envp = e->exported && has_value(e);
+    free(e->text);
+    e->text = text;
+    if (was_in_envp) {
+        store.envp[e->envp_index] = text;
+    } else if (e->exported && has_value(e)) {
+        envp_add(e);
+    }
+    return e;
+}
+
+/* Saca la variable del lugar i, corriendo hacia atrás las que siguen en la
+ * misma cadena de sondeo para que no queden huecos.
+ */
+static void remove_slot(size_t i) {
+    struct entry* e = &store.table[i];
+    if (e->exported && has_value(e)) {
+        // El último del entorno pasa al lugar que queda libre
+        store.envp_count--;
+        char* last = store.envp[store.envp_count];
+        store.envp[e->envp_index] = last;
+        store.envp[store.envp_count] = NULL;
+        if (last != e->text) {
+            size_t length = strcspn(last, "=");
+            uint32_t hash = name_hash(last, length);
+            store.table[find_slot(last, length, hash)].envp_index =
+                e->envp_index;
+        }
+    }
+    free(e->text);
+    e->text = NULL;
+    store.count--;
+
+    size_t mask = store.capacity - 1u;
+    size_t hole = i;
+    size_t j = (i + 1u) & mask;
+    while (store.table[j].text != NULL) {
+        size_t home = store.table[j].hash & mask;
+        // Se mueve si su lugar ideal no está entre el hueco y j
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            store.table[hole] = store.table[j];
+            store.table[j].text = NULL;
+            hole = j;
+        }
+        j = (j + 1u) & mask;
+    }
+}
+
+static char* make_text(const char* name, size_t length, const char* value) {
+    size_t value_length = value != NULL ? strlen(value) : 0u;
+    char* text = checked_realloc(NULL, length + 1u + value_length + 1u);
+    memcpy(text, name, length);
+    if (value != NULL) {
+        text[length] = '=';
+        memcpy(text + length + 1u, value, value_length + 1u);
+    } else {
+        text[length] = '\0';
+    }
+    return text;
+}
+
+static void import_environ(void) {
+    /* Primero se copian las del entorno: si environ lo armó setenv a partir
+       de envp, sus cadenas son las de la tabla, que se van a liberar */
+    size_t count = 0u;
+    for (char** var = environ; var != NULL && *var != NULL; var++) {
+        count++;
+    }
+    char** texts = checked_realloc(NULL, (count + 1u) * sizeof(char*));
+    size_t valid = 0u;
+    for (size_t i = 0u; i < count; i++) {
+        size_t length = vars_name_length(environ[i]);
+        if (length > 0u && environ[i][length] == '=') {
+            texts[valid] = make_text(environ[i], length, environ[i] + length + 1u);
+            valid++;
+        }
+    }
+
+    // Las exportadas se reemplazan por las del entorno
+    for (size_t i = 0u; i < store.capacity;) {
+        if (store.table[i].text != NULL && store.table[i].exported) {
+            // remove_slot puede traer otra entrada a este mismo lugar
+            remove_slot(i);
+        } else {
+            i++;
+        }
+    }
+    store.envp_count = 0u;
+    if (store.envp == NULL) {
+        store.envp_capacity = 64u;
+        store.envp = checked_realloc(NULL, store.envp_capacity * sizeof(char*));
+    }
+    store.envp[0] = NULL;
+    environ = store.envp;
+
+    for (size_t i = 0u; i < valid; i++) {
+        size_t length = vars_name_length(texts[i]);
+        struct entry* e = store_text(texts[i], length, texts[i]);
+        if (!e->exported) {
+            e->exported = true;
+            envp_add(e);
+        }
+    }
+    free(texts);
+}
+
+/********** Interfaz **********/
+
+const char* vars_get(const char* name) {
+    assert(name != NULL);
+
+    struct entry* e = lookup(name, strlen(name));
+    return e != NULL && has_value(e) ? e->text + e->name_length + 1u : NULL;
+}
+
+void vars_set(const char* name, const char* value) {
+    assert(name != NULL && value != NULL);
+    size_t length = strlen(name);
+    assert(length > 0u && vars_name_length(name) == length);
+
+    ensure_ready();
+    store_text(name, length, make_text(name, length, value));
+}
+
+bool vars_assign(const char* word, bool export) {
+    assert(word != NULL);
+
+    size_t length = vars_name_length(word);
+    if (length == 0u || word[length] != '=') {
+        return false;
+    }
+    ensure_ready();
+    struct entry* e =
+        store_text(word, length, make_text(word, length, word + length + 1u));
+    if (export && !e->exported) {
+        e->exported = true;
+        envp_add(e);
+    }
+    return true;
+}
+
+void vars_export(const char* name) {
+    assert(name != NULL);
+    size_t length = strlen(name);
+    assert(length > 0u && vars_name_length(name) == length);
+
+    struct entry* e = lookup(name, length);
+    if (e == NULL) {
+        e = store_text(name, length, make_text(name, length, NULL));
+    }
+    if (!e->exported) {
+        e->exported = true;
+        if (has_value(e)) {
+            envp_add(e);
+        }
+    }
+}
+
+void vars_unset(const char* name) {
+    assert(name != NULL);
+
+    size_t length = strlen(name);
+    ensure_ready();
+    uint32_t hash = name_hash(name, length);
+    size_t i = find_slot(name, length, hash);
+    if (store.table[i].text != NULL) {
+        remove_slot(i);
+    }
+}
+
+char* const* vars_envp(void) {
+    ensure_ready();
+    return store.envp;
+}
+
+size_t vars_count(void) {
+    ensure_ready();
+    return store.count;
+}
+
+void vars_set_status(int status) {
+    store.status = status;
+}
+
+int vars_status(void) {
+    return store.status;
+}
@@ -0,0 +1,99 @@
+/* Variables del shell y entorno de los comandos.
+ *
+ * Las variables se guardan en una tabla hash con direccionamiento abierto
+ * (sondeo lineal). Cada variable se guarda como una sola cadena
+ * "NOMBRE=valor", así el entorno de los comandos es directamente un arreglo
+ * de punteros a las cadenas de las variables exportadas.
+ *
+ * Ese arreglo (envp) se mantiene armado todo el tiempo y `environ' apunta a
+ * él: cambiar una variable exportada cambia un solo lugar del arreglo, y
+ * cada exec usa el mismo envp sin volver a armarlo. Los comandos externos
+ * heredan el entorno con execvp como siempre, y getenv ve las variables
+ * exportadas.
+ *
+ * La primera vez que se usa el módulo se importan las variables de
+ * `environ', todas exportadas. Si después alguien cambia `environ' por otro
+ * arreglo (setenv de una variable nueva), las exportadas se vuelven a
+ * importar; pero setenv de una variable que ya estaba y unsetenv modifican
+ * el arreglo sin que el módulo se entere, así que no hay que usarlos.
+ *
+ * Los nombres válidos son [A-Za-z_][A-Za-z0-9_]*.
+ */
+
+#ifndef _VARS_H_
+#define _VARS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Largo del nombre de variable válido más largo al comienzo de `s'.
+ * Returns: 0 si s no empieza con un nombre válido
+ * Requires: s != NULL
+ */
+size_t vars_name_length(const char* s);
+
+/*
+ * Indica si `word' es una asignación, NOMBRE=valor.
+ * Requires: word != NULL
+ */
+bool vars_is_assignment(const char* word);
+
+/*
+ * Valor de la variable `name'.
+ * Returns: el valor, o NULL si la variable no tiene valor. La cadena es del
+ *     módulo y deja de ser válida cuando se cambia la variable
+ * Requires: name != NULL
+ */
+const char* vars_get(const char* name);
+
+/*
+ * Le da a la variable `name' el valor `value' (se copia). Si la variable
+ * estaba exportada sigue estándolo.
+ * Requires: vars_name_length(name) == strlen(name) > 0 && value != NULL
+ */
+void vars_set(const char* name, const char* value);
+
+/*
+ * Hace la asignación `word' (NOMBRE=valor). Con export, además exporta la
+ * variable.
+ * Returns: false si word no es una asignación (y no se cambia nada)
+ * Requires: word != NULL
+ */
+bool vars_assign(const char* word, bool export);
+
+/*
+ * Exporta la variable `name'. Si todavía no tiene valor no aparece en el
+ * entorno hasta que se le dé uno.
+ * Requires: vars_name_length(name) == strlen(name) > 0
+ */
+void vars_export(const char* name);
+
+/*
+ * Borra la variable `name', si existe.
+ * Requires: name != NULL
+ */
+void vars_unset(const char* name);
+
+/*
+ * Entorno para los comandos: las variables exportadas con valor, como
+ * "NOMBRE=valor", terminado en NULL. Es el mismo arreglo que `environ'.
+ * Returns: el arreglo, que es del módulo. Sigue siendo el mismo puntero
+ *     mientras no se agreguen variables exportadas y cada cadena sigue
+ *     siendo válida mientras no se cambie esa variable
+ * Ensures: result != NULL
+ */
+char* const* vars_envp(void);
+
+/*
+ * Cantidad de variables (exportadas o no).
+ */
+size_t vars_count(void);
+
+/*
+ * Estado del último pipeline ejecutado, el valor de $? (al comienzo 0).
+ */
+void vars_set_status(int status);
+int vars_status(void);
+
+#endif
@@ -0,0 +1,341 @@
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h> // CLONE_PARENT
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "argbatch.h"
+#include "zygote.h"
+
+/* Los file descriptors de cada pedido: entrada, salida, error y directorio */
+#define REQUEST_FDS 4u
+
+/* Cabecera de un pedido. Después vienen `length' bytes de cadenas
+ * terminadas en '\0': la ruta (si no se busca en el PATH), los argc
+ * argumentos y las envc variables.
+ */
+struct request {
+    uint32_t length;
+    uint32_t argc;
+    uint32_t envc;
+    uint32_t search; // 1 si hay que buscar argv[0] en el PATH
+};
+
+/* Respuesta: el pid, o -1 y el errno del clone */
+struct reply {
+    int32_t pid;
+    int32_t error;
+};
+
+static struct {
+    int socket;  // el extremo del shell, o -1
+    pid_t pid;   // el zygote
+    pid_t owner; // el proceso que lo creó
+} state = {-1, -1, -1};
+
+/* Lee exactamente length bytes.
+ * Returns: false si se terminó el archivo o hubo un error
+ */
+static bool read_full(int fd, void* buffer, size_t length) {
+    size_t done = 0u;
+    while (done < length) {
+        ssize_t n = read(fd, (char*)buffer + done, length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+static bool write_full(int fd, const void* buffer, size_t length) {
+    size_t done = 0u;
+    while (done < length) {
+        ssize_t n = send(fd, (const char*)buffer + done, length - done,
+                         MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += (size_t)n;
+    }
+    return true;
+}
+
+/********** El zygote **********/
+
+/* Ejecuta el comando pedido. Es el proceso nuevo, así que no retorna. */
+static void run_command(const struct request* req, char* path, char** argv,
+                        char** envp, const int* fds, int sock) {
+    for (int i = 0; i < 3; i++) {
+        if (dup2(fds[i], i) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+    }
+    if (fchdir(fds[3]) == -1) {
+        perror("mybash: cd");
+        _exit(EXIT_FAILURE);
+    }
+    for (unsigned int i = 0u; i < REQUEST_FDS; i++) {
+        close(fds[i]);
+    }
+    close(sock);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+
+    // execvp busca en el PATH de environ, que ahora es el del pedido
+    environ = envp;
+    if (req->search == 0u) {
+        execv(path, argv);
+    }
+    execvp(argv[0], argv);
+    int error = errno;
+    perror(argv[0]);
+    if (error == E2BIG) {
+        fprintf(stderr, ARGBATCH_HINT, argv[0]);
+    }
+    _exit(ARGBATCH_EXEC_STATUS(error));
+}
+
+/* Recibe un pedido y lanza el comando.
+ * Returns: false si el shell cerró el socket
+ */
+static bool serve_request(int sock) {
+    struct request req;
+    int fds[REQUEST_FDS];
+    union {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = {&req, sizeof(req)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1u;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    ssize_t n = 0;
+    do {
+        n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    struct cmsghdr* cmsg = n > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+    char* strings = NULL;
+    char** pointers = NULL;
+    bool ok = read_full(sock, (char*)&req + n, sizeof(req) - (size_t)n);
+    if (ok) {
+        strings = malloc(req.length + 1u);
+        pointers = malloc((req.argc + req.envc + 2u) * sizeof(char*));
+        ok = strings != NULL && pointers != NULL &&
+             read_full(sock, strings, req.length);
+    }
+
+    struct reply reply = {-1, EINVAL};
+    if (ok) {
+        // Las cadenas, una atrás de la otra
+        strings[req.length] = '\0';
+        char* next = strings;
+        char* end = strings + req.length;
+        char* path = NULL;
+        if (req.search == 0u) {
+            path = next;
+            next += strlen(next) + 1u;
+        }
+        uint32_t total = req.argc + req.envc;
+        for (uint32_t i = 0u; i < total && next < end; i++) {
+            // argv y envp, cada uno terminado en NULL
+            pointers[i < req.argc ? i : i + 1u] = next;
+            next += strlen(next) + 1u;
+        }
+        pointers[req.argc] = NULL;
+        pointers[total + 1u] = NULL;
+
+        pid_t pid = (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, NULL,
+                                   NULL, NULL, NULL);
+        if (pid == 0) {
+            run_command(&req, path, pointers, pointers + req.argc + 1u, fds,
+                        sock);
+        }
+        reply = (struct reply){pid, pid < 0 ? errno : 0};
+    }
+    for (unsigned int i = 0u; i < REQUEST_FDS; i++) {
+        close(fds[i]);
+    }
+    free(strings);
+    free(pointers);
+    return ok && write_full(sock, &reply, sizeof(reply));
+}
+
+/* El proceso zygote: atiende pedidos hasta que el shell cierra el socket */
+static void serve(int sock) {
+    /* Ctrl-C en la terminal le llega a todo el grupo; el zygote sigue (los
+       comandos vuelven a lo normal antes del exec) */
+    signal(SIGINT, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+    // No se queda con la terminal ni con los pipes del shell
+    int null = open("/dev/null", O_RDWR);
+    for (int i = 0; i < 3 && null != -1; i++) {
+        dup2(null, i);
+    }
+    if (null > 2) {
+        close(null);
+    }
+    while (serve_request(sock)) {
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+/********** El shell **********/
+
+bool zygote_start(void) {
+    int sockets[2];
+    if (state.socket != -1 ||
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1) {
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sockets[0]);
+        close(sockets[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(sockets[0]);
+        serve(sockets[1]);
+    }
+    close(sockets[1]);
+    state.socket = sockets[0];
+    state.pid = pid;
+    state.owner = getpid();
+    return true;
+}
+
+void zygote_stop(void) {
+    if (state.socket == -1) {
+        return;
+    }
+    close(state.socket);
+    if (state.owner == getpid()) {
+        waitpid(state.pid, NULL, 0);
+    }
+    state.socket = -1;
+    state.pid = -1;
+}
+
+bool zygote_available(void) {
+    return state.socket != -1 && state.owner == getpid();
+}
+
+/* Deja de usar el zygote (se cayó o no responde) */
+static void give_up(void) {
+    close(state.socket);
+    state.socket = -1;
+    waitpid(state.pid, NULL, WNOHANG);
+}
+
+/* Copia las count cadenas de list al final de buffer */
+static char* pack(char* buffer, char* const* list, size_t count) {
+    for (size_t i = 0u; i < count; i++) {
+        size_t length = strlen(list[i]) + 1u;
+        memcpy(buffer, list[i], length);
+        buffer += length;
+    }
+    return buffer;
+}
+
+static size_t count_strings(char* const* list, size_t* bytes) {
+    size_t count = 0u;
+    while (list[count] != NULL) {
+        *bytes += strlen(list[count]) + 1u;
+        count++;
+    }
+    return count;
+}
+
+pid_t zygote_spawn(const char* path, char* const argv[], char* const envp[],
+                   const int fds[3]) {
+    assert(argv != NULL && argv[0] != NULL && envp != NULL && fds != NULL);
+
+    if (!zygote_available()) {
+        return -1;
+    }
+    int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (cwd == -1) {
+        return -1;
+    }
+
+    size_t length = path != NULL ? strlen(path) + 1u : 0u;
+    size_t argc = count_strings(argv, &length);
+    size_t envc = count_strings(envp, &length);
+    char* strings = malloc(length);
+    if (strings == NULL) {
+        perror("Error fatal: malloc");
+        exit(EXIT_FAILURE);
+    }
+    char* next = strings;
+    if (path != NULL) {
+        memcpy(next, path, strlen(path) + 1u);
+        next += strlen(path) + 1u;
+    }
+    next = pack(pack(next, argv, argc), envp, envc);
+
+    struct request req = {(uint32_t)length, (uint32_t)argc, (uint32_t)envc,
+                          path == NULL ? 1u : 0u};
+    int sent[REQUEST_FDS] = {fds[0], fds[1], fds[2], cwd};
+    union {
+        char buffer[CMSG_SPACE(sizeof(sent))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {&req, sizeof(req)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1u;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(sent));
+    memcpy(CMSG_DATA(cmsg), sent, sizeof(sent));
+
+    ssize_t n = 0;
+    do {
+        n = sendmsg(state.socket, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    struct reply reply = {-1, 0};
+    bool ok = n > 0 &&
+              write_full(state.socket, (char*)&req + n,
+                         sizeof(req) - (size_t)n) &&
+              write_full(state.socket, strings, length) &&
+              read_full(state.socket, &reply, sizeof(reply));
+    free(strings);
+    close(cwd);
+    if (!ok) {
+        give_up();
+        return -1;
+    }
+    if (reply.pid < 0) {
+        errno = reply.error;
+    }
+    return reply.pid;
+}
@@ -0,0 +1,61 @@
+/* Servidor de fork (zygote) para lanzar los comandos externos.
+ *
+ * Al arrancar, mybash crea un proceso chico (todavía no cargó historial,
+ * índices ni nada) que se queda esperando pedidos en un socketpair. Para
+ * ejecutar un comando externo, en vez de hacer fork del shell (que con una
+ * sesión larga tiene mucha memoria, y fork tiene que copiar todas sus tablas
+ * de páginas) se le manda al zygote el argv, el envp y la ruta, y la entrada,
+ * la salida, el error y el directorio actual como file descriptors
+ * (SCM_RIGHTS). El zygote hace el fork y el exec, así que lo que tarda
+ * lanzar un comando no crece con la memoria del shell.
+ *
+ * El zygote crea los procesos con clone(CLONE_PARENT): quedan como hijos
+ * del shell, no del zygote, así que el shell los espera con wait como a los
+ * que crea con fork, y comparten su grupo de procesos.
+ *
+ * Solo el proceso que llamó a zygote_start puede usarlo (un hijo del shell
+ * que quiera lanzar comandos hace fork, como siempre), y solo desde un hilo
+ * a la vez. Si el zygote termina, zygote_spawn devuelve -1 y se vuelve a
+ * hacer fork.
+ */
+
+#ifndef _ZYGOTE_H_
+#define _ZYGOTE_H_
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Crea el zygote. Conviene llamarla antes de crear hilos o reservar mucha
+ * memoria.
+ * Returns: false si no se pudo (y zygote_spawn devuelve siempre -1)
+ */
+bool zygote_start(void);
+
+/*
+ * Termina el zygote, si existe, y espera a que salga.
+ */
+void zygote_stop(void);
+
+/*
+ * Indica si este proceso puede lanzar comandos con el zygote.
+ */
+bool zygote_available(void);
+
+/*
+ * Lanza un comando con el zygote, en el directorio actual.
+ *   path: ruta del ejecutable, o NULL para buscar argv[0] en el PATH de
+ *       envp
+ *   argv, envp: terminados en NULL
+ *   fds: los file descriptors que van a ser la entrada, la salida y el
+ *       error del comando (siguen siendo del llamador)
+ * Si el exec falla, el comando imprime el error y termina con
+ * ARGBATCH_EXEC_STATUS (argbatch.h), como si se hubiera hecho fork.
+ * Returns: el pid del comando (un hijo de este proceso), o -1 si no se pudo
+ *     usar el zygote
+ * Requires: argv != NULL && argv[0] != NULL && envp != NULL && fds != NULL
+ */
+pid_t zygote_spawn(const char* path, char* const argv[], char* const envp[],
+                   const int fds[3]);
+
+#endif